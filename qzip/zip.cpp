@@ -463,6 +463,7 @@ public:
     enum EntryType { Directory, File, Symlink };
 
     void addEntry(EntryType type, const QString &fileName, const QByteArray &contents);
+    void writeEntry(EntryType type, const ZipWriter::Entry &entry);
 };
 
 LocalFileHeader CentralFileHeader::toLocalHeader() const
@@ -580,61 +581,29 @@ void ZipWriterPrivate::addEntry(EntryType type, const QString &fileName, const Q
     ZDEBUG() << "adding" << entryTypes[type] <<":" << fileName.toUtf8().data() << (type == 2 ? QByteArray(" -> " + contents).constData() : "");
 #endif
 
+    writeEntry(type, ZipWriter::compress(fileName, contents, compressionPolicy));
+}
+
+void ZipWriterPrivate::writeEntry(EntryType type, const ZipWriter::Entry &entry)
+{
     if (! (device->isOpen() || device->open(QIODevice::WriteOnly))) {
         status = ZipWriter::FileOpenError;
         return;
     }
     device->seek(start_of_directory);
 
-    // don't compress small files
-    ZipWriter::CompressionPolicy compression = compressionPolicy;
-    if (compressionPolicy == ZipWriter::AutoCompress) {
-        if (contents.length() < 64)
-            compression = ZipWriter::NeverCompress;
-        else
-            compression = ZipWriter::AlwaysCompress;
-    }
-
     FileHeader header;
     memset(&header.h, 0, sizeof(CentralFileHeader));
     writeUInt(header.h.signature, 0x02014b50);
 
     writeUShort(header.h.version_needed, 0x14);
-    writeUInt(header.h.uncompressed_size, contents.length());
+    writeUInt(header.h.uncompressed_size, entry.size);
     writeMSDosDate(header.h.last_mod_file, QDateTime::currentDateTime());
-    QByteArray data = contents;
-    if (compression == ZipWriter::AlwaysCompress) {
-        writeUShort(header.h.compression_method, 8);
-
-       ulong len = contents.length();
-        // shamelessly copied form zlib
-        len += (len >> 12) + (len >> 14) + 11;
-        int res;
-        do {
-            data.resize(len);
-            res = deflate((uchar*)data.data(), &len, (const uchar*)contents.constData(), contents.length());
-
-            switch (res) {
-            case Z_OK:
-                data.resize(len);
-                break;
-            case Z_MEM_ERROR:
-                qWarning("QZip: Z_MEM_ERROR: Not enough memory to compress file, skipping");
-                data.resize(0);
-                break;
-            case Z_BUF_ERROR:
-                len *= 2;
-                break;
-            }
-        } while (res == Z_BUF_ERROR);
-    }
-// TODO add a check if data.length() > contents.length().  Then try to store the original and revert the compression method to be uncompressed
-    writeUInt(header.h.compressed_size, data.length());
-    uint crc_32 = ::crc32(0, 0, 0);
-    crc_32 = ::crc32(crc_32, (const uchar *)contents.constData(), contents.length());
-    writeUInt(header.h.crc_32, crc_32);
+    writeUShort(header.h.compression_method, entry.method);
+    writeUInt(header.h.compressed_size, entry.data.length());
+    writeUInt(header.h.crc_32, entry.crc);
 
-    header.file_name = fileName.toLocal8Bit();
+    header.file_name = entry.fileName.toLocal8Bit();
     if (header.file_name.size() > 0xffff) {
         qWarning("QZip: Filename too long, chopping it to 65535 characters");
         header.file_name = header.file_name.left(0xffff);
@@ -658,9 +627,10 @@ void ZipWriterPrivate::addEntry(EntryType type, const QString &fileName, const Q
     fileHeaders.append(header);
 
     LocalFileHeader h = header.h.toLocalHeader();
-    device->write((const char *)&h, sizeof(LocalFileHeader));
-    device->write(header.file_name);
-    device->write(data);
+    if (device->write((const char *)&h, sizeof(LocalFileHeader)) != qint64(sizeof(LocalFileHeader)) ||
+        device->write(header.file_name) != header.file_name.size() ||
+        device->write(entry.data) != entry.data.size())
+        status = ZipWriter::FileWriteError; // e.g. disk full
     start_of_directory = device->pos();
     dirtyFileTree = true;
 }
@@ -1161,6 +1131,73 @@ QFile::Permissions ZipWriter::creationPermissions() const
     return d->permissions;
 }
 
+/*!
+    Compresses \a contents for an entry called \a fileName using
+    \a policy, without touching any archive. Since this is where the
+    time goes it can be done on other threads, with the results added
+    in whatever order is wanted by addEntry().
+
+    \sa addEntry()
+*/
+ZipWriter::Entry ZipWriter::compress(const QString &fileName, const QByteArray &contents, CompressionPolicy policy)
+{
+    Entry entry;
+    entry.fileName = QDir::fromNativeSeparators(fileName);
+    entry.size = contents.length();
+
+    // don't compress small files
+    ZipWriter::CompressionPolicy compression = policy;
+    if (policy == ZipWriter::AutoCompress) {
+        if (contents.length() < 64)
+            compression = ZipWriter::NeverCompress;
+        else
+            compression = ZipWriter::AlwaysCompress;
+    }
+
+    entry.data = contents;
+    if (compression == ZipWriter::AlwaysCompress) {
+        entry.method = 8;
+
+       ulong len = contents.length();
+        // shamelessly copied form zlib
+        len += (len >> 12) + (len >> 14) + 11;
+        int res;
+        do {
+            entry.data.resize(len);
+            res = deflate((uchar*)entry.data.data(), &len, (const uchar*)contents.constData(), contents.length());
+
+            switch (res) {
+            case Z_OK:
+                entry.data.resize(len);
+                break;
+            case Z_MEM_ERROR:
+                qWarning("QZip: Z_MEM_ERROR: Not enough memory to compress file, skipping");
+                entry.data.resize(0);
+                break;
+            case Z_BUF_ERROR:
+                len *= 2;
+                break;
+            }
+        } while (res == Z_BUF_ERROR);
+    }
+// TODO add a check if data.length() > contents.length().  Then try to store the original and revert the compression method to be uncompressed
+    uint crc_32 = ::crc32(0, 0, 0);
+    entry.crc = ::crc32(crc_32, (const uchar *)contents.constData(), contents.length());
+
+    return entry;
+}
+
+/*!
+    Add a file compressed by compress() to the archive, with the
+    current creationPermissions.
+
+    \sa compress()
+*/
+void ZipWriter::addEntry(const Entry &entry)
+{
+    d->writeEntry(ZipWriterPrivate::File, entry);
+}
+
 /*!
     Add a file to the archive with \a data as the file contents.
     The file will be stored in the archive using the \a fileName which
@@ -1238,12 +1275,13 @@ void ZipWriter::close()
     //qDebug("QZip::close writing directory, %d entries", d->fileHeaders.size());
     d->device->seek(d->start_of_directory);
     // write new directory
+    bool ok = true;
     for (int i = 0; i < d->fileHeaders.size(); ++i) {
         const FileHeader &header = d->fileHeaders.at(i);
-        d->device->write((const char *)&header.h, sizeof(CentralFileHeader));
-        d->device->write(header.file_name);
-        d->device->write(header.extra_field);
-        d->device->write(header.file_comment);
+        ok &= d->device->write((const char *)&header.h, sizeof(CentralFileHeader)) == qint64(sizeof(CentralFileHeader));
+        ok &= d->device->write(header.file_name) == header.file_name.size();
+        ok &= d->device->write(header.extra_field) == header.extra_field.size();
+        ok &= d->device->write(header.file_comment) == header.file_comment.size();
     }
     int dir_size = d->device->pos() - d->start_of_directory;
     // write end of directory
@@ -1258,8 +1296,11 @@ void ZipWriter::close()
     writeUInt(eod.dir_start_offset, d->start_of_directory);
     writeUShort(eod.comment_length, d->comment.length());
 
-    d->device->write((const char *)&eod, sizeof(EndOfDirectory));
-    d->device->write(d->comment);
+    ok &= d->device->write((const char *)&eod, sizeof(EndOfDirectory)) == qint64(sizeof(EndOfDirectory));
+    ok &= d->device->write(d->comment) == d->comment.size();
+    QFileDevice *file = qobject_cast<QFileDevice*>(d->device);
+    if (file) ok &= file->flush();
+    if (!ok) d->status = FileWriteError;
     d->device->close();
 }
 
@@ -98,6 +98,17 @@ public:
 
     void addFile(const QString &fileName, const QByteArray &data);
 
+    class Entry {
+    public:
+        Entry() : crc(0), size(0), method(0) {}
+        QString fileName;
+        QByteArray data;    // as stored, compressed or not
+        uint crc, size;     // of the contents
+        ushort method;      // 0 stored, 8 deflated
+    };
+    static Entry compress(const QString &fileName, const QByteArray &contents, CompressionPolicy policy = AlwaysCompress);
+    void addEntry(const Entry &entry);
+
     void addFile(const QString &fileName, QIODevice *device);
 
     void addDirectory(const QString &dirName);
@@ -25,6 +25,7 @@
 
 #include "ANT.h"
 #include "ANTMessage.h"
+#include "ANTLogger.h" // for ANT_LOG_RECORD_SIZE
 #include "TrainSidebar.h" // for RT_MODE_{ERGO,SPIN,CALIBRATE}
 #include <QMessageBox>
 #include <QTime>
@@ -100,6 +101,7 @@ ANT::ANT(QObject *parent, DeviceConfiguration *devConf, QString athlete) : QThre
     deviceFilename = devConf ? devConf->portSpec : "";
     baud=115200;
     powerchannels=0;
+    powerPage = false;
     configuring = false;
 
     // kickr
@@ -126,10 +128,11 @@ ANT::ANT(QObject *parent, DeviceConfiguration *devConf, QString athlete) : QThre
     if (!elapsedTimer.isMonotonic())
         qDebug() << "Caution: ANT timer is not monotonic";
 
-    // state machine
-    state = ST_WAIT_FOR_SYNC;
-    length = bytes = 0;
-    checksum = ANT_SYNC_BYTE;
+    // receive buffer
+    rxCount = 0;
+
+    // not replaying
+    replaySpeed = 1;
 
     // ant ids - may not be configured of course
     if (devConf && devConf->deviceProfile.length())
@@ -246,9 +249,13 @@ void ANT::run()
 
     for (int i=0; i<ANT_MAX_CHANNELS; i++) antChannel[i]->init();
 
-    state = ST_WAIT_FOR_SYNC;
-    length = bytes = 0;
-    checksum = ANT_SYNC_BYTE;
+    rxCount = 0;
+
+    // replaying a log rather than talking to a stick
+    if (isReplay()) {
+        replay();
+        return;
+    }
 
     if (openPort() == 0) {
 
@@ -268,14 +275,14 @@ void ANT::run()
 
     while(1)
     {
-        // read more bytes from the device
-        uint8_t byte;
-
-        int rc = rawRead(&byte, 1);
+        // read whatever is available from the device, rawRead blocks
+        // for up to ANT_READ_TIMEOUT ms when there is nothing to read
+        int rc = rawRead(rxBuffer + rxCount, ANT_RX_BUFFER_SIZE - rxCount);
 
-        if (rc > 0)
-            receiveByte((unsigned char)byte);
-        else {
+        if (rc > 0) {
+            rxCount += rc;
+            frameMessages();
+        } else {
 
             // Recognise USB device removal. Linux transitions through -5 (I/O error)
             // to -6 (No such device or address). Windows seems to stick on -5
@@ -285,20 +292,16 @@ void ANT::run()
                 qDebug() << "Error communicating with USB ANT device!! Device removed?";
                 Status = 0;
             }
-
-            msleep(5);
         }
 
         //----------------------------------------------------------------------
         // LISTEN TO CONTROLLER FOR COMMANDS
         //----------------------------------------------------------------------
-        pvars.lock();
-        status = this->Status;
-        pvars.unlock();
+        status = Status.loadAcquire();
 
         // do we have a channel to search / stop
-        if (!channelQueue.isEmpty()) {
-            setChannelAtom x = channelQueue.dequeue();
+        setChannelAtom x;
+        while (channelQueue.dequeue(x)) {
             if (x.device_number == -1) antChannel[x.channel]->close(); // unassign
             else addDevice(x.device_number, x.channel_type, x.channel); // assign
         }
@@ -312,6 +315,105 @@ void ANT::run()
     }
 }
 
+/*======================================================================
+ * Replay of an antlog.raw written by ANTLogger
+ *====================================================================*/
+
+void
+ANT::setReplay(QString filename, double speed)
+{
+    replayFilename = filename;
+    replaySpeed = speed;
+
+    // pairing comes from the log not the device profile
+    antIDs.clear();
+}
+
+void
+ANT::replay()
+{
+    QFile log(replayFilename);
+    if (!log.open(QIODevice::ReadOnly)) {
+        qDebug() << "ANT replay: cannot open" << replayFilename;
+
+        // This wakes up start()
+        portInitDone.release();
+        quit(0);
+        return;
+    }
+
+    // the log may have come from a USB2 stick, so assume the most
+    channels = ANT_MAX_CHANNELS;
+
+    // This wakes up start()
+    portInitDone.release();
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 first = -1;
+
+    unsigned char record[ANT_LOG_RECORD_SIZE];
+    while (log.read((char*)record, ANT_LOG_RECORD_SIZE) == ANT_LOG_RECORD_SIZE) {
+
+        qint64 millis = 0;
+        for (int i=8; i>0; i--) millis = (millis << 8) | record[i];
+        if (first == -1) first = millis;
+
+        // wait till its due, keeping an eye on the controller as we go
+        qint64 due = replaySpeed > 0 ? (millis - first) / replaySpeed : 0;
+        do {
+            if (!(Status.loadAcquire()&ANT_RUNNING)) {
+                quit(0);
+                return;
+            }
+
+            // channel commands make no sense when replaying
+            setChannelAtom x;
+            while (channelQueue.dequeue(x)) ;
+
+            qint64 wait = due - clock.elapsed();
+            if (wait > 0) msleep(qMin(wait, qint64(ANT_READ_TIMEOUT)));
+            else break;
+
+        } while (1);
+
+        if (record[0] == 'R') {
+            memcpy(rxMessage, record + 9, ANT_MAX_MESSAGE_SIZE);
+            processMessage();
+        } else if (record[0] == 'S') {
+            replaySent(record + 9);
+        }
+    }
+
+    // end of the log, stay running so the controller
+    // doesn't think the device went away
+    while (Status.loadAcquire()&ANT_RUNNING) msleep(ANT_READ_TIMEOUT);
+    quit(0);
+}
+
+//
+// When we originally set the channel id we told the stick what type of device
+// we wanted on that channel, so we do the same and the state machine follows
+// the responses that were logged.
+//
+void
+ANT::replaySent(const unsigned char *message)
+{
+    if (message[ANT_OFFSET_ID] != ANT_CHANNEL_ID) return;
+
+    int channel = message[3];
+    int device_number = message[4] | (message[5] << 8);
+    int device_id = message[6];
+    if (channel < 0 || channel >= channels) return;
+
+    for (int i=0; ant_sensor_types[i].type != ANTChannel::CHANNEL_TYPE_GUARD; i++) {
+        if (ant_sensor_types[i].device_id == device_id && ant_sensor_types[i].type != ANTChannel::CHANNEL_TYPE_UNUSED) {
+            addDevice(device_number, ant_sensor_types[i].type, channel);
+            return;
+        }
+    }
+}
+
 void
 ANT::setLoad(double load)
 {
@@ -493,6 +595,12 @@ ANT::setup()
         return 0;
     }
 
+    // the log has the reset and pairing we did originally
+    if (isReplay()) {
+        ANT_Reset_Acknowledge = true;
+        return 0;
+    }
+
     uint8_t attempts = 0;
     do
     {
@@ -644,7 +752,11 @@ ANT::quit(int code)
 void
 ANT::getRealtimeData(RealtimeData &rtData)
 {
-    rtData = telemetry;
+    // a consistent copy of the last published, rather
+    // than reading telemetry whilst the thread updates it
+    TelemetrySample latest;
+    if (bus.latest(latest)) rtData = latest.data;
+    else rtData = telemetry;
     rtData.mode = mode;
     rtData.setLoad(load);
     rtData.setSlope(gradient);
@@ -942,6 +1054,9 @@ ANT::sendMessage(ANTMessage m) {
     unsigned char RS='S';
     emit sentAntMessage(RS, m, timestamp);
 
+    // nowhere to send it when replaying
+    if (isReplay()) return;
+
     rawWrite((uint8_t*)m.data, m.length);
 
     // this padding is important - do not remove it
@@ -949,54 +1064,52 @@ ANT::sendMessage(ANTMessage m) {
     rawWrite((uint8_t*)padding, 5);
 }
 
+//
+// Frame messages from the receive buffer; sync, length, id, data and
+// checksum. Anything that doesn't check out is skipped a byte at a time
+// until we find the next sync, and a partial message at the end is kept
+// for when the rest of it arrives.
+//
 void
-ANT::receiveByte(unsigned char byte) {
-
-    switch (state) {
-        case ST_WAIT_FOR_SYNC:
-            if (byte == ANT_SYNC_BYTE) {
-                state = ST_GET_LENGTH;
-                checksum = ANT_SYNC_BYTE;
-                rxMessage[0] = byte;
-            }
-            break;
+ANT::frameMessages()
+{
+    int i = 0;
+    while (i < rxCount) {
 
-        case ST_GET_LENGTH:
-            if ((byte == 0) || (byte > ANT_MAX_LENGTH)) {
-                state = ST_WAIT_FOR_SYNC;
-            }
-            else {
-              rxMessage[ANT_OFFSET_LENGTH] = byte;
-                checksum ^= byte;
-                length = byte;
-                bytes = 0;
-                state = ST_GET_MESSAGE_ID;
-            }
-            break;
+        // hunt for sync
+        if (rxBuffer[i] != ANT_SYNC_BYTE) {
+            i++;
+            continue;
+        }
 
-        case ST_GET_MESSAGE_ID:
-            rxMessage[ANT_OFFSET_ID] = byte;
-            checksum ^= byte;
-            state = ST_GET_DATA;
-            break;
+        // need the length to know how much to wait for
+        if (rxCount - i < 2) break;
+        int length = rxBuffer[i + ANT_OFFSET_LENGTH];
+        if (length == 0 || length > ANT_MAX_LENGTH) {
+            i++;
+            continue;
+        }
 
-        case ST_GET_DATA:
-            rxMessage[ANT_OFFSET_DATA + bytes] = byte;
-            checksum ^= byte;
-            if (++bytes >= length){
-                state = ST_VALIDATE_PACKET;
-            }
-            break;
+        // sync, length, id, data and checksum
+        int total = length + 4;
+        if (rxCount - i < total) break;
 
-        case ST_VALIDATE_PACKET:
-            if (checksum == byte){
-                processMessage();
-            }
-            state = ST_WAIT_FOR_SYNC;
-            break;
+        unsigned char checksum = 0;
+        for (int k=0; k<total-1; k++) checksum ^= rxBuffer[i+k];
+        if (checksum != rxBuffer[i + total - 1]) {
+            i++;
+            continue;
+        }
+
+        memcpy(rxMessage, rxBuffer + i, total - 1);
+        processMessage();
+        i += total;
     }
-}
 
+    // keep what we haven't used yet
+    rxCount -= i;
+    if (rxCount > 0) memmove(rxBuffer, rxBuffer + i, rxCount);
+}
 
 //
 // Pass inbound message to channel for handling
@@ -1031,9 +1144,16 @@ ANT::processMessage(void) {
             break;
         case ANT_ACK_DATA:
         case ANT_BROADCAST_DATA:
+        case ANT_BURST_DATA:
+            handleChannelEvent();
+
+            // publish at device rate, marking the power samples
+            bus.publish(telemetry, powerPage);
+            powerPage = false;
+            break;
+
         case ANT_CHANNEL_STATUS:
         case ANT_CHANNEL_ID:
-        case ANT_BURST_DATA:
             handleChannelEvent();
             break;
 
@@ -1260,11 +1380,16 @@ int ANT::rawRead(uint8_t bytes[], int size)
     switch (usbMode) {
 #ifdef GC_HAVE_USBXPRESS
     case USB1:
-        return USBXpress::read(&devicePort, bytes, size);
+        {
+            // USBXpress doesn't block so don't spin when there is nothing to read
+            int rc = USBXpress::read(&devicePort, bytes, size);
+            if (rc <= 0) msleep(5);
+            return rc;
+        }
         break;
 #endif
     case USB2:
-        return usb2->read((char *)bytes, size);
+        return usb2->read((char *)bytes, size, ANT_READ_TIMEOUT);
         break;
     default:
         break;
@@ -1277,20 +1402,25 @@ int ANT::rawRead(uint8_t bytes[], int size)
 
 #ifdef GC_HAVE_LIBUSB
     if (usbMode == USB2) {
-        return usb2->read((char *)bytes, size);
+        // bulk read, blocks until data arrives or it times out
+        return usb2->read((char *)bytes, size, ANT_READ_TIMEOUT);
     }
 #endif
-    int i=0;
-    uint8_t byte;
-
-    // read one byte at a time sleeping when no data ready
-    // until we timeout waiting then return error
-    for (i=0; i<size; i++) {
-        int rc = read(devicePort, &byte, 1);
-        if (rc == -1 || rc == 0) return -1; // error!
-        else bytes[i] = byte;
-    }
-    return i;
+
+    // wait for the port to become readable then take all that's there
+    struct pollfd fds;
+    fds.fd = devicePort;
+    fds.events = POLLIN;
+    fds.revents = 0;
+
+    int rc = poll(&fds, 1, ANT_READ_TIMEOUT);
+    if (rc == 0) return 0; // timed out, nothing to read
+    if (rc < 0) return errno == EINTR ? 0 : -errno;
+    if (fds.revents & (POLLERR | POLLHUP | POLLNVAL)) return -ENXIO; // device gone
+
+    rc = read(devicePort, bytes, size);
+    if (rc < 0) return (errno == EAGAIN || errno == EINTR) ? 0 : -errno;
+    return rc;
 
 #endif
     return -1; // keep compiler happy.
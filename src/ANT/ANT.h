@@ -26,6 +26,7 @@
 #include "GoldenCheetah.h"
 #include "RealtimeData.h"
 #include "CalibrationData.h"
+#include "TelemetryBus.h"
 #include "DeviceConfiguration.h"
 
 //
@@ -42,6 +43,7 @@
 #include <QProgressDialog>
 #include <QFile>
 #include <QSemaphore>
+#include <QAtomicInt>
 
 //
 // Time
@@ -71,6 +73,7 @@
 #include <termios.h> // unix!!
 #include <unistd.h> // unix!!
 #include <sys/ioctl.h>
+#include <poll.h>
 #ifndef N_TTY // for OpenBSD
 #define N_TTY 0
 #endif
@@ -140,6 +143,38 @@ struct setChannelAtom {
     int channel_type;
 };
 
+// Single producer, single consumer queue used to hand channel commands from
+// the controller to the ANT thread without either side taking a lock. The
+// controller is the only producer and the ANT thread the only consumer.
+template <typename T, int N>
+class ANTCommandQueue {
+public:
+    ANTCommandQueue() : head(0), tail(0) {}
+
+    // controller side, false if full
+    bool enqueue(const T &x) {
+        int t = tail.loadAcquire();
+        int next = (t + 1) % N;
+        if (next == head.loadAcquire()) return false;
+        atoms[t] = x;
+        tail.storeRelease(next);
+        return true;
+    }
+
+    // ANT thread side, false if empty
+    bool dequeue(T &x) {
+        int h = head.loadAcquire();
+        if (h == tail.loadAcquire()) return false;
+        x = atoms[h];
+        head.storeRelease((h + 1) % N);
+        return true;
+    }
+
+private:
+    T atoms[N];
+    QAtomicInt head, tail;
+};
+
 //======================================================================
 // ANT Constants
 //======================================================================
@@ -210,6 +245,8 @@ struct setChannelAtom {
 #define ANT_KEY_LENGTH       8
 #define ANT_MAX_BURST_DATA   8
 #define ANT_MAX_MESSAGE_SIZE 12
+#define ANT_RX_BUFFER_SIZE   256
+#define ANT_READ_TIMEOUT     125 // ms to block waiting for data
 #define ANT_MAX_CHANNELS     8
 
 // Channel messages
@@ -444,7 +481,9 @@ public slots:
     bool isConfiguring() { return configuring; }
     void setConfigurationMode(bool x) { configuring = x; }
     void setChannel(int channel, int device_number, int channel_type) {
-        channelQueue.enqueue(setChannelAtom(channel, device_number, channel_type));
+        // the ANT thread drains the queue at least every read timeout
+        while (!channelQueue.enqueue(setChannelAtom(channel, device_number, channel_type)))
+            QThread::yieldCurrentThread();
     }
     bool find();                              // find usb device
     bool discover(QString name);              // confirm Server available at portSpec
@@ -463,6 +502,7 @@ public slots:
 
     // get telemetry
     void getRealtimeData(RealtimeData &);             // return current realtime data
+    TelemetryBus *telemetryBus() { return &bus; }     // published as it arrives
 
     // kickr command loading - only ANT device we know about to do this so not generic
     void setLoad(double);
@@ -497,7 +537,7 @@ public:
 
     // transmission
     void sendMessage(ANTMessage);
-    void receiveByte(unsigned char byte);
+    void frameMessages();
     void handleChannelEvent(void);
     void processMessage(void);
 
@@ -585,6 +625,11 @@ public:
     // serial i/o lifted from Computrainer.cpp
     void setDevice(QString devname);
     void setBaud(int baud);
+
+    // replay an antlog.raw instead of talking to a stick, speed
+    // is a multiple of real time with 0 meaning as fast as possible
+    void setReplay(QString filename, double speed);
+    bool isReplay() const { return !replayFilename.isEmpty(); }
     int openPort();
     int closePort();
     int rawRead(uint8_t bytes[], int size);
@@ -626,6 +671,7 @@ public:
 
     void setWatts(float x) {
         telemetry.setWatts(x);
+        powerPage = true;
     }
     void setAltWatts(float x) {
         telemetry.setAltWatts(x);
@@ -677,10 +723,12 @@ private:
     void run();
 
     RealtimeData telemetry;
+    TelemetryBus bus; // telemetry is published after each data message
+    bool powerPage; // the message being handled was a power data page
     CalibrationData calibration;
 
     QMutex pvars;  // lock/unlock access to telemetry data between thread and controller
-    int Status;     // what status is the client in?
+    QAtomicInt Status; // what status is the client in? read by the thread without locking
     bool configuring; // set to true if we're in configuration mode.
     int channels;  // how many 4 or 8 ? depends upon the USB stick...
 
@@ -710,18 +758,16 @@ private:
     bool ANT_Reset_Acknowledge;
     unsigned char rxMessage[ANT_MAX_MESSAGE_SIZE];
 
-    // state machine whilst receiving bytes
-    enum States {ST_WAIT_FOR_SYNC, ST_GET_LENGTH, ST_GET_MESSAGE_ID, ST_GET_DATA, ST_VALIDATE_PACKET} state;
-    //enum States state;
-    int length;
-    int bytes;
-    int checksum;
+    // bytes read from the stick in bulk, messages are framed from here
+    // and any partial message is kept until the rest arrives
+    unsigned char rxBuffer[ANT_RX_BUFFER_SIZE];
+    int rxCount;
     int powerchannels; // how many power channels do we have?
     QDateTime lastCadenceMessage;
 
     QElapsedTimer elapsedTimer;
 
-    QQueue<setChannelAtom> channelQueue; // messages for configuring channels from controller
+    ANTCommandQueue<setChannelAtom, 64> channelQueue; // messages for configuring channels from controller
 
     // generic trainer settings
     double currentLoad, load;
@@ -745,6 +791,12 @@ private:
 
     // athlete for wheelsize settings, etc.
     QString trainAthlete;
+
+    // replaying a log
+    void replay();
+    void replaySent(const unsigned char *message);
+    QString replayFilename;
+    double replaySpeed;
 };
 
 #include "ANTMessage.h"
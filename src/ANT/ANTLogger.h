@@ -24,6 +24,10 @@
 #ifndef ANTLOGGER_H
 #define ANTLOGGER_H
 
+// each record in antlog.raw is 'R' or 'S' for received or sent, the time in
+// milliseconds since the epoch as 8 bytes little endian, then the message
+#define ANT_LOG_RECORD_SIZE (1 + 8 + ANT_MAX_MESSAGE_SIZE)
+
 class ANTLogger : public QObject
 {
     Q_OBJECT
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2020 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ANTReplayController.h"
+#include "ANT.h"
+
+ANTReplayController::ANTReplayController(TrainSidebar *parent, DeviceConfiguration *dc) : ANTlocalController(parent, dc)
+{
+    // for Device Pairing the controller is called with dc = NULL
+    if (dc) {
+        double speed = dc->deviceProfile.trimmed().isEmpty() ? 1.0 : dc->deviceProfile.toDouble();
+        myANTlocal->setReplay(dc->portSpec, speed);
+    }
+}
+
+int
+ANTReplayController::start()
+{
+    // no stick to worry about and we don't log, we
+    // might be replaying the athlete's antlog.raw !
+    myANTlocal->start();
+    myANTlocal->setup();
+    return 0;
+}
+
+// nothing to scan for, the log is entered as the port when adding
+bool ANTReplayController::find() { return true; }
+bool ANTReplayController::discover(QString) { return true; }
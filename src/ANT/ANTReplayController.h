@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2020 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "GoldenCheetah.h"
+#include "ANTlocalController.h"
+
+#ifndef _GC_ANTReplayController_h
+#define _GC_ANTReplayController_h 1
+
+// Plays back an antlog.raw recorded by ANTLogger through the ANT message
+// handling and channels, so train mode can be exercised without any hardware.
+//
+// The port is the path to the log and the device profile is the replay speed
+// as a multiple of real time (blank for real time, 0 for as fast as possible).
+// Configure more than one to replay several logs side by side.
+class ANTReplayController : public ANTlocalController
+{
+    Q_OBJECT
+
+public:
+    ANTReplayController (TrainSidebar *parent =0, DeviceConfiguration *dc =0);
+
+    int start();
+
+    bool find();
+    bool discover(QString name);
+};
+
+#endif // _GC_ANTReplayController_h
@@ -60,6 +60,7 @@ public:
     bool doesPush(), doesPull(), doesLoad();
     void getRealtimeData(RealtimeData &rtData);
     void pushRealtimeData(RealtimeData &rtData);
+    TelemetryBus *telemetryBus() { return myANTlocal->telemetryBus(); }
 
     // now with the kickr we can control trainers
     void setLoad(double);
@@ -18,6 +18,7 @@
  */
 
 #include "AllPlot.h"
+#include "Trace.h"
 #include "Context.h"
 #include "Athlete.h"
 #include "AllPlotWindow.h"
@@ -5426,6 +5427,8 @@ AllPlot::setDataFromObject(AllPlotObject *object, AllPlot *reference)
 void
 AllPlot::setDataFromRide(RideItem *_rideItem, QList<UserData*>user)
 {
+    GC_TRACE("AllPlot::setDataFromRide");
+
     rideItem = _rideItem;
     if (_rideItem == NULL) return;
 
@@ -20,6 +20,7 @@
  */
 
 #include "Athlete.h"
+#include "Trace.h"
 #include "Zones.h"
 #include "Colors.h"
 #include "CPPlot.h"
@@ -156,6 +157,8 @@ CPPlot::setAxisTitle(int axis, QString label)
 void
 CPPlot::setDateRange(const QDate &start, const QDate &end, bool stale)
 {
+    GC_TRACE("CPPlot::setDateRange");
+
 
     // wipe out current - calculate will reinstate
     QDate istart = (start == QDate()) ? QDate(1900, 1, 1) : start;
@@ -1971,6 +1974,8 @@ CPPlot::plotRide(RideItem *rideItem)
 void
 CPPlot::setRide(RideItem *rideItem)
 {
+    GC_TRACE("CPPlot::setRide");
+
     // null ride ?
     if (!rideItem) return;
 
@@ -25,6 +25,7 @@
 #include "Utils.h"
 
 #include <limits>
+#include <cmath>
 
 // used to format dates/times on axes
 QString GenericPlot::gl_dateformat = QString("dd MMM yy");
@@ -356,6 +357,13 @@ GenericPlot::plotAreaChanged()
     }
 }
 
+GenericPlot::~GenericPlot()
+{
+    // quadtrees only reference these
+    qDeleteAll(treecache);
+    treecache.clear();
+}
+
 bool
 GenericPlot::initialiseChart(QString title, int type, bool animate, int legpos)
 {
@@ -369,8 +377,10 @@ GenericPlot::initialiseChart(QString title, int type, bool animate, int legpos)
     foreach(QLabel *label, labels) delete label;
     labels.clear();
 
-    foreach(Quadtree *tree, quadtrees) delete tree;
+    // trees are kept in treecache so unchanged series
+    // don't need to be re-indexed, see addCurve()
     quadtrees.clear();
+    scatterdata.clear();
 
     foreach(GenericAxisInfo *axisinfo, axisinfos) delete axisinfo;
     axisinfos.clear();
@@ -630,32 +640,39 @@ GenericPlot::addCurve(QString name, QVector<double> xseries, QVector<double> yse
             add->setOpacity(double(opacity) / 100.0); // 0-100% to 0.0-1.0 values
 
             // data
-            GenericCalculator calc; // watching as we add
-            for (int i=0; i<xseries.size() && i<yseries.size(); i++) {
-                add->append(xseries.at(i), yseries.at(i));
+            int n = qMin(xseries.size(), yseries.size());
+            for (int i=0; i<n; i++) {
 
                 // tell axis about the data
                 xaxis->point(xseries.at(i), yseries.at(i));
                 yaxis->point(xseries.at(i), yseries.at(i));
-
-                // calculate stuff
-                calc.addPoint(QPointF(xseries.at(i), yseries.at(i)));
-
             }
 
+            // points are binned once the axis ranges are known, see finaliseChart()
+            GenericScatterData data;
+            data.x = xseries;
+            data.y = yseries;
+            data.xaxis = xaxis;
+            data.yaxis = yaxis;
+            scatterdata.insert(add, data);
+
             if (datalabels) {
                 add->setPointLabelsVisible(true);    // is false by default
                 add->setPointLabelsColor(QColor(color));
                 add->setPointLabelsFormat("@yPoint");
             }
 
-            // set the quadtree up - now we know the ranges...
-            Quadtree *tree = new Quadtree(QPointF(calc.x.min, calc.y.min), QPointF(calc.x.max, calc.y.max));
-            for (int i=0; i<xseries.size() && i<yseries.size(); i++)
-                if (xseries.at(i) != 0 && yseries.at(i) != 0) // 0,0 is common and lets ignore (usually means no data)
-                    tree->insert(QPointF(xseries.at(i), yseries.at(i)));
-
-            if (tree->nodes.count() || tree->root->contents.count()) quadtrees.insert(add, tree);
+            // set the quadtree up, but only re-index if the data changed
+            // this is all the samples, not just the binned points
+            Quadtree *tree = treecache.value(name, NULL);
+            if (tree == NULL) {
+                tree = new Quadtree();
+                treecache.insert(name, tree);
+                tree->build(xseries, yseries);
+            } else if (tree->fingerprint() != Quadtree::fingerprint(xseries, yseries)) {
+                tree->build(xseries, yseries);
+            }
+            if (tree->count()) quadtrees.insert(add, tree);
 
             // hardware support?
             chartview->setRenderHint(QPainter::Antialiasing);
@@ -773,12 +790,71 @@ GenericPlot::addCurve(QString name, QVector<double> xseries, QVector<double> yse
     return true;
 }
 
+// when there are more points than the canvas can resolve we bin them
+// to a raster of marker sized cells and only plot one point per cell
+// the plot looks the same, but qt charts doesn't grind to a halt
+// the raster covers the visible axis ranges so a fixed axis that
+// zooms into the data still gets full resolution where it is shown
+static int
+rastercell(double v, double min, double max, bool log, int cells)
+{
+    if (log) {
+        if (v <= 0 || min <= 0) return -1;
+        v = log10(v); max = log10(max); min = log10(min);
+    }
+    if (v < min || v > max) return -1;
+    return qBound(0, int((v - min) / (max - min) * (cells-1)), cells-1);
+}
+
+void
+GenericPlot::rasterise(QScatterSeries *series, const GenericScatterData &data)
+{
+    int n = qMin(data.x.size(), data.y.size());
+
+    QRectF area = qchart->plotArea();
+    if (area.isEmpty()) area = QRectF(QPointF(0,0), chartview->size());
+    double cell = qMax(1.0, series->markerSize() / 2.0);
+    int cols = qMax(1, int(area.width() / cell));
+    int rows = qMax(1, int(area.height() / cell));
+    double minx = data.xaxis->min(), maxx = data.xaxis->max();
+    double miny = data.yaxis->min(), maxy = data.yaxis->max();
+
+    QVector<QPointF> points;
+    if (n > cols * rows && maxx > minx && maxy > miny) {
+
+        QVector<bool> raster(cols * rows, false);
+        for (int i=0; i<n; i++) {
+            int c = rastercell(data.x.at(i), minx, maxx, data.xaxis->log, cols);
+            int r = rastercell(data.y.at(i), miny, maxy, data.yaxis->log, rows);
+            if (c < 0 || r < 0) continue; // not visible
+            if (raster[r*cols + c]) continue;
+            raster[r*cols + c] = true;
+            points.append(QPointF(data.x.at(i), data.y.at(i))); // real values for hover
+        }
+
+    } else {
+
+        points.reserve(n);
+        for (int i=0; i<n; i++) points.append(QPointF(data.x.at(i), data.y.at(i)));
+    }
+    series->replace(points); // much faster than append point by point
+}
+
 // once python script has run polish the chart, fixup axes/ranges and so on.
 void
 GenericPlot::finaliseChart()
 {
     if (!qchart) return;
 
+    // drop cached quadtrees for series that went away
+    foreach(QString name, treecache.keys()) {
+        Quadtree *tree = treecache.value(name);
+        if (quadtrees.key(tree, NULL) == NULL) {
+            treecache.remove(name);
+            delete tree;
+        }
+    }
+
     // clear ALL axes
     foreach(QAbstractAxis *axis, qchart->axes(Qt::Vertical)) {
         qchart->removeAxis(axis);
@@ -918,6 +994,13 @@ GenericPlot::finaliseChart()
         }
     }
 
+    // now the axis ranges are known we can bin the scatter points
+    QMapIterator<QAbstractSeries*, GenericScatterData> it(scatterdata);
+    while (it.hasNext()) {
+        it.next();
+        rasterise(static_cast<QScatterSeries*>(it.key()), it.value());
+    }
+
     if (charttype == GC_CHART_SCATTER || charttype == GC_CHART_LINE) {
 
         bool havexaxis=false;
@@ -56,6 +56,13 @@ class GenericLegend;
 class GenericSelectTool;
 class GenericAxisInfo;
 
+// all the data behind a scatter series, the series itself only
+// holds the points left over after binning, see rasterise()
+struct GenericScatterData {
+    QVector<double> x, y;
+    GenericAxisInfo *xaxis, *yaxis;
+};
+
 // the chart
 class GenericPlot : public QWidget {
 
@@ -71,6 +78,7 @@ class GenericPlot : public QWidget {
         friend class GenericLegend;
 
         GenericPlot(QWidget *parent, Context *context);
+        ~GenericPlot();
 
         // some helper functions
         static QColor seriesColor(QAbstractSeries* series);
@@ -136,14 +144,22 @@ class GenericPlot : public QWidget {
         GenericLegend *legend;
         QStringList havelegend;
 
-        // quadtrees
+        // quadtrees, owned by treecache and reused across refreshes
+        // when the series data has not changed (keyed by curve name)
         QMap<QAbstractSeries*, Quadtree*> quadtrees;
+        QMap<QString, Quadtree*> treecache;
+
+        // full data for scatter series, selection stats use this
+        QMap<QAbstractSeries*, GenericScatterData> scatterdata;
 
 
         // annotation labels
         QList<QLabel *> labels;
 
     private:
+        // bin scatter points to the visible axis ranges
+        void rasterise(QScatterSeries *series, const GenericScatterData &data);
+
         Context *context;
         int charttype;
 
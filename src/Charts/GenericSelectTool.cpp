@@ -617,12 +617,9 @@ GenericSelectTool::moved(QPointF pos)
                     QRectF vrect(host->qchart->mapToValue(srect.topLeft(),series), host->qchart->mapToValue(srect.bottomRight(),series));
                     //QPointF vpos = host->qchart->mapToValue(pos, series);
 
-                    // find candidates all close by using paint co-ords
-                    QList<QPointF> tohere;
-                    tree->candidates(vrect, tohere);
-
+                    // check candidates all close by using paint co-ords
                     QPointF cursorpos=mapFromScene(pos);
-                    foreach(QPointF p, tohere) {
+                    tree->visit(vrect, [&](const QPointF &p) {
                         QPointF scpos = mapFromScene(host->qchart->mapToPosition(p, series));
                         if (hoverpoint == QPointF()) {
                             hoverpoint = scpos;
@@ -633,9 +630,8 @@ GenericSelectTool::moved(QPointF pos)
                             hoverseries = series;
                             hoverv = p;
                         }
-                    }
+                    });
 
-                    //if (tohere.count())  fprintf(stderr, "HOVER %d candidates nearby\n", tohere.count()); fflush(stderr);
                 }
 
             }
@@ -1095,13 +1091,23 @@ GenericSelectTool::updateScene()
                     calc.xaxis = xaxis;
                     calc.yaxis = yaxis;
                     calc.series = scatter;
+
+                    // the series only holds the binned points, so
+                    // stats are calculated from all of the data
+                    GenericScatterData data = host->scatterdata.value(scatter);
+                    int n = qMin(data.x.size(), data.y.size());
+                    for(int i=0; i<n; i++) {
+                        double px = data.x.at(i), py = data.y.at(i);
+                        if (py >= miny && py <= maxy && px >= minx && px <= maxx)
+                            calc.addPoint(QPointF(px, py));
+                    }
+
+                    // but the selection curve only needs what is plotted
                     for(int i=0; i<scatter->count(); i++) {
                         QPointF point = scatter->at(i); // avoid deep copy
                         if (point.y() >= miny && point.y() <= maxy &&
-                            point.x() >= minx && point.x() <= maxx) {
-                            if (!points.contains(point)) points << point; // avoid dupes
-                            calc.addPoint(point);
-                        }
+                            point.x() >= minx && point.x() <= maxx)
+                            points << point; // binned, so no dupes
                     }
                     calc.finalise();
                     stats.insert(scatter, calc);
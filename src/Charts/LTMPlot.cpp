@@ -17,6 +17,7 @@
  */
 
 #include "Athlete.h"
+#include "Trace.h"
 #include "Context.h"
 #include "LTMPlot.h"
 #include "LTMTool.h"
@@ -223,6 +224,8 @@ LTMPlot::setAxisTitle(QwtAxisId axis, QString label)
 void
 LTMPlot::setData(LTMSettings *set)
 {
+    GC_TRACE("LTMPlot::setData");
+
     QTime timer;
     timer.start();
 
@@ -18,6 +18,7 @@
  */
 
 #include "PfPvPlot.h"
+#include "Trace.h"
 #include "Athlete.h"
 #include "Context.h"
 #include "RideFile.h"
@@ -507,6 +508,8 @@ PfPvPlot::refreshIntervalMarkers()
 void
 PfPvPlot::setData(RideItem *_rideItem)
 {
+    GC_TRACE("PfPvPlot::setData");
+
     if (context->isCompareIntervals) return;
 
     // clear out any interval curves which are presently defined
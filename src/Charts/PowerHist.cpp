@@ -18,6 +18,7 @@
  */
 
 #include "PowerHist.h"
+#include "Trace.h"
 #include "MainWindow.h"
 #include "Context.h"
 #include "Athlete.h"
@@ -1299,6 +1300,8 @@ longFromDouble(QVector<unsigned int>&here, QVector<double>&there)
 void
 PowerHist::setData(RideFileCache *cache)
 {
+    GC_TRACE("PowerHist::setData");
+
     source = Cache;
     this->cache = cache;
     dt = 1.0f / 60.0f; // rideFileCache is normalised to 1secs
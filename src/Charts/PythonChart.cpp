@@ -23,6 +23,7 @@
 #include "Colors.h"
 #include "TabView.h"
 #include "RideFileCommand.h"
+#include "RideResidency.h"
 
 #include <QtConcurrent>
 
@@ -200,6 +201,7 @@ void PythonConsole::keyPressEvent(QKeyEvent *e)
                 bool readOnly = pythonHost->readOnly();
                 QList<RideFile *> editedRideFiles;
                 python->cancelled = false;
+                RideResidencyHold hold(context);
                 python->runline(ScriptContext(context, nullptr, true, readOnly, &editedRideFiles), line);
 
                 // finish up commands on edited rides
@@ -602,7 +604,8 @@ PythonChart::runScript()
             // replace $$ with chart identifier (to avoid shared data)
             line = line.replace("$$", console->chartid);
 
-            // run it
+            // run it, scripts can get at any ride
+            RideResidencyHold hold(context);
             QFutureWatcher<void>watcher;
             QFuture<void>f= QtConcurrent::run(execScript,this);
 
@@ -22,6 +22,7 @@
 
 #include "Colors.h"
 #include "TabView.h"
+#include "RideResidency.h"
 #include "GenericChart.h"
 
 // unique identifier for each chart
@@ -194,6 +195,7 @@ void RConsole::keyPressEvent(QKeyEvent *e)
                 SEXP ret = NULL;
 
                 rtool->cancelled = false;
+                RideResidencyHold hold(rtool->context);
                 int rc = rtool->R->parseEval(line, ret);
 
                 // if this isn't an assignment then print the result
@@ -548,7 +550,8 @@ RChart::runScript()
             // replace $$ with chart identifier (to avoid shared data)
             line = line.replace("$$", console->chartid);
 
-            // run it
+            // run it, scripts can get at any ride
+            RideResidencyHold hold(context);
             rtool->R->parseEval(line);
 
             // output on console
@@ -17,6 +17,7 @@
  */
 
 #include "RideSummaryWindow.h"
+#include "Trace.h"
 
 #include "Context.h"
 #include "Athlete.h"
@@ -269,6 +270,8 @@ RideSummaryWindow::refresh(QDate past)
 void
 RideSummaryWindow::refresh()
 {
+    GC_TRACE("RideSummaryWindow::refresh");
+
     if ((ridesummary && firstload && myRideItem==NULL) || !amVisible()) return; // only if you can see me!
     firstload = false;
 
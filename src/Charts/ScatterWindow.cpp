@@ -17,6 +17,7 @@
  */
 
 #include "ScatterWindow.h"
+#include "Trace.h"
 #include "ScatterPlot.h"
 #include "GcOverlayWidget.h"
 #include "Athlete.h"
@@ -401,6 +402,8 @@ ScatterWindow::rySelectorChanged(int value)
 void
 ScatterWindow::setData()
 {
+    GC_TRACE("ScatterWindow::setData");
+
     settings.ride = ride;
     settings.x = xSelector->itemData(xSelector->currentIndex()).toInt();
     settings.y = ySelector->itemData(ySelector->currentIndex()).toInt();
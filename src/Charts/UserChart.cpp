@@ -17,6 +17,7 @@
  */
 
 #include "UserChart.h"
+#include "Trace.h"
 
 #include "Colors.h"
 #include "TabView.h"
@@ -102,6 +103,8 @@ UserChart::chartConfigChanged()
 void
 UserChart::setRide(RideItem *item)
 {
+    GC_TRACE("UserChart::setRide");
+
     // not being shown so just ignore
     if (!amVisible()) { stale=true; return; }
 
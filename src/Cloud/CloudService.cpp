@@ -24,16 +24,18 @@
 #include "MainWindow.h"
 #include "JsonRideFile.h"
 #include "CsvRideFile.h"
+#include "TcxRideFile.h"
 #include "Colors.h"
 #include "Units.h"
-#include "DataProcessor.h"  // to run auto data processors
-#include "RideMetadata.h"   // for linked defaults processing
+#include "RideImportPipeline.h" // data processors and linked defaults, as an import does
+#include "CloudTransferScheduler.h"
 
 #include <QIcon>
 #include <QFileIconProvider>
 #include <QMessageBox>
 #include <QHeaderView>
 #include <QDesktopWidget>
+#include <QBuffer>
 
 #include "../qzip/zipwriter.h"
 #include "../qzip/zipreader.h"
@@ -175,11 +177,6 @@ static QByteArray gUncompress(const QByteArray &data)
 void
 CloudService::compressRide(RideFile*ride, QByteArray &data, QString name)
 {
-    // compress via a temporary file
-    QTemporaryFile tempfile;
-    tempfile.open();
-    tempfile.close();
-
     // write as file type requested
     QString spec;
     switch(filetype) {
@@ -191,41 +188,56 @@ CloudService::compressRide(RideFile*ride, QByteArray &data, QString name)
         case CSV: spec="csv"; break;
     }
 
-    QFile jsonFile(tempfile.fileName());
-    bool result;
+    bool result = true;
+
+    if (spec == "json") {
+
+        // in memory, with the BOM the file writer adds
+        JsonFileReader writer;
+        data = QByteArray("\xEF\xBB\xBF") + writer.toByteArray(ride->context, ride, true, true, true, true);
+
+    } else if (spec == "tcx") {
+
+        TcxFileReader writer;
+        data = writer.toByteArray(ride->context, ride, true, true, true, true);
 
-    if (spec == "csv") {
-        CsvFileReader writer;
-        result = writer.writeRideFile(ride->context, ride, jsonFile, CsvFileReader::gc);
     } else {
-        result = RideFileFactory::instance().writeRideFile(ride->context, ride, jsonFile, spec);
+
+        // the other writers only write files
+        QTemporaryFile tempfile;
+        tempfile.open();
+        tempfile.close();
+
+        QFile rideFile(tempfile.fileName());
+        if (spec == "csv") {
+            CsvFileReader writer;
+            result = writer.writeRideFile(ride->context, ride, rideFile, CsvFileReader::gc);
+        } else {
+            result = RideFileFactory::instance().writeRideFile(ride->context, ride, rideFile, spec);
+        }
+
+        if (result == true) {
+            rideFile.open(QFile::ReadOnly);
+            data = rideFile.readAll();
+            rideFile.close();
+        }
     }
 
     if (result == true) {
-        // read the ride file
-        jsonFile.open(QFile::ReadOnly);
-        data = jsonFile.readAll();
-        jsonFile.close();
 
         if (uploadCompression == zip) {
-            // create a temp zip file
-            QTemporaryFile zipFile;
-            zipFile.open();
-            zipFile.close();
 
-            // add files using zip writer
-            QString zipname = zipFile.fileName();
-            ZipWriter writer(zipname);
+            // zip into memory
+            QByteArray zipped;
+            QBuffer buffer(&zipped);
+            buffer.open(QIODevice::WriteOnly);
 
-            // add the ride file to the zip file
+            ZipWriter writer(&buffer);
             writer.addFile(name, data);
             writer.close();
 
-            // now read in the zipfile
-            QFile zip(zipname);
-            zip.open(QFile::ReadOnly);
-            data = zip.readAll();
-            zip.close();
+            data = zipped;
+
         } else if (uploadCompression == gzip) {
             data = gCompress(data);
         }
@@ -250,14 +262,11 @@ CloudService::uncompressRide(QByteArray *data, QString name, QStringList &errors
     // filename to indicate it. The file format must still be included
     // in the name e.g. .pwx.gz or .fit.zip
     if (name.endsWith(".zip")) {
-        // write out to a zip file first
-        QTemporaryFile zipfile;
-        zipfile.open();
-        zipfile.write(*data);
-        zipfile.close();
-
-        // open zip
-        ZipReader reader(zipfile.fileName());
+        // unzip from memory
+        QBuffer buffer(data);
+        buffer.open(QIODevice::ReadOnly);
+
+        ZipReader reader(&buffer);
         ZipReader::FileInfo info = reader.entryInfoAt(0);
         jsonData = reader.fileData(info.filePath);
         // name without the .zip
@@ -270,23 +279,9 @@ CloudService::uncompressRide(QByteArray *data, QString name, QStringList &errors
         jsonData = *data;
     }
 
-    // uncompress and write to tmp preserviing the file extension
-    QString tmp = context->athlete->home->temp().absolutePath() + "/" + QFileInfo(name).baseName() + "." + QFileInfo(name).suffix();
-
-    // uncompress and write a file
-    QFile file(tmp);
-    file.open(QFile::WriteOnly);
-    file.write(jsonData);
-    file.close();
-
-    // read the file in using the correct ridefile reader
-    RideFile *ride = RideFileFactory::instance().openRideFile(context, file, errors);
-
-    // remove temp
-    file.remove();
-
-    // return whatever we got
-    return ride;
+    // read using the correct ridefile reader, preserving the file extension,
+    // json is parsed in memory, anything else via a temporary file
+    return RideFileFactory::instance().openRideFile(context, QFileInfo(name).baseName() + "." + QFileInfo(name).suffix(), jsonData, errors);
 }
 
 QString
@@ -694,7 +689,7 @@ FolderNameDialog::FolderNameDialog(QWidget *parent) : QDialog(parent)
 }
 
 CloudServiceSyncDialog::CloudServiceSyncDialog(Context *context, CloudService *store)
-    : QDialog(context->mainWindow, Qt::Dialog), context(context), store(store), downloading(false), aborted(false)
+    : QDialog(context->mainWindow, Qt::Dialog), context(context), store(store), downloading(false), aborted(false), transfers(NULL)
 {
     setWindowTitle(tr("Synchronise ") + store->uiName());
     setMinimumSize(850 *dpiXFactor,450 *dpiYFactor);
@@ -732,10 +727,6 @@ CloudServiceSyncDialog::CloudServiceSyncDialog(Context *context, CloudService *s
     QVBoxLayout *uploadLayout = new QVBoxLayout(upload);
     QVBoxLayout *syncLayout = new QVBoxLayout(sync);
 
-    // notification when upload/download completes
-    connect (store, SIGNAL(writeComplete(QString,QString)), this, SLOT(completedWrite(QString,QString)));
-    connect (store, SIGNAL(readComplete(QByteArray*,QString,QString)), this, SLOT(completedRead(QByteArray*,QString,QString)));
-
     // combo box
     athleteCombo = new QComboBox(this);
     athleteCombo->addItem(context->athlete->cyclist);
@@ -1072,6 +1063,7 @@ CloudServiceSyncDialog::refreshClicked()
         rideListDown->setItemWidget(add, 4, exists);
         add->setTextAlignment(4, Qt::AlignCenter);
         add->setText(6, workouts[i]->id); // download_id
+        add->setData(6, Qt::UserRole, CloudTransferScheduler::version(workouts[i]->size, workouts[i]->modified));
 
         if (rideFiles.contains(targetnosuffix.mid(0,14))) exists->setChecked(true);
         else {
@@ -1109,6 +1101,7 @@ CloudServiceSyncDialog::refreshClicked()
             sync->setText(7, "");
 
             sync->setText(8, workouts[i]->id); // download_id
+            sync->setData(8, Qt::UserRole, CloudTransferScheduler::version(workouts[i]->size, workouts[i]->modified));
         }
     }
 
@@ -1312,6 +1305,7 @@ CloudServiceSyncDialog::downloadClicked()
         downloadButton->setText(tr("Download"));
         downloading=false;
         aborted=true;
+        if (transfers) transfers->abort();
         cancelButton->show();
         return;
     } else {
@@ -1327,7 +1321,6 @@ CloudServiceSyncDialog::downloadClicked()
     downloadcounter = 0;
     successful = 0;
     downloadtotal = 0;
-    listindex = 0;
 
     QTreeWidget *which = NULL;
     switch(tabs->currentIndex()) {
@@ -1351,178 +1344,105 @@ CloudServiceSyncDialog::downloadClicked()
         progressBar->setValue(0);
     }
 
-    // even if nothing to download this
-    // cleans up variables et al
-    sync = false;
-    switch(tabs->currentIndex()) {
-        case 0 : downloadNext(); break;
-        case 1 : uploadNext(); break;
-        case 2 : sync = true; syncNext(); break;
-    }
-}
-
-bool
-CloudServiceSyncDialog::syncNext()
-{
-    // the actual download/upload is kicked off using the uploader / downloader
-    // if in sync mode the completedRead / completedWrite functions
-    // just call completedSync to get the next Sync done
-    for (int i=listindex; i<rideListSync->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListSync->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)rideListSync->itemWidget(curr, 0);
-
-        if (check->isChecked()) {
-
-            listindex = i+1; // start from the next one
-
-            progressLabel->setText(QString(tr("Processed %1 of %2")).arg(downloadcounter).arg(downloadtotal));
-            if (curr->text(6) == tr("Download")) {
-                curr->setText(7, tr("Downloading"));
-                rideListSync->setCurrentItem(curr);
-
-                QByteArray *data = new QByteArray;
-                store->readFile(data, curr->text(1), curr->text(8)); // filename
-                QApplication::processEvents();
-
-            } else {
-                curr->setText(7, tr("Uploading"));
-                rideListSync->setCurrentItem(curr);
-
-                // read in the file
-                QStringList errors;
-                QFile file(context->athlete->home->activities().canonicalPath() + "/" + curr->text(1));
-                RideFile *ride = RideFileFactory::instance().openRideFile(context, file, errors);
-
-                if (ride) {
-
-                    // get a compressed version
-                    QByteArray data;
-                    store->compressRide(ride, data, QFileInfo(curr->text(1)).baseName() + ".json");
-
-                    store->writeFile(data, QFileInfo(curr->text(1)).baseName() + store->uploadExtension(), ride);
-                    QApplication::processEvents();
-                    delete ride; // clean up!
-                    return true;
-
-                } else {
-                    curr->setText(7, tr("Parse failure"));
-                    QApplication::processEvents();
-                }
+    // a new run, but skip anything done by one that was interrupted
+    delete transfers;
+    transfers = new CloudTransferScheduler(context, store, this);
+    transfers->setStateFile(context->athlete->home->config().canonicalPath() + "/" + store->id().toLower().replace(" ", "") + "-transfers.txt");
+    connect(transfers, SIGNAL(started(int)), this, SLOT(transferStarted(int)));
+    connect(transfers, SIGNAL(downloaded(int,RideFile*,QStringList)), this, SLOT(transferDownloaded(int,RideFile*,QStringList)));
+    connect(transfers, SIGNAL(uploaded(int,bool,QString)), this, SLOT(transferUploaded(int,bool,QString)));
+    connect(transfers, SIGNAL(finished()), this, SLOT(transfersFinished()));
+    transferring.clear();
+    transferTab = tabs->currentIndex();
+    sync = (transferTab == 2);
+
+    QString activities = context->athlete->home->activities().canonicalPath() + "/";
+    int col = transferTab == 0 ? 5 : 7;
 
+    for (int i=0; i<which->invisibleRootItem()->childCount(); i++) {
+        QTreeWidgetItem *curr = which->invisibleRootItem()->child(i);
+        QCheckBox *check = (QCheckBox*)which->itemWidget(curr, 0);
+        if (!check->isChecked()) continue;
+
+        // sync always goes ahead, otherwise skip existing if overwrite not set
+        if (transferTab != 2) {
+            QCheckBox *exists = (QCheckBox*)which->itemWidget(curr, transferTab == 0 ? 4 : 6);
+            if (exists->isChecked() && !overwrite->isChecked()) {
+                curr->setText(col, tr("File exists"));
+                progressBar->setValue(++downloadcounter);
+                continue;
             }
-            return true;
         }
-    }
-
-    //
-    // Our work is done!
-    //
-    rideListDown->setSortingEnabled(true);
-    rideListUp->setSortingEnabled(true);
-    rideListSync->setSortingEnabled(true);
-    progressLabel->setText(tr("Sync complete"));
-    downloadButton->setText(tr("Synchronize"));
-    downloading=false;
-    aborted=false;
-    sync=false;
-    cancelButton->show();
-    selectAllSync->setChecked(Qt::Unchecked);
-    for (int i=0; i<rideListSync->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListSync->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)rideListSync->itemWidget(curr, 0);
-        check->setChecked(false);
-    }
-    progressLabel->setText(QString(tr("Processed %1 of %2 successfully")).arg(successful).arg(downloadtotal));
-
-    // save the ride cache, we don't want to lose that if we crash etc.
-    context->athlete->rideCache->save();
 
-    return false;
-}
+        bool download = (transferTab == 0 || (transferTab == 2 && curr->text(6) == tr("Download")));
+        QString remotename = download ? curr->text(1) : QFileInfo(curr->text(1)).baseName() + store->uploadExtension();
 
-bool
-CloudServiceSyncDialog::downloadNext()
-{
-    for (int i=listindex; i<rideListDown->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListDown->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)rideListDown->itemWidget(curr, 0);
-        QCheckBox *exists = (QCheckBox*)rideListDown->itemWidget(curr, 4);
+        // what we would transfer now
+        QString version;
+        if (download) version = curr->data(transferTab == 0 ? 6 : 8, Qt::UserRole).toString();
+        else {
+            QFileInfo local(activities + curr->text(1));
+            version = CloudTransferScheduler::version(local.size(), local.lastModified());
+        }
 
-        // skip existing if overwrite not set
-        if (check->isChecked() && exists->isChecked() && !overwrite->isChecked()) {
-            curr->setText(5, tr("File exists"));
+        // done before we were interrupted last time, and not changed since
+        if (!overwrite->isChecked() &&
+            transfers->transferredBefore(download ? CloudTransferScheduler::Download : CloudTransferScheduler::Upload, remotename, version)) {
+            curr->setText(col, tr("Already transferred"));
             progressBar->setValue(++downloadcounter);
+            successful++;
             continue;
         }
 
-        if (check->isChecked()) {
-
-            listindex = i+1; // start from the next one
-            curr->setText(5, tr("Downloading"));
-            rideListDown->setCurrentItem(curr);
-            progressLabel->setText(QString(tr("Downloaded %1 of %2")).arg(downloadcounter).arg(downloadtotal));
-
-            QByteArray *data = new QByteArray; // gets deleted when read completes
-            store->readFile(data, curr->text(1), curr->text(6));
-            QApplication::processEvents();
-            //delete data;
-            return true;
-        }
-    }
-
-    //
-    // Our work is done!
-    //
-    rideListDown->setSortingEnabled(true);
-    rideListUp->setSortingEnabled(true);
-    progressLabel->setText(tr("Downloads complete"));
-    downloadButton->setText(tr("Download"));
-    downloading=false;
-    aborted=false;
-    cancelButton->show();
-    selectAll->setChecked(Qt::Unchecked);
-    for (int i=0; i<rideListDown->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListDown->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)rideListDown->itemWidget(curr, 0);
-        check->setChecked(false);
+        int index;
+        if (download) index = transfers->download(curr->text(1), curr->text(transferTab == 0 ? 6 : 8), version);
+        else index = transfers->upload(activities + curr->text(1));
+        transferring.insert(index, curr);
+        curr->setText(col, tr("Queued"));
     }
-    progressLabel->setText(QString(tr("Downloaded %1 of %2 successfully")).arg(successful).arg(downloadtotal));
-
-    // save the ride cache, we don't want to lose that if we crash etc.
-    context->athlete->rideCache->save();
 
-    return false;
+    // even if nothing to transfer this
+    // cleans up variables et al
+    transfers->start();
 }
 
 void
-CloudServiceSyncDialog::completedRead(QByteArray *data, QString name, QString /*message*/)
+CloudServiceSyncDialog::transferStarted(int index)
 {
-    QTreeWidget *which = sync ? rideListSync : rideListDown;
-    int col = sync ? 7 : 5;
+    QTreeWidgetItem *curr = transferring.value(index);
+    QTreeWidget *which = curr->treeWidget();
 
-    // was abort pressed?
-    if (aborted == true) {
-        QTreeWidgetItem *curr = which->invisibleRootItem()->child(listindex-1);
-        curr->setText(col, tr("Aborted"));
-        return;
+    switch(transferTab) {
+    case 0:
+        curr->setText(5, tr("Downloading"));
+        progressLabel->setText(QString(tr("Downloaded %1 of %2")).arg(downloadcounter).arg(downloadtotal));
+        break;
+    case 1:
+        curr->setText(7, tr("Uploading"));
+        progressLabel->setText(QString(tr("Uploaded %1 of %2")).arg(downloadcounter).arg(downloadtotal));
+        break;
+    default:
+        curr->setText(7, curr->text(6) == tr("Download") ? tr("Downloading") : tr("Uploading"));
+        progressLabel->setText(QString(tr("Processed %1 of %2")).arg(downloadcounter).arg(downloadtotal));
+        break;
     }
+    which->setCurrentItem(curr);
+    QApplication::processEvents();
+}
 
-    // uncompress and parse, note the filename is passed and may be
-    // different to what we asked for (sometimes the data is converted
-    // from one file format to another).
-    QStringList errors;
-    RideFile *ride = store->uncompressRide(data, name, errors);
-
-    // was allocated in before calling readfile
-    delete data;
+void
+CloudServiceSyncDialog::transferDownloaded(int index, RideFile *ride, QStringList errors)
+{
+    QTreeWidgetItem *curr = transferring.value(index);
+    int col = sync ? 7 : 5;
 
     progressBar->setValue(++downloadcounter);
 
-    QTreeWidgetItem *curr = which->invisibleRootItem()->child(listindex-1);
     if (ride) {
         if (saveRide(ride, errors) == true) {
             curr->setText(col, tr("Saved"));
             successful++;
+            transfers->done(index);
         } else {
             curr->setText(col, errors.join(" "));
         }
@@ -1534,100 +1454,82 @@ CloudServiceSyncDialog::completedRead(QByteArray *data, QString name, QString /*
     }
 
     QApplication::processEvents();
-
-    if (sync)
-        syncNext();
-    else
-        downloadNext();
 }
 
-bool
-CloudServiceSyncDialog::uploadNext()
+void
+CloudServiceSyncDialog::transferUploaded(int index, bool success, QString message)
 {
-    for (int i=listindex; i<rideListUp->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListUp->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)rideListUp->itemWidget(curr, 0);
-        QCheckBox *exists = (QCheckBox*)rideListUp->itemWidget(curr, 6);
+    QTreeWidgetItem *curr = transferring.value(index);
 
-        // skip existing if overwrite not set
-        if (check->isChecked() && exists->isChecked() && !overwrite->isChecked()) {
-            curr->setText(7, tr("File exists"));
-            progressBar->setValue(++downloadcounter);
-            continue;
-        }
-
-        if (check->isChecked()) {
-
-            listindex = i+1; // start from the next one
-            curr->setText(7, tr("Uploading"));
-            rideListUp->setCurrentItem(curr);
-            progressLabel->setText(QString(tr("Uploaded %1 of %2")).arg(downloadcounter).arg(downloadtotal));
-
-            // read in the file - TEMPORARILY *** WE DON'T USE IN MEMORY VERSION ***
-            QStringList errors;
-            QFile file(context->athlete->home->activities().canonicalPath() + "/" + curr->text(1));
-            RideFile *ride = RideFileFactory::instance().openRideFile(context, file, errors);
-
-            if (ride) {
-
-                    // get a compressed version
-                    QByteArray data;
-                    store->compressRide(ride, data, QFileInfo(curr->text(1)).baseName() + ".json");
-                    store->writeFile(data, QFileInfo(curr->text(1)).baseName() + store->uploadExtension(), ride);
-                    QApplication::processEvents();
-                    delete ride; // clean up!
-                    return true;
+    progressBar->setValue(++downloadcounter);
 
-            } else {
-                curr->setText(7, tr("Parse failure"));
-                QApplication::processEvents();
-            }
-        }
+    curr->setText(7, message);
+    if (success) {
+        successful++;
+        transfers->done(index);
     }
+    QApplication::processEvents();
+}
+
+void
+CloudServiceSyncDialog::transfersFinished()
+{
+    // abort has already tidied up
+    if (aborted) return;
 
     //
     // Our work is done!
     //
+    QTreeWidget *which = NULL;
+    QCheckBox *all = NULL;
+    switch(transferTab) {
+    case 0:
+        which = rideListDown;
+        all = selectAll;
+        progressLabel->setText(tr("Downloads complete"));
+        downloadButton->setText(tr("Download"));
+        break;
+    case 1:
+        which = rideListUp;
+        all = selectAllUp;
+        progressLabel->setText(tr("Uploads complete"));
+        downloadButton->setText(tr("Upload"));
+        break;
+    default:
+        which = rideListSync;
+        all = selectAllSync;
+        rideListSync->setSortingEnabled(true);
+        progressLabel->setText(tr("Sync complete"));
+        downloadButton->setText(tr("Synchronize"));
+        break;
+    }
     rideListDown->setSortingEnabled(true);
     rideListUp->setSortingEnabled(true);
-    progressLabel->setText(tr("Uploads complete"));
-    downloadButton->setText(tr("Upload"));
     downloading=false;
     aborted=false;
+    sync=false;
     cancelButton->show();
-    selectAllUp->setChecked(Qt::Unchecked);
-    for (int i=0; i<rideListUp->invisibleRootItem()->childCount(); i++) {
-        QTreeWidgetItem *curr = rideListUp->invisibleRootItem()->child(i);
-        QCheckBox *check = (QCheckBox*)rideListUp->itemWidget(curr, 0);
+    all->setChecked(Qt::Unchecked);
+    for (int i=0; i<which->invisibleRootItem()->childCount(); i++) {
+        QTreeWidgetItem *curr = which->invisibleRootItem()->child(i);
+        QCheckBox *check = (QCheckBox*)which->itemWidget(curr, 0);
         check->setChecked(false);
     }
-    progressLabel->setText(QString(tr("Uploaded %1 of %2 successfully")).arg(successful).arg(downloadtotal));
-    return false;
-}
 
-void
-CloudServiceSyncDialog::completedWrite(QString, QString result)
-{
-    QTreeWidget *which = sync ? rideListSync : rideListUp;
-
-    // was abort pressed?
-    if (aborted == true) {
-        QTreeWidgetItem *curr = which->invisibleRootItem()->child(listindex-1);
-        curr->setText(7, tr("Aborted"));
-        return;
+    switch(transferTab) {
+    case 0:
+        progressLabel->setText(QString(tr("Downloaded %1 of %2 successfully")).arg(successful).arg(downloadtotal));
+        break;
+    case 1:
+        progressLabel->setText(QString(tr("Uploaded %1 of %2 successfully")).arg(successful).arg(downloadtotal));
+        break;
+    default:
+        progressLabel->setText(QString(tr("Processed %1 of %2 successfully")).arg(successful).arg(downloadtotal));
+        break;
     }
 
-    progressBar->setValue(++downloadcounter);
-
-    QTreeWidgetItem *curr = which->invisibleRootItem()->child(listindex-1);
-    curr->setText(7, result);
-    if (result == tr("Completed.")) successful++;
-    QApplication::processEvents();
-
-    if (sync)
-        syncNext();
-    else
-        uploadNext();
+    // save the ride cache, we don't want to lose that if we crash etc.
+    if (transferTab != 1) context->athlete->rideCache->save();
 }
 
 bool
@@ -1653,18 +1555,14 @@ CloudServiceSyncDialog::saveRide(RideFile *ride, QStringList &errors)
         return false;
     }
 
-    // process linked defaults
-    context->athlete->rideMetadata()->setLinkedDefaults(ride);
-
-    // run the processor first... import
-    DataProcessorFactory::instance().autoProcess(ride, "Auto", "Import");
-    ride->recalculateDerivedSeries();
-    // now metrics have been calculated
-    DataProcessorFactory::instance().autoProcess(ride, "Save", "ADD");
-
-    JsonFileReader reader;
-    QFile file(filename);
-    reader.writeRideFile(context, ride, file);
+    // linked defaults, data processors and save as json, as an import does
+    RideImportJob job(ride, 0);
+    job.target = filename;
+    QList<RideFile*> rides;
+    bool written;
+    RideImportPipeline::run(context, &job, RideImportJob::Process | RideImportJob::Save | RideImportJob::Serialise,
+                            ride, rides, errors, written);
+    job.take(); // the caller deletes it
 
     // add to the ride list
     rideFiles<<targetnosuffix;
@@ -1944,21 +1842,12 @@ CloudServiceAutoDownload::readComplete(QByteArray*data,QString name,QString)
         return;
     }
 
-    // process linked defaults
-    context->athlete->rideMetadata()->setLinkedDefaults(ride);
-
-    // run the processor first... import
-    DataProcessorFactory::instance().autoProcess(ride, "Auto", "Import");
-    ride->recalculateDerivedSeries();
-    // now metrics have been calculated
-    DataProcessorFactory::instance().autoProcess(ride, "Save", "ADD");
-
-    JsonFileReader reader;
-    QFile file(filename);
-    reader.writeRideFile(context, ride, file);
-
-    // delete temporary in-memory copy
-    delete ride;
+    // linked defaults, data processors and save as json, as an import does
+    // the job deletes the temporary in-memory copy
+    RideImportJob job(ride, 0);
+    job.target = filename;
+    RideImportPipeline::run(context, &job, RideImportJob::Process | RideImportJob::Save | RideImportJob::Serialise,
+                            job.ride, job.rides, job.errors, job.written);
 
     // add to the ride list -- but don't select it
     context->athlete->addRide(fileinfo.fileName(), true, false);
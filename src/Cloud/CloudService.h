@@ -50,6 +50,10 @@
 
 class RideItem;
 class CloudServiceEntry;
+class CloudTransferScheduler;
+
+// transfers a service that matches replies to requests may have running at once
+#define CLOUD_TRANSFERS 4
 
 // Representing an Athlete when the service allows for
 // a coach or manager relationship -- i.e. it lists athletes
@@ -132,6 +136,11 @@ class CloudService : public QObject {
         }
         void notifyReadComplete(QByteArray *data, QString name, QString message) { emit readComplete(data,name,message); }
 
+        // how many reads and writes the sync dialog may have outstanding at
+        // once, only raise it if replies are matched to their own request
+        // (reads by data, writes by remotename) as Dropbox does
+        virtual int maxTransfers() const { return 1; }
+
         // list and select an athlete - list will need to block rather than notify asynchronously
         virtual QList<CloudServiceAthlete> listAthletes() { return QList<CloudServiceAthlete>(); }
         virtual bool selectAthlete(CloudServiceAthlete) { return false; }
@@ -336,8 +345,11 @@ class CloudServiceSyncDialog : public QDialog
         void selectAllUpChanged(int);
         void selectAllSyncChanged(int);
 
-        void completedRead(QByteArray *data, QString name, QString message);
-        void completedWrite(QString name,QString message);
+        void transferStarted(int index);
+        void transferDownloaded(int index, RideFile *ride, QStringList errors);
+        void transferUploaded(int index, bool success, QString message);
+        void transfersFinished();
+
     private:
         Context *context;
         CloudService *store;
@@ -355,16 +367,14 @@ class CloudServiceSyncDialog : public QDialog
         // keeping track of progress...
         int downloadcounter,    // *x* of n downloading
             downloadtotal,      // x of *n* downloading
-            successful,         // how many downloaded ok?
-            listindex;          // where in rideList we've got to
+            successful;         // how many downloaded ok?
 
         bool saveRide(RideFile *, QStringList &);
-        bool syncNext();        // kick off another download/upload
-                                // returns false if none left
-        bool downloadNext();    // kick off another download
-                                // returns false if none left
-        bool uploadNext();     // kick off another upload
-                                // returns false if none left
+
+        // does the downloads/uploads for the tab we started on
+        CloudTransferScheduler *transfers;
+        QMap<int, QTreeWidgetItem*> transferring; // rows by transfer
+        int transferTab;
 
         // tabs - Upload/Download
         QTabWidget *tabs;
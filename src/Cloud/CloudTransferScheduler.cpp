@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "CloudTransferScheduler.h"
+
+#include "CloudService.h"
+#include "RideFile.h"
+#include "Trace.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QFile>
+#include <QTextStream>
+
+CloudTransferScheduler::CloudTransferScheduler(Context *context, CloudService *store, QObject *parent) :
+    QObject(parent), concurrency(store->maxTransfers()), context(context), store(store),
+    running(false), aborted(false), dispatching(false)
+{
+    connect(store, SIGNAL(readComplete(QByteArray*,QString,QString)), this, SLOT(readComplete(QByteArray*,QString,QString)));
+    connect(store, SIGNAL(writeComplete(QString,QString)), this, SLOT(writeComplete(QString,QString)));
+}
+
+CloudTransferScheduler::~CloudTransferScheduler()
+{
+    // buffers for reads still outstanding are left alone, the
+    // service may yet write to them
+}
+
+int
+CloudTransferScheduler::download(QString remotename, QString remoteid, QString version)
+{
+    Transfer add;
+    add.direction = Download;
+    add.name = remotename;
+    add.remoteid = remoteid;
+    add.version = version;
+    transfers << add;
+    queued << transfers.count()-1;
+    return transfers.count()-1;
+}
+
+int
+CloudTransferScheduler::upload(QString filename)
+{
+    Transfer add;
+    add.direction = Upload;
+    add.name = QFileInfo(filename).baseName() + store->uploadExtension();
+    add.filename = filename;
+    add.version = version(QFileInfo(filename).size(), QFileInfo(filename).lastModified());
+    transfers << add;
+    queued << transfers.count()-1;
+    return transfers.count()-1;
+}
+
+void
+CloudTransferScheduler::start()
+{
+    running = true;
+    aborted = false;
+    dispatch();
+}
+
+void
+CloudTransferScheduler::abort()
+{
+    aborted = true;
+    queued.clear();
+    check();
+}
+
+void
+CloudTransferScheduler::dispatch()
+{
+    // services that complete inside readFile/writeFile
+    // come back here, the loop below carries on for them
+    if (dispatching || !running) return;
+    dispatching = true;
+
+    while (!aborted && !queued.isEmpty() && reading.count() + writing.count() < qMax(1, concurrency)) {
+
+        int index = queued.takeFirst();
+        emit started(index);
+
+        if (transfers.at(index).direction == Download) startDownload(index);
+        else startUpload(index);
+    }
+
+    dispatching = false;
+    check();
+}
+
+void
+CloudTransferScheduler::check()
+{
+    if (!running || !reading.isEmpty() || !writing.isEmpty()) return;
+    if (!aborted && !queued.isEmpty()) return;
+
+    running = false;
+
+    // all done, nothing to resume
+    if (!aborted && statefile != "") {
+        QFile::remove(statefile);
+        before.clear();
+    }
+
+    emit finished();
+}
+
+void
+CloudTransferScheduler::startDownload(int index)
+{
+    const Transfer &transfer = transfers.at(index);
+
+    QByteArray *data = new QByteArray; // deleted when the read completes
+    reading.insert(data, index);
+
+    // didn't start and won't call back
+    if (!store->readFile(data, transfer.name, transfer.remoteid) && reading.contains(data)) {
+        reading.remove(data);
+        delete data;
+        emit downloaded(index, NULL, QStringList() << tr("Download failed"));
+    }
+}
+
+void
+CloudTransferScheduler::readComplete(QByteArray *data, QString name, QString)
+{
+    // not one of ours
+    if (!reading.contains(data)) return;
+    int index = reading.take(data);
+
+    GC_TRACE("CloudTransferScheduler::readComplete");
+
+    // note the name may differ from what we asked for (sometimes the
+    // data is converted from one file format to another)
+    QStringList errors;
+    RideFile *ride = NULL;
+    if (aborted) errors << tr("Aborted");
+    else ride = store->uncompressRide(data, name, errors);
+    delete data;
+
+    emit downloaded(index, ride, errors);
+
+    dispatch();
+}
+
+void
+CloudTransferScheduler::startUpload(int index)
+{
+    GC_TRACE("CloudTransferScheduler::startUpload");
+
+    const Transfer &transfer = transfers.at(index);
+
+    QStringList errors;
+    QFile file(transfer.filename);
+    RideFile *ride = RideFileFactory::instance().openRideFile(context, file, errors);
+    if (ride == NULL) {
+        emit uploaded(index, false, tr("Parse failure"));
+        return;
+    }
+
+    // get a compressed version
+    QByteArray data;
+    store->compressRide(ride, data, QFileInfo(transfer.filename).baseName() + ".json");
+
+    writing << index;
+
+    // didn't start and didn't call back
+    if (!store->writeFile(data, transfer.name, ride) && writing.contains(index)) {
+        writing.removeOne(index);
+        emit uploaded(index, false, tr("Upload failed"));
+    }
+    delete ride; // clean up!
+}
+
+void
+CloudTransferScheduler::writeComplete(QString name, QString message)
+{
+    if (writing.isEmpty()) return;
+
+    // services report the remote name (or an id, or nothing
+    // at all) so fall back to the oldest outstanding
+    int index = writing.first();
+    foreach(int outstanding, writing) {
+        if (transfers.at(outstanding).name == name) {
+            index = outstanding;
+            break;
+        }
+    }
+    writing.removeOne(index);
+
+    // services translate in their own context
+    bool success = (message == QCoreApplication::translate(store->metaObject()->className(), "Completed."));
+
+    if (aborted) emit uploaded(index, false, tr("Aborted"));
+    else emit uploaded(index, success, message);
+
+    dispatch();
+}
+
+void
+CloudTransferScheduler::setStateFile(QString filename)
+{
+    statefile = filename;
+    before.clear();
+
+    QFile file(statefile);
+    if (!file.open(QFile::ReadOnly | QFile::Text)) return;
+
+    // one transfer per line, D or U, the name then a tab and the version
+    QTextStream in(&file);
+    in.setCodec("UTF-8");
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        int tab = line.lastIndexOf('\t');
+        if (tab > 2) before.insert(line.left(tab), line.mid(tab+1));
+    }
+    file.close();
+}
+
+QString
+CloudTransferScheduler::version(qint64 size, QDateTime modified)
+{
+    if (size <= 0 && !modified.isValid()) return QString();
+    return QString("%1 %2").arg(size).arg(modified.isValid() ? modified.toMSecsSinceEpoch() : 0);
+}
+
+bool
+CloudTransferScheduler::transferredBefore(Direction direction, QString name, QString version) const
+{
+    // services that tell us neither size nor time can only go by name
+    QString key = QString(direction == Download ? "D " : "U ") + name;
+    return before.contains(key) && before.value(key) == version;
+}
+
+void
+CloudTransferScheduler::done(int index)
+{
+    if (statefile == "") return;
+
+    // appended as we go so a crash loses nothing
+    QFile file(statefile);
+    if (!file.open(QFile::WriteOnly | QFile::Append | QFile::Text)) return;
+
+    const Transfer &transfer = transfers.at(index);
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    out << (transfer.direction == Download ? "D " : "U ") << transfer.name << "\t" << transfer.version << "\n";
+    out.flush();
+    file.close();
+}
+
+//
+// Tally
+//
+CloudTransferTally::CloudTransferTally(CloudTransferScheduler *transfers) :
+    QObject(transfers), files(0), samples(0), transfers(transfers)
+{
+    connect(transfers, SIGNAL(downloaded(int,RideFile*,QStringList)), this, SLOT(downloaded(int,RideFile*,QStringList)));
+    connect(transfers, SIGNAL(uploaded(int,bool,QString)), this, SLOT(uploaded(int,bool,QString)));
+}
+
+void
+CloudTransferTally::downloaded(int index, RideFile *ride, QStringList errs)
+{
+    if (ride) {
+        files++;
+        samples += ride->dataPoints().count();
+        delete ride;
+    } else {
+        errors << QString("%1: %2").arg(transfers->remoteName(index)).arg(errs.join(" "));
+    }
+}
+
+void
+CloudTransferTally::uploaded(int index, bool success, QString message)
+{
+    if (success) files++;
+    else errors << QString("%1: %2").arg(transfers->remoteName(index)).arg(message);
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_CloudTransferScheduler_h
+#define _GC_CloudTransferScheduler_h 1
+
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QDateTime>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QStringList>
+
+class Context;
+class CloudService;
+class RideFile;
+
+//
+// Keeps up to store->maxTransfers() reads and writes outstanding with a
+// cloud service, so a sync of thousands of activities isn't one round trip
+// after another. Downloads are uncompressed and parsed, and uploads read
+// and compressed, on the main thread as replies arrive, which overlaps
+// with the other transfers still in flight.
+//
+// When a state file is set the transfers reported done() are appended to
+// it as they complete, so an interrupted sync can skip them when it is
+// run again. The file is removed once a run finishes without aborting.
+// Each is recorded with the version of the file transferred, its size and
+// modification time, so one that changed since is transferred again.
+//
+// Services like the LocalFileStore that complete inside readFile() and
+// writeFile() work too, they just run one at a time.
+//
+class CloudTransferScheduler : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        enum Direction { Download, Upload };
+
+        CloudTransferScheduler(Context *context, CloudService *store, QObject *parent=NULL);
+        ~CloudTransferScheduler();
+
+        // queue transfers, the index is used in the signals
+        int download(QString remotename, QString remoteid, QString version=QString());
+        int upload(QString filename); // local activity file
+
+        // what gets sent where
+        QString remoteName(int index) const { return transfers.at(index).name; }
+
+        void start();
+        void abort(); // queued are dropped, outstanding report "Aborted"
+        bool isRunning() const { return running; }
+
+        int concurrency; // defaults to store->maxTransfers()
+
+        // resumable state
+        void setStateFile(QString filename);
+        bool transferredBefore(Direction direction, QString name, QString version) const;
+        static QString version(qint64 size, QDateTime modified); // empty if neither known
+        void done(int index); // completed and wanted, record it
+
+    signals:
+
+        void started(int index);
+        void downloaded(int index, RideFile *ride, QStringList errors); // receiver deletes ride
+        void uploaded(int index, bool success, QString message);
+        void finished();
+
+    private slots:
+
+        void readComplete(QByteArray *data, QString name, QString message);
+        void writeComplete(QString name, QString message);
+
+    private:
+
+        void dispatch();           // start more if there's room
+        void startDownload(int index);
+        void startUpload(int index);
+        void check();              // finished?
+
+        Context *context;
+        CloudService *store;
+
+        struct Transfer {
+            Direction direction;
+            QString name, remoteid;  // on the store
+            QString filename;        // local, for uploads
+            QString version;         // of what was transferred
+        };
+        QList<Transfer> transfers;
+
+        QList<int> queued;
+        QMap<QByteArray*, int> reading;
+        QList<int> writing;          // oldest first
+
+        bool running, aborted, dispatching;
+
+        QString statefile;
+        QMap<QString, QString> before; // from an earlier run, with the version
+};
+
+//
+// Counts what a scheduler did and throws the downloads away, for
+// measuring transfers without saving anything (see Benchmark)
+//
+class CloudTransferTally : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        CloudTransferTally(CloudTransferScheduler *transfers);
+
+        int files;          // transferred ok
+        qint64 samples;     // in the downloads
+        QStringList errors;
+
+    public slots:
+
+        void downloaded(int index, RideFile *ride, QStringList errors);
+        void uploaded(int index, bool success, QString message);
+
+    private:
+        CloudTransferScheduler *transfers;
+};
+
+#endif
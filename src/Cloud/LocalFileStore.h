@@ -50,6 +50,7 @@ class LocalFileStore : public CloudService {
 
         // read a file
         bool readFile(QByteArray *data, QString remotename, QString);
+        int maxTransfers() const { return CLOUD_TRANSFERS; }
 
         // create a folder
         bool createFolder(QString path);
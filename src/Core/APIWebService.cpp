@@ -17,6 +17,7 @@
  */
 
 #include "APIWebService.h"
+#include "Trace.h"
 
 #include "Settings.h"
 #include "GcUpgrade.h"
@@ -37,6 +38,8 @@
 void
 APIWebService::service(HttpRequest &request, HttpResponse &response)
 {
+    GC_TRACE("APIWebService::service");
+
     // remove trailing '/' from request, just to be consistent
     QString fullPath = request.getPath();
     while (fullPath.endsWith("/")) fullPath.chop(1);
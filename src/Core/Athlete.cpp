@@ -47,6 +47,7 @@
 #include "IntervalTreeView.h"
 #include "LTMSettings.h"
 #include "RideImportWizard.h"
+#include "RideImportPipeline.h"
 #include "RideAutoImportConfig.h"
 #include "AthleteBackup.h"
 #include "CloudService.h"
@@ -224,6 +225,9 @@ Athlete::loadCharts()
 
 Athlete::~Athlete()
 {
+    // imports still parsing use our context
+    RideImportPipeline::drain(context);
+
     // close the ride cache down first
     delete rideCache;
 
@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Batch.h"
+
+#include "Context.h"
+#include "Athlete.h"
+#include "Settings.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "RideFile.h"
+#include "RideFileCommand.h"
+#include "JsonRideFile.h"
+#include "DataProcessor.h"
+#include "RideExporter.h"
+#include "Specification.h"
+#include "Trace.h"
+
+#include <QRunnable>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDateTime>
+
+#include <stdio.h>
+
+class BatchRunner : public QRunnable
+{
+    public:
+        BatchRunner(Batch *batch, int index) : batch(batch), index(index) {}
+        void run() { batch->work(index); }
+
+    private:
+        Batch *batch;
+        int index;
+};
+
+Batch::Batch(QDir home, QString athlete) : force(false), athlete(athlete), context(NULL), working(NULL),
+                                           current(Refresh), processor(NULL), done(0)
+{
+    QDir athleteHome(home.canonicalPath() + "/" + athlete);
+    if (athlete == "" || !athleteHome.exists()) return;
+
+    // open the athlete, as the benchmark does, without a main window
+    appsettings->initializeQSettingsAthlete(home.canonicalPath(), athlete);
+    context = new Context(NULL);
+    new Athlete(context, athleteHome); // sets context->athlete
+
+    // opening it started a refresh of everything that is stale,
+    // we only want those in range and need to know when its done
+    context->athlete->rideCache->cancel();
+}
+
+Batch::~Batch()
+{
+    // runners use us, so wait for them
+    pool.waitForDone();
+
+    // the ride cache is saved as it closes
+    if (context) {
+        context->athlete->close();
+        delete context->athlete;
+        delete context;
+    }
+}
+
+int
+Batch::run(QString job, QStringList args)
+{
+    if (context == NULL) {
+        fprintf(stderr, "Batch: no athlete %s\n", athlete.toLocal8Bit().constData());
+        return 1;
+    }
+
+    // the activities to work on
+    QList<RideItem*> items;
+    foreach(RideItem *item, context->athlete->rideCache->rides())
+        if (!item->planned && range.pass(item->dateTime.date())) items << item;
+
+    if (job == "refresh" && args.count() == 0) {
+
+        return refresh(items) ? 2 : 0;
+
+    } else if (job == "process" && args.count() == 1) {
+
+        // by the name its registered with, or shown in the menus
+        QMapIterator<QString,DataProcessor*> i(DataProcessorFactory::instance().getProcessors());
+        while (i.hasNext()) {
+            i.next();
+            if (i.key().compare(args.at(0), Qt::CaseInsensitive) == 0 ||
+                i.value()->name().compare(args.at(0), Qt::CaseInsensitive) == 0)
+                processor = i.value();
+        }
+        if (processor == NULL) {
+            fprintf(stderr, "Batch: no data processor %s, choose from \"%s\"\n", args.at(0).toLocal8Bit().constData(),
+                    DataProcessorFactory::instance().getProcessors().keys().join("\", \"").toLocal8Bit().constData());
+            return 1;
+        }
+
+        int fails = process(items);
+
+        // the ones that changed need their metrics recomputing
+        QList<RideItem*> changed;
+        foreach(const Job &processed, jobs) {
+            if (processed.changed) {
+                processed.item->isstale = true;
+                changed << processed.item;
+            }
+        }
+        fails += refresh(changed);
+
+        return fails ? 2 : 0;
+
+    } else if (job == "export" && args.count() == 2) {
+
+        type = args.at(0).toLower();
+        if (type != "csv" && !RideFileFactory::instance().writeSuffixes().contains(type)) {
+            fprintf(stderr, "Batch: cannot write %s, choose from csv %s\n", type.toLocal8Bit().constData(),
+                    RideFileFactory::instance().writeSuffixes().join(" ").toLocal8Bit().constData());
+            return 1;
+        }
+
+        QDir target(args.at(1));
+        if (!target.exists() && !target.mkpath(target.absolutePath())) {
+            fprintf(stderr, "Batch: cannot create %s\n", args.at(1).toLocal8Bit().constData());
+            return 1;
+        }
+
+        // existing files are left alone, so a nightly run
+        // only exports what was added since the last one
+        jobs.clear();
+        int skipped = 0;
+        foreach(RideItem *item, items) {
+            Job add(item);
+            add.target = target.absolutePath() + "/" + QFileInfo(item->fileName).baseName() + "." + type;
+            if (QFile(add.target).exists()) skipped++;
+            else jobs << add;
+        }
+        if (skipped) fprintf(stderr, "export: %d activities already exported\n", skipped);
+
+        return stage(Export, "export") ? 2 : 0;
+
+    } else if (job == "metrics" && args.count() == 1) {
+
+        int fails = refresh(items);
+
+        // the same activities the other jobs use, so no planned ones
+        QStringList names;
+        foreach(RideItem *item, items) names << item->fileName;
+
+        if (!context->athlete->rideCache->writeAsCSV(args.at(0), Specification(range, FilterSet(true, names)))) {
+            fprintf(stderr, "Batch: cannot write %s\n", args.at(0).toLocal8Bit().constData());
+            return 1;
+        }
+        return fails ? 2 : 0;
+    }
+
+    fprintf(stderr, "usage: GoldenCheetah --batch=refresh|process|export|metrics [--from=yyyy-mm-dd] [--to=yyyy-mm-dd] [--force] athlete [args]\n");
+    fprintf(stderr, "       refresh, process processor, export format dir or metrics file.csv\n");
+    return 1;
+}
+
+int
+Batch::refresh(QList<RideItem*> items)
+{
+    // only those that need it, unless forced
+    jobs.clear();
+    foreach(RideItem *item, items) {
+        if (force) item->isstale = true;
+        if (item->checkStale()) jobs << Job(item);
+    }
+    return stage(Refresh, "refresh");
+}
+
+int
+Batch::process(QList<RideItem*> items)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // files are read and written on the pool but the processors are
+    // run here, on the main thread, since some of them use widgets.
+    // a few at a time so we don't have every activity open at once
+    QVector<Job> all;
+    foreach(RideItem *item, items) all << Job(item);
+
+    qint64 reported = 0;
+    int window = pool.maxThreadCount() * 4;
+    for(int from=0; from < all.count(); from += window) {
+
+        jobs = all.mid(from, window);
+        parallel(Read, "");
+
+        for(int i=0; i<jobs.count(); i++) {
+            Job &job = jobs[i];
+            if (job.ride == NULL) continue;
+
+            if (processor->postProcess(job.ride, NULL, "UPDATE")) {
+                DataProcessorFactory::instance().autoProcess(job.ride, "Save", "UPDATE");
+
+                // update the change history, as saving does
+                QString log = job.ride->getTag("Change History", "");
+                log += QObject::tr("Changes on ");
+                log += QDateTime::currentDateTime().toString() + ":";
+                log += '\n' + job.ride->command->changeLog();
+                job.ride->setTag("Change History", log);
+                job.changed = true;
+            }
+        }
+
+        parallel(Write, "");
+        for(int i=0; i<jobs.count(); i++) all[from+i] = jobs[i];
+
+        // every few seconds, for the log
+        if (timer.elapsed() - reported >= 5000) {
+            reported = timer.elapsed();
+            fprintf(stderr, "process: %d of %d activities, %.1fs\n", qMin(from + window, all.count()), all.count(), reported / 1000.0);
+            fflush(stderr);
+        }
+    }
+
+    jobs = all;
+    return report("process", timer.elapsed());
+}
+
+int
+Batch::stage(Stage which, QString name)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    parallel(which, name);
+    return report(name, timer.elapsed());
+}
+
+void
+Batch::parallel(Stage which, QString name)
+{
+    current = which;
+    done.store(0);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // workers update their own job in place, so no sharing
+    working = jobs.data();
+    for(int i=0; i<jobs.count(); i++) pool.start(new BatchRunner(this, i));
+
+    // every few seconds, for the log
+    while (!pool.waitForDone(5000)) {
+        if (name == "") continue;
+        fprintf(stderr, "%s: %d of %d activities, %.1fs\n", name.toLocal8Bit().constData(),
+                done.load(), jobs.count(), timer.elapsed() / 1000.0);
+        fflush(stderr);
+    }
+}
+
+int
+Batch::report(QString name, qint64 msecs)
+{
+    int fails = 0;
+    foreach(const Job &job, jobs) {
+        if (job.error == "") continue;
+        fails++;
+        fprintf(stderr, "%s: %s\n", job.item->fileName.toLocal8Bit().constData(), job.error.toLocal8Bit().constData());
+    }
+
+    fprintf(stderr, "%s: %d activities in %.1fs on %d threads, %d failed.\n", name.toLocal8Bit().constData(),
+            jobs.count(), msecs / 1000.0, pool.maxThreadCount(), fails);
+    fflush(stderr);
+
+    return fails;
+}
+
+void
+Batch::work(int index)
+{
+    GC_TRACE("Batch::work");
+
+    Job &job = working[index];
+    QString filename = job.item->path + "/" + job.item->fileName;
+
+    switch (current) {
+
+    case Refresh:
+        job.item->refresh();
+        break;
+
+    case Read:
+    {
+        // written back in place, so only our own format
+        if (QFileInfo(filename).suffix().toLower() != "json") {
+            job.error = "not a json activity file, open and save it first";
+            break;
+        }
+
+        QStringList errors;
+        QFile file(filename);
+        job.ride = RideFileFactory::instance().openRideFile(context, file, errors);
+        if (job.ride == NULL) job.error = "read error";
+    }
+        break;
+
+    case Write:
+        if (job.ride && job.changed) {
+            QFile out(filename);
+            JsonFileReader reader;
+            if (!reader.writeRideFile(context, job.ride, out)) {
+                job.error = "write failed";
+                job.changed = false;
+            }
+        }
+        delete job.ride;
+        job.ride = NULL;
+        break;
+
+    case Export:
+    {
+        QString status;
+        if (!RideExporter::exportFile(context, filename, job.target, type, status)) job.error = status;
+    }
+        break;
+    }
+
+    done.fetchAndAddOrdered(1);
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_Batch_h
+#define _GC_Batch_h 1
+
+#include "GoldenCheetah.h"
+#include "TimeUtils.h"
+
+#include <QString>
+#include <QStringList>
+#include <QDir>
+#include <QVector>
+#include <QThreadPool>
+#include <QAtomicInt>
+
+class Context;
+class RideItem;
+class RideFile;
+class DataProcessor;
+
+//
+// Headless batch jobs over an athlete's activities, run via
+//
+//     GoldenCheetah --batch=job [--from=yyyy-mm-dd] [--to=yyyy-mm-dd] [--force] athlete [args]
+//
+//     refresh              recompute metrics for stale activities, or all with --force
+//     process processor    run a data processor (eg "Fix GPS errors") with its saved
+//                          settings, save the activities it changed and refresh them
+//     export format dir    export activities to dir, existing files are left alone
+//     metrics file.csv     refresh, then write the activity metrics as csv
+//
+// Data processors run on the main thread, some of them use widgets, but
+// everything else is worked on by a pool of threads, one per core, with
+// progress and timings reported on stderr. The exit code is 0 when all
+// went well, 1 when the job could not be run at all and 2 when one or
+// more activities failed, so it can be left to run nightly from cron.
+//
+class Batch
+{
+    public:
+
+        Batch(QDir home, QString athlete);
+        ~Batch();
+
+        // only activities in range, either end can be left open
+        DateRange range;
+        bool force; // refresh even when not stale
+
+        // run job with its arguments, returns exit code
+        int run(QString job, QStringList args);
+
+    private:
+
+        friend class BatchRunner;
+
+        enum Stage { Refresh, Read, Write, Export };
+
+        // run stage over all the jobs and report, returns failures
+        int stage(Stage which, QString name);
+        void parallel(Stage which, QString name); // progress when named
+        int report(QString name, qint64 msecs);
+        void work(int index);
+
+        int refresh(QList<RideItem*> items);
+        int process(QList<RideItem*> items);
+
+        QString athlete;
+        Context *context;
+        QThreadPool pool;
+
+        struct Job {
+            Job(RideItem *item=NULL) : item(item), ride(NULL), changed(false) {}
+            RideItem *item;
+            QString target;  // export
+            RideFile *ride;  // process, between reading and writing
+            bool changed;    // process
+            QString error;
+        };
+        QVector<Job> jobs;
+        Job *working;        // workers only touch their own job
+        Stage current;
+
+        DataProcessor *processor; // run on the main thread
+        QString type;        // export format
+
+        QAtomicInt done;
+};
+
+#endif
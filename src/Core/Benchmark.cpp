@@ -0,0 +1,678 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Benchmark.h"
+
+#include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "Settings.h"
+#include "GcUpgrade.h"
+#include "RideFile.h"
+#include "JsonRideFile.h"
+#include "JsonStreamReader.h"
+#include "RideItem.h"
+#include "IntervalItem.h"
+#include "RideFileCache.h"
+#include "RideMetric.h"
+#include "Specification.h"
+#include "WPrime.h"
+#include "Zones.h"
+#include "HrZones.h"
+#include "CloudService.h"
+#include "CloudTransferScheduler.h"
+#ifdef GC_WANT_PYTHON
+#include "PythonEmbed.h"
+#endif
+
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QAtomicInteger>
+#include <QEventLoop>
+#include <QTextCodec>
+
+#include <stdio.h>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+// heap allocation counting replaces the global operator new, so it is
+// only compiled in when asked for, see gcconfig.pri.in
+#ifdef GC_WANT_ALLOCCOUNT
+#include <new>
+#include <stdlib.h>
+
+static QAtomicInteger<qint64> allocCount;
+static QAtomicInteger<qint64> allocBytes;
+static QAtomicInteger<qint64> allocLive; // bytes currently allocated
+static QAtomicInteger<qint64> allocPeak; // most allocated since last reset
+
+// each block is prefixed with its size so delete can track what is live,
+// 16 bytes keeps the alignment malloc gave us
+static const size_t allocHeader = 16;
+
+void *operator new(size_t size)
+{
+    allocCount.fetchAndAddRelaxed(1);
+    allocBytes.fetchAndAddRelaxed(size);
+    char *p = static_cast<char*>(malloc(size + allocHeader));
+    if (p == NULL) throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(p) = size;
+
+    qint64 live = allocLive.fetchAndAddRelaxed(size) + size;
+    qint64 peak = allocPeak.load();
+    while (live > peak && !allocPeak.testAndSetRelaxed(peak, live)) peak = allocPeak.load();
+
+    return p + allocHeader;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept
+{
+    if (p == NULL) return;
+    char *block = static_cast<char*>(p) - allocHeader;
+    allocLive.fetchAndSubRelaxed(*reinterpret_cast<size_t*>(block));
+    free(block);
+}
+void operator delete[](void *p) noexcept { operator delete(p); }
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+#endif
+
+// root directory for gc, see main.cpp
+extern QString gcroot;
+
+// name of the scratch athlete
+static const char *athleteName = "bench";
+
+// the folders in test/ that hold activities
+static const char *corpus[] = { "rides", "runs", "swims", "aerolab", NULL };
+
+// describe the first difference between two rides, empty if the same
+static QString difference(RideFile *a, RideFile *b);
+
+// times a stage from construction to destruction
+class StageProbe
+{
+    public:
+        StageProbe(Benchmark::Stage &stage, qint64 samples=0) : samples(samples), stage(stage) {
+#ifdef GC_WANT_ALLOCCOUNT
+            allocs = allocCount.load();
+            bytes = allocBytes.load();
+            live = allocLive.load();
+            allocPeak.store(live);
+#endif
+            timer.start();
+        }
+        ~StageProbe() {
+            stage.nsecs += timer.nsecsElapsed();
+            stage.files++;
+            stage.samples += samples;
+#ifdef GC_WANT_ALLOCCOUNT
+            stage.allocs += allocCount.load() - allocs;
+            stage.bytes += allocBytes.load() - bytes;
+            stage.peak = qMax(stage.peak, allocPeak.load() - live);
+#endif
+        }
+
+        qint64 samples; // may be set once known (e.g. after reading)
+
+    private:
+        Benchmark::Stage &stage;
+        QElapsedTimer timer;
+#ifdef GC_WANT_ALLOCCOUNT
+        qint64 allocs, bytes, live;
+#endif
+};
+
+Benchmark::Benchmark(QString testdir) : testdir(testdir), context(NULL), files(0), elapsed(0),
+                                        conformed(0), mismatched(0)
+{
+}
+
+Benchmark::~Benchmark()
+{
+    if (context) {
+        context->athlete->close();
+        delete context->athlete;
+        delete context;
+    }
+}
+
+bool
+Benchmark::setup()
+{
+    if (!scratch.isValid() || !testdir.exists()) return false;
+
+    // a brand new athlete, set up the same way as NewCyclistDialog
+    // but with fixed zones so results are comparable between runs
+    QDir root(scratch.path());
+    if (!root.mkdir(athleteName)) return false;
+    QDir home(root.canonicalPath() + "/" + athleteName);
+
+    AthleteDirectoryStructure athleteHome(home);
+    athleteHome.createAllSubdirs();
+
+    gcroot = root.canonicalPath();
+    appsettings->initializeQSettingsGlobal(gcroot);
+    appsettings->initializeQSettingsNewAthlete(gcroot, athleteName);
+    appsettings->setCValue(athleteName, GC_UPGRADE_FOLDER_SUCCESS, true);
+    appsettings->setCValue(athleteName, GC_VERSION_USED, QVariant(VERSION_LATEST));
+    appsettings->setCValue(athleteName, GC_WEIGHT, 75.0);
+
+    Zones zones;
+    zones.addZoneRange(QDate(1900, 01, 01), 250, 250, 20000, 1000);
+    zones.write(athleteHome.config().canonicalPath());
+
+    HrZones hrzones;
+    hrzones.addHrZoneRange(QDate(1900, 01, 01), 165, 50, 190);
+    hrzones.write(athleteHome.config().canonicalPath());
+
+    RideMetricFactory::instance().initialize();
+
+    context = new Context(NULL);
+    new Athlete(context, home); // sets context->athlete
+
+#ifdef GC_WANT_PYTHON
+    // the python stage needs the interpreter, which is
+    // normally only started when the gui is
+    if (python == NULL && appsettings->value(NULL, GC_EMBED_PYTHON, true).toBool()) {
+        python = new PythonEmbed();
+        if (python->loaded == false) python = NULL;
+    }
+#endif
+
+    return true;
+}
+
+int
+Benchmark::run(QString filename)
+{
+    if (!setup()) {
+        fprintf(stderr, "Benchmark: cannot find %s or create scratch athlete.\n", testdir.absolutePath().toLocal8Bit().constData());
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList benched;
+    for(int i=0; corpus[i]; i++) {
+
+        QDir dir(testdir.absoluteFilePath(corpus[i]));
+        if (!dir.exists()) continue;
+
+        foreach(QString name, dir.entryList(QDir::Files, QDir::Name)) {
+
+            // only files we have a reader for, allowing for compression
+            QStringList parts = name.toLower().split(".");
+            if (parts.count() > 2 && (parts.last() == "gz" || parts.last() == "zip")) parts.removeLast();
+            if (!RideFileFactory::instance().suffixes().contains(parts.last())) continue;
+
+            bench(dir.absoluteFilePath(name));
+            benched << dir.absoluteFilePath(name);
+            files++;
+        }
+    }
+
+    // and round trip them through a cloud service
+    sync(benched);
+
+    elapsed = timer.nsecsElapsed();
+
+    // machine readable results
+    QByteArray json = results().toUtf8();
+    if (filename == "") {
+        fprintf(stdout, "%s\n", json.constData());
+        fflush(stdout);
+    } else {
+        QFile out(filename);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            fprintf(stderr, "Benchmark: cannot write %s\n", filename.toLocal8Bit().constData());
+            return 1;
+        }
+        out.write(json);
+        out.close();
+    }
+    return 0;
+}
+
+void
+Benchmark::bench(QString filename)
+{
+    const RideFileFactory &factory = RideFileFactory::instance();
+    const RideMetricFactory &metrics = RideMetricFactory::instance();
+
+    // stages are listed in the order they were first used
+    foreach(QString name, QStringList() << "read" << "derived" << "metrics" << "meanmax" << "intervals" << "wbal")
+        if (!order.contains(name)) order << name;
+
+    // READ, also timed per source format (decode tcx, decode fit ...)
+    // so the readers can be compared across builds
+    QString source = "decode " + QFileInfo(filename).suffix().toLower();
+    if (!order.contains(source)) order << source;
+
+    RideFile *ride = NULL;
+    QStringList errs;
+    {
+        QFile file(filename);
+        StageProbe probe(stages["read"]);
+        StageProbe format(stages[source]);
+        ride = factory.openRideFile(context, file, errs);
+        if (ride) probe.samples = format.samples = ride->dataPoints().count();
+    }
+    stages[source].filebytes += QFileInfo(filename).size();
+    if (ride == NULL) {
+        errors << QString("%1: %2").arg(QFileInfo(filename).fileName()).arg(errs.join(" "));
+        return;
+    }
+
+    // both json readers must agree
+    if (QFileInfo(filename).suffix().toLower() == "json")
+        conform(filename, QFileInfo(filename).fileName());
+
+    // SCAN, just the summary as a listing would want it
+    if (!order.contains("scan")) order << "scan";
+    {
+        QFile file(filename);
+        RideFileSummary summary;
+        QStringList scanerrs;
+        StageProbe probe(stages["scan"]);
+        factory.scanRideFile(context, file, summary, scanerrs);
+    }
+    qint64 samples = ride->dataPoints().count();
+
+    // DERIVED SERIES
+    {
+        StageProbe probe(stages["derived"], samples);
+        ride->recalculateDerivedSeries(true);
+    }
+
+    // a standalone ride item, setup as RideItem::refresh() would
+    // the item owns the ride and will delete it
+    RideItem *item = new RideItem(ride, context);
+    item->dateTime = ride->startTime();
+    item->sport = ride->sport();
+    item->isBike = ride->isBike();
+    item->isRun = ride->isRun();
+    item->isSwim = ride->isSwim();
+    item->isXtrain = ride->isXtrain();
+    item->samples = samples > 0;
+    item->getWeight();
+    if (context->athlete->zones(item->isRun))
+        item->zoneRange = context->athlete->zones(item->isRun)->whichRange(item->dateTime.date());
+    if (context->athlete->hrZones(item->isRun))
+        item->hrZoneRange = context->athlete->hrZones(item->isRun)->whichRange(item->dateTime.date());
+
+    // METRICS
+    {
+        StageProbe probe(stages["metrics"], samples);
+        RideMetric::computeMetrics(item, Specification(), metrics.allMetrics());
+    }
+
+    // MEANMAX
+    {
+        StageProbe probe(stages["meanmax"], samples);
+        RideFileCache cache(ride);
+    }
+
+    // INTERVAL DISCOVERY
+    {
+        StageProbe probe(stages["intervals"], samples);
+        item->updateIntervals();
+    }
+
+    // W'BAL
+    {
+        StageProbe probe(stages["wbal"], samples);
+        WPrime wprime;
+        wprime.setRide(ride);
+    }
+
+#ifdef GC_WANT_PYTHON
+    // PYTHON, what a script pays to get at the data. The same series and
+    // metric columns are taken element by element and as lists, as scripts
+    // have always done, and then through the buffer protocol as numpy would.
+    // The ride is in the cache whilst we do so the season calls see it
+    if (python) {
+        static const char *scripts[][2] = {
+            { "python list",
+              "for s in range(GC.seriesLast()):\n"
+              "    if GC.seriesPresent(s): [v for v in GC.series(s)]\n"
+              "w = GC.activityWbal()\n"
+              "if w is not None: [v for v in w]\n"
+              "_bench = GC.seasonMetrics(True)\n" },
+            { NULL, // untimed, the metric names for the buffer route
+              "_bench = [k for k, v in _bench.items() if len(v) and isinstance(v[0], float)]\n" },
+            { "python buffer",
+              "for s in range(GC.seriesLast()):\n"
+              "    if GC.seriesPresent(s): memoryview(GC.series(s))\n"
+              "w = GC.activityWbal()\n"
+              "if w is not None: memoryview(w)\n"
+              "for name in _bench: memoryview(GC.metrics(name, True))\n" },
+            { NULL, NULL }
+        };
+
+        context->athlete->rideCache->rides() << item;
+        for (int i=0; scripts[i][1]; i++) {
+
+            if (scripts[i][0]) {
+                if (!order.contains(scripts[i][0])) order << scripts[i][0];
+                StageProbe probe(stages[scripts[i][0]], samples);
+                python->runline(ScriptContext(context, item), scripts[i][1]);
+            } else {
+                python->runline(ScriptContext(context, item), scripts[i][1]);
+            }
+
+            // the scripts print nothing, anything caught is an error
+            if (python->messages.join("").trimmed() != "") {
+                errors << QString("%1: python %2").arg(QFileInfo(filename).fileName()).arg(python->messages.join(" ").trimmed());
+                break;
+            }
+        }
+        context->athlete->rideCache->rides().removeAll(item);
+    }
+#endif
+
+    // WRITE AND READ BACK
+    foreach(QString format, QStringList() << "json" << "gcb" << "fit") {
+
+        if (!factory.writeSuffixes().contains(format)) continue;
+
+        QString write = "write " + format;
+        QString read = "read " + format;
+        if (!order.contains(write)) order << write << read;
+
+        QFile out(scratch.path() + "/bench." + format);
+        bool written;
+        {
+            StageProbe probe(stages[write], samples);
+            written = factory.writeRideFile(context, ride, out, format);
+        }
+        if (!written) {
+            errors << QString("%1: cannot write %2").arg(QFileInfo(filename).fileName()).arg(format);
+            continue;
+        }
+        stages[write].filebytes += QFileInfo(out.fileName()).size();
+
+        if (format == "json")
+            conform(out.fileName(), QFileInfo(filename).fileName() + " written back");
+
+        QFile in(out.fileName());
+        QStringList readerrs;
+        RideFile *back;
+        {
+            StageProbe probe(stages[read], samples);
+            back = factory.openRideFile(context, in, readerrs);
+        }
+        if (back == NULL) {
+            errors << QString("%1: cannot read back %2").arg(QFileInfo(filename).fileName()).arg(format);
+            continue;
+        }
+
+        // gcb must round trip exactly, json and fit round numbers
+        if (format == "gcb") {
+            QString diff = difference(ride, back);
+            if (diff != "") errors << QString("%1: gcb round trip differs, %2").arg(QFileInfo(filename).fileName()).arg(diff);
+        }
+        delete back;
+    }
+
+    // done with this one
+    foreach(IntervalItem *interval, item->intervals()) delete interval;
+    item->clearIntervals();
+    delete item;
+}
+
+// the first difference between two samples, or -1 if they are the same
+static int
+difference(const RideFilePoint *a, const RideFilePoint *b)
+{
+    for (int series=0; series < RideFile::none; series++)
+        if (a->value(RideFile::SeriesType(series)) != b->value(RideFile::SeriesType(series)))
+            return series;
+    return -1;
+}
+
+static QString
+difference(RideFile *a, RideFile *b)
+{
+    if (a->startTime() != b->startTime()) return "start time";
+    if (a->recIntSecs() != b->recIntSecs()) return "recording interval";
+    if (a->deviceType() != b->deviceType()) return "device type";
+    if (a->id() != b->id()) return "identifier";
+    if (a->tags() != b->tags()) return "tags";
+    if (a->metricOverrides != b->metricOverrides) return "overrides";
+
+    if (a->intervals().count() != b->intervals().count()) return "interval count";
+    for (int i=0; i<a->intervals().count(); i++) {
+        const RideFileInterval *x = a->intervals().at(i), *y = b->intervals().at(i);
+        if (x->type != y->type || x->start != y->start || x->stop != y->stop ||
+            x->name != y->name || x->test != y->test || x->color != y->color)
+            return QString("interval %1").arg(i);
+    }
+
+    if (a->calibrations().count() != b->calibrations().count()) return "calibration count";
+    for (int i=0; i<a->calibrations().count(); i++) {
+        const RideFileCalibration *x = a->calibrations().at(i), *y = b->calibrations().at(i);
+        if (x->start != y->start || x->value != y->value || x->name != y->name)
+            return QString("calibration %1").arg(i);
+    }
+
+    if (a->referencePoints().count() != b->referencePoints().count()) return "reference count";
+    for (int i=0; i<a->referencePoints().count(); i++) {
+        int series = difference(a->referencePoints().at(i), b->referencePoints().at(i));
+        if (series >= 0) return QString("reference %1 %2").arg(i).arg(RideFile::seriesName(RideFile::SeriesType(series), true));
+    }
+
+    if (a->dataPoints().count() != b->dataPoints().count()) return "sample count";
+    for (int i=0; i<a->dataPoints().count(); i++) {
+        int series = difference(a->dataPoints().at(i), b->dataPoints().at(i));
+        if (series >= 0) return QString("sample %1 %2").arg(i).arg(RideFile::seriesName(RideFile::SeriesType(series), true));
+    }
+
+    if (a->xdata().keys() != b->xdata().keys()) return "xdata series";
+    foreach(QString name, a->xdata().keys()) {
+        const XDataSeries *x = a->xdata().value(name), *y = b->xdata().value(name);
+        if (x->valuename != y->valuename || x->unitname != y->unitname || x->valuetype != y->valuetype)
+            return QString("xdata %1 header").arg(name);
+        if (x->datapoints.count() != y->datapoints.count()) return QString("xdata %1 sample count").arg(name);
+        for (int i=0; i<x->datapoints.count(); i++) {
+            const XDataPoint *p = x->datapoints.at(i), *q = y->datapoints.at(i);
+            bool same = p->secs == q->secs && p->km == q->km &&
+                        p->number.count() == q->number.count() && p->string.count() == q->string.count();
+            for (int j=0; same && j<p->number.count(); j++) same = p->number.at(j) == q->number.at(j);
+            for (int j=0; same && j<p->string.count(); j++) same = p->string.at(j) == q->string.at(j);
+            if (!same) return QString("xdata %1 sample %2").arg(name).arg(i);
+        }
+    }
+    return QString();
+}
+
+// read with the streaming reader and the grammar, they must agree
+void
+Benchmark::conform(QString filename, QString name)
+{
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly)) return;
+    QByteArray bytes = file.readAll();
+    file.close();
+
+    RideFile *streamed = new RideFile;
+    QString streamerror;
+    bool streamok = JsonStreamReader(bytes).parse(streamed, streamerror);
+
+    QStringList grammarerrors;
+    RideFile *parsed = JsonFileReader::parseGrammar(bytes, grammarerrors);
+
+    // legacy latin1 files are left to the grammar, that's expected
+    QTextCodec::ConverterState state;
+    QTextCodec::codecForName("UTF-8")->toUnicode(bytes.constData(), bytes.size(), &state);
+    bool legacy = state.invalidChars > 0;
+
+    QString diff;
+    if (!streamok && parsed == NULL) diff = "neither can read it";
+    else if (parsed == NULL) diff = "grammar failed";
+    else if (!streamok) { if (!legacy) diff = "streaming reader failed, " + streamerror; }
+    else diff = difference(streamed, parsed);
+
+    conformed++;
+    if (diff != "") {
+        mismatched++;
+        errors << QString("%1: json readers differ, %2").arg(name).arg(diff);
+    }
+    delete streamed;
+    delete parsed;
+}
+
+void
+Benchmark::sync(QStringList filenames)
+{
+    // a local store in the scratch directory, so the sync is
+    // measured without the network getting in the way
+    QDir folder(scratch.path() + "/localstore");
+    if (!folder.mkpath(folder.absolutePath())) return;
+
+    if (!CloudServiceFactory::instance().serviceNames().contains("Local Store")) return;
+    CloudService *store = CloudServiceFactory::instance().newService("Local Store", context);
+    store->setSetting(GC_NETWORKFILESTORE_FOLDER, folder.absolutePath());
+
+    foreach(QString name, QStringList() << "sync upload" << "sync download")
+        if (!order.contains(name)) order << name;
+
+    // UPLOAD the corpus
+    {
+        CloudTransferScheduler transfers(context, store);
+        foreach(QString filename, filenames) transfers.upload(filename);
+        transfer(transfers, stages["sync upload"]);
+    }
+
+    // DOWNLOAD it all back
+    {
+        CloudTransferScheduler transfers(context, store);
+        foreach(QString name, folder.entryList(QDir::Files, QDir::Name)) transfers.download(name, name);
+        transfer(transfers, stages["sync download"]);
+    }
+
+    delete store;
+}
+
+void
+Benchmark::transfer(CloudTransferScheduler &transfers, Stage &stage)
+{
+    CloudTransferTally *tally = new CloudTransferTally(&transfers); // deleted with transfers
+
+    QEventLoop loop;
+    QObject::connect(&transfers, SIGNAL(finished()), &loop, SLOT(quit()));
+
+    QElapsedTimer timer;
+    timer.start();
+#ifdef GC_WANT_ALLOCCOUNT
+    qint64 allocs = allocCount.load();
+    qint64 bytes = allocBytes.load();
+    qint64 live = allocLive.load();
+    allocPeak.store(live);
+#endif
+
+    // local stores may finish before start() returns
+    transfers.start();
+    if (transfers.isRunning()) loop.exec();
+
+    stage.nsecs += timer.nsecsElapsed();
+    stage.files += tally->files;
+    stage.samples += tally->samples;
+#ifdef GC_WANT_ALLOCCOUNT
+    stage.allocs += allocCount.load() - allocs;
+    stage.bytes += allocBytes.load() - bytes;
+    stage.peak = qMax(stage.peak, allocPeak.load() - live);
+#endif
+    errors << tally->errors;
+}
+
+QString
+Benchmark::results()
+{
+    QJsonObject root;
+    root.insert("version", QString(VERSION_STRING));
+    root.insert("build", VERSION_LATEST);
+    root.insert("files", files);
+    root.insert("secs", double(elapsed) / 1000000000.0);
+    root.insert("peakrss", double(peakRSS()));
+
+    QJsonObject conformance;
+    conformance.insert("files", conformed);
+    conformance.insert("mismatches", mismatched);
+    root.insert("jsonconformance", conformance);
+
+    QJsonArray list;
+    foreach(QString name, order) {
+
+        const Stage &stage = stages[name];
+        double secs = double(stage.nsecs) / 1000000000.0;
+
+        QJsonObject entry;
+        entry.insert("stage", name);
+        entry.insert("files", stage.files);
+        entry.insert("samples", double(stage.samples));
+        entry.insert("secs", secs);
+        entry.insert("filespersec", secs > 0 ? stage.files / secs : 0);
+        entry.insert("samplespersec", secs > 0 ? stage.samples / secs : 0);
+        if (stage.filebytes) {
+            entry.insert("filebytes", double(stage.filebytes));
+            entry.insert("bytespersample", stage.samples ? double(stage.filebytes) / stage.samples : 0);
+        }
+#ifdef GC_WANT_ALLOCCOUNT
+        entry.insert("allocs", double(stage.allocs));
+        entry.insert("allocbytes", double(stage.bytes));
+        entry.insert("peakheap", double(stage.peak));
+#endif
+        list.append(entry);
+    }
+    root.insert("stages", list);
+
+    QJsonArray failed;
+    foreach(QString error, errors) failed.append(error);
+    root.insert("errors", failed);
+
+    return QString(QJsonDocument(root).toJson(QJsonDocument::Indented));
+}
+
+qint64
+Benchmark::peakRSS()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef Q_OS_MAC
+        return usage.ru_maxrss; // bytes on a Mac
+#else
+        return qint64(usage.ru_maxrss) * 1024; // kilobytes elsewhere
+#endif
+    }
+#endif
+    return -1;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_Benchmark_h
+#define _GC_Benchmark_h
+
+#include <QString>
+#include <QStringList>
+#include <QDir>
+#include <QMap>
+#include <QTemporaryDir>
+
+class Context;
+class CloudTransferScheduler;
+
+//
+// Headless benchmark over the test/ corpus, run via
+//
+//     GoldenCheetah --bench [testdir [results.json]]
+//
+// Every ride in test/rides, runs, swims and aerolab is pushed through
+// the same stages the ride cache uses when refreshing an activity and
+// the time spent in each stage is reported as JSON so results can be
+// compared across builds to spot regressions. Reading is also reported
+// per source format ("decode fit", "decode tcx" ...) for decode throughput,
+// and against "scan", which only reads what a file listing needs. The
+// decode and write stages report the size of the files ("filebytes") so
+// throughput per byte, and the .gcb and .json formats, can be compared.
+// When built with GC_WANT_ALLOCCOUNT every stage also reports the heap
+// it allocated and the most it held at once for a single file
+// ("peakheap"), e.g. for the TCX and GPX readers on test/rides.
+//
+// When built with Python the "python list" and "python buffer" stages
+// time a script taking every series, W'bal and the season metrics first
+// element by element and as lists, as scripts always have, and then
+// through the buffer protocol, so the two routes can be compared.
+//
+// The files are then uploaded to, and downloaded back from, a local
+// store through the cloud sync transfer scheduler so sync throughput
+// can be measured without a network.
+//
+// Every .json, the originals and those written back, is also read by
+// both the streaming reader and the bison grammar and the two rides
+// compared field by field and sample by sample. Any difference is
+// reported as an error, the counts are in "jsonconformance".
+//
+// A scratch athlete is created in a temporary directory so the user's
+// own settings and athletes are never touched.
+//
+class Benchmark
+{
+    public:
+
+        Benchmark(QString testdir);
+        ~Benchmark();
+
+        // run all stages over all files and write results to
+        // filename, or stdout when empty. returns exit code
+        int run(QString filename);
+
+        // counters kept per stage
+        struct Stage {
+            Stage() : files(0), samples(0), nsecs(0), allocs(0), bytes(0), peak(0), filebytes(0) {}
+            int files;
+            qint64 samples;
+            qint64 nsecs;
+            qint64 allocs, bytes; // only when built with GC_WANT_ALLOCCOUNT
+            qint64 peak; // most heap held at once by one file, ditto
+            qint64 filebytes; // size of the files decoded or written
+        };
+
+        // peak resident set size in bytes, -1 if not known
+        static qint64 peakRSS();
+
+    private:
+
+        bool setup();
+        void bench(QString filename);
+        void conform(QString filename, QString name);
+        void sync(QStringList filenames);
+        void transfer(CloudTransferScheduler &transfers, Stage &stage);
+        QString results();
+
+        QDir testdir;
+        QTemporaryDir scratch;
+        Context *context;
+
+        // stage name to counters, in order of first use
+        QStringList order;
+        QMap<QString, Stage> stages;
+        QStringList errors;
+        int files;
+        qint64 elapsed;
+        int conformed, mismatched; // json readers compared
+};
+
+#endif
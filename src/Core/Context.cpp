@@ -53,6 +53,12 @@ Context::~Context()
     if (i >= 0) _contexts.removeAt(i);
 }
 
+QList<Context*>
+Context::contexts()
+{
+    return _contexts;
+}
+
 void 
 Context::notifyCompareIntervals(bool state) 
 { 
@@ -77,6 +77,9 @@ class Context : public QObject
         Context(MainWindow *mainWindow);
         ~Context();
 
+        // every open context, one per athlete tab
+        static QList<Context*> contexts();
+
         // mainwindow state
         int viewIndex;
         bool showSidebar, showLowbar, showToolbar, showTabbar;
@@ -17,11 +17,13 @@
  */
 
 #include "Utils.h"
+#include "Trace.h"
 #include "Statistic.h"
 #include "DataFilter.h"
 #include "Context.h"
 #include "Athlete.h"
 #include "RideItem.h"
+#include "RideResidency.h"
 #include "IntervalItem.h"
 #include "RideNavigator.h"
 #include "RideFileCache.h"
@@ -2686,6 +2688,8 @@ DataFilter::DataFilter(QObject *parent, Context *context, QString formula) : QOb
 
 Result DataFilter::evaluate(RideItem *item, RideFilePoint *p)
 {
+    GC_TRACE("DataFilter::evaluate");
+
     if (!item || !treeRoot || DataFiltererrors.count())
         return Result(0);
 
@@ -2744,6 +2748,8 @@ QStringList DataFilter::check(QString query)
 
 QStringList DataFilter::parseFilter(Context *context, QString query, QStringList *list)
 {
+    GC_TRACE("DataFilter::parseFilter");
+
     // remember where we apply
     this->list = list;
     rt.isdynamic=false;
@@ -6263,7 +6269,8 @@ DataFilterRuntime::runPythonScript(Context *context, QString script, RideItem *m
 
     try {
 
-        // run it
+        // run it, scripts can get at any ride
+        RideResidencyHold hold(context);
         python->runline(ScriptContext(context, m, metrics, spec), script);
         result = python->result;
 
@@ -17,123 +17,90 @@
  */
 
 #include "Quadtree.h"
+#include <QHash>
+#include <QByteArray>
+#include <algorithm>
 
-// add a node
-bool
-QuadtreeNode::insert(Quadtree *root, QPointF value)
+static bool lessxy(const QPointF &a, const QPointF &b)
 {
-    if (!contains(value)) return false;
-
-    // here will do
-    if (leaf && contents.count() < maxentries) {
-        if (!contents.contains(value)) contents.append(value); // de dupe
-        return true;
-    }
-
-    // full, so split out
-    if (leaf)  split(root);
-
-    // find me a home below
-    for(int i=0; i<4; i++)
-        if (aabb[i]->insert(root, value) == true)
-            return true;
-
-    // should not get here
-    return false;
+    return a.x() < b.x() || (a.x() == b.x() && a.y() < b.y());
 }
 
-// get candidates
-int
-QuadtreeNode::candidates(QRectF rect, QList<QPointF> &here)
+uint
+Quadtree::fingerprint(const QVector<double> &x, const QVector<double> &y)
 {
-    // nope
-    if (!intersect(rect)) return 0;
-
-    if (leaf) {
-
-        // lemme see if any of mine match
-        int found=0;
-        for(int i=0; i<contents.count(); i++) {
-            if (rect.contains(contents.at(i))) {
-                here.append(contents.at(i));
-                found++;
-            }
-        }
-        return found;
-
-    } else {
-
-        // recurse through my children
-        int count=0;
-        for (int i=0; i<4; i++)
-            count += aabb[i]->candidates(rect, here);
-        return count;
-    }
+    // hash the raw bytes, way cheaper than a rebuild
+    uint h = qHash(QByteArray::fromRawData(reinterpret_cast<const char*>(x.constData()), x.count() * sizeof(double)));
+    return qHash(QByteArray::fromRawData(reinterpret_cast<const char*>(y.constData()), y.count() * sizeof(double)), h);
 }
 
-// infitesmal amount to make quadtrees have slightly
-// tiny differences on boundaries
-static double tiny = 0.000000001;
-
-// split leaf into nodes (when to many entries)
 void
-QuadtreeNode::split(Quadtree *root)
+Quadtree::build(const QVector<double> &x, const QVector<double> &y)
 {
-    leaf=false;
-    aabb[0]=root->newnode(topleft, mid);
-    aabb[1]=root->newnode(QPointF(mid.x(),topleft.y()), QPointF(bottomright.x(), mid.y()));
-    aabb[2]=root->newnode(QPointF(topleft.x(),mid.y()), QPointF(mid.x(), bottomright.y()));
-    aabb[3]=root->newnode(mid,bottomright);
-
-    // find them homes and clear here
-    for(int i=0; i<contents.count(); i++)
-        for(int j=0; j<4; j++)
-            if (aabb[j]->insert(root, contents.at(i)) == true)
-                break;
-    contents.clear();
-
-}
-
-Quadtree::Quadtree(QPointF topleft, QPointF bottomright)
-{
-    root = new QuadtreeNode(topleft, bottomright);
-}
-
-// manage the entire child tree on a single qvector to delete quickly
-void
-Quadtree::reset (QPointF topleft, QPointF bottomright)
-{
-    for(int i=0; i<nodes.count(); i++) delete nodes.at(i);
     nodes.clear();
-    delete root;
-    root = new QuadtreeNode(topleft,bottomright);
-}
+    points.clear();
+    fp = fingerprint(x, y);
+
+    // collect the points we index
+    int n = qMin(x.count(), y.count());
+    points.reserve(n);
+    for (int i=0; i<n; i++)
+        if (x.at(i) != 0 && y.at(i) != 0) // 0,0 is common and lets ignore (usually means no data)
+            points.append(QPointF(x.at(i), y.at(i)));
+
+    if (points.isEmpty()) return;
+
+    // de dupe, sample data has lots of repeats
+    std::sort(points.begin(), points.end(), lessxy);
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+    points.squeeze();
+
+    // root covers the data range
+    QPointF topleft(points.first().x(), points.first().y()), bottomright(topleft);
+    foreach(const QPointF &p, points) {
+        if (p.y() < topleft.y()) topleft.setY(p.y());
+        if (p.y() > bottomright.y()) bottomright.setY(p.y());
+    }
+    bottomright.setX(points.last().x()); // sorted by x
 
-Quadtree::~Quadtree()
-{
-    // zap the nodes
-    for(int i=0; i<nodes.count(); i++) delete nodes.at(i);
-    nodes.clear();
-    delete root;
+    nodes.reserve(1 + (points.count() / maxentries) * 2);
+    nodes.append(QuadtreeNode(topleft, bottomright, 0, points.count()));
+    split(0, 0);
+    nodes.squeeze();
 }
 
-QuadtreeNode *
-Quadtree::newnode(QPointF topleft, QPointF bottomright)
+// split node into quadrants (when too many entries)
+void
+Quadtree::split(int index, int depth)
 {
-    QuadtreeNode *add = new QuadtreeNode(topleft, bottomright);
-    nodes.append(add);
-    return add;
+    // take a copy, append below may reallocate
+    const QuadtreeNode node = nodes.at(index);
+    if (node.end - node.start <= maxentries || depth >= maxdepth) return;
+
+    const QPointF topleft=node.topleft, bottomright=node.bottomright;
+    const QPointF mid = (topleft+bottomright)/2.0;
+
+    // partition in place, top/bottom then left/right of each
+    QPointF *base = points.data();
+    QPointF *begin = base + node.start, *end = base + node.end;
+    QPointF *ymid = std::partition(begin, end, [mid](const QPointF &p) { return p.y() < mid.y(); });
+    QPointF *x1 = std::partition(begin, ymid, [mid](const QPointF &p) { return p.x() < mid.x(); });
+    QPointF *x2 = std::partition(ymid, end, [mid](const QPointF &p) { return p.x() < mid.x(); });
+
+    // children are stored together
+    int first = nodes.count();
+    nodes[index].children = first;
+    nodes.append(QuadtreeNode(topleft, mid, node.start, x1-base));
+    nodes.append(QuadtreeNode(QPointF(mid.x(),topleft.y()), QPointF(bottomright.x(), mid.y()), x1-base, ymid-base));
+    nodes.append(QuadtreeNode(QPointF(topleft.x(),mid.y()), QPointF(mid.x(), bottomright.y()), ymid-base, x2-base));
+    nodes.append(QuadtreeNode(mid, bottomright, x2-base, node.end));
+
+    for(int i=0; i<4; i++) split(first+i, depth+1);
 }
 
-bool Quadtree::insert(QPointF point)
+// get candidates
+int
+Quadtree::candidates(QRectF rect, QVector<QPointF> &here) const
 {
-    bool result= root->insert(this, point);
-    if (result == false) {
-
-        fprintf(stderr, "quadtree: insert failed (%f,%f) in [%f,%f = %f-%f]\n", point.x(), point.y(),
-                                                                               root->topleft.x(), root->topleft.y(),
-                                                                               root->bottomright.x(), root->bottomright.y());
-        fflush(stderr);
-    }
-    return result;
+    return visit(rect, [&here](const QPointF &p) { here.append(p); });
 }
@@ -21,77 +21,111 @@
 
 #include <QPointF>
 #include <QRectF>
-#include <QList>
+#include <QVector>
+
+// The quadtree is bulk loaded from the series data in one pass and
+// stored flat; all the points live in a single array that is partitioned
+// in place so every node refers to a contiguous [start,end) range and
+// the four children of a node are always stored next to each other.
+//
+// Memory is bounded by the number of points, we never hold more than
+// one copy of each (de-duplicated) point and the node count is at most
+// ~ points/maxentries * 4/3 since we never split small quadrants.
+//
+// It is used for hover and select on scatter charts where there may be
+// millions of points (e.g. all samples across a season).
 
-class GenericPlot;
-class Quadtree;
 class QuadtreeNode
 {
-    static const int maxdepth=12;
-    static const int maxentries=25;
-
-    friend class ::Quadtree;
-    friend class ::GenericPlot;
-
     public:
 
-        // constructor makes an empty leaf
-        QuadtreeNode(QPointF topleft, QPointF bottomright) :
-              topleft(topleft), bottomright(bottomright), mid((topleft+bottomright)/2.0), leaf(true) {}
-
-        // is the point in our space - when inserting
-        bool contains(QPointF p) { return ((p.x() >= topleft.x() && p.x() <= bottomright.x()) &&
-                                           p.y() >= topleft.y() && p.y() <= bottomright.y()); }
+        QuadtreeNode() : start(0), end(0), children(-1) {}
+        QuadtreeNode(QPointF topleft, QPointF bottomright, int start, int end) :
+              topleft(topleft), bottomright(bottomright), start(start), end(end), children(-1) {}
 
-        // do we overlap with the search space - when looking
-        bool intersect(QRectF r) { return r.intersects(QRectF(topleft,bottomright)); }
-
-        // add a point - return false if not added
-        bool insert(Quadtree *root, QPointF value);
-
-        // get candidates in same quadrant (might be miles away for big quadrant).
-        int candidates(QRectF,QList<QPointF>&tohere);
-
-    protected:
+        // do we overlap with the (normalized) search space - when looking
+        bool intersect(const QRectF &r) const { return r.left() <= bottomright.x() && r.right() >= topleft.x() &&
+                                                       r.top() <= bottomright.y() && r.bottom() >= topleft.y(); }
 
-        // split leaf into nodes (when to many entries)
-        void split(Quadtree *root);
+        bool leaf() const { return children < 0; }
 
         // geom of quadrant
-        QPointF topleft, bottomright, mid;
+        QPointF topleft, bottomright;
 
-        // AABB children (also in a freelist in Quadtree)
-        QuadtreeNode *aabb[4];
+        // the points in this quadrant are points[start] to points[end-1]
+        int start, end;
 
-        // the points in this quadrant
-        QList<QPointF> contents;
-
-        // if no children in aabb leaf==true
-        bool leaf;
+        // index of first of four children, -1 if we are a leaf
+        int children;
 };
 
 class Quadtree
 {
-    friend class ::GenericPlot;
+    static const int maxdepth=12;
+    static const int maxentries=25;
 
     public:
-        Quadtree (QPointF topleft, QPointF bottomright);
-        ~Quadtree();
+        Quadtree() : fp(0) {}
+
+        // bulk load, replacing anything already loaded, 0,0 points are
+        // ignored since they are common and usually means no data
+        void build(const QVector<double> &x, const QVector<double> &y);
 
-        // add a point - returns false if not in range
-        bool insert(QPointF x);
+        // how many (distinct) points are indexed
+        int count() const { return points.count(); }
 
-        // find points in boundg rect, of course might be long way away...
-        int candidates(QRectF rect, QList<QPointF>&tohere) { return root->candidates(rect, tohere); }
+        // fingerprint of the data used to build, so callers can avoid
+        // rebuilding when a series is refreshed but has not changed
+        uint fingerprint() const { return fp; }
+        static uint fingerprint(const QVector<double> &x, const QVector<double> &y);
 
-        // manage the entire child tree on a single qvector to delete quickly
-        QuadtreeNode *newnode(QPointF topleft, QPointF bottomright);
-        void reset (QPointF topleft, QPointF bottomright);
-        QVector<QuadtreeNode *> nodes;
+        // find points in bounding rect, appended to tohere
+        int candidates(QRectF rect, QVector<QPointF>&tohere) const;
+
+        // call f(const QPointF &) for every point in rect without copying
+        template<typename F> int visit(QRectF rect, F f) const;
 
     protected:
-        QuadtreeNode *root;
+
+        // recursively partition the points for node, depth first
+        void split(int node, int depth);
+
+        QVector<QuadtreeNode> nodes; // nodes[0] is the root
+        QVector<QPointF> points;
+        uint fp;
 };
 
+template<typename F> int
+Quadtree::visit(QRectF rect, F f) const
+{
+    if (nodes.isEmpty()) return 0;
+
+    // screen to value mapping will usually flip the y-axis
+    rect = rect.normalized();
+
+    // iterative, each level pops one and pushes four
+    int stack[(maxdepth+2)*4];
+    int sp=0, found=0;
+    stack[sp++] = 0;
+
+    while (sp) {
+        const QuadtreeNode &node = nodes.at(stack[--sp]);
+
+        if (!node.intersect(rect)) continue;
+
+        if (node.leaf()) {
+            for(int i=node.start; i<node.end; i++) {
+                const QPointF &p = points.at(i);
+                if (p.x() >= rect.left() && p.x() <= rect.right() && p.y() >= rect.top() && p.y() <= rect.bottom()) {
+                    f(p);
+                    found++;
+                }
+            }
+        } else {
+            for(int i=0; i<4; i++) stack[sp++] = node.children+i;
+        }
+    }
+    return found;
+}
 
 #endif
@@ -17,6 +17,8 @@
  */
 
 #include "RideCache.h"
+#include "Trace.h"
+#include "RideResidency.h"
 
 #include "Context.h"
 #include "Athlete.h"
@@ -57,6 +59,7 @@ RideCache::RideCache(Context *context) : context(context)
     progress_ = 100;
     exiting = false;
     estimator = new Estimator(context);
+    residency_ = new RideResidency(context, this);
 
     // initial load of user defined metrics - do once we have an initial context
     // but before we refresh or check metrics for the first time
@@ -390,8 +393,8 @@ RideCache::removeCurrentRide()
 // RideCache::load() and save() -- see RideDB.y
 
 // export metrics to csv, for users to play with R, Matlab, Excel etc
-void
-RideCache::writeAsCSV(QString filename)
+bool
+RideCache::writeAsCSV(QString filename, Specification spec)
 {
     const RideMetricFactory &factory = RideMetricFactory::instance();
     QVector<const RideMetric *> indexed(factory.metricCount());
@@ -406,12 +409,15 @@ RideCache::writeAsCSV(QString filename)
     // open file.. truncate if exists already
     QFile file(filename);
     if (!file.open(QFile::WriteOnly)) {
-        QMessageBox msgBox;
-        msgBox.setIcon(QMessageBox::Critical);
-        msgBox.setText(tr("Problem Saving Ride Cache"));
-        msgBox.setInformativeText(tr("File: %1 cannot be opened for 'Writing'. Please check file properties.").arg(filename));
-        msgBox.exec();
-        return;
+        // no one to tell when headless
+        if (context->mainWindow) {
+            QMessageBox msgBox;
+            msgBox.setIcon(QMessageBox::Critical);
+            msgBox.setText(tr("Problem Saving Ride Cache"));
+            msgBox.setInformativeText(tr("File: %1 cannot be opened for 'Writing'. Please check file properties.").arg(filename));
+            msgBox.exec();
+        }
+        return false;
     };
     file.resize(0);
     QTextStream out(&file);
@@ -429,6 +435,9 @@ RideCache::writeAsCSV(QString filename)
     // write values
     foreach(RideItem *item, rides()) {
 
+        // skip filtered rides
+        if (!spec.pass(item)) continue;
+
         // date, time, filename
         out << item->dateTime.date().toString("MM/dd/yy");
         out << "," << item->dateTime.time().toString("hh:mm:ss");
@@ -442,11 +451,14 @@ RideCache::writeAsCSV(QString filename)
         out<<"\n";
     }
     file.close();
+    return true;
 }
 
 void
 itemRefresh(RideItem *&item)
 {
+    GC_TRACE("itemRefresh");
+
     // need parser to be reentrant !item->refresh();
     if (item->isstale) {
         item->refresh();
@@ -486,6 +498,8 @@ RideCache::cancel()
 void
 RideCache::refresh()
 {
+    GC_TRACE("RideCache::refresh");
+
     // already on it !
     if (future.isRunning()) return;
 
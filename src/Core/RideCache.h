@@ -40,6 +40,7 @@ class AthleteBest;
 class RideCacheModel;
 class Estimator;
 class Banister;
+class RideResidency;
 
 class RideCache : public QObject
 {
@@ -53,6 +54,9 @@ class RideCache : public QObject
         // table models
         RideCacheModel *model() { return model_; }
 
+        // which rides are open and closing them when memory is tight
+        RideResidency *residency() { return residency_; }
+
         // query the cache
         int count() const { return rides_.count(); }
         RideItem *getRide(QString filename);
@@ -89,8 +93,8 @@ class RideCache : public QObject
         void addRide(QString name, bool dosignal, bool select, bool useTempActivities, bool planned);
         void removeCurrentRide();
 
-        // export metrics in CSV format
-        void writeAsCSV(QString filename);
+        // export metrics in CSV format, for the activities in spec
+        bool writeAsCSV(QString filename, Specification spec=Specification());
 
         // the background refresher !
         void refresh();
@@ -141,6 +145,7 @@ class RideCache : public QObject
 
         QVector<RideItem*> rides_, reverse_, delete_;
         RideCacheModel *model_;
+        RideResidency *residency_;
         bool exiting;
 	    double progress_; // percent
 
@@ -17,6 +17,7 @@
  */
 
 #include "RideItem.h"
+#include "Trace.h"
 #include "RideMetric.h"
 #include "RideFile.h"
 #include "RideFileCache.h"
@@ -24,6 +25,9 @@
 #include "IntervalItem.h"
 #include "Route.h"
 #include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "RideResidency.h"
 #include "Zones.h"
 #include "HrZones.h"
 #include "PaceZones.h"
@@ -45,7 +49,7 @@
 RideItem::RideItem() 
     : 
     ride_(NULL), fileCache_(NULL), context(NULL), isdirty(false), isstale(true), isedit(false), skipsave(false), path(""), fileName(""),
-    color(QColor(1,1,1)), sport(""), isBike(false), isRun(false), isSwim(false), isXtrain(false), samples(false), zoneRange(-1), hrZoneRange(-1), paceZoneRange(-1), fingerprint(0), metacrc(0), crc(0), timestamp(0), dbversion(0), udbversion(0), weight(0) {
+    color(QColor(1,1,1)), sport(""), isBike(false), isRun(false), isSwim(false), isXtrain(false), samples(false), zoneRange(-1), hrZoneRange(-1), paceZoneRange(-1), fingerprint(0), metacrc(0), crc(0), timestamp(0), dbversion(0), udbversion(0), weight(0), lastused(0) {
     metrics_.fill(0, RideMetricFactory::instance().metricCount());
     count_.fill(0, RideMetricFactory::instance().metricCount());
 }
@@ -53,7 +57,7 @@ RideItem::RideItem()
 RideItem::RideItem(RideFile *ride, Context *context) 
     : 
     ride_(ride), fileCache_(NULL), context(context), isdirty(false), isstale(true), isedit(false), skipsave(false), path(""), fileName(""),
-    color(QColor(1,1,1)), sport(""), isBike(false), isRun(false), isSwim(false), isXtrain(false), samples(false), zoneRange(-1), hrZoneRange(-1), paceZoneRange(-1), fingerprint(0), metacrc(0), crc(0), timestamp(0), dbversion(0), udbversion(0), weight(0)
+    color(QColor(1,1,1)), sport(""), isBike(false), isRun(false), isSwim(false), isXtrain(false), samples(false), zoneRange(-1), hrZoneRange(-1), paceZoneRange(-1), fingerprint(0), metacrc(0), crc(0), timestamp(0), dbversion(0), udbversion(0), weight(0), lastused(0)
 {
     metrics_.fill(0, RideMetricFactory::instance().metricCount());
     count_.fill(0, RideMetricFactory::instance().metricCount());
@@ -63,7 +67,7 @@ RideItem::RideItem(QString path, QString fileName, QDateTime &dateTime, Context
     :
     ride_(NULL), fileCache_(NULL), context(context), isdirty(false), isstale(true), isedit(false), skipsave(false), path(path), fileName(fileName),
     dateTime(dateTime), color(QColor(1,1,1)), planned(planned), sport(""), isBike(false), isRun(false), isSwim(false), isXtrain(false), samples(false), zoneRange(-1), hrZoneRange(-1), paceZoneRange(-1), fingerprint(0),
-    metacrc(0), crc(0), timestamp(0), dbversion(0), udbversion(0), weight(0) 
+    metacrc(0), crc(0), timestamp(0), dbversion(0), udbversion(0), weight(0), lastused(0) 
 {
     metrics_.fill(0, RideMetricFactory::instance().metricCount());
     count_.fill(0, RideMetricFactory::instance().metricCount());
@@ -74,7 +78,7 @@ RideItem::RideItem(QString path, QString fileName, QDateTime &dateTime, Context
 RideItem::RideItem(RideFile *ride, QDateTime &dateTime, Context *context)
     :
     ride_(ride), fileCache_(NULL), context(context), isdirty(true), isstale(true), isedit(false), skipsave(false), dateTime(dateTime),
-    zoneRange(-1), hrZoneRange(-1), paceZoneRange(-1), fingerprint(0), metacrc(0), crc(0), timestamp(0), dbversion(0), udbversion(0), weight(0)
+    zoneRange(-1), hrZoneRange(-1), paceZoneRange(-1), fingerprint(0), metacrc(0), crc(0), timestamp(0), dbversion(0), udbversion(0), weight(0), lastused(0)
 {
     metrics_.fill(0, RideMetricFactory::instance().metricCount());
     count_.fill(0, RideMetricFactory::instance().metricCount());
@@ -171,7 +175,12 @@ RideItem::metaCRC()
 
 RideFile *RideItem::ride(bool open)
 {
-    if (!open || ride_) return ride_;
+    RideResidency *residency = context && context->athlete && context->athlete->rideCache ? context->athlete->rideCache->residency() : NULL;
+
+    if (!open || ride_) {
+        if (ride_ && residency) residency->touch(this);
+        return ride_;
+    }
 
     // open the ride file
     QFile file(path + "/" + fileName);
@@ -233,6 +242,9 @@ RideFile *RideItem::ride(bool open)
     connect(ride_, SIGNAL(saved()), this, SLOT(saved()));
     connect(ride_, SIGNAL(reverted()), this, SLOT(reverted()));
 
+    // may close others if we're over budget
+    if (residency) residency->opened(this);
+
     return ride_;
 }
 
@@ -441,6 +453,9 @@ RideItem::close()
         foreach(IntervalItem *x, intervals()) x->rideInterval = NULL;
         delete ride_;
         ride_ = NULL;
+
+        if (context && context->athlete && context->athlete->rideCache)
+            context->athlete->rideCache->residency()->closed(this);
     }
 
     // and the cpx data
@@ -545,6 +560,8 @@ RideItem::checkStale()
 void
 RideItem::refresh()
 {
+    GC_TRACE("RideItem::refresh");
+
     if (!isstale) return;
 
     // update current state coz we'll fix it below
@@ -839,6 +856,8 @@ static bool intervalGreaterThanZone(const IntervalItem *a, const IntervalItem *b
 void
 RideItem::updateIntervals()
 {
+    GC_TRACE("RideItem::updateIntervals");
+
     // what do we need ?
     int discovery = appsettings->cvalue(context->athlete->cyclist, GC_DISCOVERY, 57).toInt(); // 57 does not include search for PEAKS
 
@@ -38,6 +38,8 @@ class IntervalSummaryWindow;
 class Context;
 class UserData;
 class ComparePane;
+class RideResidency;
+class RideResidencyDialog;
 
 Q_DECLARE_METATYPE(RideItem*)
 
@@ -56,6 +58,8 @@ class RideItem : public QObject
         friend class ::IntervalSummaryWindow;
         friend class ::UserData;
         friend class ::ComparePane;
+        friend class ::RideResidency;
+        friend class ::RideResidencyDialog;
 
         // ridefile
         RideFile *ride_;
@@ -154,6 +158,7 @@ class RideItem : public QObject
         int dbversion; // metric version
         int udbversion; // user metric version
         double weight; // what weight was used ?
+        qint64 lastused; // when ride() was last called, see RideResidency
 
         // access to the cached data !
         BodyMeasure weightData;
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideResidency.h"
+
+#include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "RideFile.h"
+#include "Settings.h"
+#include "Colors.h"
+
+#include <QThread>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QSpinBox>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+
+RideResidency::RideResidency(Context *context, QObject *parent) : QObject(parent), context(context), clock(0), holds(0), scheduled(false)
+{
+    // we don't close rides while the cache is refreshing, so
+    // check again once its done
+    connect(context, SIGNAL(refreshEnd()), this, SLOT(enforce()));
+}
+
+void
+RideResidency::opened(RideItem *item)
+{
+    // the background refresh opens and closes rides itself, we
+    // only look after rides opened for the user interface
+    if (QThread::currentThread() != thread()) return;
+
+    lock.lock();
+    open.insert(item);
+    lock.unlock();
+
+    touch(item);
+    schedule();
+}
+
+void
+RideResidency::closed(RideItem *item)
+{
+    QMutexLocker locker(&lock);
+    open.remove(item);
+}
+
+void
+RideResidency::hold()
+{
+    holds.ref();
+}
+
+void
+RideResidency::unhold()
+{
+    // may be able to close some now, queued since
+    // scripts can run from any thread
+    if (!holds.deref() && budget()) QMetaObject::invokeMethod(this, "enforce", Qt::QueuedConnection);
+}
+
+QList<RideItem*>
+RideResidency::resident()
+{
+    QMutexLocker locker(&lock);
+    return open.toList();
+}
+
+bool
+RideResidency::isPinned(RideItem *item, QString *why)
+{
+    QString reason;
+    if (item == context->ride) reason = tr("Current");
+    else if (item->isedit) reason = tr("Editing");
+    else if (item->isdirty) reason = tr("Unsaved");
+    else if (holds.load()) reason = tr("Script running");
+    else if (isCompared(item)) reason = tr("Compared");
+
+    if (why) *why = reason;
+    return reason != "";
+}
+
+bool
+RideResidency::isCompared(RideItem *item)
+{
+    // our rides can be compared in any athlete's tab
+    foreach(Context *compare, Context::contexts()) {
+
+        // intervals being compared are from the ride
+        if (compare->isCompareIntervals) {
+            foreach(const CompareInterval &x, compare->compareIntervals)
+                if (x.checked && x.sourceContext == context && x.rideItem &&
+                    x.rideItem->fileName == item->fileName) return true;
+        }
+
+        // date ranges being compared include the ride
+        if (compare->isCompareDateRanges) {
+            QDate date = item->dateTime.date();
+            foreach(const CompareDateRange &x, compare->compareDateRanges)
+                if (x.checked && x.sourceContext == context &&
+                    date >= x.start && date <= x.end) return true;
+        }
+    }
+    return false;
+}
+
+qint64
+RideResidency::footprint(RideItem *item)
+{
+    // don't use ride() since that counts as using it
+    RideFile *f = item->ride_;
+    if (f == NULL) return 0;
+
+    qint64 bytes = sizeof(RideFile);
+
+    // samples are held by pointer
+    bytes += (f->dataPoints().count() + f->referencePoints().count()) * (sizeof(RideFilePoint) + sizeof(RideFilePoint*));
+
+    // xdata
+    foreach(XDataSeries *series, f->xdata())
+        bytes += series->datapoints.count() * (sizeof(XDataPoint) + sizeof(XDataPoint*));
+
+    // w'bal and the editor keep a few values per sample
+    if (f->isDataPresent(RideFile::wprime)) bytes += f->dataPoints().count() * 6 * sizeof(double);
+    if (f->editorData()) bytes += f->dataPoints().count() * sizeof(double);
+
+    // meanmax and distributions are per second of the ride
+    if (item->fileCache_ && f->dataPoints().count())
+        bytes += qint64(f->dataPoints().last()->secs) * 24 * sizeof(float);
+
+    return bytes;
+}
+
+qint64
+RideResidency::budget() const
+{
+    return qint64(appsettings->value(NULL, GC_RIDE_MEMORY, RIDE_MEMORY_DEFAULT).toInt()) * 1024 * 1024;
+}
+
+void
+RideResidency::schedule()
+{
+    if (scheduled || budget() == 0) return;
+
+    // after the caller has finished with the ride
+    scheduled = true;
+    QTimer::singleShot(0, this, SLOT(enforce()));
+}
+
+void
+RideResidency::enforce()
+{
+    scheduled = false;
+
+    // background refresh or a script may be using rides we'd close
+    if (holds.load()) return;
+    if (context->athlete->rideCache && context->athlete->rideCache->isRunning()) return;
+
+    qint64 limit = budget();
+    if (limit) evict(limit);
+}
+
+void
+RideResidency::release()
+{
+    if (holds.load()) return;
+    if (context->athlete->rideCache && context->athlete->rideCache->isRunning()) return;
+    evict(0);
+}
+
+static bool lastUsedLessThan(const RideItem *a, const RideItem *b) { return a->lastused < b->lastused; }
+
+void
+RideResidency::evict(qint64 limit)
+{
+    // oldest first
+    QList<RideItem*> items = resident();
+    qSort(items.begin(), items.end(), lastUsedLessThan);
+
+    qint64 total = 0;
+    QVector<qint64> sizes(items.count());
+    for(int i=0; i<items.count(); i++) total += sizes[i] = footprint(items[i]);
+
+    // when releasing everything we don't keep a minimum
+    int keep = limit ? RIDE_MEMORY_MINIMUM : 0;
+    int remaining = items.count();
+
+    for(int i=0; i<items.count() && total > limit && remaining > keep; i++) {
+
+        if (isPinned(items[i])) continue;
+
+        total -= sizes[i];
+        remaining--;
+        items[i]->close(); // tells us via closed()
+    }
+}
+
+RideResidencyHold::RideResidencyHold(Context *context) : residency(NULL)
+{
+    if (context && context->athlete && context->athlete->rideCache)
+        residency = context->athlete->rideCache->residency();
+    if (residency) residency->hold();
+}
+
+RideResidencyHold::~RideResidencyHold()
+{
+    if (residency) residency->unhold();
+}
+
+//
+// Diagnostic view
+//
+RideResidencyDialog::RideResidencyDialog(Context *context) : QDialog(context->mainWindow), context(context)
+{
+    setWindowTitle(tr("Resident Activities"));
+    setAttribute(Qt::WA_DeleteOnClose);
+    setMinimumWidth(600 * dpiXFactor);
+    setMinimumHeight(400 * dpiYFactor);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    QHBoxLayout *budgetLayout = new QHBoxLayout;
+    budget = new QSpinBox(this);
+    budget->setRange(0, 65536);
+    budget->setSingleStep(64);
+    budget->setSpecialValueText(tr("No limit"));
+    budget->setSuffix(tr(" MB"));
+    budget->setValue(appsettings->value(NULL, GC_RIDE_MEMORY, RIDE_MEMORY_DEFAULT).toInt());
+    budgetLayout->addWidget(new QLabel(tr("Memory budget for open activities"), this));
+    budgetLayout->addWidget(budget);
+    budgetLayout->addStretch();
+    layout->addLayout(budgetLayout);
+
+    list = new QTreeWidget(this);
+    list->setColumnCount(4);
+    list->setHeaderLabels(QStringList() << tr("Activity") << tr("Samples") << tr("Size (KB)") << tr("Kept open"));
+    list->setRootIsDecorated(false);
+    list->setSortingEnabled(false);
+    layout->addWidget(list);
+
+    total = new QLabel(this);
+    layout->addWidget(total);
+
+    QHBoxLayout *buttons = new QHBoxLayout;
+    QPushButton *refreshButton = new QPushButton(tr("Refresh"), this);
+    QPushButton *releaseButton = new QPushButton(tr("Release"), this);
+    QPushButton *closeButton = new QPushButton(tr("Close"), this);
+    buttons->addStretch();
+    buttons->addWidget(refreshButton);
+    buttons->addWidget(releaseButton);
+    buttons->addWidget(closeButton);
+    layout->addLayout(buttons);
+
+    connect(budget, SIGNAL(valueChanged(int)), this, SLOT(budgetChanged(int)));
+    connect(refreshButton, SIGNAL(clicked()), this, SLOT(refresh()));
+    connect(releaseButton, SIGNAL(clicked()), this, SLOT(releaseClicked()));
+    connect(closeButton, SIGNAL(clicked()), this, SLOT(close()));
+
+    refresh();
+}
+
+static bool lastUsedGreaterThan(const RideItem *a, const RideItem *b) { return a->lastused > b->lastused; }
+
+void
+RideResidencyDialog::refresh()
+{
+    RideResidency *residency = context->athlete->rideCache->residency();
+
+    // most recently used first
+    QList<RideItem*> items = residency->resident();
+    qSort(items.begin(), items.end(), lastUsedGreaterThan);
+
+    list->clear();
+    qint64 bytes = 0;
+    foreach(RideItem *item, items) {
+
+        qint64 size = RideResidency::footprint(item);
+        bytes += size;
+
+        QString why;
+        residency->isPinned(item, &why);
+
+        QTreeWidgetItem *add = new QTreeWidgetItem(list->invisibleRootItem());
+        add->setText(0, item->dateTime.toString("dd MMM yyyy hh:mm") + " " + item->fileName);
+        add->setText(1, QString("%1").arg(item->ride_ ? item->ride_->dataPoints().count() : 0));
+        add->setText(2, QString("%1").arg(size / 1024));
+        add->setText(3, why);
+        add->setTextAlignment(1, Qt::AlignRight);
+        add->setTextAlignment(2, Qt::AlignRight);
+    }
+    list->header()->resizeSections(QHeaderView::ResizeToContents);
+
+    qint64 limit = residency->budget();
+    total->setText(tr("%1 activities open, using an estimated %2 MB of %3")
+                   .arg(items.count())
+                   .arg(double(bytes) / (1024*1024), 0, 'f', 1)
+                   .arg(limit ? QString("%1 MB").arg(limit / (1024*1024)) : tr("no limit")));
+}
+
+void
+RideResidencyDialog::budgetChanged(int value)
+{
+    appsettings->setValue(GC_RIDE_MEMORY, value);
+    context->athlete->rideCache->residency()->enforce();
+    refresh();
+}
+
+void
+RideResidencyDialog::releaseClicked()
+{
+    context->athlete->rideCache->residency()->release();
+    refresh();
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideResidency_h
+#define _GC_RideResidency_h 1
+
+#include "GoldenCheetah.h"
+#include "RideItem.h"
+
+#include <QObject>
+#include <QDialog>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QThread>
+#include <QSet>
+
+class Context;
+class QTreeWidget;
+class QLabel;
+class QSpinBox;
+
+// default budget for opened rides in MB, 0 means no limit
+#define RIDE_MEMORY_DEFAULT 512
+
+// rides kept open regardless of the budget, so callers working
+// with a handful of rides at once never see them closed
+#define RIDE_MEMORY_MINIMUM 4
+
+//
+// Keeps track of which RideItems have their RideFile open and closes
+// the least recently used ones when their estimated footprint goes
+// over the memory budget (GC_RIDE_MEMORY).
+//
+// Rides are never closed while they are the current ride, being
+// compared, edited or have unsaved changes. Closing is deferred to the event
+// loop, so a caller that has just asked for a ride never has it pulled
+// out from under it, and waits while the ride cache is refreshing in
+// the background or while a script is running (see RideResidencyHold).
+//
+// Only use from the GUI thread counts, so lastused is only ever
+// written there and rides opened by worker threads aren't tracked.
+//
+class RideResidency : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        RideResidency(Context *context, QObject *parent);
+
+        // called by RideItem as rides are opened, used and closed
+        void opened(RideItem *item);
+        void touch(RideItem *item) { if (QThread::currentThread() == thread()) item->lastused = clock.fetchAndAddRelaxed(1); }
+        void closed(RideItem *item);
+
+        // close nothing until released, calls nest
+        void hold();
+        void unhold();
+
+        // current state, for diagnostics
+        QList<RideItem*> resident();
+        bool isPinned(RideItem *item, QString *why=NULL);
+        static qint64 footprint(RideItem *item); // estimated bytes
+        qint64 budget() const; // bytes, 0 for no limit
+
+    public slots:
+
+        // close rides until within budget
+        void enforce();
+
+        // close everything we are allowed to
+        void release();
+
+    private:
+
+        void schedule();
+        void evict(qint64 budget);
+        bool isCompared(RideItem *item);
+
+        Context *context;
+        QAtomicInteger<qint64> clock;
+        QAtomicInt holds;
+
+        QMutex lock;
+        QSet<RideItem*> open;
+        bool scheduled;
+};
+
+//
+// Python and R scripts can get at any ride, from a worker thread or
+// while a nested event loop is running, so nothing is closed while one
+// of these is in scope around running a script
+//
+class RideResidencyHold
+{
+    public:
+        RideResidencyHold(Context *context);
+        ~RideResidencyHold();
+
+    private:
+        RideResidency *residency;
+};
+
+//
+// Tools > Resident Activities, shows what is open and lets the user
+// set the budget or release memory right away
+//
+class RideResidencyDialog : public QDialog
+{
+    Q_OBJECT
+
+    public:
+        RideResidencyDialog(Context *context);
+
+    public slots:
+        void refresh();
+        void budgetChanged(int);
+        void releaseClicked();
+
+    private:
+        Context *context;
+        QTreeWidget *list;
+        QLabel *total;
+        QSpinBox *budget;
+};
+
+#endif
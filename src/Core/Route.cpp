@@ -32,6 +32,7 @@
 #include <QXmlInputSource>
 #include <QXmlSimpleReader>
 
+#include <algorithm>
 
 #define tr(s) QObject::tr(s)
 
@@ -124,8 +125,80 @@ RouteSegment::addPoint(RoutePoint _point)
     return points.count();
 }
 
+/*
+ * RouteRideIndex
+ *
+ */
+
+// grid cells are 0.001 degrees, ~110m of latitude, so a search
+// at the minimum precision of 100m only looks at a handful of cells
+static const double cellsize = 0.001;
+
+static bool validgps(RideFilePoint *point)
+{
+    return point->lat != 0 && point->lon !=0 &&
+           ceil(point->lat) != 180 && ceil(point->lon) != 180 &&
+           ceil(point->lat) != 540 && ceil(point->lon) != 540;
+}
+
+RouteRideIndex::RouteRideIndex(RideFile *ride) : minLat(180), maxLat(-180), minLon(180), maxLon(-180), ride(ride)
+{
+    for (int i=0; i<ride->dataPoints().count(); i++) {
+        RideFilePoint *point = ride->dataPoints().at(i);
+        if (!validgps(point)) continue;
+
+        // appended in order so each cell stays sorted
+        cells[key(floor(point->lat / cellsize), floor(point->lon / cellsize))].append(i);
+
+        if (point->lat < minLat) minLat = point->lat;
+        if (point->lat > maxLat) maxLat = point->lat;
+        if (point->lon < minLon) minLon = point->lon;
+        if (point->lon > maxLon) maxLon = point->lon;
+    }
+}
+
+bool
+RouteRideIndex::overlaps(RouteSegment &segment) const
+{
+    // The third decimal place is worth up to 110 m
+    return !isEmpty() &&
+           minLat<segment.getMinLat()+0.001 && maxLat>segment.getMaxLat()-0.001 &&
+           minLon<segment.getMinLon()+0.001 && maxLon>segment.getMaxLon()-0.001;
+}
+
+int
+RouteRideIndex::next(double lat, double lon, double km, int from) const
+{
+    // degrees covered by km, with a little slack for rounding
+    double dlat = (km / 111.0) * 1.1;
+    double coslat = cos(lat * pi / 180.0);
+    double dlon = coslat > 0.01 ? dlat / coslat : 360;
+
+    int best = -1;
+    for (int la=floor((lat-dlat) / cellsize); la <= floor((lat+dlat) / cellsize); la++) {
+        for (int lo=floor((lon-dlon) / cellsize); lo <= floor((lon+dlon) / cellsize); lo++) {
+
+            QHash<quint64, QVector<int> >::const_iterator cell = cells.find(key(la,lo));
+            if (cell == cells.end()) continue;
+
+            // first sample in the cell at or after from that is close enough
+            const QVector<int> &indexes = cell.value();
+            for (QVector<int>::const_iterator it = std::lower_bound(indexes.constBegin(), indexes.constEnd(), from);
+                 it != indexes.constEnd() && (best == -1 || *it < best); it++) {
+
+                RideFilePoint *point = ride->dataPoints().at(*it);
+                if (RouteSegment::distance(lat, lon, point->lat, point->lon) < km) {
+                    best = *it;
+                    break;
+                }
+            }
+        }
+    }
+    return best;
+}
+
 void 
-RouteSegment::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
+RouteSegment::search(RideItem *item, RideFile*ride, const RouteRideIndex &index, QList<IntervalItem*>&here)
 {
     //qDebug() << "Opening ride: " << item->fileName << " for " << name;
 
@@ -142,13 +215,21 @@ RouteSegment::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
     int lastpoint = -1; // Last point to match
     double start = -1, stop = -1; // Start and stop secs
 
-    for (int n=0; n< this->getPoints().count();n++) {
-        RoutePoint routepoint = this->getPoints().at(n);
+    for (int n=0; n< points.count();n++) {
+        RoutePoint routepoint = points.at(n);
 
         bool present = false;
-        RideFilePoint* point;
+        RideFilePoint* point = NULL;
 
         for (int i=lastpoint+1; i<ride->dataPoints().count();i++) {
+
+            // looking for a start, so jump straight to the next sample
+            // that is close enough using the index instead of scanning
+            if (start == -1) {
+                i = index.next(routepoint.lat, routepoint.lon, minimumprecision, i);
+                if (i < 0) break;
+            }
+
             point = ride->dataPoints().at(i);
 
             double minimumdistance = -1;
@@ -248,7 +329,7 @@ RouteSegment::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
         
         stop = point->secs;
         
-        if (n == this->getPoints().count()-1) {
+        if (n == points.count()-1) {
 
             // Add the interval and continue search
             //qDebug() << "    >>> Route identified in ride: " << name << " start: " << start << " stop: " << stop << " (distance " << precision << "km)\r\n";
@@ -406,6 +487,9 @@ Routes::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
 {
     if (ride) {
 
+        // only index the ride when a segment might be in it
+        RouteRideIndex *index = NULL;
+
         // search all segments
         for (int routecount=0;routecount<routes.count();routecount++) {
             RouteSegment *segment = &routes[routecount];
@@ -414,10 +498,16 @@ Routes::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
             if (ride->getMinPoint(RideFile::lat).toDouble()<segment->getMinLat()+0.001 &&
                 ride->getMaxPoint(RideFile::lat).toDouble()>segment->getMaxLat()-0.001 &&
                 ride->getMinPoint(RideFile::lon).toDouble()<segment->getMinLon()+0.001 &&
-                ride->getMaxPoint(RideFile::lon).toDouble()>segment->getMaxLon()-0.001   )
+                ride->getMaxPoint(RideFile::lon).toDouble()>segment->getMaxLon()-0.001   ) {
+
+                if (index == NULL) index = new RouteRideIndex(ride);
 
-            segment->search(item, ride, here);
+                // the ride min/max include bad gps values, so check
+                // again against the valid samples before searching
+                if (index->overlaps(*segment)) segment->search(item, ride, *index, here);
+            }
         }
+        delete index;
     }
 }
 
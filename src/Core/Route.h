@@ -25,11 +25,14 @@
 #include <QString>
 #include <QDate>
 #include <QFile>
+#include <QHash>
+#include <QVector>
 
 #include "Context.h"
 
 class  RideFile;
 class  Routes;
+class  RouteRideIndex;
 struct RoutePoint;
 
 class RouteSegment // represents a segment we match against
@@ -57,10 +60,10 @@ class RouteSegment // represents a segment we match against
 
         // managing points and matched rides
         int addPoint(RoutePoint _point);
-        double distance(double lat1, double lon1, double lat2, double lon2);
+        static double distance(double lat1, double lon1, double lat2, double lon2);
 
         // find segments in ridefiles
-        void search(RideItem *, RideFile*, QList<IntervalItem*>&);
+        void search(RideItem *, RideFile*, const RouteRideIndex &, QList<IntervalItem*>&);
 
     private:
 
@@ -82,6 +85,32 @@ struct RoutePoint // represents a point within a segment
     double lon, lat;
 };
 
+class RouteRideIndex // grid over the valid gps samples of a ride, built once per search
+{
+    public:
+
+        RouteRideIndex(RideFile *ride);
+
+        bool isEmpty() const { return cells.isEmpty(); }
+
+        // could the segment bounding box be in this ride at all?
+        bool overlaps(RouteSegment &segment) const;
+
+        // first sample index >= from that is within km of lat/lon or -1 if none
+        int next(double lat, double lon, double km, int from) const;
+
+        // bounding box of the valid gps samples
+        double minLat, maxLat;
+        double minLon, maxLon;
+
+    private:
+
+        static quint64 key(int lat, int lon) { return (quint64(quint32(lat)) << 32) | quint32(lon); }
+
+        RideFile *ride;
+        QHash<quint64, QVector<int> > cells; // sample indexes in each cell, ascending
+};
+
 
 class Routes : public QObject { // top-level object with API and map of segments/rides
 
@@ -160,6 +160,7 @@
 #define GC_PACE                         "<global-general>pace"
 #define GC_SWIMPACE                     "<global-general>swimpace"
 #define GC_ELEVATION_HYSTERESIS         "<global-general>elevationHysteresis"
+#define GC_RIDE_MEMORY                  "<global-general>rideMemory"
 #define GC_UNIT                         "<global-general>unit"
 #define GC_ALLOW_TELEMETRY              "<global-general>telemetryAllowed"
 #define GC_ALLOW_TELEMETRY_DATE         "<global-general>telemetryDecisionDate"
@@ -284,6 +285,8 @@
 #define GC_AUTOBACKUP_FOLDER            "<athlete-preferences>autobackup/folder"
 #define GC_AUTOBACKUP_PERIOD            "<athlete-preferences>autobackup/period"                  // how often is the Athlete Folder backuped up / 0 == never
 #define GC_AUTOBACKUP_COUNTER           "<athlete-preferences>autobackup/counter"                 // counts to the next backup
+#define GC_AUTOBACKUP_INCREMENTAL       "<athlete-preferences>autobackup/incremental"             // only files changed since the last backup
+#define GC_AUTOBACKUP_CACHE             "<athlete-preferences>autobackup/cache"                   // include the cache, which can be regenerated
 
 #define GC_CLOUDDB_TC_ACCEPTANCE       "<athlete-preferences>clouddb/acceptance"                  // bool
 #define GC_CLOUDDB_TC_ACCEPTANCE_DATE  "<athlete-preferences>clouddb/acceptancedate"              // date/time string of acceptance
@@ -133,6 +133,79 @@ QString interval_to_str(double secs)
     return result;
 }
 
+// digits at s[i] .. s[i+n-1], -1 if any aren't
+static inline int isoDigits(const QChar *s, int i, int n)
+{
+    int value = 0;
+    for (int k=i; k<i+n; k++) {
+        ushort c = s[k].unicode();
+        if (c < '0' || c > '9') return -1;
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
+
+QDateTime convertISO8601ToUTC(const QString &timestamp)
+{
+    // trim without copying
+    const QChar *s = timestamp.constData();
+    int from = 0, to = timestamp.length();
+    while (from < to && s[from].isSpace()) from++;
+    while (to > from && s[to-1].isSpace()) to--;
+
+    // yyyy-MM-ddThh:mm:ss at least
+    if (to - from < 20) return convertToLocalTime(timestamp.trimmed());
+
+    int i = from;
+    int year = isoDigits(s, i, 4), month = isoDigits(s, i+5, 2), day = isoDigits(s, i+8, 2);
+    int hour = isoDigits(s, i+11, 2), minute = isoDigits(s, i+14, 2), second = isoDigits(s, i+17, 2);
+    if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31 || hour < 0 || hour > 23 ||
+        minute < 0 || minute > 59 || second < 0 || second > 60 ||
+        s[i+4] != '-' || s[i+7] != '-' || s[i+10].toLower() != 't' || s[i+13] != ':' || s[i+16] != ':')
+        return convertToLocalTime(timestamp.trimmed());
+    i += 19;
+
+    // fractions, to the millisecond
+    int msecs = 0;
+    if (i < to && (s[i] == '.' || s[i] == ',')) {
+        int scale = 100;
+        for (i++; i < to && s[i].isDigit(); i++) {
+            msecs += (s[i].unicode() - '0') * scale;
+            scale /= 10;
+        }
+    }
+
+    // zone, without one it is local time
+    int offset = 0;
+    if (i < to && s[i].toLower() == 'z') {
+        i++;
+    } else if (i < to && (s[i] == '+' || s[i] == '-')) {
+        int sign = s[i] == '-' ? -1 : 1;
+        int oh = to-i >= 3 ? isoDigits(s, i+1, 2) : -1;
+        int om = -1;
+        if (to-i == 6 && s[i+3] == ':') om = isoDigits(s, i+4, 2);
+        else if (to-i == 5) om = isoDigits(s, i+3, 2);
+        else if (to-i == 3) om = 0;
+        if (oh < 0 || om < 0) return convertToLocalTime(timestamp.trimmed());
+        offset = sign * (oh * 3600 + om * 60);
+        i = to;
+    } else {
+        return convertToLocalTime(timestamp.trimmed());
+    }
+    if (i != to) return convertToLocalTime(timestamp.trimmed());
+
+    // days since the epoch, proleptic gregorian
+    int y = year - (month <= 2 ? 1 : 0);
+    qint64 era = (y >= 0 ? y : y-399) / 400;
+    qint64 yoe = y - era * 400;
+    qint64 doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    qint64 doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+    qint64 days = era * 146097 + doe - 719468;
+
+    qint64 secs = days * 86400 + hour * 3600 + minute * 60 + second - offset;
+    return QDateTime::fromMSecsSinceEpoch(secs * 1000 + msecs, Qt::UTC);
+}
+
 QDateTime convertToLocalTime(QString timestamp)
 {
     //check if the last character is Z designating the timezone to be UTC
@@ -38,6 +38,12 @@ QString time_to_string_minutes(double secs); // output always hh:mm - seconds ar
 */
 QDateTime convertToLocalTime(QString timestamp);
 
+/* the same instant as convertToLocalTime() but decoded by hand, for the timestamp
+   on every sample of an xml activity file. Returned as UTC so use it for offsets
+   not display. Anything other than yyyy-MM-ddThh:mm:ss[.zzz](Z|+hh:mm) falls back
+*/
+QDateTime convertISO8601ToUTC(const QString &timestamp);
+
 class DateRange : QObject
 {
     Q_OBJECT
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Trace.h"
+
+#ifdef GC_WANT_TRACE
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QAtomicPointer>
+#include <QMutex>
+#include <QThread>
+#include <QFile>
+#include <QList>
+
+#include <stdio.h>
+
+// events are kept in fixed size blocks that are never moved, so
+// stop() can read them while other threads are still recording
+#define TRACE_BLOCK 4096
+
+struct TraceEvent
+{
+    const char *name;
+    qint64 start, duration;
+};
+
+struct TraceBlock
+{
+    TraceBlock() : next(NULL) {}
+
+    TraceEvent events[TRACE_BLOCK];
+    QAtomicPointer<TraceBlock> next;
+};
+
+// one per thread, only ever written by that thread
+struct TraceBuffer
+{
+    TraceBuffer(int tid, QString name) : tid(tid), name(name), count(0) { first = last = new TraceBlock; }
+
+    int tid;
+    QString name;
+    TraceBlock *first, *last;
+    QAtomicInt count; // published after the event is written
+};
+
+QAtomicInt Trace::on(0);
+
+static QMutex tracelock; // buffers and filename
+static QList<TraceBuffer*> buffers;
+static QString filename;
+static QElapsedTimer timer;
+
+static thread_local TraceBuffer *local = NULL;
+
+// quote a name for the trace json
+static QByteArray
+escaped(const QByteArray &name)
+{
+    QByteArray out;
+    foreach(char c, name) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (uchar(c) < 0x20) out += "\\u00" + QByteArray::number(uchar(c), 16).rightJustified(2, '0');
+        else out += c;
+    }
+    return out;
+}
+
+void
+Trace::start(QString name)
+{
+    QMutexLocker locker(&tracelock);
+    filename = name;
+    timer.start();
+    on.storeRelease(1);
+}
+
+qint64
+Trace::now()
+{
+    return timer.nsecsElapsed();
+}
+
+void
+Trace::record(const char *name, qint64 start, qint64 duration)
+{
+    // first span on this thread, only time we lock
+    TraceBuffer *buffer = local;
+    if (buffer == NULL) {
+
+        QMutexLocker locker(&tracelock);
+
+        QString threadname = QThread::currentThread()->objectName();
+        if (QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread()) threadname = "main";
+        else if (threadname == "") threadname = QString("thread %1").arg(buffers.count() + 1);
+
+        local = buffer = new TraceBuffer(buffers.count() + 1, threadname);
+        buffers << buffer;
+    }
+
+    int n = buffer->count.load();
+    int slot = n % TRACE_BLOCK;
+    if (n && slot == 0) {
+        TraceBlock *block = new TraceBlock;
+        buffer->last->next.storeRelease(block);
+        buffer->last = block;
+    }
+
+    TraceEvent &event = buffer->last->events[slot];
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    buffer->count.storeRelease(n + 1);
+}
+
+bool
+Trace::stop()
+{
+    if (!enabled()) return false;
+    on.storeRelease(0);
+
+    QMutexLocker locker(&tracelock);
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        fprintf(stderr, "Trace: cannot write %s\n", filename.toLocal8Bit().constData());
+        return false;
+    }
+
+    // chrome trace event format, times are in microseconds
+    file.write("{\"traceEvents\":[\n");
+    bool first = true;
+    foreach(TraceBuffer *buffer, buffers) {
+
+        QByteArray out;
+
+        // name the thread
+        out += first ? "" : ",\n";
+        out += QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,\"args\":{\"name\":\"")
+               .arg(buffer->tid).toUtf8();
+        out += escaped(buffer->name.toUtf8());
+        out += "\"}}";
+        first = false;
+
+        // and its spans
+        int count = buffer->count.loadAcquire();
+        TraceBlock *block = buffer->first;
+        for(int i=0; i<count; i++) {
+
+            if (i && i % TRACE_BLOCK == 0) block = block->next.loadAcquire();
+            const TraceEvent &event = block->events[i % TRACE_BLOCK];
+
+            out += ",\n{\"name\":\"";
+            out += escaped(event.name);
+            out += "\",\"cat\":\"gc\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+            out += QByteArray::number(buffer->tid);
+            out += ",\"ts\":";
+            out += QByteArray::number(double(event.start) / 1000.0, 'f', 3);
+            out += ",\"dur\":";
+            out += QByteArray::number(double(event.duration) / 1000.0, 'f', 3);
+            out += "}";
+
+            // don't let it get too big
+            if (out.size() > 1024*1024) {
+                file.write(out);
+                out.clear();
+            }
+        }
+        file.write(out);
+    }
+    file.write("\n],\"displayTimeUnit\":\"ms\"}\n");
+    file.close();
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_Trace_h
+#define _GC_Trace_h
+
+#include <QString>
+#include <QAtomicInt>
+
+//
+// Tracing of hot paths, instead of adding QTime timers and qDebug.
+//
+// Mark a scope with GC_TRACE("RideCache::refresh") and when started
+// with --trace=file.json the time spent in that scope is recorded and
+// written on exit in the Chrome trace event format, which can be
+// loaded into chrome://tracing or https://ui.perfetto.dev
+//
+// Span names must be string literals, they are not copied.
+//
+// Each thread records into its own buffer so there is no locking on
+// the hot path, and when not tracing a span costs one atomic load.
+// Without GC_WANT_TRACE defined (see gcconfig.pri.in) the macros
+// compile to nothing at all.
+//
+#ifdef GC_WANT_TRACE
+
+#define GC_TRACE_JOIN(a,b) a##b
+#define GC_TRACE_NAME(a,b) GC_TRACE_JOIN(a,b)
+#define GC_TRACE(name) TraceSpan GC_TRACE_NAME(_gc_trace_, __LINE__)(name)
+
+class Trace
+{
+    public:
+
+        // start recording, the trace is written to filename by stop()
+        static void start(QString filename);
+        static bool stop();
+
+        static bool enabled() { return on.loadAcquire() != 0; }
+
+        // nanoseconds since start
+        static qint64 now();
+
+        // add a completed span for the calling thread
+        static void record(const char *name, qint64 start, qint64 duration);
+
+    private:
+        static QAtomicInt on;
+};
+
+class TraceSpan
+{
+    public:
+        TraceSpan(const char *name) : name(name), start(Trace::enabled() ? Trace::now() : -1) {}
+        ~TraceSpan() { if (start >= 0) Trace::record(name, start, Trace::now() - start); }
+
+    private:
+        const char *name;
+        qint64 start;
+};
+
+#else
+
+#define GC_TRACE(name)
+
+#endif
+#endif
@@ -28,6 +28,9 @@
 #include "IdleTimer.h"
 #include "PowerProfile.h"
 #include "GcCrashDialog.h" // for versionHTML
+#include "Benchmark.h"
+#include "Batch.h"
+#include "Trace.h"
 
 #include <QApplication>
 #include <QDesktopWidget>
@@ -91,6 +94,9 @@ void terminate(int code)
 #ifdef GC_WANT_HTTP
     if (listener) listener->close();
 #endif
+#ifdef GC_WANT_TRACE
+    Trace::stop();
+#endif
 
     // tidy up static stuff (our globals) that are not tied
     // to a mainwindow instance (which will be deleted on close)
@@ -206,6 +212,10 @@ main(int argc, char *argv[])
     nogui = false;
     bool help = false;
     bool newgui = false;
+    bool bench = false;
+    QString batchJob;
+    QDate batchFrom, batchTo;
+    bool batchForce = false;
 
     // honour command line switches
     foreach (QString arg, sargs) {
@@ -225,6 +235,14 @@ main(int argc, char *argv[])
             fprintf(stderr, "--help or --usage   to print this message and exit\n");
             fprintf(stderr, "--version           to print detailed version information and exit\n");
             fprintf(stderr, "--newgui            to open the new gui (WIP)\n");
+            fprintf(stderr, "--bench [dir [file]] to benchmark the test/ corpus in dir and write results to file\n");
+            fprintf(stderr, "--batch=job athlete [args] to refresh, process, export or write metrics for activities and exit\n");
+            fprintf(stderr, "                    refresh, process processor, export format dir, metrics file.csv\n");
+            fprintf(stderr, "--from=yyyy-mm-dd   --to=yyyy-mm-dd to only batch activities in a date range\n");
+            fprintf(stderr, "--force             to batch refresh activities even when they are not stale\n");
+#ifdef GC_WANT_TRACE
+            fprintf(stderr, "--trace=file.json   to record a trace of hot paths for chrome://tracing or perfetto\n");
+#endif
 #ifdef GC_WANT_HTTP
             fprintf(stderr, "--server            to run as an API server\n");
 #endif
@@ -258,6 +276,33 @@ main(int argc, char *argv[])
         } else if (arg == "--newgui") {
             newgui = true;
 
+        } else if (arg == "--bench") {
+            nogui = bench = true;
+
+        } else if (arg.startsWith("--batch=")) {
+            nogui = true;
+            batchJob = arg.mid(8).toLower();
+
+        } else if (arg.startsWith("--from=") || arg.startsWith("--to=")) {
+            QDate date = QDate::fromString(arg.mid(arg.indexOf("=")+1), Qt::ISODate);
+            if (!date.isValid()) {
+                fprintf(stderr, "%s is not a yyyy-mm-dd date, exiting.\n", arg.toLocal8Bit().constData());
+                exit(1);
+            }
+            if (arg.startsWith("--from=")) batchFrom = date;
+            else batchTo = date;
+
+        } else if (arg == "--force") {
+            batchForce = true;
+
+        } else if (arg.startsWith("--trace=")) {
+#ifdef GC_WANT_TRACE
+            Trace::start(arg.mid(8));
+#else
+            fprintf(stderr, "Tracing support not compiled in, exiting.\n");
+            exit(1);
+#endif
+
         } else if (arg == "--server") {
 #ifdef GC_WANT_HTTP
             nogui = server = true;
@@ -355,6 +400,9 @@ main(int argc, char *argv[])
     // what to do. We may add our own error handler later.
     gsl_set_error_handler_off();
 
+    // benchmarks and batch jobs run without a display
+    if ((bench || batchJob != "") && qgetenv("QT_QPA_PLATFORM").isEmpty()) qputenv("QT_QPA_PLATFORM", "offscreen");
+
     // create the application -- only ever ONE regardless of restarts
     application = new QApplication(argc, argv);
     //XXXIdleEventFilter idleFilter;
@@ -368,6 +416,16 @@ main(int argc, char *argv[])
     appsettings->migrateQSettingsSystem(); // colors must be setup before migration can take place, but reading has to be from the migrated ones
     GCColor::readConfig();
 
+    // run the benchmark and exit, see Benchmark.h
+    if (bench) {
+        int code;
+        {
+            Benchmark benchmark(args.count() > 1 ? args.at(1) : "test");
+            code = benchmark.run(args.count() > 2 ? args.at(2) : "");
+        }
+        terminate(code);
+    }
+
     // set defaultfont - may be adjusted below
     QFont font;
     font.fromString(appsettings->value(NULL, GC_FONT_DEFAULT, QFont().toString()).toString());
@@ -534,9 +592,10 @@ main(int argc, char *argv[])
         appsettings->initializeQSettingsGlobal(gcroot);
 
 
-        // now redirect stderr
+        // now redirect stderr, but not when the command line
+        // is waiting on progress and errors, eg from cron
 #ifndef WIN32
-        if (!debug) nostderr(home.canonicalPath());
+        if (!debug && batchJob == "") nostderr(home.canonicalPath());
 #else
         Q_UNUSED(debug)
 #endif
@@ -568,6 +627,19 @@ main(int argc, char *argv[])
         // initialise the trainDB
         trainDB = new TrainDB(home);
 
+        // batch job and exit, see Batch.h
+        if (batchJob != "") {
+            int code;
+            {
+                Batch batch(home, args.count() > 1 ? args.at(1) : "");
+                batch.range = DateRange(batchFrom, batchTo);
+                batch.force = batchForce;
+                code = batch.run(batchJob, args.mid(2));
+            }
+            delete trainDB;
+            terminate(code);
+        }
+
         // lets do what the command line says ...
         QVariant lastOpened;
         if(args.count() == 2) { // $ ./GoldenCheetah Mark -or- ./GoldenCheetah --server ~/athletedir
@@ -749,5 +821,9 @@ main(int argc, char *argv[])
 
     delete application;
 
+#ifdef GC_WANT_TRACE
+    Trace::stop();
+#endif
+
     return ret;
 }
@@ -20,6 +20,20 @@
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QStorageInfo>
+#include <QThreadPool>
+#include <QThread>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QCryptographicHash>
+#include <QEventLoop>
+#include <QTimer>
+#include <QSet>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QRegExp>
+#include <QtConcurrent>
 
 #include "Athlete.h"
 #include "AthleteBackup.h"
@@ -29,9 +43,64 @@
 #include "../qzip/zipwriter.h"
 #include "../qzip/zipreader.h"
 
+extern QString gcroot;
 
 
-AthleteBackup::AthleteBackup(QDir athleteHome)
+
+// a file being backed up, read, hashed and compressed by a worker
+class AthleteBackupFile
+{
+    public:
+        AthleteBackupFile() : size(0), modified(0), read(false), changed(true), ready(0) {}
+
+        QString name;           // in the zip
+        QString source;
+        qint64 size, modified;
+        QString previous;       // hash in the manifest
+
+        bool read, changed;
+        QString hash;
+        ZipWriter::Entry entry;
+        QAtomicInt ready;
+};
+
+class AthleteBackupRunner : public QRunnable
+{
+    public:
+        AthleteBackupRunner(AthleteBackupFile *file, QAtomicInt *stop, QMutex *mutex, QWaitCondition *ready) :
+            file(file), stop(stop), mutex(mutex), ready(ready) {}
+
+        void run() {
+            if (stop->load() == 0) {
+                QFile in(file->source);
+                if (in.open(QIODevice::ReadOnly)) {
+                    QByteArray contents = in.readAll();
+                    in.close();
+
+                    // touched since the last backup, but is it different?
+                    file->read = true;
+                    file->hash = QCryptographicHash::hash(contents, QCryptographicHash::Sha1).toHex();
+                    file->changed = (file->hash != file->previous);
+                    if (file->changed) file->entry = ZipWriter::compress(file->name, contents);
+                }
+            }
+            file->ready.storeRelease(1);
+
+            // the writer may be waiting for this one
+            mutex->lock();
+            ready->wakeAll();
+            mutex->unlock();
+        }
+
+    private:
+        AthleteBackupFile *file;
+        QAtomicInt *stop;
+        QMutex *mutex;
+        QWaitCondition *ready;
+};
+
+AthleteBackup::AthleteBackup(QDir athleteHome) : backedUp(0), immediate(false), incremental(false), changes(false),
+                                                 done(0), cancelled(0), progress(NULL), timer(NULL)
 {
     this->athleteDirs = new AthleteDirectoryStructure(athleteHome);
     this->athlete = athleteHome.dirName();
@@ -48,10 +117,18 @@ AthleteBackup::AthleteBackup(QDir athleteHome)
     sourceFolderList.append(athleteDirs->calendar());
     sourceFolderList.append(athleteDirs->workouts());
     sourceFolderList.append(athleteDirs->media());
+
+    connect(&watcher, SIGNAL(finished()), this, SLOT(written()));
 }
 
 AthleteBackup::~AthleteBackup()
 {
+    // the worker uses us
+    cancelled.store(1);
+    watcher.waitForFinished();
+
+    qDeleteAll(files);
+    delete progress;
     delete athleteDirs;
 }
 
@@ -68,7 +145,13 @@ AthleteBackup::backupOnClose()
         return;
     }
 
-    backup(tr("Abort Backup and Reset Counter"));
+    // the athlete is closing so we need to wait, but the work
+    // is done elsewhere so the gui still repaints meanwhile
+    if (backup(tr("Abort Backup and Reset Counter"))) {
+        QEventLoop loop;
+        connect(this, SIGNAL(finished()), &loop, SLOT(quit()));
+        loop.exec();
+    }
 
     appsettings->setCValue(athlete, GC_AUTOBACKUP_COUNTER, 0);
 
@@ -77,11 +160,13 @@ AthleteBackup::backupOnClose()
 void
 AthleteBackup::backupImmediate()
 {
+    immediate = true;
     backupFolder = appsettings->cvalue(athlete, GC_AUTOBACKUP_FOLDER, "").toString();
     QString dir = QFileDialog::getExistingDirectory(NULL, tr("Select Backup Directory"),
                             backupFolder, QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
     if (dir == "") {
         QMessageBox::information(NULL, tr("Athlete Backup"), tr("No backup directory selected - backup aborted"));
+        deleteLater();
         return;
     }
     // do the backup
@@ -95,16 +180,55 @@ AthleteBackup::backupImmediate()
     int ret = msgBox.exec();
     switch (ret) {
     case QMessageBox::No:
+        deleteLater();
         return; // No Backup
         break;
     default:
         // Ok - let's backup
         break;
     }
-    if (backup(tr("Abort Backup"))) {
-       QMessageBox::information(NULL, tr("Athlete Backup"), tr("Backup successfully stored in \n%1").arg(backupFolder));
+
+    // messages are shown by written() when done
+    if (backup(tr("Abort Backup"))) connect(this, SIGNAL(finished()), this, SLOT(deleteLater()));
+    else deleteLater();
+}
+
+void
+AthleteBackup::restoreImmediate()
+{
+    QString zip = QFileDialog::getOpenFileName(NULL, tr("Select Backup to Restore"), "",
+                                               tr("Athlete Backups (GC_*.zip)"));
+    if (zip == "") return;
+
+    QStringList chain;
+    if (!backupChain(zip, chain)) {
+        QMessageBox::warning(NULL, tr("Restore Athlete Backup"), tr("%1 is not an athlete backup, or the full backup it follows on from is missing.").arg(QFileInfo(zip).fileName()));
+        return;
+    }
+
+    QString target = QFileDialog::getExistingDirectory(NULL, tr("Select Empty Directory to Restore to"),
+                            gcroot, QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
+    if (target == "") return;
+    if (!QDir(target).entryList(QDir::AllEntries | QDir::NoDotAndDotDot).isEmpty()) {
+        QMessageBox::warning(NULL, tr("Restore Athlete Backup"), tr("Directory %1 is not empty - nothing restored.").arg(target));
+        return;
     }
 
+    // extract in the background, there may be a lot of it
+    QProgressDialog progress(tr("Restoring %1 backup(s) to %2 ...").arg(chain.count()).arg(target), QString(), 0, 0, NULL);
+    progress.setWindowModality(Qt::NonModal);
+    progress.show();
+
+    QString error;
+    QFutureWatcher<bool> watcher;
+    QEventLoop loop;
+    connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    watcher.setFuture(QtConcurrent::run(&AthleteBackup::restore, chain, target, &error));
+    loop.exec();
+    progress.hide();
+
+    if (watcher.result()) QMessageBox::information(NULL, tr("Restore Athlete Backup"), tr("Backup restored to \n%1").arg(target));
+    else QMessageBox::warning(NULL, tr("Restore Athlete Backup"), error);
 }
 
 // -- private methods
@@ -112,17 +236,51 @@ AthleteBackup::backupImmediate()
 bool
 AthleteBackup::backup(QString progressText)
 {
+    backedUp = 0;
+    done.store(0);
+    cancelled.store(0);
+    error = "";
+    qDeleteAll(files);
+    files.clear();
+    deleted.clear();
+
+    // the cache is regenerated if missing, so only if asked for
+    QList<QDir> folders = sourceFolderList;
+    if (appsettings->cvalue(athlete, GC_AUTOBACKUP_CACHE, false).toBool()) folders.append(athleteDirs->cache());
+
+    // what we backed up last time, if only backing up changes
+    incremental = appsettings->cvalue(athlete, GC_AUTOBACKUP_INCREMENTAL, false).toBool();
+    manifest.clear();
+    changes = incremental && readManifest();
 
     // backup requested so lets see if we have something to backup and if yes, how much
     int fileCount = 0;
     qint64 fileSize = 0;
-    // count the files for the progress bar and the calculate the overall size
-    foreach (QDir folder, sourceFolderList) {
+    QSet<QString> present;
+    foreach (QDir folder, folders) {
         // get all files
         foreach (QFileInfo fileName, folder.entryInfoList(QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks)) {
-           fileCount++;
-           fileSize += fileName.size();
+            fileCount++;
+
+            AthleteBackupFile *file = new AthleteBackupFile;
+            file->name = folder.dirName()+"/"+fileName.fileName();
+            file->source = fileName.canonicalFilePath();
+            file->size = fileName.size();
+            file->modified = fileName.lastModified().toMSecsSinceEpoch();
+            present.insert(file->name);
 
+            // not touched since the last backup, so not even read
+            if (changes && manifest.contains(file->name)) {
+                const ManifestEntry &was = manifest[file->name];
+                if (was.size == file->size && was.modified == file->modified) {
+                    delete file;
+                    continue;
+                }
+                file->previous = was.hash;
+            }
+
+            fileSize += file->size;
+            files << file;
         }
     }
 
@@ -131,6 +289,18 @@ AthleteBackup::backup(QString progressText)
        return false;
     }
 
+    // gone since the last backup
+    if (changes) {
+        foreach(QString name, manifest.keys())
+            if (!present.contains(name)) deleted << name;
+    }
+
+    // nothing to do
+    if (files.isEmpty() && deleted.isEmpty()) {
+        if (immediate) QMessageBox::information(NULL, tr("Athlete Backup"), tr("Nothing has changed since the last backup in \n%1").arg(backupFolder));
+        return false;
+    }
+
     // if if there is enough space available for the backup
     QStorageInfo storage(backupFolder);
     if (storage.isValid() && storage.isReady()) {
@@ -145,7 +315,7 @@ AthleteBackup::backup(QString progressText)
     }
 
     QChar zero = QLatin1Char('0');
-    QString targetFileName = QString( "GC_%1_%2_%3_%4_%5_%6_%7_%8.zip" )
+    QString targetFileName = QString( "GC_%1_%2_%3_%4_%5_%6_%7_%8%9.zip" )
                        .arg ( VERSION_LATEST )
                        .arg ( athlete )
                        .arg ( QDate::currentDate().year(), 4, 10, zero )
@@ -153,56 +323,288 @@ AthleteBackup::backup(QString progressText)
                        .arg ( QDate::currentDate().day(), 2, 10, zero )
                        .arg ( QTime::currentTime().hour(), 2, 10, zero )
                        .arg ( QTime::currentTime().minute(), 2, 10, zero )
-                       .arg ( QTime::currentTime().second(), 2, 10, zero );
+                       .arg ( QTime::currentTime().second(), 2, 10, zero )
+                       .arg ( changes ? "_changes" : "" );
 
 
-    // add files using zip writer
+    // check we can create the zip before we start
     QFile zipFile(backupFolder+"/"+targetFileName);
     if (!zipFile.open(QIODevice::WriteOnly)) {
         QMessageBox::warning(NULL, tr("Athlete Backup"), tr("Backup file %1 cannot be created.").arg(zipFile.fileName()));
         return false;
     }
     zipFile.close();
-    ZipWriter writer(zipFile.fileName());
+    zipFileName = zipFile.fileName();
+    folderNames.clear();
+    foreach (QDir folder, folders) folderNames << folder.dirName();
 
-    QProgressDialog progress(tr("Adding files to backup %1 for athlete %2 ...").arg(targetFileName).arg(athlete), progressText, 0, fileCount, NULL);
-    progress.setWindowModality(Qt::WindowModal);
+    // not modal, the work is done elsewhere
+    delete progress;
+    progress = new QProgressDialog(tr("Adding files to backup %1 for athlete %2 ...").arg(targetFileName).arg(athlete), progressText, 0, files.count(), NULL);
+    progress->setWindowModality(Qt::NonModal);
+    if (timer == NULL) {
+        timer = new QTimer(this);
+        connect(timer, SIGNAL(timeout()), this, SLOT(updateProgress()));
+    }
+    timer->start(100);
 
-    // now do the Zipping
-    bool userCanceled = false;
-    int fileCounter = 0;
-    foreach (QDir folder, sourceFolderList) {
-        // get all files
-        writer.addDirectory(folder.dirName());
-        foreach (QFileInfo fileName, folder.entryInfoList(QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks)) {
-            QFile file(fileName.canonicalFilePath());
-            if (file.open(QIODevice::ReadOnly)) {
-                if (progress.wasCanceled()) {
-                    userCanceled = true;
-                    break;
-                }
-                writer.addFile(folder.dirName()+"/"+fileName.fileName(), file.readAll());
-                progress.setValue(fileCounter);
-                fileCounter++;
-                file.close();
+    // written() is called when done
+    watcher.setFuture(QtConcurrent::run(this, &AthleteBackup::writeZip));
+    return true;
+}
+
+void
+AthleteBackup::updateProgress()
+{
+    if (progress->wasCanceled()) cancelled.store(1);
+    else progress->setValue(done.load());
+}
+
+// the zip has been written, or not
+void
+AthleteBackup::written()
+{
+    timer->stop();
+    progress->setValue(files.count());
+    progress->hide();
+
+    bool ok = watcher.result();
+    bool userCanceled = cancelled.load() != 0;
+
+    // delete the .ZIP file if the user canceled the backup, it failed, or if
+    // all the files touched turned out to be the same
+    if (!ok || (changes && backedUp == 0 && deleted.isEmpty())) QFile::remove(zipFileName);
+
+    if (ok) {
+
+        // remember what was backed up for next time
+        if (incremental) {
+            foreach(AthleteBackupFile *file, files) {
+                if (!file->read) continue;
+                ManifestEntry entry;
+                entry.size = file->size;
+                entry.modified = file->modified;
+                entry.hash = file->hash;
+                manifest.insert(file->name, entry);
+            }
+            foreach(QString name, deleted) manifest.remove(name);
+            if (!writeManifest()) {
+                QMessageBox::warning(NULL, tr("Athlete Backup"), tr("Cannot update %1, the next backup will not be incremental.").arg(manifestFileName()));
+                QFile::remove(manifestFileName());
             }
+
+        } else {
+
+            // backups of changes must follow on from this one
+            QFile::remove(manifestFileName());
+        }
+
+        if (immediate) {
+            if (backedUp || !deleted.isEmpty()) QMessageBox::information(NULL, tr("Athlete Backup"), tr("Backup successfully stored in \n%1").arg(backupFolder));
+            else QMessageBox::information(NULL, tr("Athlete Backup"), tr("Nothing has changed since the last backup in \n%1").arg(backupFolder));
+        }
+
+    } else if (!userCanceled) {
+
+        QMessageBox::warning(NULL, tr("Athlete Backup"), tr("%1 - no backup .zip file created for athlete %2.").arg(error).arg(athlete));
+    }
+
+    qDeleteAll(files);
+    files.clear();
+
+    emit finished();
+}
+
+// on a worker thread, writes the zip in order as the pool compresses
+bool
+AthleteBackup::writeZip()
+{
+    ZipWriter writer(zipFileName);
+    foreach (QString folder, folderNames) writer.addDirectory(folder);
+
+    // files are compressed by the pool, a window ahead of the one
+    // being written so memory use stays bounded
+    QThreadPool pool;
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+    int window = pool.maxThreadCount() * BACKUP_WINDOW;
+    QAtomicInt stop(0);
+    QMutex mutex;
+    QWaitCondition ready;
+    int submitted = 0;
+
+    // now do the Zipping, in order
+    for (int i=0; i<files.count() && cancelled.load() == 0; i++) {
+
+        while (submitted < files.count() && submitted < i + window)
+            pool.start(new AthleteBackupRunner(files[submitted++], &stop, &mutex, &ready));
+
+        mutex.lock();
+        while (files[i]->ready.loadAcquire() == 0 && cancelled.load() == 0) ready.wait(&mutex, 100);
+        mutex.unlock();
+        if (cancelled.load()) break;
+
+        AthleteBackupFile *file = files[i];
+        if (file->read && file->changed) {
+            writer.addEntry(file->entry);
+            backedUp++;
         }
-        if (userCanceled) break;
+        file->entry = ZipWriter::Entry(); // done with it
+        done.store(i+1);
+
+        if (writer.status() != ZipWriter::NoError) break;
     }
 
+    // runners use the files
+    stop.store(1);
+    pool.waitForDone();
+
+    // restoring a backup of changes needs to know what went
+    if (cancelled.load() == 0 && !deleted.isEmpty()) writer.addFile("deleted.txt", deleted.join("\n").toUtf8());
+
     // final processing
     writer.close();
 
-    // delete the .ZIP file if the user canceled the backup
-    if (userCanceled) {
-        zipFile.remove();
+    if (cancelled.load()) return false;
+    if (writer.status() != ZipWriter::NoError) {
+        error = tr("Backup file %1 could not be written").arg(zipFileName);
         return false;
     }
+    return verifyZip();
+}
+
+// read it all back, every file must match the hash it was read with
+bool
+AthleteBackup::verifyZip()
+{
+    ZipReader reader(zipFileName);
+    if (!reader.isReadable() || reader.status() != ZipReader::NoError) {
+        error = tr("Backup file %1 cannot be read back").arg(zipFileName);
+        return false;
+    }
+
+    foreach(AthleteBackupFile *file, files) {
+        if (cancelled.load()) return false;
+        if (!file->read || !file->changed) continue;
+
+        QByteArray contents = reader.fileData(file->name);
+        if (QCryptographicHash::hash(contents, QCryptographicHash::Sha1).toHex() != file->hash) {
+            error = tr("Backup file %1 is damaged, %2 does not match").arg(zipFileName).arg(file->name);
+            return false;
+        }
+    }
+    if (!deleted.isEmpty() && reader.fileData("deleted.txt") != deleted.join("\n").toUtf8()) {
+        error = tr("Backup file %1 is damaged, deleted.txt does not match").arg(zipFileName);
+        return false;
+    }
+    reader.close();
+    return true;
+}
+
+// backups are named GC_<version>_<athlete>_<yyyy>_<mm>_<dd>_<hh>_<mm>_<ss>[_changes].zip
+// and a backup of changes follows on from the backup before it in the same folder
+bool
+AthleteBackup::backupChain(QString zip, QStringList &chain)
+{
+    QRegExp backupName("^GC_(\\d+)_(.+)_(\\d{4}_\\d{2}_\\d{2}_\\d{2}_\\d{2}_\\d{2})(_changes)?\\.zip$");
+
+    QFileInfo chosen(zip);
+    if (!backupName.exactMatch(chosen.fileName())) return false;
+    QString athlete = backupName.cap(2);
+    QString when = backupName.cap(3);
+
+    // all the backups of this athlete up to the one chosen, oldest first
+    QMap<QString, QString> backups;
+    foreach(QFileInfo info, chosen.dir().entryInfoList(QStringList() << "GC_*.zip", QDir::Files)) {
+        if (!backupName.exactMatch(info.fileName())) continue;
+        if (backupName.cap(2) != athlete || backupName.cap(3) > when) continue;
+        backups.insert(backupName.cap(3), info.absoluteFilePath());
+    }
+
+    // back to the last full backup
+    chain.clear();
+    QMapIterator<QString, QString> i(backups);
+    i.toBack();
+    while (i.hasPrevious()) {
+        i.previous();
+        chain.prepend(i.value());
+        if (!i.value().endsWith("_changes.zip")) return true;
+    }
+    return false;
+}
 
-    // we are done, full progress
-    progress.setValue(fileCount);
+// on a worker thread, extract each in turn removing what was deleted
+bool
+AthleteBackup::restore(QStringList chain, QString target, QString *error)
+{
+    foreach(QString zip, chain) {
+
+        ZipReader reader(zip);
+        if (!reader.isReadable() || !reader.extractAll(target)) {
+            *error = tr("Cannot extract %1, the restore is incomplete.").arg(zip);
+            return false;
+        }
+        QByteArray deletions = reader.fileData("deleted.txt");
+        reader.close();
+
+        // only in backups of changes
+        QFile::remove(target + "/deleted.txt");
+        foreach(QString name, QString::fromUtf8(deletions).split("\n", QString::SkipEmptyParts)) {
+            if (name.contains("..")) continue; // always folder/file
+            QFile::remove(target + "/" + name);
+        }
+    }
     return true;
+}
+
+QString
+AthleteBackup::manifestFileName() const
+{
+    return backupFolder + "/GC_" + athlete + "_backup.json";
+}
+
+bool
+AthleteBackup::readManifest()
+{
+    QFile file(manifestFileName());
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+
+    if (!doc.isObject()) return false;
 
+    QJsonObject files = doc.object().value("files").toObject();
+    foreach(QString name, files.keys()) {
+        QJsonObject was = files.value(name).toObject();
+        ManifestEntry entry;
+        entry.size = qint64(was.value("size").toDouble());
+        entry.modified = qint64(was.value("modified").toDouble());
+        entry.hash = was.value("sha1").toString();
+        manifest.insert(name, entry);
+    }
+    return true;
 }
 
+bool
+AthleteBackup::writeManifest()
+{
+    QJsonObject files;
+    QMapIterator<QString, ManifestEntry> i(manifest);
+    while (i.hasNext()) {
+        i.next();
+        QJsonObject entry;
+        entry.insert("size", double(i.value().size));
+        entry.insert("modified", double(i.value().modified));
+        entry.insert("sha1", i.value().hash);
+        files.insert(i.key(), entry);
+    }
+
+    QJsonObject root;
+    root.insert("athlete", athlete);
+    root.insert("files", files);
 
+    QFile file(manifestFileName());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.close();
+    return true;
+}
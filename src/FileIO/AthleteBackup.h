@@ -20,10 +20,33 @@
 #define _GC_AthleteBackup_h 1
 
 #include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QAtomicInt>
+#include <QFutureWatcher>
 
 #include "Athlete.h"
 
+// files read and compressed ahead of the one being written, per thread
+#define BACKUP_WINDOW 4
 
+class AthleteBackupFile;
+class QProgressDialog;
+class QTimer;
+
+//
+// Backs up the athlete folders to a zip file. Files are read, hashed and
+// compressed on a pool of threads while the zip is written in order on
+// a worker thread, the gui just shows progress. Once written the zip is
+// read back and every file checked against its hash.
+//
+// When incremental backups are enabled a manifest of what was backed up
+// is kept in the backup folder, and the next backup there only contains
+// the files whose content changed, along with a list of those deleted.
+// A full backup without incremental backups removes the manifest, so a
+// backup of changes always follows on from the full backup before it and
+// any changes in between; restoreImmediate() replays them in that order.
+//
 class AthleteBackup : public QObject
 {
     Q_OBJECT
@@ -31,16 +54,62 @@ class AthleteBackup : public QObject
     public:
         AthleteBackup(QDir athlete);
         ~AthleteBackup();
+
+        // waits until done, the athlete is closing
         void backupOnClose();
+
+        // returns once started, deletes itself when done
         void backupImmediate();
 
+        // restore a backup, and the backups it follows on from, to an empty folder
+        static void restoreImmediate();
+
+    signals:
+        void finished();
+
+    private slots:
+        void updateProgress();
+        void written();
+
     private:
         AthleteDirectoryStructure *athleteDirs;
         QString athlete;
         QString backupFolder;
         QList<QDir> sourceFolderList;
+        int backedUp; // files in the last backup
+
+        // scan the folders and start writing, false if not started
         bool backup(QString progressText);
 
+        // on a worker thread
+        bool writeZip();
+        bool verifyZip();
+
+        // the backup being written
+        bool immediate, incremental, changes;
+        QString zipFileName;
+        QStringList folderNames;
+        QList<AthleteBackupFile*> files;
+        QStringList deleted;
+        QAtomicInt done, cancelled;
+        QString error;
+        QProgressDialog *progress;
+        QTimer *timer;
+        QFutureWatcher<bool> watcher;
+
+        // what was backed up, by path in the zip
+        struct ManifestEntry {
+            qint64 size, modified;
+            QString hash;
+        };
+        QMap<QString, ManifestEntry> manifest;
+        QString manifestFileName() const;
+        bool readManifest();
+        bool writeManifest();
+
+        // the backups to restore in order, from the full backup before zip
+        static bool backupChain(QString zip, QStringList &chain);
+        static bool restore(QStringList chain, QString target, QString *error);
 };
 
 
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "CsvFields.h"
+
+CsvFields::CsvFields(const QString &line, QChar separator) : line(line)
+{
+    const QChar *s = line.constData();
+    int len = line.length();
+    int from = 0;
+    for (int i=0; i<len; i++) {
+        if (s[i] == separator) {
+            starts.append(from);
+            ends.append(i);
+            from = i+1;
+        }
+    }
+    starts.append(from);
+    ends.append(len);
+}
+
+QString
+CsvFields::text(int i) const
+{
+    if (i < 0 || i >= count()) return QString();
+    return line.mid(starts[i], ends[i]-starts[i]);
+}
+
+double
+CsvFields::number(int i) const
+{
+    if (i < 0 || i >= count()) return 0;
+    return toDouble(line.constData() + starts[i], ends[i]-starts[i]);
+}
+
+int
+CsvFields::integer(int i) const
+{
+    if (i < 0 || i >= count()) return 0;
+    return toInt(line.constData() + starts[i], ends[i]-starts[i]);
+}
+
+static inline bool csvSpace(const QChar &c)
+{
+    ushort u = c.unicode();
+    return u == ' ' || (u >= '\t' && u <= '\r') || (u > 127 && c.isSpace());
+}
+
+static inline bool csvDigit(const QChar &c)
+{
+    ushort u = c.unicode();
+    return u >= '0' && u <= '9';
+}
+
+double
+CsvFields::toDouble(const QChar *s, int len, bool *ok)
+{
+    // powers of ten that are exact as doubles
+    static const double exact[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    int from = 0, to = len;
+    while (from < to && csvSpace(s[from])) from++;
+    while (to > from && csvSpace(s[to-1])) to--;
+
+    int i = from;
+    bool negative = false;
+    if (i < to && (s[i] == '-' || s[i] == '+')) negative = (s[i++] == '-');
+
+    // up to 15 significant digits fit in a double exactly, so scaling by an
+    // exact power of ten is a single correctly rounded operation
+    quint64 mantissa = 0;
+    int significant = 0, digits = 0, exponent = 0;
+    for (; i < to && csvDigit(s[i]); i++, digits++) {
+        if (mantissa || s[i] != '0') significant++;
+        mantissa = mantissa * 10 + (s[i].unicode() - '0');
+        if (significant > 15) break;
+    }
+    if (significant <= 15 && i < to && s[i] == '.') {
+        for (i++; i < to && csvDigit(s[i]); i++, digits++) {
+            if (mantissa || s[i] != '0') significant++;
+            mantissa = mantissa * 10 + (s[i].unicode() - '0');
+            exponent--;
+            if (significant > 15) break;
+        }
+    }
+    if (significant <= 15 && digits && i < to && (s[i] == 'e' || s[i] == 'E')) {
+        int j = i+1;
+        bool eneg = false;
+        if (j < to && (s[j] == '-' || s[j] == '+')) eneg = (s[j++] == '-');
+        int e = 0, edigits = 0;
+        for (; j < to && csvDigit(s[j]) && e < 1000; j++, edigits++) e = e * 10 + (s[j].unicode() - '0');
+        if (edigits) {
+            exponent += eneg ? -e : e;
+            i = j;
+        }
+    }
+
+    if (digits && significant <= 15 && i == to && exponent >= -22 && exponent <= 22) {
+        double value = double(mantissa);
+        if (exponent < 0) value /= exact[-exponent];
+        else value *= exact[exponent];
+        if (ok) *ok = true;
+        return negative ? -value : value;
+    }
+
+    // anything else (long mantissas, inf, nan, junk) as QString does it
+    return QString::fromRawData(s, len).toDouble(ok);
+}
+
+int
+CsvFields::toInt(const QChar *s, int len, bool *ok)
+{
+    int from = 0, to = len;
+    while (from < to && csvSpace(s[from])) from++;
+    while (to > from && csvSpace(s[to-1])) to--;
+
+    int i = from;
+    bool negative = false;
+    if (i < to && (s[i] == '-' || s[i] == '+')) negative = (s[i++] == '-');
+
+    // nine digits can't overflow
+    int value = 0, digits = 0;
+    for (; i < to && csvDigit(s[i]) && digits < 9; i++, digits++) value = value * 10 + (s[i].unicode() - '0');
+
+    if (digits && i == to) {
+        if (ok) *ok = true;
+        return negative ? -value : value;
+    }
+    return QString::fromRawData(s, len).toInt(ok);
+}
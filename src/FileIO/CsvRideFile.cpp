@@ -19,6 +19,7 @@
  */
 
 #include "CsvRideFile.h"
+#include "CsvFields.h"
 #include "Units.h"
 #include "Context.h"
 #include "Athlete.h"
@@ -621,6 +622,9 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                     tempType = degF;
 
             } else if (lineno > unitsHeader) {
+
+                // split once, the dialects below pick columns from it
+                CsvFields fields(line);
                 double minutes=0,nm=0,kph=0,watts=0,km=0,cad=0,alt=0,hr=0,dfpm=0, seconds=0.0;
                 double temp=RideFile::NA;
                 double slope=0.0;
@@ -642,20 +646,20 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                 quint64 ms;
 
                 if (csvType == powertap || csvType == joule) {
-                     minutes = line.section(',', 0, 0).toDouble();
-                     nm = line.section(',', 1, 1).toDouble();
-                     kph = line.section(',', 2, 2).toDouble();
-                     watts = line.section(',', 3, 3).toDouble();
-                     km = line.section(',', 4, 4).toDouble();
-                     cad = line.section(',', 5, 5).toDouble();
-                     hr = line.section(',', 6, 6).toDouble();
-                     interval = line.section(',', 7, 7).toInt();
-                     alt = line.section(',', 8, 8).toDouble();
+                     minutes = fields.number(0);
+                     nm = fields.number(1);
+                     kph = fields.number(2);
+                     watts = fields.number(3);
+                     km = fields.number(4);
+                     cad = fields.number(5);
+                     hr = fields.number(6);
+                     interval = fields.integer(7);
+                     alt = fields.number(8);
                     if (csvType == joule && tempType != degNone) {
                         // is the position always the same?
                         // should we read the header and assign positions
                         // to each item instead?
-                        temp = line.section(',', 9, 9).toDouble();
+                        temp = fields.number(9);
                         if (tempType == degF) {
                            // convert to deg C
                            temp *= FAHRENHEIT_PER_CENTIGRADE + FAHRENHEIT_ADD_CENTIGRADE;
@@ -670,58 +674,58 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                 } else if (csvType == gc) {
                     // GoldenCheetah CVS Format "secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, slope, temp, interval, lrbalance, lte, rte, lps, rps, smo2, thb, o2hb, hhb\n";
 
-                    seconds = line.section(',', 0, 0).toDouble();
+                    seconds = fields.number(0);
                     minutes = seconds / 60.0f;
-                    cad = line.section(',', 1, 1).toDouble();
-                    hr = line.section(',', 2, 2).toDouble();
-                    km = line.section(',', 3, 3).toDouble();
-                    kph = line.section(',', 4, 4).toDouble();
-                    nm = line.section(',', 5, 5).toDouble();
-                    watts = line.section(',', 6, 6).toDouble();
-                    alt = line.section(',', 7, 7).toDouble();
-                    lon = line.section(',', 8, 8).toDouble();
-                    lat = line.section(',', 9, 9).toDouble();
-                    headwind = line.section(',', 10, 10).toDouble();
-                    slope = line.section(',', 11, 11).toDouble();
-                    temp = line.section(',', 12, 12)=="" ? double(RideFile::NA) : line.section(',', 12, 12).toDouble();
-                    interval = line.section(',', 13, 13).toInt();
-                    lrbalance = line.section(',', 14, 14).toDouble();
-                    lte = line.section(',', 15, 15).toDouble();
-                    rte = line.section(',', 16, 16).toDouble();
-                    lps = line.section(',', 17, 17).toDouble();
-                    rps = line.section(',', 18, 18).toDouble();
-                    smo2 = line.section(',', 19, 19).toDouble();
-                    thb = line.section(',', 20, 20).toDouble();
-                    //UNUSED o2hb = line.section(',', 21, 21).toDouble();
-                    //UNUSED hhb = line.section(',', 22, 22).toDouble();
-                    target = line.section(',', 23, 23).toInt();
+                    cad = fields.number(1);
+                    hr = fields.number(2);
+                    km = fields.number(3);
+                    kph = fields.number(4);
+                    nm = fields.number(5);
+                    watts = fields.number(6);
+                    alt = fields.number(7);
+                    lon = fields.number(8);
+                    lat = fields.number(9);
+                    headwind = fields.number(10);
+                    slope = fields.number(11);
+                    temp = fields.isEmpty(12) ? double(RideFile::NA) : fields.number(12);
+                    interval = fields.integer(13);
+                    lrbalance = fields.number(14);
+                    lte = fields.number(15);
+                    rte = fields.number(16);
+                    lps = fields.number(17);
+                    rps = fields.number(18);
+                    smo2 = fields.number(19);
+                    thb = fields.number(20);
+                    //UNUSED o2hb = fields.number(21);
+                    //UNUSED hhb = fields.number(22);
+                    target = fields.integer(23);
 
                 } else if (csvType == peripedal) {
 
                     //mm-dd,hh:mm:ss,SmO2 Live,SmO2 Averaged,THb,Target Power,Heart Rate,Speed,Power,Cadence
                     // ignore lines with wrong number of entries
-                    if (line.split(",").count() != 10) continue;
+                    if (fields.count() != 10) continue;
 
-                    seconds = moxySeconds(line.section(',',1,1));
+                    seconds = moxySeconds(fields.text(1));
                     minutes = seconds / 60.0f;
 
                     if (startTime == QDateTime()) {
-                        QDate date = periDate(line.section(',',0,0));
+                        QDate date = periDate(fields.text(0));
                         QTime time = QTime(0,0,0).addSecs(seconds);
                         startTime = QDateTime(date,time);
                     }
 
-                    double aSmo2 = line.section(',', 3, 3).toDouble();
-                    smo2 = line.section(',', 2, 2).toDouble();
+                    double aSmo2 = fields.number(3);
+                    smo2 = fields.number(2);
 
                     // use average if live not available
                     if (aSmo2 && !smo2) smo2 = aSmo2;
 
-                    thb = line.section(',', 4, 4).toDouble();
-                    hr = line.section(',', 6, 6).toDouble();
-                    kph = line.section(',', 7, 7).toDouble();
-                    watts = line.section(',', 8, 8).toDouble();
-                    cad = line.section(',', 10, 10).toDouble();
+                    thb = fields.number(4);
+                    hr = fields.number(6);
+                    kph = fields.number(7);
+                    watts = fields.number(8);
+                    cad = fields.number(10);
 
                     // dervice distance from speed
                     km = lastKM + (kph/3600.0f);
@@ -750,7 +754,7 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                     }
 
                     QRegExp timestampRegEx("^([0-9]*):([0-9]*)$");
-                    QString timestamp = line.section(',', 0, 0);
+                    QString timestamp = fields.text(0);
 
 
                     // Time,Miles,MPH,Watts,HR,RPM
@@ -760,11 +764,11 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                     int min = timestampRegEx.cap(1).toInt();
                     minutes = (double(min) + double(sec)/60.0f);
 
-                    cad = line.section(',', 5, 5).toDouble();
-                    hr = line.section(',', 4, 4).toDouble();
-                    km = line.section(',', 1, 1).toDouble();
-                    kph = line.section(',', 2, 2).toDouble();
-                    watts = line.section(',', 3, 3).toDouble();
+                    cad = fields.number(5);
+                    hr = fields.number(4);
+                    km = fields.number(1);
+                    kph = fields.number(2);
+                    watts = fields.number(3);
 
                     if (!metric) {
                         km *= KM_PER_MILE;
@@ -780,40 +784,40 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                     // For ibike software version 11 or higher:
                     // use "power" field until a the "dfpm" field becomes non-zero.
                      minutes = (recInterval * lineno - unitsHeader)/60.0;
-                     QString timestamp = line.section( ',', 14, 14);
+                     QString timestamp = fields.text(14);
                      if (timestamp.length()>0){
                          minutes = startTime.secsTo(QDateTime::fromString(timestamp, Qt::ISODate))/60.0;
                      }
                      nm = 0; //no torque
-                     kph = line.section(',', 0, 0).toDouble();
-                     dfpm = line.section( ',', 11, 11).toDouble();
-                     headwind = line.section(',', 1, 1).toDouble();
-                     km = line.section(',', 3, 3).toDouble();
+                     kph = fields.number(0);
+                     dfpm = fields.number(11);
+                     headwind = fields.number(1);
+                     km = fields.number(3);
 
                      if( iBikeVersion >= 11 && ( dfpm > 0.0 || dfpmExists ) ) {
                          dfpmExists = true;
                          watts = dfpm;
                      }
                      else {
-                         watts = line.section(',', 2, 2).toDouble();
+                         watts = fields.number(2);
                      }
                      XDataPoint *p = new XDataPoint();
                      p->secs = minutes*60.0;
                      p->km = km;
-                     p->number[0] = line.section(',', 2, 2).toDouble();  // CALC-POWER
-                     p->number[1] = line.section(',', 17, 17).toDouble();  // Rho
+                     p->number[0] = fields.number(2);  // CALC-POWER
+                     p->number[1] = fields.number(17);  // Rho
                      ibikeSeries->datapoints.append(p);
 
-                     cad = line.section(',', 4, 4).toDouble();
-                     hr = line.section(',', 5, 5).toDouble();
-                     alt = line.section(',', 6, 6).toDouble();
-                     slope = line.section(',', 7, 7).toDouble();
-                     temp = line.section(',', 8, 8).toDouble();
-                     lat = line.section(',', 12, 12).toDouble();
-                     lon = line.section(',', 13, 13).toDouble();
+                     cad = fields.number(4);
+                     hr = fields.number(5);
+                     alt = fields.number(6);
+                     slope = fields.number(7);
+                     temp = fields.number(8);
+                     lat = fields.number(12);
+                     lon = fields.number(13);
 
 
-                     int lap = line.section(',', 9, 9).toInt();
+                     int lap = fields.integer(9);
                      if (lap > 0) {
                          iBikeInterval += 1;
                          interval = iBikeInterval;
@@ -831,15 +835,15 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                 } else if (csvType == xtrain) {
                     // this must be xtrain
                     // ignore lines with wrong number of entries
-                    if (line.split(",").count() != 6) continue;
+                    if (fields.count() != 6) continue;
 
                     minutes = (recInterval * lineno - unitsHeader)/60.0;
                     nm = 0; //no torque
-                    hr = line.section(',', 1, 1).toDouble();
-                    cad = line.section(',', 2, 2).toDouble();
-                    watts = line.section(',', 3, 3).toDouble();
-                    slope = line.section(',', 4, 4).toDouble()/10;
-                    kph = line.section(',', 5, 5).toDouble();
+                    hr = fields.number(1);
+                    cad = fields.number(2);
+                    watts = fields.number(3);
+                    slope = fields.number(4)/10;
+                    kph = fields.number(5);
 
                     // derive distance from speed
                     km = lastKM + (kph/3600.0f);
@@ -858,23 +862,23 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                     // need to get time from second column and note that
                     // there will be gaps when recording drops so shouldn't
                     // assume it is a continuous stream
-                    double seconds = moxySeconds(line.section(',',1,1));
+                    double seconds = moxySeconds(fields.text(1));
 
                     if (startTime == QDateTime()) {
-                        QDate date = moxyDate(line.section(',',0,0));
+                        QDate date = moxyDate(fields.text(0));
                         QTime time = QTime(0,0,0).addSecs(seconds);
                         startTime = QDateTime(date,time);
                     }
 
                     if (seconds >0) {
                         minutes = seconds / 60.0f;
-                        smo2 = line.section(',', 2, 2).remove("\"").toDouble();
-                        thb = line.section(',', 4, 4).remove("\"").toDouble();
+                        smo2 = fields.text(2).remove("\"").toDouble();
+                        thb = fields.text(4).remove("\"").toDouble();
                     }
                 }
                 else if (csvType == bsx || csvType == wahooMA)  {
                     if (secsIndex > -1) {
-                        seconds = line.section(',', secsIndex, secsIndex).toDouble();
+                        seconds = fields.number(secsIndex);
 
                         QDateTime time;
 
@@ -894,25 +898,25 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                     }
 
                     if (wattsIndex > -1) {
-                        watts = line.section(',', wattsIndex, wattsIndex).toDouble();
+                        watts = fields.number(wattsIndex);
                     }
                     if (cadenceIndex > -1) {
-                        cad = line.section(',', cadenceIndex, cadenceIndex).toDouble();
+                        cad = fields.number(cadenceIndex);
                     }
                     if (hrIndex > -1) {
-                        hr = line.section(',', hrIndex, hrIndex).toDouble();
+                        hr = fields.number(hrIndex);
                     }
                     if (smo2Index > -1) {
-                        smo2 = line.section(',', smo2Index, smo2Index).toDouble();
+                        smo2 = fields.number(smo2Index);
                     }
                     if (gctIndex > -1) {
-                        gct = line.section(',', gctIndex, gctIndex).toDouble();
+                        gct = fields.number(gctIndex);
                     }
                     if (voIndex > -1) {
-                        vo = line.section(',', voIndex, voIndex).toDouble();
+                        vo = fields.number(voIndex);
                     }
                     if (kphIndex > -1) {
-                        kph = line.section(',', kphIndex, kphIndex).toDouble() * 3.6f; // running speed is given in m/s, convert to km/h
+                        kph = fields.number(kphIndex) * 3.6f; // running speed is given in m/s, convert to km/h
                         if (!metric) {
                            kph *= KM_PER_MILE;
                         }
@@ -923,21 +927,21 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                      *  "double","double",.. so we need to filter out "
                      */
 
-                    km = line.section(',', 0,0).remove("\"").toDouble()/1000;
-                    hr = line.section(',', 2, 2).remove("\"").toDouble();
-                    kph = line.section(',', 3, 3).remove("\"").toDouble()*3.6;
+                    km = fields.text(0).remove("\"").toDouble()/1000;
+                    hr = fields.text(2).remove("\"").toDouble();
+                    kph = fields.text(3).remove("\"").toDouble()*3.6;
 
-                    lat = line.section(',', 5, 5).remove("\"").toDouble();
+                    lat = fields.text(5).remove("\"").toDouble();
                     /* Item 8 is crank torque, 13 is wheel torque */
-                    nm = line.section(',', 8, 8).remove("\"").toDouble();
+                    nm = fields.text(8).remove("\"").toDouble();
 
                     /* Ok there's no crank torque, try the wheel */
                     if(nm == 0.0) {
-                         nm = line.section(',', 13, 13).remove("\"").toDouble();
+                         nm = fields.text(13).remove("\"").toDouble();
                     }
                     if(epoch_set == false) {
                          epoch_set = true;
-                         epoch_offset = line.section(',', 9,9).remove("\"").toULongLong(&ok, 10);
+                         epoch_offset = fields.text(9).remove("\"").toULongLong(&ok, 10);
 
                          /* We use this first value as the start time */
                          startTime = QDateTime();
@@ -945,14 +949,14 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                          rideFile->setStartTime(startTime);
                     }
 
-                    ms = line.section(',', 9,9).remove("\"").toULongLong(&ok, 10);
+                    ms = fields.text(9).remove("\"").toULongLong(&ok, 10);
                     ms -= epoch_offset;
                     seconds = ms/1000;
 
-                    alt = line.section(',', 10, 10).remove("\"").toDouble();
-                    watts = line.section(',', 11, 11).remove("\"").toDouble();
-                    lon = line.section(',', 15, 15).remove("\"").toDouble();
-                    cad = line.section(',', 16, 16).remove("\"").toDouble();
+                    alt = fields.text(10).remove("\"").toDouble();
+                    watts = fields.text(11).remove("\"").toDouble();
+                    lon = fields.text(15).remove("\"").toDouble();
+                    cad = fields.text(16).remove("\"").toDouble();
                }
                 else if (csvType == ergomo) {
                      // for ergomo formatted CSV files
@@ -967,7 +971,7 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                      kph = kph_string.toDouble();
                      hr = line.section(ergomo_separator, 5, 5).toDouble();
                      alt = line.section(ergomo_separator, 6, 6).toDouble();
-                     interval = line.section(',', 8, 8).toInt();
+                     interval = fields.integer(8);
                      if (interval != prevInterval) {
                          prevInterval = interval;
                          if (interval != 0) currentInterval++;
@@ -990,14 +994,14 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                      }
                 } else if (csvType == cpexport) {
                     // seconds, value, (model), date
-                    seconds = line.section(',',0,0).toDouble();
+                    seconds = fields.number(0);
                     if (seconds == precSecs)
                         continue;
                     minutes = seconds / 60.0f;
 
 
                     //seconds = lineno -1 ;
-                    double avgWatts = line.section(',', 1, 1).toDouble();
+                    double avgWatts = fields.number(1);
                     if ( avgWatts > maxWatts ) {
                         maxWatts = avgWatts;
                     }
@@ -1037,20 +1041,20 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                         unitsHeader = lineno + 1000;
                         continue;
                     }
-                    seconds = line.section(',', 0, 0).toDouble() / 1000;
+                    seconds = fields.number(0) / 1000;
                     minutes = seconds / 60.0f;
-                    km = line.section(',', 1, 1).toDouble() / 1000;
-                    double pace = line.section(',', 2, 2).toDouble();
+                    km = fields.number(1) / 1000;
+                    double pace = fields.number(2);
                     if (pace > 0 ) {
                         kph = 3.6 / pace;
                     }
-                    watts = line.section(',', 3, 3).toDouble();
-                    cad = line.section(',', 5, 5).toDouble();
-                    hr = line.section(',', 6, 6).toDouble();
+                    watts = fields.number(3);
+                    cad = fields.number(5);
+                    hr = fields.number(6);
 
                } else {
                     if (secsIndex > -1) {
-                        seconds = line.section(',', secsIndex, secsIndex).toDouble();
+                        seconds = fields.number(secsIndex);
                         minutes = seconds / 60.0f;
                      }
                 }
@@ -1183,13 +1187,12 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                        }
                    } else if (xdataSeries != NULL) {
 
-                       QStringList els = line.split(",", QString::KeepEmptyParts);
-                       if (els.count() != xdataSeries->valuename.count()+2) continue;
+                       if (fields.count() != xdataSeries->valuename.count()+2) continue;
                        // add ALL data series to XDATA
                        XDataPoint *p = new XDataPoint();
-                       p->secs = els[0].toDouble();
-                       p->km = els[1].toDouble();
-                       for(int i=2; i<els.count(); i++) p->number[i-2] = els[i].toDouble();
+                       p->secs = fields.number(0);
+                       p->km = fields.number(1);
+                       for(int i=2; i<fields.count(); i++) p->number[i-2] = fields.number(i);
                        xdataSeries->datapoints.append(p);
 
                        // only time and distance as standard series
@@ -1207,12 +1210,12 @@ RideFile *CsvFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
                } else if (csvType == opendata) {
 
                     // secs,km,power,hr,cad,alt
-                    double secs = line.section(',', 0, 0).toDouble();
-                    km = line.section(',', 1, 1).toDouble();
-                    watts = line.section(',', 2, 2).toDouble();
-                    hr = line.section(',', 3, 3).toDouble();
-                    cad = line.section(',', 4, 4).toDouble();
-                    alt = line.section(',', 5, 5).toDouble();
+                    double secs = fields.number(0);
+                    km = fields.number(1);
+                    watts = fields.number(2);
+                    hr = fields.number(3);
+                    cad = fields.number(4);
+                    alt = fields.number(5);
                     kph = (km - lastkm) / (secs-lastsecs) * 3600;
 
                     // for next time
@@ -33,6 +33,7 @@
 #include <time.h>
 #include <limits>
 #include <cmath>
+#include <algorithm>
 
 #define FIT_DEBUG               false // debug traces
 #define FIT_DEBUG_LEVEL         4    // debug level : 1 message, 2 definition, 3 data without record, 4 data
@@ -89,9 +90,11 @@ struct FitDeveField {
 };
 
 struct FitDefinition {
+    FitDefinition() : global_msg_num(0), is_big_endian(false), skipped(0) {}
     int global_msg_num;
     bool is_big_endian;
     std::vector<FitField> fields;
+    int skipped; // bytes of developer fields left out
 };
 
 enum fitValueType { SingleValue, ListValue, FloatValue, StringValue };
@@ -111,6 +114,7 @@ struct FitFileReaderState
 {
     QFile &file;
     QStringList &errors;
+    int skip; // FitFileReader::SkipMessages the caller doesn't want
     RideFile *rideFile;
     time_t start_time;
     time_t last_time;
@@ -134,6 +138,8 @@ struct FitFileReaderState
     int last_event_type;
     int last_event;
     int last_msg_type;
+    bool has_activity_offset;
+    int activity_offset; // local time adjustment from the activity message
     double frac_time; // to carry sub-second length time in pool swimming
     double last_altitude; // to avoid problems when records lacks altitude
     QVariant isGarminSmartRecording;
@@ -154,16 +160,35 @@ struct FitFileReaderState
     QList<QMap<int, QString>> session_device_info_list_;
     QList<QList<QString>> session_data_info_list_;
 
-    FitFileReaderState(QFile &file, QStringList &errors) :
-        file(file), errors(errors), rideFile(NULL), start_time(0),
+    FitFileReaderState(QFile &file, QStringList &errors, int skip = FitFileReader::SkipNone) :
+        file(file), errors(errors), skip(skip), rideFile(NULL), start_time(0),
         last_time(0), last_distance(0.00f), interval(0), calibration(0),
         devices(0), stopped(true), isLapSwim(false), pool_length(0.0),
-        last_event_type(-1), last_event(-1), last_msg_type(-1), frac_time(0.0),
+        last_event_type(-1), last_event(-1), last_msg_type(-1),
+        has_activity_offset(false), activity_offset(0), frac_time(0.0),
         last_altitude(0.0)
     {}
 
     struct TruncatedRead {};
 
+    // messages the caller asked us to step over
+    bool skipped(int global_msg_num) const {
+        switch (global_msg_num) {
+        case HRV_MSG_NUM:
+            return skip & (FitFileReader::SkipHRV | FitFileReader::SkipSamples);
+        case 206: // developer field description
+            return skip & FitFileReader::SkipDeveloper;
+        case RECORD_MSG_NUM:
+        case 101: // length
+        case 128: // weather
+        case 132: // hr
+        case SEGMENT_MSG_NUM:
+            return skip & FitFileReader::SkipSamples;
+        default:
+            return false;
+        }
+    }
+
     void read_unknown( int size, int *count = NULL ) {
         if (!file.seek(file.pos() + size))
             throw TruncatedRead();
@@ -1305,6 +1330,10 @@ struct FitFileReaderState
         if (0 == local_timestamp && 0 == timestamp)
             return;
 
+        // remembered for a scan, which has no records to set the start time
+        activity_offset = (0 == local_timestamp) ? timestamp : local_timestamp - timestamp;
+        has_activity_offset = true;
+
         QDateTime t(rideFile->startTime().toUTC());
         if (0 == local_timestamp) {
             // ZWift FIT files are not reporting local timestamp
@@ -2816,6 +2845,15 @@ struct FitFileReaderState
                 int num_fields = read_uint8(&count);
 
                 for (int i = 0; i < num_fields; ++i) {
+
+                    // not wanted, just remember how much to step over
+                    if (skip & FitFileReader::SkipDeveloper) {
+                        read_uint8(&count);
+                        def.skipped += read_uint8(&count);
+                        read_uint8(&count);
+                        continue;
+                    }
+
                     def.fields.push_back(FitField());
                     FitField &field = def.fields.back();
 
@@ -2862,7 +2900,17 @@ struct FitFileReaderState
                     def.global_msg_num, time_offset );
             }
 
+            // not wanted by the caller, step over it
+            if (skipped(def.global_msg_num)) {
+                int size = def.skipped;
+                foreach(const FitField &field, def.fields) size += field.size;
+                read_unknown(size, &count);
+                last_msg_type = def.global_msg_num;
+                return count;
+            }
+
             std::vector<FitValue> values;
+            values.reserve(def.fields.size());
             foreach(const FitField &field, def.fields) {
                 FitValue value;
                 int size;
@@ -3027,6 +3075,9 @@ struct FitFileReaderState
                     }
                 }
             }
+            // developer fields left out
+            if (def.skipped) read_unknown(def.skipped, &count);
+
             // Most of the record types in the FIT format aren't actually all
             // that useful.  FileId, Lap, and Record clearly are.  The one
             // other one that might be useful is DeviceInfo, but it doesn't
@@ -3156,6 +3207,7 @@ struct FitFileReaderState
         rideFile->setRecIntSecs(1.0); // this is a terrible assumption!
         if (!file.open(QIODevice::ReadOnly)) {
             delete rideFile;
+            rideFile = NULL;
             return NULL;
         }
 
@@ -3228,6 +3280,7 @@ struct FitFileReaderState
         if (stop) {
             file.close();
             delete rideFile;
+            rideFile = NULL;
             return NULL;
         }
         else {
@@ -3346,12 +3399,46 @@ struct FitFileReaderState
             delete extraXdata;
     }
 
+    // after a run() that skipped the samples, the sessions say when the
+    // activity started and stopped. false if they don't (or it didn't parse)
+    bool summarise(RideFileSummary &summary) {
+
+        if (rideFile == NULL) return false;
+
+        quint32 start = 0, stop = 0;
+        foreach(const SessionTagMap &session, session_tags_) {
+            if (start == 0 && session.contains("_start_time")) start = session.value("_start_time").toUInt();
+            if (session.contains("_timestamp")) stop = session.value("_timestamp").toUInt();
+        }
+
+        bool summarised = (start != 0);
+        if (summarised) {
+
+            // as decodeRecord() and decodeActivity() would set it
+            QDateTime t;
+            t.setTime_t(start - 1);
+            if (has_activity_offset) t = t.toUTC().addSecs(activity_offset);
+
+            summary.startTime = t;
+            summary.duration = stop > start ? stop - start : 0;
+            summary.deviceType = rideFile->deviceType();
+            summary.tags = rideFile->tags();
+        }
+
+        delete rideFile;
+        rideFile = NULL;
+        return summarised;
+    }
+
     RideFile *splitSessions(QList<RideFile*> *rides) {
         // NOTES:
         // - start altitude of first transition not correct (zero), leads to too high climb figure
         //   i think this is not really a big deal yet
 
-        if (session_tags_.size() < 2) {
+        if (rideFile == NULL) return NULL; // didn't parse
+
+        // one session, or the caller only wants the combined ride
+        if (session_tags_.size() < 2 || rides == NULL) {
             // just check if it was a run activity and adjust values, like it was done
             // in decoding the session before.
             if (rideFile->isRun()) {
@@ -3407,9 +3494,9 @@ struct FitFileReaderState
             int idx_start = rideFile->timeIndex(start - start_time);
             int idx_stop = rideFile->timeIndex(stop - start_time);
             // add data points to the new file created.
-            const QVector<RideFilePoint*> points_from_file = rideFile->dataPoints().mid(idx_start, idx_stop - idx_start);
-            foreach(RideFilePoint *p, points_from_file) {
-                rf->appendPoint(*p);
+            const QVector<RideFilePoint*> &points_from_file = rideFile->dataPoints();
+            for (int i = qMax(0, idx_start); i < idx_stop && i < points_from_file.count(); i++) {
+                rf->appendPoint(*points_from_file[i]);
             }
 
             // fix subsport tag of transitions
@@ -3437,22 +3524,33 @@ struct FitFileReaderState
                 }
             }
 
-            // add XData
+            // add XData, only copying the points in this session
+            // rather than the whole series (they are in time order)
             const auto file_xdata = rideFile->xdata();
             for (auto it = file_xdata.begin(); it != file_xdata.end(); ++it) {
-                XDataSeries *s = new XDataSeries(*(it.value()));
-                s->datapoints.erase(std::remove_if(s->datapoints.begin(), s->datapoints.end(), [start_time, start, stop](XDataPoint *xdp){
-                    return xdp && (xdp->secs >= (stop - start_time) || xdp->secs < (start - start_time));
-                }), s->datapoints.end());
+                const QVector<XDataPoint*> &from = it.value()->datapoints;
+                const double from_secs = start - start_time, to_secs = stop - start_time;
+                auto first = std::lower_bound(from.begin(), from.end(), from_secs, [](XDataPoint *xdp, double secs) {
+                    return xdp->secs < secs;
+                });
+                if (first == from.end() || (*first)->secs >= to_secs) continue;
+
+                XDataSeries *s = new XDataSeries;
+                s->name = it.value()->name;
+                s->valuename = it.value()->valuename;
+                s->unitname = it.value()->unitname;
+                s->valuetype = it.value()->valuetype;
+
                 // adjust their timing
-                if (!s->datapoints.empty()) {
-                    auto first_time = s->datapoints.first()->secs;
-                    foreach (XDataPoint *p, s->datapoints) {
-                        p->secs -= first_time;
-                    }
-                    // and append
-                    rf->addXData(it.key(), s);
+                const double first_time = (*first)->secs;
+                for (auto p = first; p != from.end() && (*p)->secs < to_secs; ++p) {
+                    XDataPoint *add = new XDataPoint(**p);
+                    add->secs -= first_time;
+                    s->datapoints.append(add);
                 }
+
+                // and append
+                rf->addXData(it.key(), s);
             }
 
             // convert if necessary (run and transition)
@@ -3479,7 +3577,20 @@ struct FitFileReaderState
 
 RideFile *FitFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*> *rides) const
 {
-    QSharedPointer<FitFileReaderState> state(new FitFileReaderState(file, errors));
+    return openRideFile(file, errors, rides, SkipNone);
+}
+
+bool FitFileReader::scanRideFile(QFile &file, RideFileSummary &summary, QStringList &errors) const
+{
+    // file id, activity and sessions only
+    QSharedPointer<FitFileReaderState> state(new FitFileReaderState(file, errors, SkipSamples | SkipDeveloper));
+    state->run();
+    return state->summarise(summary);
+}
+
+RideFile *FitFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*> *rides, int skip) const
+{
+    QSharedPointer<FitFileReaderState> state(new FitFileReaderState(file, errors, skip));
     auto ret = state->run();
     ret = state->splitSessions(rides);
     return ret;
@@ -24,7 +24,19 @@
 
 struct FitFileReader : public RideFileReader {
 
+    // messages that can be stepped over rather than decoded, for callers
+    // that don't need them (e.g. a summary scan has no use for samples)
+    enum skipmessages { SkipNone = 0x00,
+                        SkipHRV = 0x01,        // beat to beat intervals
+                        SkipDeveloper = 0x02,  // developer fields and their descriptions
+                        SkipSamples = 0x04     // records, lengths, hr, hrv, weather and segments
+                      };
+
     virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*> *rides = 0) const;
+    RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*> *rides, int skip) const;
+
+    bool hasScan() const { return true; }
+    bool scanRideFile(QFile &file, RideFileSummary &summary, QStringList &errors) const;
 
     QByteArray toByteArray(Context *context, const RideFile *ride, bool withAlt, bool withWatts, bool withHr, bool withCad) const;
     bool writeRideFile(Context *context, const RideFile *ride, QFile &file) const;
@@ -18,6 +18,7 @@
 
 #include "FitlogRideFile.h"
 #include "FitlogParser.h"
+#include "XmlStreamParser.h"
 #include <QDomDocument>
 
 #include "Context.h"
@@ -43,10 +44,7 @@ RideFile *FitlogFileReader::openRideFile(QFile &file, QStringList &errors, QList
 
     FitlogParser handler(rideFile, list);
 
-    QXmlInputSource source (&file);
-    QXmlSimpleReader reader;
-    reader.setContentHandler (&handler);
-    reader.parse (source);
+    XmlStreamParser::parse(file, handler);
 
     return rideFile;
 }
@@ -4,6 +4,7 @@
 #include "FixPyRunner.h"
 #include "PythonEmbed.h"
 #include "RideFileCommand.h"
+#include "RideResidency.h"
 
 FixPyRunner::FixPyRunner(Context *context, RideFile *rideFile, bool useNewThread)
     : context(context), rideFile(rideFile), useNewThread(useNewThread)
@@ -36,6 +37,9 @@ int FixPyRunner::run(QString source, QString scriptKey, QString &errText)
         params.rideFile = rideFile;
         params.script = QString(line);
 
+        // scripts can get at any ride
+        RideResidencyHold hold(context);
+
         if (useNewThread) {
             QFutureWatcher<void> watcher;
             QFuture<void> f = QtConcurrent::run(execScript, &params);
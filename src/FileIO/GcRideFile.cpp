@@ -19,6 +19,7 @@
 #include "GcRideFile.h"
 #include <algorithm> // for std::sort
 #include <QDomDocument>
+#include <QXmlStreamReader>
 #include <QVector>
 
 #include <QDebug>
@@ -29,138 +30,171 @@ static int gcFileReaderRegistered =
     RideFileFactory::instance().registerReader(
         "gc", "GoldenCheetah XML", new GcFileReader());
 
+//
+// Read as a stream, everything of interest is held in attributes so there
+// is no need to build a document for the whole file first
+//
 RideFile *
 GcFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*) const
 {
-    QDomDocument doc("GoldenCheetah");
     if (!file.open(QIODevice::ReadOnly)) {
         errors << "Could not open file.";
         return NULL;
     }
 
-    bool parsed = doc.setContent(&file);
-    file.close();
-    if (!parsed) {
+    QXmlStreamReader xml(&file);
+    if (!xml.readNextStartElement()) {
+        file.close();
         errors << "Could not parse file.";
         return NULL;
     }
 
     RideFile *rideFile = new RideFile();
-    QDomElement root = doc.documentElement();
-    QDomNode attributes = root.firstChildElement("attributes");
-
-    for (QDomElement attr = attributes.firstChildElement("attribute");
-         !attr.isNull(); attr = attr.nextSiblingElement("attribute")) {
-        QString key = attr.attribute("key");
-        QString value = attr.attribute("value");
-        if (key == "Device type")
-            rideFile->setDeviceType(value);
-        else if (key == "File Format")
-            rideFile->setFileFormat(value);
-        if (key == "Start time") {
-            // by default QDateTime is localtime - the source however is UTC
-            QDateTime aslocal = QDateTime::fromString(value, DATETIME_FORMAT);
-            // construct in UTC so we can honour the conversion to localtime
-            QDateTime asUTC = QDateTime(aslocal.date(), aslocal.time(), Qt::UTC);
-            // now set in localtime
-            rideFile->setStartTime(asUTC.toLocalTime());
-        }
-        if (key == "Identifier") {
-            rideFile->setId(value);
+    QVector<double> intervalStops; // used to set the interval number for each point
+    bool hasSamples = false;
+    bool recIntSet = false;
+
+    while (xml.readNextStartElement()) {
+
+        if (xml.name() == "attributes") {
+
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "attribute") {
+                    QString key = xml.attributes().value("key").toString();
+                    QString value = xml.attributes().value("value").toString();
+                    if (key == "Device type")
+                        rideFile->setDeviceType(value);
+                    else if (key == "File Format")
+                        rideFile->setFileFormat(value);
+                    if (key == "Start time") {
+                        // by default QDateTime is localtime - the source however is UTC
+                        QDateTime aslocal = QDateTime::fromString(value, DATETIME_FORMAT);
+                        // construct in UTC so we can honour the conversion to localtime
+                        QDateTime asUTC = QDateTime(aslocal.date(), aslocal.time(), Qt::UTC);
+                        // now set in localtime
+                        rideFile->setStartTime(asUTC.toLocalTime());
+                    }
+                    if (key == "Identifier") {
+                        rideFile->setId(value);
+                    }
+                }
+                xml.skipCurrentElement();
+            }
+
+        } else if (xml.name() == "override") {
+
+            // read in metric overrides:
+            //  <override>
+            //    <metric name="skiba_bike_score" value="100"/>
+            //    <metric name="average_speed" secs="3600" km="30"/>
+            //  </override>
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "metric") {
+
+                    // setup the metric overrides QMap
+                    QMap<QString, QString> bsm;
+
+                    // for now only value is known to be maintained
+                    bsm.insert("value", xml.attributes().value("value").toString());
+
+                    // insert into the rideFile overrides
+                    rideFile->metricOverrides.insert(xml.attributes().value("name").toString(), bsm);
+                }
+                xml.skipCurrentElement();
+            }
+
+        } else if (xml.name() == "tags") {
+
+            // read in the name/value metadata pairs
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "tag")
+                    rideFile->setTag(xml.attributes().value("name").toString(), xml.attributes().value("value").toString());
+                xml.skipCurrentElement();
+            }
+
+        } else if (xml.name() == "intervals") {
+
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "interval") {
+
+                    // record the stops for old-style datapoint interval numbering
+                    double stop = xml.attributes().value("stop").toDouble();
+                    intervalStops.append(stop);
+
+                    // add a new interval to the new-style interval ranges
+                    RideFileInterval add;
+                    add.stop = stop;
+                    add.start = xml.attributes().value("start").toDouble();
+                    add.name = xml.attributes().value("name").toString();
+                    rideFile->addInterval(RideFileInterval::DEVICE, add.start, add.stop, add.name);
+                }
+                xml.skipCurrentElement();
+            }
+
+        } else if (xml.name() == "samples") {
+
+            hasSamples = true;
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "sample") {
+                    QXmlStreamAttributes sample = xml.attributes();
+                    double secs, cad, hr, km, kph, nm, watts, alt, lon, lat;
+                    double headwind = 0.0;
+                    secs = sample.value("secs").toDouble();
+                    cad = sample.value("cad").toDouble();
+                    hr = sample.value("hr").toDouble();
+                    km = sample.value("km").toDouble();
+                    kph = sample.value("kph").toDouble();
+                    nm = sample.value("nm").toDouble();
+                    watts = sample.value("watts").toDouble();
+                    alt = sample.value("alt").toDouble();
+                    lon = sample.value("lon").toDouble();
+                    lat = sample.value("lat").toDouble();
+                    rideFile->appendPoint(secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, 0.0,
+                                           RideFile::NA, RideFile::NA,
+                                          0.0, 0.0, 0.0, 0.0,
+                                          0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0);
+                    if (!recIntSet) {
+                        rideFile->setRecIntSecs(sample.value("len").toDouble());
+                        recIntSet = true;
+                    }
+                }
+                xml.skipCurrentElement();
+            }
+
+        } else {
+            xml.skipCurrentElement();
         }
     }
 
-    // read in metric overrides:
-    //  <override>
-    //    <metric name="skiba_bike_score" value="100"/>
-    //    <metric name="average_speed" secs="3600" km="30"/>
-    //  </override>
-
-    QDomNode overrides = root.firstChildElement("override");
-    if (!overrides.isNull()) {
-
-        for (QDomElement override = overrides.firstChildElement("metric");
-            !override.isNull();
-            override = override.nextSiblingElement("metric")) {
-
-            // setup the metric overrides QMap
-            QMap<QString, QString> bsm;
-
-            // for now only value is known to be maintained
-            bsm.insert("value", override.attribute("value"));
+    // the rest of the file needs to be well formed too
+    while (!xml.atEnd()) xml.readNext();
+    bool parsed = !xml.hasError();
+    file.close();
 
-            // insert into the rideFile overrides
-            rideFile->metricOverrides.insert(override.attribute("name"), bsm);
-        }
+    if (!parsed) {
+        errors << "Could not parse file.";
+        delete rideFile;
+        return NULL;
     }
 
-    // read in the name/value metadata pairs
-    QDomNode tags = root.firstChildElement("tags");
-    if (!tags.isNull()) {
-
-        for (QDomElement tag = tags.firstChildElement("tag");
-             !tag.isNull();
-             tag = tag.nextSiblingElement("tag")) {
+    if (!hasSamples) return rideFile; // manual file will have no samples
 
-            rideFile->setTag(tag.attribute("name"), tag.attribute("value"));
-        }
+    if (!recIntSet) {
+        errors << "no samples in ride file";
+        delete rideFile;
+        return NULL;
     }
 
-    QVector<double> intervalStops; // used to set the interval number for each point
-    RideFileInterval add;          // used to add each named interval to RideFile
-    QDomNode intervals = root.firstChildElement("intervals");
-    if (!intervals.isNull()) {
-        for (QDomElement interval = intervals.firstChildElement("interval");
-             !interval.isNull(); interval = interval.nextSiblingElement("interval")) {
-
-            // record the stops for old-style datapoint interval numbering
-            double stop = interval.attribute("stop").toDouble();
-            intervalStops.append(stop);
-
-            // add a new interval to the new-style interval ranges
-            add.stop = stop;
-            add.start = interval.attribute("start").toDouble();
-            add.name = interval.attribute("name");
-            rideFile->addInterval(RideFileInterval::DEVICE, add.start, add.stop, add.name);
-        }
-    }
+    // old-style datapoint interval numbering, the intervals
+    // might come after the samples so its done at the end
     std::sort(intervalStops.begin(), intervalStops.end()); // just in case
     int interval = 0;
-
-    QDomElement samples = root.firstChildElement("samples");
-    if (samples.isNull()) return rideFile; // manual file will have no samples
-
-    bool recIntSet = false;
-    for (QDomElement sample = samples.firstChildElement("sample");
-         !sample.isNull(); sample = sample.nextSiblingElement("sample")) {
-        double secs, cad, hr, km, kph, nm, watts, alt, lon, lat;
-        double headwind = 0.0;
-        secs = sample.attribute("secs", "0.0").toDouble();
-        cad = sample.attribute("cad", "0.0").toDouble();
-        hr = sample.attribute("hr", "0.0").toDouble();
-        km = sample.attribute("km", "0.0").toDouble();
-        kph = sample.attribute("kph", "0.0").toDouble();
-        nm = sample.attribute("nm", "0.0").toDouble();
-        watts = sample.attribute("watts", "0.0").toDouble();
-        alt = sample.attribute("alt", "0.0").toDouble();
-        lon = sample.attribute("lon", "0.0").toDouble();
-        lat = sample.attribute("lat", "0.0").toDouble();
-        while ((interval < intervalStops.size()) && (secs >= intervalStops[interval]))
+    foreach(RideFilePoint *point, rideFile->dataPoints()) {
+        while ((interval < intervalStops.size()) && (point->secs >= intervalStops[interval]))
             ++interval;
-        rideFile->appendPoint(secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, 0.0,
-                               RideFile::NA, RideFile::NA,
-                              0.0, 0.0, 0.0, 0.0,
-                              0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, interval);
-        if (!recIntSet) {
-            rideFile->setRecIntSecs(sample.attribute("len").toDouble());
-            recIntSet = true;
-        }
-    }
-
-    if (!recIntSet) {
-        errors << "no samples in ride file";
-        return NULL;
+        point->interval = interval;
     }
+    if (interval) rideFile->setDataPresent(RideFile::interval, true);
 
     return rideFile;
 }
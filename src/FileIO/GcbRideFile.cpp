@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2020 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "GcbRideFile.h"
+#include <QDataStream>
+#include <QVector>
+#include <string.h>
+#include <math.h>
+
+static int gcbFileReaderRegistered =
+    RideFileFactory::instance().registerReader(
+        "gcb", "GoldenCheetah Binary", new GcbFileReader());
+
+static const quint32 GCB_MAGIC = 0x47434231; // "GCB1"
+static const quint32 GCB_VERSION = 1;
+
+// how a column of values is compressed
+enum { GCB_CONSTANT=0,     // all values the same, stored once
+       GCB_INTEGER=1,      // values * 10^decimals are integers, zigzag varint deltas
+       GCB_DOUBLE=2 };     // varint of bits xor'ed with previous value
+
+// the sample series we store, same as .json, secs is always stored
+static const struct {
+    RideFile::SeriesType series;
+    bool RideFileDataPresent::*present;
+} gcbSeries[] = {
+    { RideFile::secs, &RideFileDataPresent::secs },
+    { RideFile::km, &RideFileDataPresent::km },
+    { RideFile::watts, &RideFileDataPresent::watts },
+    { RideFile::nm, &RideFileDataPresent::nm },
+    { RideFile::cad, &RideFileDataPresent::cad },
+    { RideFile::kph, &RideFileDataPresent::kph },
+    { RideFile::hr, &RideFileDataPresent::hr },
+    { RideFile::alt, &RideFileDataPresent::alt },
+    { RideFile::lat, &RideFileDataPresent::lat },
+    { RideFile::lon, &RideFileDataPresent::lon },
+    { RideFile::headwind, &RideFileDataPresent::headwind },
+    { RideFile::slope, &RideFileDataPresent::slope },
+    { RideFile::temp, &RideFileDataPresent::temp },
+    { RideFile::lrbalance, &RideFileDataPresent::lrbalance },
+    { RideFile::lte, &RideFileDataPresent::lte },
+    { RideFile::rte, &RideFileDataPresent::rte },
+    { RideFile::lps, &RideFileDataPresent::lps },
+    { RideFile::rps, &RideFileDataPresent::rps },
+    { RideFile::lpco, &RideFileDataPresent::lpco },
+    { RideFile::rpco, &RideFileDataPresent::rpco },
+    { RideFile::lppb, &RideFileDataPresent::lppb },
+    { RideFile::rppb, &RideFileDataPresent::rppb },
+    { RideFile::lppe, &RideFileDataPresent::lppe },
+    { RideFile::rppe, &RideFileDataPresent::rppe },
+    { RideFile::lpppb, &RideFileDataPresent::lpppb },
+    { RideFile::rpppb, &RideFileDataPresent::rpppb },
+    { RideFile::lpppe, &RideFileDataPresent::lpppe },
+    { RideFile::rpppe, &RideFileDataPresent::rpppe },
+    { RideFile::smo2, &RideFileDataPresent::smo2 },
+    { RideFile::thb, &RideFileDataPresent::thb },
+    { RideFile::rcad, &RideFileDataPresent::rcad },
+    { RideFile::rvert, &RideFileDataPresent::rvert },
+    { RideFile::rcontact, &RideFileDataPresent::rcontact },
+    { RideFile::none, NULL }
+};
+
+//
+// Column encoding
+//
+static quint64 doubleBits(double value)
+{
+    quint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double bitsDouble(quint64 bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void putVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+static bool getVarint(const uchar *&p, const uchar *end, quint64 &value)
+{
+    value = 0;
+    for (int shift=0; p < end && shift < 64; shift += 7) {
+        uchar byte = *p++;
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false; // truncated or corrupt
+}
+
+static quint64 zigzag(qint64 value) { return (quint64(value) << 1) ^ quint64(value >> 63); }
+static qint64 unzigzag(quint64 value) { return qint64(value >> 1) ^ -qint64(value & 1); }
+
+static QByteArray encodeColumn(const QVector<double> &values)
+{
+    QByteArray out;
+
+    // all the same? (compare bits so -0 and nan are kept)
+    bool constant = true;
+    for (int i=1; constant && i<values.count(); i++)
+        if (doubleBits(values.at(i)) != doubleBits(values.at(0))) constant = false;
+
+    if (constant) {
+        out.append(char(GCB_CONSTANT));
+        putVarint(out, values.isEmpty() ? 0 : doubleBits(values.at(0)));
+        return out;
+    }
+
+    // most series are recorded to a fixed number of decimal places so
+    // look for the smallest scale that will round trip every value exactly
+    QVector<qint64> ints(values.count());
+    for (int decimals=0; decimals <= 9; decimals++) {
+
+        double scale = pow(10.0, decimals);
+        bool lossless = true;
+        for (int i=0; lossless && i<values.count(); i++) {
+            double scaled = values.at(i) * scale;
+            if (!(fabs(scaled) < 9007199254740992.0)) lossless = false; // 2^53, also catches nan
+            else {
+                ints[i] = qRound64(scaled);
+                if (doubleBits(double(ints[i]) / scale) != doubleBits(values.at(i))) lossless = false;
+            }
+        }
+
+        if (lossless) {
+            out.append(char(GCB_INTEGER));
+            out.append(char(decimals));
+            qint64 last = 0;
+            foreach(qint64 value, ints) {
+                putVarint(out, zigzag(value - last));
+                last = value;
+            }
+            return out;
+        }
+    }
+
+    // floating point, neighbouring values share sign, exponent and
+    // the top of the mantissa so the xor has lots of leading zeros
+    out.append(char(GCB_DOUBLE));
+    quint64 last = 0;
+    foreach(double value, values) {
+        quint64 bits = doubleBits(value);
+        putVarint(out, bits ^ last);
+        last = bits;
+    }
+    return out;
+}
+
+static bool decodeColumn(const QByteArray &column, int count, QVector<double> &values)
+{
+    if (column.isEmpty() || count < 0) return false;
+
+    // every value takes at least a byte unless they are all the same
+    // so a corrupt count can't have us allocate more than the data
+    if (column.at(0) != char(GCB_CONSTANT) && count > column.size()) return false;
+    values.resize(count);
+
+    const uchar *p = reinterpret_cast<const uchar*>(column.constData());
+    const uchar *end = p + column.size();
+    quint64 raw;
+
+    switch (*p++) {
+
+    case GCB_CONSTANT:
+        {
+            if (!getVarint(p, end, raw)) return false;
+            values.fill(bitsDouble(raw));
+        }
+        break;
+
+    case GCB_INTEGER:
+        {
+            if (p >= end) return false;
+            double scale = pow(10.0, int(*p++));
+            qint64 last = 0;
+            for (int i=0; i<count; i++) {
+                if (!getVarint(p, end, raw)) return false;
+                last += unzigzag(raw);
+                values[i] = double(last) / scale;
+            }
+        }
+        break;
+
+    case GCB_DOUBLE:
+        {
+            quint64 last = 0;
+            for (int i=0; i<count; i++) {
+                if (!getVarint(p, end, raw)) return false;
+                last ^= raw;
+                values[i] = bitsDouble(last);
+            }
+        }
+        break;
+
+    default:
+        return false;
+    }
+    return true;
+}
+
+//
+// Reader
+//
+RideFile *
+GcbFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*) const
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        errors << "Could not open file.";
+        return NULL;
+    }
+    QByteArray contents = file.readAll();
+    file.close();
+
+    QDataStream in(contents);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != GCB_MAGIC) {
+        errors << "Not a GoldenCheetah binary file.";
+        return NULL;
+    }
+    if (version > GCB_VERSION) {
+        errors << QString("Unsupported GoldenCheetah binary version %1.").arg(version);
+        return NULL;
+    }
+
+    RideFile *ride = new RideFile();
+
+    // first class variables
+    qint64 start;
+    double recint;
+    QString devicetype, id;
+    in >> start >> recint >> devicetype >> id;
+    ride->setStartTime(QDateTime::fromMSecsSinceEpoch(start, Qt::UTC).toLocalTime());
+    ride->setRecIntSecs(recint);
+    ride->setDeviceType(devicetype);
+    ride->setId(id);
+
+    // overrides and tags
+    QMap<QString,QString> tags;
+    in >> ride->metricOverrides >> tags;
+    QMapIterator<QString,QString> tag(tags);
+    while (tag.hasNext()) {
+        tag.next();
+        ride->setTag(tag.key(), tag.value());
+    }
+
+    // intervals
+    quint32 count;
+    in >> count;
+    for (quint32 i=0; i<count && in.status() == QDataStream::Ok; i++) {
+        qint32 type;
+        QString name, color;
+        double start, stop;
+        bool test;
+        in >> type >> name >> start >> stop >> color >> test;
+        ride->addInterval(static_cast<RideFileInterval::IntervalType>(type), start, stop, name, QColor(color), test);
+    }
+
+    // calibrations
+    in >> count;
+    for (quint32 i=0; i<count && in.status() == QDataStream::Ok; i++) {
+        QString name;
+        double start;
+        qint32 value;
+        in >> name >> start >> value;
+        ride->addCalibration(start, value, name);
+    }
+
+    // references
+    in >> count;
+    for (quint32 i=0; i<count && in.status() == QDataStream::Ok; i++) {
+        RideFilePoint p;
+        in >> p.secs >> p.watts >> p.cad >> p.hr;
+        ride->appendReference(p);
+    }
+
+    // samples, column by column
+    quint32 samples, columns;
+    in >> samples >> columns;
+
+    // check the counts before allocating anything, the secs column takes
+    // at least a byte a sample and every column at least a type and size
+    qint64 remaining = in.device()->bytesAvailable();
+    if (in.status() != QDataStream::Ok || samples > remaining || columns > quint32(RideFile::none) || columns * 8 > remaining) {
+        errors << "Corrupt sample data.";
+        delete ride;
+        return NULL;
+    }
+    QVector<RideFile::SeriesType> series;
+    QVector<QVector<double> > values(columns);
+    for (quint32 c=0; c<columns && in.status() == QDataStream::Ok; c++) {
+        qint32 type;
+        QByteArray column;
+        in >> type >> column;
+        series << static_cast<RideFile::SeriesType>(type);
+        if (!decodeColumn(column, samples, values[c])) {
+            errors << "Corrupt sample data.";
+            break;
+        }
+    }
+    for (quint32 i=0; errors.isEmpty() && i<samples; i++) {
+        RideFilePoint p;
+        for (int c=0; c<series.count(); c++) p.setValue(series.at(c), values.at(c).at(i));
+        ride->appendPoint(p);
+    }
+
+    // xdata
+    in >> count;
+    for (quint32 i=0; errors.isEmpty() && i<count && in.status() == QDataStream::Ok; i++) {
+        XDataSeries *add = new XDataSeries();
+        quint32 points;
+        QByteArray secs, km;
+        in >> add->name >> add->valuename >> add->unitname >> points >> secs >> km;
+
+        // as for samples, at least a byte a point for secs unless constant
+        if (in.status() != QDataStream::Ok || secs.isEmpty() ||
+            (secs.at(0) != char(GCB_CONSTANT) && points > quint32(secs.size()))) {
+            errors << "Corrupt xdata.";
+            delete add;
+            break;
+        }
+
+        QVector<QVector<double> > xvalues(add->valuename.count() + 2);
+        bool ok = decodeColumn(secs, points, xvalues[0]) && decodeColumn(km, points, xvalues[1]);
+        for (int v=0; v<add->valuename.count(); v++) {
+            QByteArray column;
+            in >> column;
+            ok = ok && decodeColumn(column, points, xvalues[v+2]);
+        }
+        if (!ok) {
+            errors << "Corrupt xdata.";
+            delete add;
+            break;
+        }
+        for (quint32 p=0; p<points; p++) {
+            XDataPoint *point = new XDataPoint();
+            point->secs = xvalues[0][p];
+            point->km = xvalues[1][p];
+            for (int v=0; v<add->valuename.count() && v<XDATA_MAXVALUES; v++) point->number[v] = xvalues[v+2][p];
+            add->datapoints.append(point);
+        }
+        ride->addXData(add->name, add);
+    }
+
+    if (errors.isEmpty() && in.status() != QDataStream::Ok) errors << "File is truncated.";
+
+    if (errors.count()) {
+        delete ride;
+        return NULL;
+    }
+    return ride;
+}
+
+//
+// Writer
+//
+QByteArray
+GcbFileReader::toByteArray(const RideFile *ride) const
+{
+    QByteArray contents;
+    QDataStream out(&contents, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    out << GCB_MAGIC << GCB_VERSION;
+
+    // first class variables
+    out << qint64(ride->startTime().toMSecsSinceEpoch()) << ride->recIntSecs() << ride->deviceType() << ride->id();
+
+    // overrides and tags
+    out << ride->metricOverrides << ride->tags();
+
+    // intervals, calibrations and references
+    out << quint32(ride->intervals().count());
+    foreach(RideFileInterval *i, ride->intervals())
+        out << qint32(i->type) << i->name << i->start << i->stop << i->color.name() << i->test;
+
+    out << quint32(ride->calibrations().count());
+    foreach(RideFileCalibration *i, ride->calibrations())
+        out << i->name << i->start << qint32(i->value);
+
+    out << quint32(ride->referencePoints().count());
+    foreach(RideFilePoint *p, ride->referencePoints())
+        out << p->secs << p->watts << p->cad << p->hr;
+
+    // samples, by column
+    QVector<RideFile::SeriesType> series;
+    for (int s=0; gcbSeries[s].series != RideFile::none; s++)
+        if (s == 0 || ride->areDataPresent()->*gcbSeries[s].present) series << gcbSeries[s].series;
+
+    out << quint32(ride->dataPoints().count()) << quint32(series.count());
+    QVector<double> values(ride->dataPoints().count());
+    foreach(RideFile::SeriesType type, series) {
+        for (int i=0; i<ride->dataPoints().count(); i++) values[i] = ride->dataPoints().at(i)->value(type);
+        out << qint32(type) << encodeColumn(values);
+    }
+
+    // xdata, only series with value names (as .json)
+    QList<XDataSeries*> xdata;
+    foreach(XDataSeries *x, const_cast<RideFile*>(ride)->xdata())
+        if (!x->valuename.isEmpty()) xdata << x;
+
+    out << quint32(xdata.count());
+    foreach(XDataSeries *x, xdata) {
+        int n = x->datapoints.count();
+        QVector<double> secs(n), km(n);
+        for (int i=0; i<n; i++) {
+            secs[i] = x->datapoints.at(i)->secs;
+            km[i] = x->datapoints.at(i)->km;
+        }
+        out << x->name << x->valuename << x->unitname << quint32(n) << encodeColumn(secs) << encodeColumn(km);
+
+        for (int v=0; v<x->valuename.count(); v++) {
+            QVector<double> column(n);
+            for (int i=0; i<n; i++) column[i] = v < XDATA_MAXVALUES ? x->value(i, v) : 0;
+            out << encodeColumn(column);
+        }
+    }
+
+    return contents;
+}
+
+bool
+GcbFileReader::writeRideFile(Context *, const RideFile *ride, QFile &file) const
+{
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    QByteArray contents = toByteArray(ride);
+    bool ok = file.write(contents) == contents.size();
+    file.close();
+
+    return ok;
+}
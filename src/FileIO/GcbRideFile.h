@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2020 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GcbRideFile_h
+#define _GcbRideFile_h
+#include "GoldenCheetah.h"
+
+#include "RideFile.h"
+
+// GoldenCheetah Binary, a compact alternative to .json holding the same
+// content; first class variables, overrides, tags, intervals, calibrations,
+// references, samples and xdata. The samples are stored by column and each
+// column is compressed on its own (constant, scaled integer deltas or
+// xor'ed doubles) so open/save avoids all the text conversion.
+struct GcbFileReader : public RideFileReader {
+    virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const;
+    QByteArray toByteArray(const RideFile *ride) const;
+    bool writeRideFile(Context *, const RideFile *ride, QFile &file) const;
+    bool hasWrite() const { return true; }
+};
+
+#endif // _GcbRideFile_h
@@ -111,13 +111,15 @@ bool
     else if (qName == "time")
     {
 
-        time = convertToLocalTime(buffer);
+        // the start time is shown, the rest are only used for offsets
         if(firstTime)
         {
+            time = convertToLocalTime(buffer);
             start_time = time;
             rideFile->setStartTime(time);
             firstTime = false;
         }
+        else time = convertISO8601ToUTC(buffer);
     }
     else if (qName == "ele")
     {
@@ -21,6 +21,7 @@
 
 #include "GpxRideFile.h"
 #include "GpxParser.h"
+#include "XmlStreamParser.h"
 #include "GcUpgrade.h"
 #include <QDomDocument>
 
@@ -38,10 +39,7 @@ RideFile *GpxFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
 
     GpxParser handler(rideFile);
 
-    QXmlInputSource source (&file);
-    QXmlSimpleReader reader;
-    reader.setContentHandler (&handler);
-    reader.parse (source);
+    XmlStreamParser::parse(file, handler);
 
     return rideFile;
 }
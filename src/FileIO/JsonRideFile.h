@@ -38,6 +38,11 @@ struct JsonFileReader : public RideFileReader {
     QByteArray toByteArray(Context *context, const RideFile *ride, bool withAlt, bool withWatts, bool withHr, bool withCad) const;
     bool writeRideFile(Context *context, const RideFile *ride, QFile &file) const;
     bool hasWrite() const { return true; }
+    bool hasScan() const { return true; }
+    bool scanRideFile(QFile &file, RideFileSummary &summary, QStringList &errors) const;
+
+    // just the grammar, openRideFile() tries the streaming reader first
+    static RideFile *parseGrammar(const QByteArray &bytes, QStringList &errors);
 };
 
 #endif // _JsonRideFile_h
@@ -35,6 +35,7 @@
 // in writeRideFile below, this is NOT a generic json parser.
 
 #include "JsonRideFile.h"
+#include "JsonStreamReader.h"
 
 // now we have a reentrant parser we save context data
 // in a structure rather than in global variables -- so
@@ -395,39 +396,88 @@ static int jsonFileReaderRegistered =
     RideFileFactory::instance().registerReader(
         "json", "GoldenCheetah Json", new JsonFileReader());
 
-RideFile *
-JsonFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*) const
+// the tags and header, with the samples stepped over
+bool
+JsonFileReader::scanRideFile(QFile &file, RideFileSummary &summary, QStringList &errors) const
 {
-    // Read the entire file into a QString -- we avoid using fopen since it
-    // doesn't handle foreign characters well. Instead we use QFile and parse
-    // from a QString
-    QString contents;
-    if (file.exists() && file.open(QFile::ReadOnly | QFile::Text)) {
-
-        // read in the whole thing
-        QTextStream in(&file);
-        // GC .JSON is stored in UTF-8 with BOM(Byte order mark) for identification
-        in.setCodec ("UTF-8");
-        contents = in.readAll();
+    QByteArray bytes;
+    if (file.exists() && file.open(QFile::ReadOnly)) {
+        bytes = file.readAll();
         file.close();
+    } else {
 
-        // check if the text string contains the replacement character for UTF-8 encoding
-        // if yes, try to read with Latin1/ISO 8859-1 (assuming this is an "old" non-UTF-8 Json file)
-        if (contents.contains(QChar::ReplacementCharacter)) {
-           if (file.exists() && file.open(QFile::ReadOnly | QFile::Text)) {
-             QTextStream in(&file);
-             in.setCodec ("ISO 8859-1");
-             contents = in.readAll();
-             file.close();
-           }
-         }
+        errors << "unable to open file" + file.fileName();
+        return false;
+    }
+
+    // legacy files the streaming reader doesn't understand are left
+    // to the grammar, via a full open by the caller
+    RideFile *ride = new RideFile;
+    QString streamerror;
+    double lastSecs = 0;
+    bool scanned = JsonStreamReader(bytes).scan(ride, lastSecs, streamerror);
+
+    if (scanned) {
+        summary.startTime = ride->startTime();
+        summary.deviceType = ride->deviceType();
+        summary.tags = ride->tags();
+        summary.duration = ride->metricOverrides.value("workout_time").value("value", "0.0").toDouble();
+        if (!summary.duration && lastSecs > 0)
+            summary.duration = lastSecs + ride->recIntSecs();
+    }
+    delete ride;
 
+    return scanned;
+}
+
+RideFile *
+JsonFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*) const
+{
+    // Read the entire file, we avoid using fopen since it
+    // doesn't handle foreign characters well
+    QByteArray bytes;
+    if (file.exists() && file.open(QFile::ReadOnly)) {
+        bytes = file.readAll();
+        file.close();
     } else {
 
         errors << "unable to open file" + file.fileName();
         return NULL; 
     }
 
+    // try the streaming reader first, it works on the raw UTF-8
+    // and is much faster than the grammar below for large files
+    RideFile *ride = new RideFile;
+    QString streamerror;
+    if (JsonStreamReader(bytes).parse(ride, streamerror)) return ride;
+    delete ride;
+
+    // didn't understand it, so use the grammar
+    return parseGrammar(bytes, errors);
+}
+
+// the bison grammar, slower than the streaming reader but it also copes
+// with legacy Latin1 files. the two must agree, the bench checks they do
+RideFile *
+JsonFileReader::parseGrammar(const QByteArray &bytes, QStringList &errors)
+{
+    // parse from a QString
+    QString contents;
+    {
+        QTextStream in(bytes, QIODevice::ReadOnly | QIODevice::Text);
+        // GC .JSON is stored in UTF-8 with BOM(Byte order mark) for identification
+        in.setCodec ("UTF-8");
+        contents = in.readAll();
+    }
+
+    // check if the text string contains the replacement character for UTF-8 encoding
+    // if yes, try to read with Latin1/ISO 8859-1 (assuming this is an "old" non-UTF-8 Json file)
+    if (contents.contains(QChar::ReplacementCharacter)) {
+        QTextStream in(bytes, QIODevice::ReadOnly | QIODevice::Text);
+        in.setCodec ("ISO 8859-1");
+        contents = in.readAll();
+    }
+
     // create scanner context for reentrant parsing
     JsonContext *jc = new JsonContext;
     JsonRideFilelex_init(&scanner);
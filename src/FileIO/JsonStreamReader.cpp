@@ -0,0 +1,674 @@
+/*
+ * Copyright (c) 2020 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "JsonStreamReader.h"
+#include "JsonRideFile.h" // DATETIME_FORMAT and Utils::RidefileUnEscape
+#include <string.h>
+#include <limits.h>
+
+// compare a key with a literal
+#define IS(s) (len == int(sizeof(s))-1 && !memcmp(name, s, len))
+
+// the sample keys and the series they set, in the order they are written
+// so we can usually guess the next one (see point() below)
+static const struct {
+    const char *name;
+    int len;
+    RideFile::SeriesType series;
+} sampleKeys[] = {
+    { "SECS", 4, RideFile::secs },
+    { "KM", 2, RideFile::km },
+    { "WATTS", 5, RideFile::watts },
+    { "NM", 2, RideFile::nm },
+    { "CAD", 3, RideFile::cad },
+    { "KPH", 3, RideFile::kph },
+    { "HR", 2, RideFile::hr },
+    { "ALT", 3, RideFile::alt },
+    { "LAT", 3, RideFile::lat },
+    { "LON", 3, RideFile::lon },
+    { "HEADWIND", 8, RideFile::headwind },
+    { "SLOPE", 5, RideFile::slope },
+    { "TEMP", 4, RideFile::temp },
+    { "LRBALANCE", 9, RideFile::lrbalance },
+    { "LTE", 3, RideFile::lte },
+    { "RTE", 3, RideFile::rte },
+    { "LPS", 3, RideFile::lps },
+    { "RPS", 3, RideFile::rps },
+    { "LPCO", 4, RideFile::lpco },
+    { "RPCO", 4, RideFile::rpco },
+    { "LPPB", 4, RideFile::lppb },
+    { "RPPB", 4, RideFile::rppb },
+    { "LPPE", 4, RideFile::lppe },
+    { "RPPE", 4, RideFile::rppe },
+    { "LPPPB", 5, RideFile::lpppb },
+    { "RPPPB", 5, RideFile::rpppb },
+    { "LPPPE", 5, RideFile::lpppe },
+    { "RPPPE", 5, RideFile::rpppe },
+    { "SMO2", 4, RideFile::smo2 },
+    { "THB", 3, RideFile::thb },
+    { "RCAD", 4, RideFile::rcad },
+    { "RVERT", 5, RideFile::rvert },
+    { "RCON", 4, RideFile::rcontact },
+};
+static const int sampleKeyCount = sizeof(sampleKeys) / sizeof(sampleKeys[0]);
+
+// exactly representable powers of ten for the fast path
+static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+JsonStreamReader::JsonStreamReader(const QByteArray &data) : rideFile(NULL), summary(false), lastSecs(0)
+{
+    start = p = data.constData();
+    end = start + data.size();
+
+    // skip the UTF-8 byte order mark
+    if (end - p >= 3 && !memcmp(p, "\xEF\xBB\xBF", 3)) p += 3;
+}
+
+bool
+JsonStreamReader::parse(RideFile *into, QString &message)
+{
+    rideFile = into;
+
+    // we allow a .json file to be encapsulated within optional braces
+    // and multiple rides in a single file are joined
+    bool braces = next('{');
+    do {
+        const char *name;
+        int len;
+        if (!key(name, len)) break;
+        if (!IS("RIDE")) { fail("expected RIDE"); break; }
+        if (!ride()) break;
+    } while (next(','));
+
+    if (error.isEmpty() && braces) expect('}');
+    if (error.isEmpty()) {
+        whitespace();
+        if (p != end) fail("unexpected data after ride");
+    }
+
+    message = error;
+    return error.isEmpty();
+}
+
+bool
+JsonStreamReader::scan(RideFile *into, double &secs, QString &message)
+{
+    summary = true;
+    bool parsed = parse(into, message);
+    secs = lastSecs;
+    return parsed;
+}
+
+//
+// Primitives
+//
+void
+JsonStreamReader::whitespace()
+{
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r')) p++;
+}
+
+bool
+JsonStreamReader::fail(const char *message)
+{
+    if (error.isEmpty()) error = QString("%1 at byte %2").arg(message).arg(p - start);
+    return false;
+}
+
+bool
+JsonStreamReader::expect(char c)
+{
+    whitespace();
+    if (p < end && *p == c) {
+        p++;
+        return true;
+    }
+    return fail(QString("expected '%1'").arg(c).toLatin1().constData());
+}
+
+bool
+JsonStreamReader::next(char c)
+{
+    whitespace();
+    if (p < end && *p == c) {
+        p++;
+        return true;
+    }
+    return false;
+}
+
+bool
+JsonStreamReader::key(const char *&name, int &len)
+{
+    whitespace();
+    if (p >= end || *p != '"') return fail("expected key");
+    name = ++p;
+    while (p < end && *p != '"') {
+        if (*p == '\\') p++;
+        p++;
+    }
+    if (p >= end) return fail("unterminated key");
+    len = p++ - name;
+    return expect(':');
+}
+
+bool
+JsonStreamReader::string(QString &value)
+{
+    whitespace();
+    if (p >= end || *p != '"') return fail("expected string");
+
+    const char *begin = ++p;
+    bool escaped = false;
+    while (p < end && *p != '"') {
+        if (*p == '\\') {
+            escaped = true;
+            p++;
+        }
+        p++;
+    }
+    if (p >= end) return fail("unterminated string");
+
+    value = QString::fromUtf8(begin, p++ - begin);
+
+    // not UTF-8, leave it to the grammar which tries Latin1
+    if (value.contains(QChar::ReplacementCharacter)) return fail("not UTF-8");
+
+    // the writer adds a trailing space to avoid conflicting with tokens
+    if (value.endsWith(" ")) value.chop(1);
+    if (escaped) value = Utils::RidefileUnEscape(value.midRef(0));
+
+    return true;
+}
+
+bool
+JsonStreamReader::number(double &value, bool toint)
+{
+    whitespace();
+    const char *begin = p;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+    // accumulate up to 19 significant digits, beyond that we can't be exact
+    quint64 mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool exact = true, integer = true;
+
+    const char *first = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa) digits++;
+        } else {
+            exponent++;
+            exact = false;
+        }
+        p++;
+    }
+    if (p == first) return fail("expected number");
+
+    if (p < end && *p == '.') {
+        integer = false;
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa) digits++;
+                exponent--;
+            } else exact = false;
+            p++;
+        }
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        integer = false;
+        p++;
+        bool negexp = false;
+        if (p < end && (*p == '-' || *p == '+')) negexp = (*p++ == '-');
+        int e = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (e < 10000) e = e * 10 + (*p - '0');
+            p++;
+        }
+        exponent += negexp ? -e : e;
+    }
+
+    // integers are converted as QString::toInt, which is 0 on overflow
+    if (integer && toint) {
+        if (exact && mantissa <= quint64(INT_MAX) + (negative ? 1 : 0)) value = negative ? -double(mantissa) : double(mantissa);
+        else value = 0;
+        return true;
+    }
+
+    // fast path is exact when mantissa and power of ten are both exact doubles
+    if (exact && mantissa < (quint64(1) << 53) && exponent >= -22 && exponent <= 22) {
+        value = exponent < 0 ? double(mantissa) / powers[-exponent] : double(mantissa) * powers[exponent];
+        if (negative) value = -value;
+        return true;
+    }
+
+    // otherwise let Qt do it (locale independent, unlike strtod)
+    bool ok;
+    value = QByteArray::fromRawData(begin, p - begin).toDouble(&ok);
+    return ok ? true : fail("invalid number");
+}
+
+bool
+JsonStreamReader::skipValue()
+{
+    whitespace();
+    if (p >= end) return fail("expected value");
+
+    switch (*p) {
+    case '"':
+        {
+            QString ignored;
+            return string(ignored);
+        }
+
+    case '{':
+        p++;
+        if (next('}')) return true;
+        do {
+            const char *name;
+            int len;
+            if (!key(name, len) || !skipValue()) return false;
+        } while (next(','));
+        return expect('}');
+
+    case '[':
+        p++;
+        if (next(']')) return true;
+        do {
+            if (!skipValue()) return false;
+        } while (next(','));
+        return expect(']');
+
+    default:
+        if ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+') {
+            double ignored;
+            return number(ignored);
+        }
+
+        // true, false or null
+        const char *begin = p;
+        while (p < end && *p >= 'a' && *p <= 'z') p++;
+        return p > begin ? true : fail("unexpected character");
+    }
+}
+
+bool
+JsonStreamReader::stringList(QStringList &list)
+{
+    list.clear();
+    if (!expect('[')) return false;
+    if (next(']')) return true;
+    do {
+        QString value;
+        if (!string(value)) return false;
+        list << value;
+    } while (next(','));
+    return expect(']');
+}
+
+//
+// Ride elements
+//
+bool
+JsonStreamReader::ride()
+{
+    if (!expect('{')) return false;
+    if (next('}')) return true;
+
+    do {
+        const char *name;
+        int len;
+        if (!key(name, len)) return false;
+
+        bool ok;
+        QString value;
+        double recint;
+
+        // first class variables
+        if (IS("STARTTIME")) {
+            if ((ok = string(value))) {
+                QDateTime aslocal = QDateTime::fromString(value, DATETIME_FORMAT);
+                QDateTime asUTC = QDateTime(aslocal.date(), aslocal.time(), Qt::UTC);
+                rideFile->setStartTime(asUTC.toLocalTime());
+            }
+        } else if (IS("RECINTSECS")) {
+            if ((ok = this->number(recint))) rideFile->setRecIntSecs(recint);
+        } else if (IS("DEVICETYPE")) {
+            if ((ok = string(value))) rideFile->setDeviceType(value);
+        } else if (IS("IDENTIFIER")) {
+            if ((ok = string(value))) rideFile->setId(value);
+
+        // sections
+        } else if (IS("OVERRIDES")) ok = overrides();
+        else if (IS("TAGS")) ok = tags();
+        else if (IS("SAMPLES")) ok = summary ? skipSamples() : samples();
+        else if (summary) ok = skipValue(); // nothing else wanted
+        else if (IS("INTERVALS")) ok = intervals();
+        else if (IS("CALIBRATIONS")) ok = calibrations();
+        else if (IS("REFERENCES")) ok = references();
+        else if (IS("XDATA")) ok = xdata();
+        else ok = skipValue();
+
+        if (!ok) return false;
+
+    } while (next(','));
+
+    return expect('}');
+}
+
+bool
+JsonStreamReader::overrides()
+{
+    if (!expect('[')) return false;
+    if (next(']')) return true;
+
+    do {
+        if (!expect('{')) return false;
+        do {
+            // metric name, we renamed time riding to time moving ...
+            QString metric;
+            if (!string(metric) || !expect(':') || !expect('{')) return false;
+            if (metric == "Time Riding") metric = "Time Moving";
+
+            QMap<QString,QString> values;
+            if (!next('}')) {
+                do {
+                    QString key, value;
+                    if (!string(key) || !expect(':') || !string(value)) return false;
+                    values.insert(key, value);
+                } while (next(','));
+                if (!expect('}')) return false;
+            }
+            rideFile->metricOverrides.insert(metric, values);
+
+        } while (next(','));
+        if (!expect('}')) return false;
+
+    } while (next(','));
+
+    return expect(']');
+}
+
+bool
+JsonStreamReader::tags()
+{
+    if (!expect('{')) return false;
+    if (next('}')) return true;
+
+    do {
+        QString key, value;
+        if (!string(key) || !expect(':') || !string(value)) return false;
+
+        // we renamed time riding to time moving ...
+        if (key == "Time Riding") key = "Time Moving";
+        rideFile->setTag(key, value);
+
+    } while (next(','));
+
+    return expect('}');
+}
+
+bool
+JsonStreamReader::intervals()
+{
+    if (!expect('[')) return false;
+    if (next(']')) return true;
+
+    do {
+        RideFileInterval interval;
+        if (!expect('{')) return false;
+        if (!next('}')) {
+            do {
+                const char *name;
+                int len;
+                if (!key(name, len)) return false;
+
+                QString value;
+                bool ok;
+                if (IS("NAME")) ok = string(interval.name);
+                else if (IS("START")) ok = number(interval.start);
+                else if (IS("STOP")) ok = number(interval.stop);
+                else if (IS("COLOR")) { if ((ok = string(value))) interval.color.setNamedColor(value); }
+                else if (IS("PTEST")) { if ((ok = string(value))) interval.test = (value == "true"); }
+                else ok = skipValue();
+                if (!ok) return false;
+
+            } while (next(','));
+            if (!expect('}')) return false;
+        }
+        rideFile->addInterval(RideFileInterval::USER, interval.start, interval.stop, interval.name,
+                              interval.color, interval.test);
+
+    } while (next(','));
+
+    return expect(']');
+}
+
+bool
+JsonStreamReader::calibrations()
+{
+    if (!expect('[')) return false;
+    if (next(']')) return true;
+
+    do {
+        RideFileCalibration calibration;
+        if (!expect('{')) return false;
+        if (!next('}')) {
+            do {
+                const char *name;
+                int len;
+                if (!key(name, len)) return false;
+
+                double value;
+                bool ok;
+                if (IS("NAME")) ok = string(calibration.name);
+                else if (IS("START")) ok = number(calibration.start);
+                else if (IS("VALUE")) { if ((ok = number(value))) calibration.value = value; }
+                else ok = skipValue();
+                if (!ok) return false;
+
+            } while (next(','));
+            if (!expect('}')) return false;
+        }
+        rideFile->addCalibration(calibration.start, calibration.value, calibration.name);
+
+    } while (next(','));
+
+    return expect(']');
+}
+
+bool
+JsonStreamReader::references()
+{
+    if (!expect('[')) return false;
+    if (next(']')) return true;
+
+    do {
+        RideFilePoint add;
+        if (!point(add)) return false;
+        rideFile->appendReference(add);
+    } while (next(','));
+
+    return expect(']');
+}
+
+bool
+JsonStreamReader::samples()
+{
+    if (!expect('[')) return false;
+    if (next(']')) return true;
+
+    do {
+        RideFilePoint add;
+        if (!point(add)) return false;
+        rideFile->appendPoint(add);
+    } while (next(','));
+
+    return expect(']');
+}
+
+bool
+JsonStreamReader::skipSamples()
+{
+    const char *from = p;
+    if (!skipValue()) return false;
+
+    // the last SECS in the array is the last sample's
+    for (const char *q = p - 6; q >= from; q--) {
+        if (*q == '"' && !memcmp(q, "\"SECS\"", 6)) {
+            const char *resume = p;
+            p = q + 6;
+            bool ok = expect(':') && number(lastSecs);
+            p = resume;
+            return ok;
+        }
+    }
+    return true;
+}
+
+bool
+JsonStreamReader::point(RideFilePoint &add)
+{
+    if (!expect('{')) return false;
+    if (next('}')) return true;
+
+    // keys are nearly always in the same order, so try the one after the last first
+    int guess = 0;
+    do {
+        const char *name;
+        int len;
+        if (!key(name, len)) return false;
+
+        int found = -1;
+        for (int i=0; i<sampleKeyCount; i++) {
+            int k = (guess + i) % sampleKeyCount;
+            if (sampleKeys[k].len == len && !memcmp(sampleKeys[k].name, name, len)) {
+                found = k;
+                break;
+            }
+        }
+
+        if (found >= 0) {
+            double value;
+            if (!number(value)) return false;
+            add.setValue(sampleKeys[found].series, value);
+            guess = found + 1;
+        } else if (!skipValue()) return false; // for future compatibility
+
+    } while (next(','));
+
+    return expect('}');
+}
+
+bool
+JsonStreamReader::xdata()
+{
+    if (!expect('[')) return false;
+    if (next(']')) return true;
+
+    do {
+        if (!xdataSeries()) return false;
+    } while (next(','));
+
+    return expect(']');
+}
+
+bool
+JsonStreamReader::xdataSeries()
+{
+    if (!expect('{')) return false;
+
+    XDataSeries *add = new XDataSeries;
+    bool ok = true;
+    if (!next('}')) {
+        do {
+            const char *name;
+            int len;
+            if (!(ok = key(name, len))) break;
+
+            QString value;
+            if (IS("NAME")) ok = string(add->name);
+            else if (IS("VALUE")) { if ((ok = string(value))) add->valuename << value; }
+            else if (IS("UNIT")) { if ((ok = string(value))) add->unitname << value; }
+            else if (IS("VALUES")) ok = stringList(add->valuename);
+            else if (IS("UNITS")) ok = stringList(add->unitname);
+            else if (IS("SAMPLES")) {
+                if ((ok = expect('[')) && !next(']')) {
+                    do {
+                        ok = xdataSample(add);
+                    } while (ok && next(','));
+                    ok = ok && expect(']');
+                }
+            } else ok = skipValue();
+
+        } while (ok && next(','));
+        ok = ok && expect('}');
+    }
+
+    if (!ok) {
+        delete add;
+        return false;
+    }
+    rideFile->addXData(add->name, add);
+    return true;
+}
+
+bool
+JsonStreamReader::xdataSample(XDataSeries *series)
+{
+    if (!expect('{')) return false;
+
+    XDataPoint *add = new XDataPoint();
+    series->datapoints.append(add);
+    if (next('}')) return true;
+
+    do {
+        const char *name;
+        int len;
+        if (!key(name, len)) return false;
+
+        bool ok = true;
+        if (IS("SECS")) ok = number(add->secs);
+        else if (IS("KM")) ok = number(add->km);
+        else if (IS("VALUE")) ok = number(add->number[0], false);
+        else if (IS("VALUES")) {
+            if (!expect('[')) return false;
+            if (!next(']')) {
+                int i=0;
+                do {
+                    double value;
+                    if (!number(value, false)) return false;
+                    if (i < XDATA_MAXVALUES) add->number[i++] = value;
+                } while (next(','));
+                ok = expect(']');
+            }
+        } else ok = skipValue(); // ignored for future compatibility
+
+        if (!ok) return false;
+
+    } while (next(','));
+
+    return expect('}');
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2020 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _JsonStreamReader_h
+#define _JsonStreamReader_h
+#include "GoldenCheetah.h"
+
+#include "RideFile.h"
+#include <QByteArray>
+#include <QString>
+
+// A hand written reader for the GoldenCheetah .json ride format as
+// serialised by JsonFileReader::toByteArray. It works directly on the
+// UTF-8 bytes in a single pass, numbers are parsed straight from the
+// buffer into the sample and only string values are converted to QString.
+//
+// It accepts everything the bison grammar in JsonRideFile.y accepts, keys
+// may appear in any order and unknown keys are skipped. If parse() returns
+// false the caller should fall back to the grammar, which also handles the
+// legacy non UTF-8 files.
+class JsonStreamReader
+{
+    public:
+
+        JsonStreamReader(const QByteArray &data);
+
+        // parse into ride, returns false and sets error if not understood
+        bool parse(RideFile *into, QString &error);
+
+        // as parse() but only the header and tags are kept, the samples are
+        // stepped over noting the time of the last one, for a summary
+        bool scan(RideFile *into, double &lastSecs, QString &error);
+
+    private:
+
+        // primitives
+        void whitespace();
+        bool expect(char c);
+        bool next(char c); // consume c if its next
+        bool key(const char *&name, int &len); // "NAME" followed by ':'
+        bool string(QString &value);
+        bool number(double &value, bool toint=true); // integers as QString::toInt
+        bool skipValue();
+        bool fail(const char *message);
+
+        // elements
+        bool ride();
+        bool overrides();
+        bool tags();
+        bool intervals();
+        bool calibrations();
+        bool references();
+        bool samples();
+        bool skipSamples();
+        bool point(RideFilePoint &p);
+        bool xdata();
+        bool xdataSeries();
+        bool xdataSample(XDataSeries *series);
+        bool stringList(QStringList &list);
+
+        const char *start, *p, *end;
+        RideFile *rideFile;
+        QString error;
+
+        bool summary;      // scan()
+        double lastSecs;
+};
+
+#endif // _JsonStreamReader_h
@@ -20,6 +20,7 @@
 #include "Athlete.h"
 #include "Settings.h"
 #include <QDomDocument>
+#include <QXmlStreamWriter>
 #include <QVector>
 
 #include <QDebug>
@@ -31,29 +32,57 @@ static int pwxFileReaderRegistered =
 RideFile *
 PwxFileReader::openRideFile(QFile &file, QStringList &errors, QList<RideFile*>*) const
 {
-    QDomDocument doc("TrainingPeaks PWX");
     if (!file.open(QIODevice::ReadOnly)) {
         errors << "Could not open file.";
         return NULL;
     }
 
-    bool parsed = doc.setContent(&file);
+    QXmlStreamReader xml(&file);
+    RideFile *rideFile = PwxFromStream(xml, errors);
     file.close();
-    if (!parsed) {
-        errors << "Could not parse file.";
-        return NULL;
-    }
 
-    return PwxFromDomDoc(doc, errors);
+    return rideFile;
 }
 
+// the elements other than samples are small, so they are read into a
+// detached element and picked apart just as they were from the document
+static QDomElement
+readDomElement(QXmlStreamReader &xml, QDomDocument &doc)
+{
+    QDomElement element = doc.createElement(xml.qualifiedName().toString());
+    foreach(const QXmlStreamAttribute &attribute, xml.attributes())
+        element.setAttribute(attribute.qualifiedName().toString(), attribute.value().toString());
+
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (xml.isStartElement()) element.appendChild(readDomElement(xml, doc));
+        else if (xml.isCharacters()) element.appendChild(doc.createTextNode(xml.text().toString()));
+        else if (xml.isEndElement()) break;
+    }
+    return element;
+}
+
+//
+// The file is read as a stream, samples are decoded straight into the ride
+// rather than building a document for the whole file first (which was many
+// times the size of the file for long rides)
+//
 RideFile *
-PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
+PwxFileReader::PwxFromStream(QXmlStreamReader &xml, QStringList &errors) const
 {
+    // the root element and then the workout within it
+    if (!xml.readNextStartElement()) {
+        errors << "Could not parse file.";
+        return NULL;
+    }
+    bool workout = false;
+    while (!workout && xml.readNextStartElement()) {
+        if (xml.qualifiedName() == "workout") workout = true;
+        else xml.skipCurrentElement();
+    }
+
     RideFile *rideFile = new RideFile();
-    QDomElement root = doc.documentElement();
-    QDomNode workout = root.firstChildElement("workout");
-    QDomNode node = workout.firstChild();
+    QDomDocument scratch;
 
     // get the Smart Recording parameters
     QVariant isGarminSmartRecording = appsettings->value(NULL, GC_GARMIN_SMARTRECORD,Qt::Checked);
@@ -90,10 +119,14 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
     swimXdata->valuename << "DURATION";
     swimXdata->valuename << "STROKES";
 
-    while (!node.isNull()) {
+    while (workout && xml.readNextStartElement()) {
+
+        QString element = xml.qualifiedName().toString();
+        QDomElement node;
+        if (element != "sample") node = readDomElement(xml, scratch);
 
         // athlete
-        if (node.nodeName() == "athlete") {
+        if (element == "athlete") {
 
             QDomElement name = node.firstChildElement("name");
             if (!name.isNull()) {
@@ -106,38 +139,38 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
             }
 
         // workout code
-        } else if (node.nodeName() == "code") {
+        } else if (element == "code") {
 
             QDomElement code = node.toElement();
             rideFile->setTag("Workout Code", code.text());
 
         // workout title
-        } else if (node.nodeName() == "title") {
+        } else if (element == "title") {
 
             QDomElement title = node.toElement();
             rideFile->setTag("Workout Title", title.text());
 
         // goal / objective
-        } else if (node.nodeName() == "goal") {
+        } else if (element == "goal") {
 
             QDomElement goal = node.toElement();
             rideFile->setTag("Objective", goal.text());
 
         // sport
-        } else if (node.nodeName() == "sportType") {
+        } else if (element == "sportType") {
 
             QDomElement sport = node.toElement();
             rideFile->setTag("Sport", sport.text());
 
         // notes
-        } else if (node.nodeName() == "cmt") {
+        } else if (element == "cmt") {
 
             // Add the PWX cmt tag as notes
             QDomElement notes = node.toElement();
             rideFile->setTag("Notes", notes.text());
 
         // device type and info
-        } else if (node.nodeName() == "device") {
+        } else if (element == "device") {
 
             QString devicetype;
             // make and model
@@ -167,13 +200,13 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
             rideFile->setTag("Device Info", deviceinfo);
 
         // start date/time
-        } else if (node.nodeName() == "time") {
+        } else if (element == "time") {
             QDomElement date = node.toElement();
             rideDate = QDateTime::fromString(date.text(), Qt::ISODate);
             rideFile->setStartTime(rideDate);
 
         // interval data
-        } else if (node.nodeName() == "segment") {
+        } else if (element == "segment") {
             RideFileInterval add;
 
             // name
@@ -203,85 +236,66 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
             }
 
         // data points: offset, hr, spd, pwr, torq, cad, dist, lat, lon, alt, temp
-        } else if (node.nodeName() == "sample") {
+        } else if (element == "sample") {
             RideFilePoint add;
 
-            // offset (secs)
-            QDomElement off = node.firstChildElement("timeoffset");
-            if (!off.isNull()) add.secs = round(off.text().toDouble());
-            else add.secs = 0.0;
-            // hr
-            QDomElement hr = node.firstChildElement("hr");
-            if (!hr.isNull()) add.hr = hr.text().toDouble();
-            else add.hr = 0.0;
-            // spd in meters per second converted to kph
-            QDomElement spd = node.firstChildElement("spd");
-            if (!spd.isNull()) add.kph = spd.text().toDouble() * 3.6;
-            else add.kph = 0.0;
-            // pwr
-            QDomElement pwr = node.firstChildElement("pwr");
-            if (!pwr.isNull()) {
-                add.watts = pwr.text().toDouble();
-                // NOTE! undo the fudge to set zero values to
-                //       1 in the writer (below). This is to keep
-                //       the TP upload web-service happy with zero values
-                if (add.watts == 1) add.watts = 0.0;
-            } else add.watts = 0.0;
+            // defaults for those that are missing
+            add.secs = 0.0;
+            add.hr = 0.0;
+            add.kph = 0.0;
+            add.watts = 0.0;
+            add.nm = 0.0;
+            add.cad = 0.0;
+            add.km = 0.0;
+            add.lat = 0.0;
+            add.lon = 0.0;
+            add.alt = 0.0;
+            add.temp = RideFile::NA;
+            add.lte = 0.0;
+            add.rte = 0.0;
+            add.lps = 0.0;
+            add.rps = 0.0;
+            bool haslrbalance = false;
+            double pwrright = 0.0;
+
+            // data points: offset, hr, spd, pwr, torq, cad, dist, lat, lon, alt, temp
+            while (xml.readNextStartElement()) {
+
+                QString field = xml.qualifiedName().toString();
+                double value = xml.readElementText(QXmlStreamReader::SkipChildElements).toDouble();
+
+                if (field == "timeoffset") add.secs = round(value); // offset (secs)
+                else if (field == "hr") add.hr = value;
+                else if (field == "spd") add.kph = value * 3.6; // meters per second converted to kph
+                else if (field == "pwr") {
+                    add.watts = value;
+                    // NOTE! undo the fudge to set zero values to
+                    //       1 in the writer (below). This is to keep
+                    //       the TP upload web-service happy with zero values
+                    if (add.watts == 1) add.watts = 0.0;
+                }
+                else if (field == "pwrright") { haslrbalance = true; pwrright = value; }
+                else if (field == "torq") add.nm = value;
+                else if (field == "cad") add.cad = value;
+                else if (field == "dist") add.km = value / 1000;
+                else if (field == "lat") add.lat = value;
+                else if (field == "lon") add.lon = value;
+                else if (field == "alt") add.alt = value;
+                else if (field == "temp") add.temp = value;
+                else if (field == "torque_effectiveness_left") add.lte = value;
+                else if (field == "torque_effectiveness_right") add.rte = value;
+                else if (field == "pedal_smoothness_left") add.lps = value;
+                else if (field == "pedal_smoothness_right") add.rps = value;
+            }
+
             // lrbalance (pwrright)
-            QDomElement lrbalance = node.firstChildElement("pwrright");
-            if (!lrbalance.isNull()) {
+            if (haslrbalance) {
                 if (add.watts == 0) {
                    add.lrbalance = 50.0;
                 } else {
-                    add.lrbalance =(add.watts-lrbalance.text().toDouble())/add.watts*100.0;
+                    add.lrbalance =(add.watts-pwrright)/add.watts*100.0;
                 }
             } else add.lrbalance = RideFile::NA;
-            // torq
-            QDomElement torq = node.firstChildElement("torq");
-            if (!torq.isNull()) add.nm = torq.text().toDouble();
-            else add.nm = 0.0;
-            // cad
-            QDomElement cad = node.firstChildElement("cad");
-            if (!cad.isNull()) add.cad = cad.text().toDouble();
-            else add.cad = 0.0;
-            // dist
-            QDomElement dist = node.firstChildElement("dist");
-            if (!dist.isNull()) add.km = dist.text().toDouble() /1000;
-            else add.km = 0.0;
-
-            // lat
-            QDomElement lat = node.firstChildElement("lat");
-            if (!lat.isNull()) add.lat = lat.text().toDouble();
-            else add.lat = 0.0;
-            // lon
-            QDomElement lon = node.firstChildElement("lon");
-            if (!lon.isNull()) add.lon = lon.text().toDouble();
-            else add.lon = 0.0;
-            // alt
-            QDomElement alt = node.firstChildElement("alt");
-            if (!alt.isNull()) add.alt = alt.text().toDouble();
-            else add.alt = 0.0;
-            // temp
-            QDomElement temp = node.firstChildElement("temp");
-            if (!temp.isNull()) add.temp = temp.text().toDouble();
-            else add.temp = RideFile::NA;
-
-            // torque_effectiveness_left
-            QDomElement lte = node.firstChildElement("torque_effectiveness_left");
-            if (!lte.isNull()) add.lte = lte.text().toDouble();
-            else add.lte = 0.0;
-            // torque_effectiveness_right
-            QDomElement rte = node.firstChildElement("torque_effectiveness_right");
-            if (!rte.isNull()) add.rte = rte.text().toDouble();
-            else add.rte = 0.0;
-            // pedal_smoothness_left
-            QDomElement lps = node.firstChildElement("pedal_smoothness_left");
-            if (!lps.isNull()) add.lps = lps.text().toDouble();
-            else add.lps = 0.0;
-            // pedal_smoothness_right
-            QDomElement rps = node.firstChildElement("pedal_smoothness_right");
-            if (!rps.isNull()) add.rps = rps.text().toDouble();
-            else add.rps = 0.0;
 
             // if there are data points && a time difference > 1sec && smartRecording processing is requested at all
             if ((!rideFile->dataPoints().empty()) && (add.secs > rtime + 1) && (isGarminSmartRecording.toInt() != 0)) {
@@ -425,7 +439,7 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
                     add.interval);
             }
         
-        } else if (node.nodeName() == "summarydata") {
+        } else if (element == "summarydata") {
 
             // get the summary data in case there are no samples
             // this is when there is a manual entry, so we can
@@ -475,10 +489,17 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
             if (!off.isNull()) manualElevation = off.text().toDouble();
 
 
-        } else if (node.nodeName() == "extension") {
+        } else if (element == "extension") {
         }
+    }
 
-        node = node.nextSibling();
+    // the rest of the file needs to be well formed too
+    while (!xml.atEnd()) xml.readNext();
+    if (xml.hasError()) {
+        errors << "Could not parse file.";
+        delete swimXdata;
+        delete rideFile;
+        return NULL;
     }
 
     // post-process and check
@@ -600,63 +621,49 @@ PwxFileReader::PwxFromDomDoc(QDomDocument doc, QStringList&) const
 bool
 PwxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file) const
 {
-    QDomText text; // used all over
-    QDomDocument doc;
-    QDomProcessingInstruction hdr = doc.createProcessingInstruction("xml","version=\"1.0\"");
-    doc.appendChild(hdr);
+    // streamed out as we go rather than built as a DOM first, rides with
+    // many hours of samples made for very large documents
+    if (!file.open(QIODevice::WriteOnly)) return(false);
+    file.resize(0);
+    file.write("\xEF\xBB\xBF"); // utf-8 byte order mark
+
+    QXmlStreamWriter xml(&file);
+    xml.setCodec("UTF-8");
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(4);
+    xml.writeStartDocument();
 
     // pwx
-    QDomElement pwx = doc.createElementNS("http://www.peaksware.com/PWX/1/0", "pwx");
-    pwx.setAttribute("creator", "Golden Cheetah");
-    pwx.setAttribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance");
-    pwx.setAttribute("xmlns:xsd", "http://www.w3.org/2001/XMLSchema");
-    pwx.setAttribute("xsi:schemaLocation", "http://www.peaksware.com/PWX/1/0 http://www.peaksware.com/PWX/1/0/pwx.xsd");
-    pwx.setAttribute("version", "1.0");
-    doc.appendChild(pwx);
+    xml.writeStartElement("pwx");
+    xml.writeAttribute("xmlns", "http://www.peaksware.com/PWX/1/0");
+    xml.writeAttribute("creator", "Golden Cheetah");
+    xml.writeAttribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance");
+    xml.writeAttribute("xmlns:xsd", "http://www.w3.org/2001/XMLSchema");
+    xml.writeAttribute("xsi:schemaLocation", "http://www.peaksware.com/PWX/1/0 http://www.peaksware.com/PWX/1/0/pwx.xsd");
+    xml.writeAttribute("version", "1.0");
 
     // workouts... we just serialise 1 at a time
-    QDomElement root = doc.createElement("workout");
-    pwx.appendChild(root);
+    xml.writeStartElement("workout");
 
     // athlete details
-    QDomElement athlete = doc.createElement("athlete");
-    QDomElement name = doc.createElement("name");
-    text = doc.createTextNode(context ? context->athlete->cyclist : "athlete"); name.appendChild(text);
-    athlete.appendChild(name);
+    xml.writeStartElement("athlete");
+    xml.writeTextElement("name", context ? context->athlete->cyclist : "athlete");
     double cyclistweight = ride->getTag("Weight", "0.0").toDouble();
-    if (cyclistweight) {
-        QDomElement weight = doc.createElement("weight");
-        text = doc.createTextNode(QString("%1").arg(cyclistweight));
-        weight.appendChild(text);
-        athlete.appendChild(weight);
-    }
-    root.appendChild(athlete);
+    if (cyclistweight) xml.writeTextElement("weight", QString("%1").arg(cyclistweight));
+    xml.writeEndElement(); // athlete
 
     // sport
     QString sport = ride->getTag("Sport", "Bike");
     if (sport == QObject::tr("Biking") || sport == QObject::tr("Cycling") || sport == QObject::tr("Cycle") || sport == QObject::tr("Bike")) {
         sport = "Bike";
     }
-    QDomElement sportType = doc.createElement("sportType");
-    text = doc.createTextNode(sport); 
-    sportType.appendChild(text);
-    root.appendChild(sportType);
+    xml.writeTextElement("sportType", sport);
 
     // notes
-    if (ride->getTag("Notes","") != "") {
-        QDomElement notes = doc.createElement("cmt");
-        text = doc.createTextNode(ride->getTag("Notes","")); notes.appendChild(text);
-        root.appendChild(notes);
-    }
-    
-    
+    if (ride->getTag("Notes","") != "") xml.writeTextElement("cmt", ride->getTag("Notes",""));
+
     // workout code
-    if (ride->getTag("Workout Code", "") != "") {
-        QString wcode = ride->getTag("Workout Code", "");
-        QDomElement code = doc.createElement("code");
-        text = doc.createTextNode(wcode); code.appendChild(text);
-        root.appendChild(code);
-    }
+    if (ride->getTag("Workout Code", "") != "") xml.writeTextElement("code", ride->getTag("Workout Code", ""));
 
     // workout title
     QString wtitle;
@@ -690,145 +697,75 @@ PwxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file
         }
     }
     // did we set it to /anything/ ?
-    if (wtitle != "") {
-        QDomElement title = doc.createElement("title");
-        text = doc.createTextNode(wtitle); title.appendChild(text);
-        root.appendChild(title);
-    }
+    if (wtitle != "") xml.writeTextElement("title", wtitle);
 
     // goal
-    if (ride->getTag("Objective", "") != "") {
-        QString obj = ride->getTag("Objective", "");
-        QDomElement goal = doc.createElement("goal");
-        text = doc.createTextNode(obj); goal.appendChild(text);
-        root.appendChild(goal);
+    if (ride->getTag("Objective", "") != "") xml.writeTextElement("goal", ride->getTag("Objective", ""));
+
+    // device type
+    if (ride->deviceType() != "") {
+        xml.writeStartElement("device");
+        xml.writeAttribute("id", ride->deviceType());
+        xml.writeTextElement("make", "Golden Cheetah");
+        xml.writeTextElement("model", ride->deviceType());
+        xml.writeEndElement(); // device
     }
 
-    // device type 
-    if (ride->deviceType() != "") { 
-
-        QDomElement device = doc.createElement("device"); 
-        device.setAttribute("id", ride->deviceType());
-
-        QDomElement make = doc.createElement("make"); 
-        text = doc.createTextNode("Golden Cheetah"); 
-        make.appendChild(text); 
-        device.appendChild(make);
-
-        QDomElement model = doc.createElement("model"); 
-        text = doc.createTextNode(ride->deviceType());
-        model.appendChild(text); 
-        device.appendChild(model);
-
-        root.appendChild(device); 
-    }
-    
     // time
-    QDomElement time = doc.createElement("time");
-    text = doc.createTextNode(ride->startTime().toUTC().toString(Qt::ISODate));
-    time.appendChild(text);
-    root.appendChild(time);
+    xml.writeTextElement("time", ride->startTime().toUTC().toString(Qt::ISODate));
 
     // summary data
-    QDomElement summarydata = doc.createElement("summarydata");
-    root.appendChild(summarydata);
-    QDomElement beginning = doc.createElement("beginning");
-    text = doc.createTextNode(QString("%1").arg(ride->dataPoints().empty()
+    const RideFileDataPresent *present = ride->areDataPresent();
+    xml.writeStartElement("summarydata");
+    xml.writeTextElement("beginning", QString("%1").arg(ride->dataPoints().empty()
         ? 0 : ride->dataPoints().first()->secs));
-    beginning.appendChild(text);
-    summarydata.appendChild(beginning);
-
-    QDomElement duration = doc.createElement("duration");
-    text = doc.createTextNode(QString("%1").arg(ride->dataPoints().empty()
+    xml.writeTextElement("duration", QString("%1").arg(ride->dataPoints().empty()
         ? 0 : ride->dataPoints().last()->secs));
-    duration.appendChild(text);
-    summarydata.appendChild(duration);
 
     // the channels - min max avg get set by TP anyway
     // so we leave them blank to save time on calculating them
-    if (ride->areDataPresent()->hr) {
-        QDomElement s = doc.createElement("hr");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
+    struct { bool present; const char *name; } channels[] = {
+        { present->hr, "hr" }, { present->kph, "spd" }, { present->watts, "pwr" },
+        { present->nm, "torq" }, { present->cad, "cad" }
+    };
+    for (unsigned int i=0; i<sizeof(channels)/sizeof(channels[0]); i++) {
+        if (!channels[i].present) continue;
+        xml.writeStartElement(channels[i].name);
+        xml.writeAttribute("max", "0");
+        xml.writeAttribute("min", "0");
+        xml.writeAttribute("avg", "0");
+        xml.writeEndElement();
     }
-    if (ride->areDataPresent()->kph) {
-        QDomElement s = doc.createElement("spd");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
-    }
-    if (ride->areDataPresent()->watts) {
-        QDomElement s = doc.createElement("pwr");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
-    }
-    if (ride->areDataPresent()->nm) {
-        QDomElement s = doc.createElement("torq");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
-    }
-    if (ride->areDataPresent()->cad) {
-        QDomElement s = doc.createElement("cad");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
-    }
-    QDomElement dist = doc.createElement("dist");
-    text = doc.createTextNode(QString("%1")
+    xml.writeTextElement("dist", QString("%1")
         .arg((int)(ride->dataPoints().empty() ? 0
             : ride->dataPoints().last()->km * 1000)));
-    dist.appendChild(text);
-    summarydata.appendChild(dist);
-
-    if (ride->areDataPresent()->alt) {
-        QDomElement s = doc.createElement("alt");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
+
+    if (present->alt) {
+        xml.writeStartElement("alt");
+        xml.writeAttribute("max", "0");
+        xml.writeAttribute("min", "0");
+        xml.writeAttribute("avg", "0");
+        xml.writeEndElement();
     }
 
-    if (ride->areDataPresent()->temp) {
-        QDomElement s = doc.createElement("temp");
-        s.setAttribute("max", "0");
-        s.setAttribute("min", "0");
-        s.setAttribute("avg", "0");
-        summarydata.appendChild(s);
-    }  
+    if (present->temp) {
+        xml.writeStartElement("temp");
+        xml.writeAttribute("max", "0");
+        xml.writeAttribute("min", "0");
+        xml.writeAttribute("avg", "0");
+        xml.writeEndElement();
+    }
+    xml.writeEndElement(); // summarydata
 
     // interval "segments"
     foreach (RideFileInterval *i, ride->intervals()) {
-        QDomElement segment = doc.createElement("segment");
-        root.appendChild(segment);
-
-        // name
-        QDomElement name = doc.createElement("name");
-        text = doc.createTextNode(i->name); name.appendChild(text);
-        segment.appendChild(name);
-
-        // summarydata
-        QDomElement summarydata = doc.createElement("summarydata");
-        segment.appendChild(summarydata);
-
-        // beginning
-        QDomElement beginning = doc.createElement("beginning");
-        text = doc.createTextNode(QString("%1").arg(i->start));
-        beginning.appendChild(text);
-        summarydata.appendChild(beginning);
-
-        // duration
-        QDomElement duration = doc.createElement("duration");
-        text = doc.createTextNode(QString("%1").arg(i->stop - i->start));
-        duration.appendChild(text);
-        summarydata.appendChild(duration);
+        xml.writeStartElement("segment");
+        xml.writeTextElement("name", i->name);
+        xml.writeStartElement("summarydata");
+        xml.writeTextElement("beginning", QString("%1").arg(i->start));
+        xml.writeTextElement("duration", QString("%1").arg(i->stop - i->start));
+        xml.writeEndElement(); // summarydata
+        xml.writeEndElement(); // segment
     }
 
     // samples
@@ -839,156 +776,83 @@ PwxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file
         foreach (const RideFilePoint *point, ride->dataPoints()) {
             // if there was a gap, log time when this sample started:
             if( secs + ride->recIntSecs() < point->secs ){
-                QDomElement sample = doc.createElement("sample");
-                root.appendChild(sample);
-
-                QDomElement timeoffset = doc.createElement("timeoffset");
-                text = doc.createTextNode(QString("%1")
+                xml.writeStartElement("sample");
+                xml.writeTextElement("timeoffset", QString("%1")
                     .arg(point->secs - ride->recIntSecs() ));
-                timeoffset.appendChild(text);
-                sample.appendChild(timeoffset);
+                xml.writeEndElement();
             }
 
-            QDomElement sample = doc.createElement("sample");
-            root.appendChild(sample);
+            xml.writeStartElement("sample");
 
             // time
-            QDomElement timeoffset = doc.createElement("timeoffset");
-            text = doc.createTextNode(QString("%1").arg(point->secs));
-            timeoffset.appendChild(text);
-            sample.appendChild(timeoffset);
+            xml.writeTextElement("timeoffset", QString("%1").arg(point->secs));
 
             // hr
-            if (ride->areDataPresent()->hr) {
-                QDomElement hr = doc.createElement("hr");
-                text = doc.createTextNode(QString("%1").arg((int)point->hr));
-                hr.appendChild(text);
-                sample.appendChild(hr);
-            }
+            if (present->hr) xml.writeTextElement("hr", QString("%1").arg((int)point->hr));
+
             // spd - meters per second
-            if (ride->areDataPresent()->kph) {
-                QDomElement spd = doc.createElement("spd");
-                text = doc.createTextNode(QString("%1").arg(point->kph / 3.6));
-                spd.appendChild(text);
-                sample.appendChild(spd);
-            }
+            if (present->kph) xml.writeTextElement("spd", QString("%1").arg(point->kph / 3.6));
+
             // pwr
-            if (ride->areDataPresent()->watts) {
+            if (present->watts) {
                 // TrainingPeaks.com file upload rejects rides
                 // with excessive power of zero for some reason
                 // looks like they expect some smoothing or something?
                 // we set 0 to 1 to at least get an upload
                 // and do the reverse in the reader above
                 int watts = point->watts ? point->watts : 1;
-                QDomElement pwr = doc.createElement("pwr");
-                text = doc.createTextNode(QString("%1").arg(watts));
-                pwr.appendChild(text);
-                sample.appendChild(pwr);
+                xml.writeTextElement("pwr", QString("%1").arg(watts));
             }
             // lrbalance
-            if (ride->areDataPresent()->lrbalance) {
+            if (present->lrbalance) {
                 int rwatts = point->watts ? (point->watts - (point->watts * (point->lrbalance/100))) : 0;
-                QDomElement lrbalance = doc.createElement("pwrright");
-                text = doc.createTextNode(QString("%1").arg(rwatts));
-                lrbalance.appendChild(text);
-                sample.appendChild(lrbalance);
+                xml.writeTextElement("pwrright", QString("%1").arg(rwatts));
             }
             // torq
-            if (ride->areDataPresent()->nm) {
-                QDomElement torq = doc.createElement("torq");
-                text = doc.createTextNode(QString("%1").arg(point->nm));
-                torq.appendChild(text);
-                sample.appendChild(torq);
-            }
+            if (present->nm) xml.writeTextElement("torq", QString("%1").arg(point->nm));
+
             // cad
-            if (ride->areDataPresent()->cad) {
-                QDomElement cad = doc.createElement("cad");
-                text = doc.createTextNode(QString("%1").arg((int)(point->cad)));
-                cad.appendChild(text);
-                sample.appendChild(cad);
-            }
+            if (present->cad) xml.writeTextElement("cad", QString("%1").arg((int)(point->cad)));
 
             // distance - meters
-            QDomElement dist = doc.createElement("dist");
-            text = doc.createTextNode(QString("%1").arg((point->km*1000)));
-            dist.appendChild(text);
-            sample.appendChild(dist);
-
+            xml.writeTextElement("dist", QString("%1").arg((point->km*1000)));
 
             // lat/lon only if both non-zero and valid.
             if (point->lat && point->lon) {
 
                 // lon
-                if (ride->areDataPresent()->lat && point->lat > -90.0 && point->lat < 90.0) {
-                    QDomElement lat = doc.createElement("lat");
-                    text = doc.createTextNode(QString("%1").arg(point->lat, 0, 'g', 11));
-                    lat.appendChild(text);
-                    sample.appendChild(lat);
-                }
+                if (present->lat && point->lat > -90.0 && point->lat < 90.0)
+                    xml.writeTextElement("lat", QString("%1").arg(point->lat, 0, 'g', 11));
+
                 // lon
-                if (ride->areDataPresent()->lon && point->lon > -180.00 && point->lon < 180.00) {
-                    QDomElement lon = doc.createElement("lon");
-                    text = doc.createTextNode(QString("%1").arg(point->lon, 0, 'g', 11));
-                    lon.appendChild(text);
-                    sample.appendChild(lon);
-                }
+                if (present->lon && point->lon > -180.00 && point->lon < 180.00)
+                    xml.writeTextElement("lon", QString("%1").arg(point->lon, 0, 'g', 11));
             }
 
             // alt
-            if (ride->areDataPresent()->alt) {
-                QDomElement alt = doc.createElement("alt");
-                text = doc.createTextNode(QString("%1").arg(point->alt));
-                alt.appendChild(text);
-                sample.appendChild(alt);
-            }
+            if (present->alt) xml.writeTextElement("alt", QString("%1").arg(point->alt));
 
             // temp
-            if (ride->areDataPresent()->temp) {
-                QDomElement temp = doc.createElement("temp");
-                text = doc.createTextNode(QString("%1").arg(point->temp));
-                temp.appendChild(text);
-                sample.appendChild(temp);
-            }
+            if (present->temp) xml.writeTextElement("temp", QString("%1").arg(point->temp));
 
             // torque_effectiveness_left
-            if (ride->areDataPresent()->lte) {
-                QDomElement lte = doc.createElement("torque_effectiveness_left");
-                text = doc.createTextNode(QString("%1").arg(point->lte));
-                lte.appendChild(text);
-                sample.appendChild(lte);
-            }
+            if (present->lte) xml.writeTextElement("torque_effectiveness_left", QString("%1").arg(point->lte));
+
             // torque_effectiveness_right
-            if (ride->areDataPresent()->rte) {
-                QDomElement rte = doc.createElement("torque_effectiveness_right");
-                text = doc.createTextNode(QString("%1").arg(point->rte));
-                rte.appendChild(text);
-                sample.appendChild(rte);
-            }
+            if (present->rte) xml.writeTextElement("torque_effectiveness_right", QString("%1").arg(point->rte));
+
             // pedal_smoothness_left
-            if (ride->areDataPresent()->lps) {
-                QDomElement lps = doc.createElement("pedal_smoothness_left");
-                text = doc.createTextNode(QString("%1").arg(point->lps));
-                lps.appendChild(text);
-                sample.appendChild(lps);
-            }
+            if (present->lps) xml.writeTextElement("pedal_smoothness_left", QString("%1").arg(point->lps));
+
             // pedal_smoothness_right
-            if (ride->areDataPresent()->rps) {
-                QDomElement rps = doc.createElement("pedal_smoothness_right");
-                text = doc.createTextNode(QString("%1").arg(point->rps));
-                rps.appendChild(text);
-                sample.appendChild(rps);
-            }
+            if (present->rps) xml.writeTextElement("pedal_smoothness_right", QString("%1").arg(point->rps));
+
+            xml.writeEndElement(); // sample
         }
     }
 
-    QByteArray xml = doc.toByteArray(4);
-    if (!file.open(QIODevice::WriteOnly)) return(false);
-    file.resize(0);
-    QTextStream out(&file);
-    out.setCodec("UTF-8");
-    out.setGenerateByteOrderMark(true);
-    out << xml;
-    out.flush();
+    xml.writeEndDocument(); // closes workout and pwx
+    bool success = !xml.hasError();
     file.close();
-    return(true);
+    return(success);
 }
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideExporter.h"
+
+#include "Context.h"
+#include "RideFile.h"
+#include "CsvRideFile.h"
+#include "Trace.h"
+
+#include <QRunnable>
+#include <QFileInfo>
+
+class RideExportRunner : public QRunnable
+{
+    public:
+        RideExportRunner(RideExporter *exporter, int index) : exporter(exporter), index(index) {}
+        void run() { exporter->run(index); }
+
+    private:
+        RideExporter *exporter;
+        int index;
+};
+
+RideExporter::RideExporter(Context *context, QObject *parent) : QObject(parent), context(context), work(NULL), cancelled(0), remaining(0)
+{
+}
+
+RideExporter::~RideExporter()
+{
+    // runners use us, so wait for them
+    cancel();
+    pool.waitForDone();
+}
+
+int
+RideExporter::add(QString source, QString target, QString type)
+{
+    Job job;
+    job.source = source;
+    job.target = target;
+    job.type = type;
+    job.success = false;
+    jobs << job;
+    return jobs.count()-1;
+}
+
+void
+RideExporter::start()
+{
+    cancelled.store(0);
+    remaining.store(jobs.count());
+
+    // nothing to do, but still finish after the caller
+    // has had a chance to start waiting for it
+    if (jobs.isEmpty()) {
+        QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+        return;
+    }
+
+    // workers update their own job in place, so no sharing
+    work = jobs.data();
+    for(int i=0; i<jobs.count(); i++) pool.start(new RideExportRunner(this, i));
+}
+
+void
+RideExporter::cancel()
+{
+    cancelled.store(1);
+}
+
+void
+RideExporter::run(int index)
+{
+    // dropped when cancelled, but still counted
+    if (cancelled.load() == 0) {
+
+        Job &job = work[index];
+        emit progress(index, tr("Exporting..."));
+        job.success = exportFile(context, job.source, job.target, job.type, job.status);
+        emit exported(index, job.success, job.status);
+    }
+
+    if (remaining.fetchAndAddOrdered(-1) == 1) emit finished();
+}
+
+bool
+RideExporter::exportFile(Context *context, QString source, QString target, QString type, QString &status)
+{
+    GC_TRACE("RideExporter::exportFile");
+
+    // open it..
+    QStringList errors;
+    QList<RideFile*> rides;
+    QFile thisfile(source);
+    RideFile *ride = RideFileFactory::instance().openRideFile(context, thisfile, errors, &rides);
+
+    // we only export the whole activity, not the
+    // sessions or files split or extracted from it
+    rides.removeAll(ride);
+    qDeleteAll(rides);
+
+    // open failed
+    if (ride == NULL) {
+        status = tr("Read error");
+        return false;
+    }
+
+    QFile out(target);
+    bool success = false;
+    if (type == "csv") {
+        CsvFileReader writer;
+        success = writer.writeRideFile(context, ride, out, CsvFileReader::gc);
+    } else {
+        success = RideFileFactory::instance().writeRideFile(context, ride, out, type);
+    }
+
+    delete ride; // free memory!
+
+    status = success ? tr("Exported") : tr("Write failed");
+    return success;
+}
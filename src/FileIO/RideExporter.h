@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideExporter_h
+#define _GC_RideExporter_h 1
+
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QStringList>
+#include <QVector>
+
+class Context;
+
+//
+// Exports activity files to another format on a pool of worker threads,
+// each one is read, written and freed before the next is started on that
+// thread so memory use doesn't grow with the number of files.
+//
+// The signals are emitted from the worker threads, so connections to
+// widgets are queued. Used by the batch export dialog and --batch=export.
+//
+class RideExporter : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        RideExporter(Context *context, QObject *parent=NULL);
+        ~RideExporter(); // cancels and waits for running exports
+
+        // queue an activity file to export as type, "csv" being the
+        // GoldenCheetah csv format, returns its index for the signals
+        int add(QString source, QString target, QString type);
+
+        void start();
+        void cancel(); // those not started yet are dropped
+        void wait() { pool.waitForDone(); }
+        bool isRunning() const { return remaining.load() > 0; }
+
+        // export one file, returns false with the reason in status
+        static bool exportFile(Context *context, QString source, QString target, QString type, QString &status);
+
+    signals:
+
+        void progress(int index, QString status);
+        void exported(int index, bool success, QString status);
+        void finished();
+
+    private:
+
+        friend class RideExportRunner;
+        void run(int index);
+
+        Context *context;
+        QThreadPool pool;
+
+        struct Job {
+            QString source, target, type;
+            bool success;
+            QString status;
+        };
+        QVector<Job> jobs;
+        Job *work;
+
+        QAtomicInt cancelled;
+        QAtomicInt remaining;
+};
+
+#endif
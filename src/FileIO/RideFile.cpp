@@ -28,6 +28,7 @@
 #include "Settings.h"
 #include "Colors.h"
 #include "Units.h"
+#include "JsonStreamReader.h"
 
 #include <QtXml/QtXml>
 #include <algorithm> // for std::lower_bound
@@ -794,6 +795,9 @@ static QByteArray gUncompress(const QByteArray &data)
     return result;
 }
 
+// temporary folders for readers that need a file
+static QAtomicInt uncompressUnique(0);
+
 RideFile *RideFileFactory::openRideFile(Context *context, QFile &file,
                                            QStringList &errors, QList<RideFile*> *rideList) const
 {
@@ -852,8 +856,11 @@ RideFile *RideFileFactory::openRideFile(Context *context, QFile &file,
     // if we uncompressed a ride, we need to save to a temporary ride for import
     if (uncompressed) {
 
-        // create a temporary ride
-        QString tmp = context->athlete->home->temp().absolutePath() + "/" + QFileInfo(file.fileName()).baseName() + "." + suffix;
+        // create a temporary ride, in a folder of its own since imports
+        // run in parallel and files from different places can share a name
+        QDir tmpdir(context->athlete->home->temp().absolutePath() + QString("/uncompress-%1").arg(uncompressUnique.fetchAndAddRelaxed(1)));
+        tmpdir.mkpath(tmpdir.absolutePath());
+        QString tmp = tmpdir.absolutePath() + "/" + QFileInfo(file.fileName()).baseName() + "." + suffix;
 
         QFile ufile(tmp); // look at uncompressed version mot the source
         ufile.open(QFile::ReadWrite);
@@ -865,6 +872,7 @@ RideFile *RideFileFactory::openRideFile(Context *context, QFile &file,
 
         // now zap the temporary file
         ufile.remove();
+        tmpdir.rmdir(tmpdir.absolutePath());
 
     } else {
 
@@ -873,144 +881,226 @@ RideFile *RideFileFactory::openRideFile(Context *context, QFile &file,
     }
 
     // if it was successful, lets post process the file
-    if (result) {
+    if (result) postProcess(context, result, file.fileName());
 
-        result->context = context;
+    return result;
+}
 
-        if (result->intervals().empty()) result->fillInIntervals();
-        // override the file ride time with that set from the filename
-        // but only if it matches the GC format
-        QFileInfo fileInfo(file.fileName());
-        
-        // Regular expression to match either date format, including a mix of dashes and underscores
-        // yyyy-MM-dd-hh-mm-ss.extension
-        // or yyyy_MM_dd_hh_mm_ss.extension
-        // year is the only one matching for 4 digits, the rest can either be 1 or 2 digits.
-        QRegExp rx ("^((\\d{4})[-_](\\d{1,2})[-_](\\d{1,2})[-_](\\d{1,2})[-_](\\d{1,2})[-_](\\d{1,2}))\\.(.+)$");
-        if (rx.exactMatch(fileInfo.fileName())) {
-            QDate date(rx.cap(2).toInt(), rx.cap(3).toInt(),rx.cap(4).toInt());
-            QTime time(rx.cap(5).toInt(), rx.cap(6).toInt(),rx.cap(7).toInt());
-            QDateTime datetime(date, time);
-            result->setStartTime(datetime);
+RideFile *RideFileFactory::openRideFile(Context *context, QString filename, const QByteArray &data,
+                                           QStringList &errors, QList<RideFile*> *rideList) const
+{
+    // gc json is the usual format for data that never touches the disk (e.g.
+    // from a cloud service) and its streaming reader works straight from memory
+    if (QFileInfo(filename).suffix().toLower() == "json") {
+
+        RideFile *result = new RideFile;
+        QString streamerror;
+        if (JsonStreamReader(data).parse(result, streamerror)) {
+            postProcess(context, result, filename);
+            return result;
         }
+        delete result;
+    }
 
-        // legacy support for .notes file
-        QString notesFileName = fileInfo.canonicalPath() + '/' + fileInfo.baseName() + ".notes";
-        QFile notesFile(notesFileName);
+    // the readers all want a file, so write one, see above
+    QDir tmpdir(context->athlete->home->temp().absolutePath() + QString("/uncompress-%1").arg(uncompressUnique.fetchAndAddRelaxed(1)));
+    tmpdir.mkpath(tmpdir.absolutePath());
 
-        // read it in if it exists and "Notes" is not already set
-        if (result->getTag("Notes", "") == "" && notesFile.exists() &&
-            notesFile.open(QFile::ReadOnly | QFile::Text)) {
-            QTextStream in(&notesFile);
-            result->setTag("Notes", in.readAll());
-            notesFile.close();
-        }
+    QFile file(tmpdir.absolutePath() + "/" + QFileInfo(filename).fileName());
+    if (!file.open(QFile::WriteOnly)) {
+        errors << QObject::tr("unable to write temporary file %1").arg(file.fileName());
+        return NULL;
+    }
+    file.write(data);
+    file.close();
 
-        // set other "special" fields
-        result->setTag("Filename", QFileInfo(file.fileName()).fileName());
-        result->setTag("Device", result->deviceType());
-        result->setTag("File Format", result->fileFormat());
-        if (context) result->setTag("Athlete", context->athlete->cyclist);
-        result->setTag("Year", result->startTime().toString("yyyy"));
-        result->setTag("Month", result->startTime().toString("MMMM"));
-        result->setTag("Weekday", result->startTime().toString("ddd"));
-
-        // reset timestamps and distances to always start from zero
-        double timeOffset=0.00f, kmOffset=0.00f;
-        if (result->dataPoints().count()) {
-            timeOffset=result->dataPoints()[0]->secs;
-            kmOffset=result->dataPoints()[0]->km;
-        }
+    RideFile *result = openRideFile(context, file, errors, rideList);
 
-        // drag back samples
-        if (timeOffset || kmOffset) {
-            foreach (RideFilePoint *p, result->dataPoints()) {
-                p->km = p->km - kmOffset;
-                p->secs = p->secs - timeOffset;
-            }
-        }
+    file.remove();
+    tmpdir.rmdir(tmpdir.absolutePath());
 
-        // drag back intervals
-        foreach(RideFileInterval *i, result->intervals()) {
-            i->start -= timeOffset;
-            i->stop -= timeOffset;
-        }
+    return result;
+}
+
+// the start time in a GC style file name, if it is one
+static bool startTimeFromFileName(QString filename, QDateTime &datetime)
+{
+    // Regular expression to match either date format, including a mix of dashes and underscores
+    // yyyy-MM-dd-hh-mm-ss.extension
+    // or yyyy_MM_dd_hh_mm_ss.extension
+    // year is the only one matching for 4 digits, the rest can either be 1 or 2 digits.
+    QRegExp rx ("^((\\d{4})[-_](\\d{1,2})[-_](\\d{1,2})[-_](\\d{1,2})[-_](\\d{1,2})[-_](\\d{1,2}))\\.(.+)$");
+    if (rx.exactMatch(QFileInfo(filename).fileName())) {
+        QDate date(rx.cap(2).toInt(), rx.cap(3).toInt(),rx.cap(4).toInt());
+        QTime time(rx.cap(5).toInt(), rx.cap(6).toInt(),rx.cap(7).toInt());
+        datetime = QDateTime(date, time);
+        return true;
+    }
+    return false;
+}
+
+bool RideFileFactory::scanRideFile(Context *context, QFile &file, RideFileSummary &summary, QStringList &errors) const
+{
+    // compressed files are uncompressed and read by openRideFile
+    QString suffix = QFileInfo(file).suffix().toLower();
+    RideFileReader *reader = readFuncs_.value(suffix);
+
+    if (reader && reader->hasScan() && reader->scanRideFile(file, summary, errors)) {
+
+        // as postProcess() and RideFile::sport() would
+        QDateTime datetime;
+        if (startTimeFromFileName(file.fileName(), datetime)) summary.startTime = datetime;
+
+        QString sport = summary.tags.value("Sport", "");
+        if (sport == "Bike" || sport == RideFile::tr("Bike")) summary.sport = "Bike";
+        else if (sport == "Run" || sport == RideFile::tr("Run")) summary.sport = "Run";
+        else if (sport == "Swim" || sport == RideFile::tr("Swim")) summary.sport = "Swim";
+        else if (sport == "") summary.sport = "Bike"; // no Sport tag defaults to Bike
+        else summary.sport = sport;
+        return true;
+    }
+
+    // the long way round
+    RideFile *ride = openRideFile(context, file, errors);
+    if (ride == NULL) return false;
+
+    summary.startTime = ride->startTime();
+    summary.sport = ride->sport();
+    summary.deviceType = ride->deviceType();
+    summary.tags = ride->tags();
+    summary.duration = ride->metricOverrides.value("workout_time").value("value", "0.0").toDouble();
+    if (!summary.duration && ride->dataPoints().count())
+        summary.duration = ride->dataPoints().last()->secs + ride->recIntSecs();
 
-        // calculate derived data series -- after data fixers applied above
-        // Update presens and filter HRV
-        XDataSeries *series = result->xdata("HRV");
+    delete ride;
+    return true;
+}
+
+void RideFileFactory::postProcess(Context *context, RideFile *result, QString filename) const
+{
+    result->context = context;
+
+    if (result->intervals().empty()) result->fillInIntervals();
+    // override the file ride time with that set from the filename
+    // but only if it matches the GC format
+    QFileInfo fileInfo(filename);
+    QDateTime datetime;
+    if (startTimeFromFileName(filename, datetime)) result->setStartTime(datetime);
 
-        if (series && series->datapoints.count() > 0) {
-            double rrMax = appsettings->value(NULL, GC_RR_MAX, "2000.0").toDouble();
-            double rrMin = appsettings->value(NULL, GC_RR_MIN, "270.0").toDouble();
-            double rrFilt = appsettings->value(NULL, GC_RR_FILT, "0.2").toDouble();
-            int rrWindow = appsettings->value(NULL, GC_RR_WINDOW, "20").toInt();
+    // legacy support for .notes file
+    QString notesFileName = fileInfo.canonicalPath() + '/' + fileInfo.baseName() + ".notes";
+    QFile notesFile(notesFileName);
+
+    // read it in if it exists and "Notes" is not already set
+    if (result->getTag("Notes", "") == "" && notesFile.exists() &&
+        notesFile.open(QFile::ReadOnly | QFile::Text)) {
+        QTextStream in(&notesFile);
+        result->setTag("Notes", in.readAll());
+        notesFile.close();
+    }
+
+    // set other "special" fields
+    result->setTag("Filename", QFileInfo(filename).fileName());
+    result->setTag("Device", result->deviceType());
+    result->setTag("File Format", result->fileFormat());
+    if (context) result->setTag("Athlete", context->athlete->cyclist);
+    result->setTag("Year", result->startTime().toString("yyyy"));
+    result->setTag("Month", result->startTime().toString("MMMM"));
+    result->setTag("Weekday", result->startTime().toString("ddd"));
+
+    // reset timestamps and distances to always start from zero
+    double timeOffset=0.00f, kmOffset=0.00f;
+    if (result->dataPoints().count()) {
+        timeOffset=result->dataPoints()[0]->secs;
+        kmOffset=result->dataPoints()[0]->km;
+    }
 
-            FilterHrv(series, rrMin, rrMax, rrFilt, rrWindow);
+    // drag back samples
+    if (timeOffset || kmOffset) {
+        foreach (RideFilePoint *p, result->dataPoints()) {
+            p->km = p->km - kmOffset;
+            p->secs = p->secs - timeOffset;
         }
+    }
+
+    // drag back intervals
+    foreach(RideFileInterval *i, result->intervals()) {
+        i->start -= timeOffset;
+        i->stop -= timeOffset;
+    }
+
+    // calculate derived data series -- after data fixers applied above
+    // Update presens and filter HRV
+    XDataSeries *series = result->xdata("HRV");
 
-        // calculate derived data series -- after data fixers applied above
-        if (context) result->recalculateDerivedSeries();
+    if (series && series->datapoints.count() > 0) {
+        double rrMax = appsettings->value(NULL, GC_RR_MAX, "2000.0").toDouble();
+        double rrMin = appsettings->value(NULL, GC_RR_MIN, "270.0").toDouble();
+        double rrFilt = appsettings->value(NULL, GC_RR_FILT, "0.2").toDouble();
+        int rrWindow = appsettings->value(NULL, GC_RR_WINDOW, "20").toInt();
 
-        // what data is present - after processor in case 'derived' or adjusted
-        result->updateDataTag();
+        FilterHrv(series, rrMin, rrMax, rrFilt, rrWindow);
+    }
+
+    // calculate derived data series -- after data fixers applied above
+    if (context) result->recalculateDerivedSeries();
 
-        //foreach(RideFile::seriestype x, result->arePresent()) qDebug()<<"present="<<x;
+    // what data is present - after processor in case 'derived' or adjusted
+    result->updateDataTag();
 
-        // sample code for using XDATA, left here temporarily till we have an
-        // example of using it in a ride file reader
+    //foreach(RideFile::seriestype x, result->arePresent()) qDebug()<<"present="<<x;
+
+    // sample code for using XDATA, left here temporarily till we have an
+    // example of using it in a ride file reader
 #if 0
 
-        // ADD XDATA TO RIDEFILE
-
-        // For testing xdata, this code just adds an xdata series
-        // XDataSeries *xdata = new XDataSeries();
-        // xdata->name = "SPEED";
-        // xdata->valuename << "SPEED";
-        // for(int i=0; i<100; i++) {
-        // XDataPoint *p = new XDataPoint();
-        // p->km = i;
-        // p->secs = i;
-        // p->number[0] = i;
-        // xdata->datapoints.append(p);
-        // }
-        // result->addXData("SPEED", xdata);
-
-        // DEBUG OUTPUT TO SHOW XDATA LOADED FROM RIDEFILE
-        // for testing, print out what we loaded
-        if (result->xdata_.count()) {
-
-            // output the xdata series
-            qDebug()<<"XDATA";
-
-            QMapIterator<QString,XDataSeries*> xdata(result->xdata());
-            xdata.toFront();
-            while(xdata.hasNext()) {
-
-                // iterate
-                xdata.next();
-
-                XDataSeries *series = xdata.value();
-
-                // does it have values names?
-                if (series->valuename.isEmpty()) {
-                    qDebug()<<"empty xdata"<<series->name;
-                    continue;
-                } else {
-                    qDebug()<<"xdata" <<series->name<<series->valuename<<series->datapoints.count();
-                }
+    // ADD XDATA TO RIDEFILE
+
+    // For testing xdata, this code just adds an xdata series
+    // XDataSeries *xdata = new XDataSeries();
+    // xdata->name = "SPEED";
+    // xdata->valuename << "SPEED";
+    // for(int i=0; i<100; i++) {
+    // XDataPoint *p = new XDataPoint();
+    // p->km = i;
+    // p->secs = i;
+    // p->number[0] = i;
+    // xdata->datapoints.append(p);
+    // }
+    // result->addXData("SPEED", xdata);
+
+    // DEBUG OUTPUT TO SHOW XDATA LOADED FROM RIDEFILE
+    // for testing, print out what we loaded
+    if (result->xdata_.count()) {
+
+        // output the xdata series
+        qDebug()<<"XDATA";
+
+        QMapIterator<QString,XDataSeries*> xdata(result->xdata());
+        xdata.toFront();
+        while(xdata.hasNext()) {
+
+            // iterate
+            xdata.next();
+
+            XDataSeries *series = xdata.value();
+
+            // does it have values names?
+            if (series->valuename.isEmpty()) {
+                qDebug()<<"empty xdata"<<series->name;
+                continue;
+            } else {
+                qDebug()<<"xdata" <<series->name<<series->valuename<<series->datapoints.count();
+            }
 
-                // samples
-                if (series->datapoints.count()) {
-                    foreach(XDataPoint *p, series->datapoints)
-                        qDebug()<<"sample:"<<p->secs<<p->km<<p->number[0]<<p->number[1];
-                }
+            // samples
+            if (series->datapoints.count()) {
+                foreach(XDataPoint *p, series->datapoints)
+                    qDebug()<<"sample:"<<p->secs<<p->km<<p->number[0]<<p->number[1];
             }
         }
-#endif
     }
-
-    return result;
+#endif
 }
 
 void
@@ -1042,11 +1132,11 @@ RideFile::xdataValue(RideFilePoint *p, int &idx, QString sxdata, QString series,
     XDataSeries *s = xdata(sxdata);
 
     // if not there or no values return NA
-    if (s == NULL || !s->valuename.contains(series) || s->datapoints.count()==0)
-        return RideFile::NA;
+    if (s == NULL || s->datapoints.count()==0) return RideFile::NA;
 
     // get index of series we care about
-    int vindex = s->valuename.indexOf(series);
+    int vindex = s->valueIndex(series);
+    if (vindex == -1) return RideFile::NA;
 
     // where are we in the ride?
     double secs = p->secs;
@@ -1072,7 +1162,7 @@ RideFile::xdataValue(RideFilePoint *p, int &idx, QString sxdata, QString series,
             break;
 
         case REPEAT:
-            if (idx) returning = s->datapoints[idx-1]->number[vindex];
+            if (idx) returning = s->value(idx-1, vindex);
             else  returning = RideFile::NIL;
             break;
         }
@@ -1082,7 +1172,7 @@ RideFile::xdataValue(RideFilePoint *p, int &idx, QString sxdata, QString series,
         // ITS THE SAME AS US!
         //
         // if its a match we always take the value
-        returning = s->datapoints[idx]->number[vindex];
+        returning = s->value(idx, vindex);
     } else {
         //
         // ITS IN THE FUTURE
@@ -1095,8 +1185,8 @@ RideFile::xdataValue(RideFilePoint *p, int &idx, QString sxdata, QString series,
                 double gap = s->datapoints[idx]->secs - s->datapoints[idx-1]->secs;
                 double diff = secs - s->datapoints[idx-1]->secs;
                 double ratio = diff/gap;
-                double vgap = s->datapoints[idx]->number[vindex] - s->datapoints[idx-1]->number[vindex];
-                returning = s->datapoints[idx-1]->number[vindex] + (vgap * ratio);
+                double vgap = s->value(idx, vindex) - s->value(idx-1, vindex);
+                returning = s->value(idx-1, vindex) + (vgap * ratio);
             }
             break;
 
@@ -1110,7 +1200,7 @@ RideFile::xdataValue(RideFilePoint *p, int &idx, QString sxdata, QString series,
 
         case REPEAT:
             // for now, just return the last value we saw
-            if (idx) returning = s->datapoints[idx-1]->number[vindex];
+            if (idx) returning = s->value(idx-1, vindex);
             else  returning = RideFile::NA;
             break;
         }
@@ -3413,3 +3503,19 @@ XDataSeries::timeIndex(double secs) const
         return datapoints.size()-1;
     return i - datapoints.begin();
 }
+
+QVector<double>
+XDataSeries::column(int index) const
+{
+    QVector<double> returning(datapoints.count());
+    for (int i=0; i<datapoints.count(); i++) returning[i] = datapoints.at(i)->number.at(index);
+    return returning;
+}
+
+QVector<double>
+XDataSeries::seconds() const
+{
+    QVector<double> returning(datapoints.count());
+    for (int i=0; i<datapoints.count(); i++) returning[i] = datapoints.at(i)->secs;
+    return returning;
+}
@@ -177,6 +177,7 @@ class RideFile : public QObject // QObject to emit signals
         friend class TcxFileReader;
         friend struct PwxFileReader;
         friend struct JsonFileReader;
+        friend struct GcbFileReader;
         friend class ManualRideDialog;
         friend class PolarFileReader;
         friend class Strava;
@@ -551,27 +552,36 @@ class RideFileIterator {
 
 #define XDATA_MAXVALUES 32
 
+// XData values are stored compactly, a point only holds as many values as
+// have been written to it, so a series with two values costs two doubles per
+// point rather than XDATA_MAXVALUES doubles and strings. Most series never
+// use strings so they cost nothing at all.
+//
+// Writing with operator[] grows the storage as needed, reading beyond what
+// has been written returns 0 or "". Use at() to read without growing.
+template <typename T>
+class XDataValues {
+public:
+    T &operator[](int i) { if (i >= values.count()) values.resize(i+1); return values[i]; }
+    T operator[](int i) const { return at(i); }
+    T at(int i) const { return (i >= 0 && i < values.count()) ? values.at(i) : T(); }
+
+    int count() const { return values.count(); }
+    void insert(int i, const T &value) { if (i > values.count()) values.resize(i); values.insert(i, value); }
+    void remove(int i) { if (i < values.count()) values.remove(i); }
+    void resize(int n) { values.resize(n); }
+
+private:
+    QVector<T> values;
+};
+
 class XDataPoint {
 public:
-    XDataPoint() {
-        secs=km=0;
-        for(int i=0; i<XDATA_MAXVALUES; i++) {
-            number[i]=0;
-            string[i]="";
-        }
-    }
-    XDataPoint (const XDataPoint &other) {
-        this->secs=other.secs;
-        this->km=other.km;
-        for(int i=0; i<XDATA_MAXVALUES; i++) {
-            this->number[i]= other.number[i];
-            this->string[i]= other.string[i];
-        }
-    }
+    XDataPoint() : secs(0), km(0) {}
 
     double secs, km;
-    double number[XDATA_MAXVALUES];
-    QString string[XDATA_MAXVALUES];
+    XDataValues<double> number;
+    XDataValues<QString> string;
 };
 
 class XDataSeries {
@@ -593,6 +603,13 @@ public:
 
     int timeIndex(double) const;          // get index offset for time in secs
 
+    // read only view of the values, without growing the points
+    int valueIndex(const QString &value) const { return valuename.indexOf(value); }
+    double value(int row, int index) const { return datapoints.at(row)->number.at(index); }
+    QString string(int row, int index) const { return datapoints.at(row)->string.at(index); }
+    QVector<double> column(int index) const;   // all values for a series, e.g. for R and Python
+    QVector<double> seconds() const;           // all sample times
+
     QString name;
     QStringList valuename;
     QStringList unitname;
@@ -600,6 +617,19 @@ public:
     QVector<XDataPoint*> datapoints;
 };
 
+// What can be learned about an activity without decoding its samples,
+// for listing, duplicate detection and sync comparisons
+struct RideFileSummary
+{
+    RideFileSummary() : duration(0) {}
+
+    QDateTime startTime;
+    QString sport;                  // Bike, Run, Swim or the Sport tag, Bike if there isn't one
+    double duration;                // secs, 0 if not known
+    QString deviceType;
+    QMap<QString,QString> tags;     // whatever was found on the way
+};
+
 struct RideFileReader {
     virtual ~RideFileReader() {}
     virtual RideFile *openRideFile(QFile &file, QStringList &errors, QList<RideFile*>* = 0) const = 0;
@@ -607,6 +637,12 @@ struct RideFileReader {
     // if hasWrite capability should re-implement writeRideFile and hasWrite
     virtual bool hasWrite() const { return false; }
     virtual bool writeRideFile(Context *, const RideFile *, QFile &) const { return false; }
+
+    // if hasScan capability should re-implement scanRideFile and hasScan, it
+    // fills the summary from the header without reading the samples and
+    // returns false if it can't (the factory then opens the file instead)
+    virtual bool hasScan() const { return false; }
+    virtual bool scanRideFile(QFile &, RideFileSummary &, QStringList &) const { return false; }
 };
 
 class MetricAggregator;
@@ -620,6 +656,9 @@ class RideFileFactory {
 
         RideFileFactory() {}
 
+        // tags, times, hrv and derived series for a ride just read
+        void postProcess(Context *context, RideFile *result, QString filename) const;
+
     protected:
 
         friend class ::MetricAggregator;
@@ -639,7 +678,14 @@ class RideFileFactory {
         int registerReader(const QString &suffix, const QString &description,
                            RideFileReader *reader);
         RideFile *openRideFile(Context *context, QFile &file, QStringList &errors, QList<RideFile*>* = 0) const;
+        RideFile *openRideFile(Context *context, QString filename, const QByteArray &data,
+                               QStringList &errors, QList<RideFile*>* = 0) const; // filename for the suffix
         bool writeRideFile(Context *context, const RideFile *ride, QFile &file, QString format) const;
+
+        // start time, sport, duration and device without reading the samples where
+        // the reader can, otherwise the file is opened and summarised
+        bool scanRideFile(Context *context, QFile &file, RideFileSummary &summary, QStringList &errors) const;
+
         QStringList suffixes() const;
         QStringList writeSuffixes() const;
         bool supportedFormat(QString filename) const;
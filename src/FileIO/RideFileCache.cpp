@@ -17,6 +17,7 @@
  */
 
 #include "RideFileCache.h"
+#include "Trace.h"
 #include "MainWindow.h"
 #include "Context.h"
 #include "Athlete.h"
@@ -317,6 +318,8 @@ static long countForMeanMax(RideFileCacheHeader head, RideFile::SeriesType serie
 
 QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float> &wpk, QDate from, QDate to, QVector<QDate>*dates, bool wantruns)
 {
+    GC_TRACE("RideFileCache::meanMaxPowerFor");
+
     QVector<float> returning;
     QVector<float> returningwpk;
     bool first = true;
@@ -376,8 +379,7 @@ QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float> &
 
 QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float>&wpk, QString fileName)
 {
-    QTime start;
-    start.start();
+    GC_TRACE("RideFileCache::meanMaxPowerFor(file)");
 
     QVector<float> returning;
 
@@ -418,7 +420,6 @@ QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float>&w
                 inFile.readRawData((char*)wpk.constData(), head.wattsKgMeanMaxCount * sizeof(float));
                 for(int i=0; i<wpk.size(); i++) wpk[i] = wpk[i] / 100.00f;
 
-                //qDebug()<<"retrieved:"<<head.wattsMeanMaxCount<<"in:"<<start.elapsed()<<"ms";
             }
 
             // we're done reading
@@ -924,6 +925,8 @@ void RideFileCache::refresh(RideFile *file)
 // with many cores would benefit enormously
 void RideFileCache::RideFileCache::compute()
 {
+    GC_TRACE("RideFileCache::compute");
+
     if (ride == NULL) {
         return;
     }
@@ -161,7 +161,7 @@ RideFileCommand::setXDataPointValue(QString xdata, int row, int column, double v
     switch(column) {
         case 0: ovalue = series->datapoints[row]->secs; break;
         case 1: ovalue = series->datapoints[row]->km; break;
-        default: ovalue = series->datapoints[row]->number[column-2]; break;
+        default: ovalue = series->value(row, column-2); break;
     }
 
     SetXDataPointValueCommand *cmd = new  SetXDataPointValueCommand(ride, xdata, row, column, ovalue, value);
@@ -544,14 +544,10 @@ RemoveXDataSeriesCommand::doCommand()
     // snaffle away the data and clear
     values.resize(series->datapoints.count());
     for(int i=0; i<series->datapoints.count(); i++) {
-        values[i] = series->datapoints[i]->number[index];
-        series->datapoints[i]->number[index] = 0;
+        values[i] = series->datapoints[i]->number.at(index);
 
         // shift the values down
-        for(int j=index+1; j<8; j++) {
-            series->datapoints[i]->number[j-1] =
-            series->datapoints[i]->number[j];
-        }
+        series->datapoints[i]->number.remove(index);
     }
 
     // remove the name
@@ -574,11 +570,7 @@ RemoveXDataSeriesCommand::undoCommand()
     // put data back
     for(int i=0; i<series->datapoints.count(); i++) {
         // shift the values right
-        for(int j=index; j<7; j++) {
-            series->datapoints[i]->number[j+1] =
-            series->datapoints[i]->number[j];
-        }
-        series->datapoints[i]->number[index] = values[i];
+        series->datapoints[i]->number.insert(index, values[i]);
     }
     return true;
 }
@@ -621,6 +613,9 @@ AddXDataSeriesCommand::undoCommand()
     if (index == -1) return false;
     series->valuename.removeAt(index);
 
+    // and the storage for it
+    for(int i=0; i<series->datapoints.count(); i++) series->datapoints[i]->number.remove(index);
+
     return true;
 }
 
@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideImportPipeline.h"
+
+#include "Context.h"
+#include "Athlete.h"
+#include "RideFile.h"
+#include "RideMetadata.h"
+#include "JsonRideFile.h"
+#include "DataProcessor.h"
+#include "Trace.h"
+
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QEventLoop>
+#include <QTimer>
+#include <QFile>
+
+//
+// Jobs
+//
+RideImportJob::RideImportJob(QString filename, int stages) :
+    filename(filename), stages(stages), ride(NULL), written(false), timedout(false), state(Queued), started(0)
+{
+}
+
+RideImportJob::RideImportJob(RideFile *ride, int stages) :
+    stages(stages & ~Parse), ride(ride), written(false), timedout(false), state(Queued), started(0)
+{
+}
+
+RideImportJob::~RideImportJob()
+{
+    // archive readers may return one of the list too
+    if (ride && !rides.contains(ride)) delete ride;
+    foreach(RideFile *extracted, rides) delete extracted;
+}
+
+//
+// Worker, the results are kept locally until we know the job is still
+// wanted, so a job that has timed out is never written to
+//
+class RideImportRunner : public QRunnable
+{
+    public:
+        RideImportRunner(Context *context, RideImportJobPtr job, int stages) : context(context), job(job), stages(stages) {}
+
+        void run() {
+            work();
+
+            // context may go now, see drain()
+            RideImportPipeline::track(context, -1);
+        }
+
+        void work() {
+
+            // cancelled before we got to it
+            if (!job->state.testAndSetOrdered(RideImportJob::Queued, RideImportJob::Running)) return;
+            job->started.storeRelease(QDateTime::currentMSecsSinceEpoch());
+
+            GC_TRACE("RideImportPipeline::run");
+
+            // an in memory ride is ours till we hand it back
+            RideFile *ride;
+            {
+                QMutexLocker locker(&job->lock);
+                ride = job->ride;
+                job->ride = NULL;
+            }
+
+            QList<RideFile*> rides;
+            QStringList errors;
+            bool written = false;
+
+            // a bad file shouldn't take everything else down with it
+            try {
+                RideImportPipeline::run(context, job.data(), stages, ride, rides, errors, written);
+            } catch (...) {
+                errors << QObject::tr("Unexpected error reading file");
+                if (ride && !rides.contains(ride)) delete ride;
+                foreach(RideFile *extracted, rides) delete extracted;
+                ride = NULL;
+                rides.clear();
+            }
+
+            QMutexLocker locker(&job->lock);
+            if (job->state.load() == RideImportJob::Running) {
+
+                job->ride = ride;
+                job->rides = rides;
+                job->errors << errors;
+                job->written = written;
+                job->state.storeRelease(RideImportJob::Done);
+
+            } else {
+
+                // timed out, nobody wants it now
+                if (ride && !rides.contains(ride)) delete ride;
+                foreach(RideFile *extracted, rides) delete extracted;
+            }
+        }
+
+    private:
+        Context *context;
+        RideImportJobPtr job;
+        int stages;
+};
+
+//
+// Pipeline
+//
+QMutex RideImportPipeline::usersLock;
+QWaitCondition RideImportPipeline::drained;
+QMap<Context*, int> RideImportPipeline::users;
+
+RideImportPipeline::RideImportPipeline(Context *context, QObject *parent) :
+    QObject(parent), timeout(RIDE_IMPORT_TIMEOUT), context(context), tickets(0), inflight(0), cancelled(false)
+{
+    // data processors, linked defaults and so on are
+    // left for the main thread, see finish()
+    workerStages = RideImportJob::Parse;
+}
+
+RideImportPipeline::~RideImportPipeline()
+{
+    // workers hold their own reference to the job, so anything still
+    // running just finishes and is thrown away
+    cancel();
+}
+
+QThreadPool *
+RideImportPipeline::pool()
+{
+    // separate from the global pool used by the ride cache refresh, and
+    // never deleted so a reader that hangs can't hold up exiting
+    static QThreadPool *pool = NULL;
+    if (pool == NULL) {
+        pool = new QThreadPool;
+        pool->setMaxThreadCount(QThread::idealThreadCount());
+    }
+    return pool;
+}
+
+int
+RideImportPipeline::submit(RideImportJobPtr job)
+{
+    int ticket = tickets++;
+    jobs.insert(ticket, job);
+    queued << ticket;
+    cancelled = false;
+
+    dispatch();
+    return ticket;
+}
+
+void
+RideImportPipeline::track(Context *context, int delta)
+{
+    QMutexLocker locker(&usersLock);
+    int count = users.value(context) + delta;
+    if (count > 0) users.insert(context, count);
+    else {
+        users.remove(context);
+        drained.wakeAll();
+    }
+}
+
+void
+RideImportPipeline::drain(Context *context)
+{
+    // jobs that timed out may still be running, and a reader
+    // that never returns will hold this up, but its better
+    // than it using a context that has gone
+    QMutexLocker locker(&usersLock);
+    while (users.contains(context)) drained.wait(&usersLock);
+}
+
+void
+RideImportPipeline::start(int ticket)
+{
+    queued.removeOne(ticket);
+    inflight++;
+
+    RideImportJobPtr job = jobs.value(ticket);
+    track(context, 1);
+    pool()->start(new RideImportRunner(context, job, job->stages & workerStages));
+}
+
+void
+RideImportPipeline::dispatch()
+{
+    int window = pool()->maxThreadCount() * RIDE_IMPORT_WINDOW;
+    while (!queued.isEmpty() && inflight < window) start(queued.first());
+}
+
+void
+RideImportPipeline::cancel()
+{
+    foreach(int ticket, queued) {
+        RideImportJobPtr job = jobs.value(ticket);
+        job->state.testAndSetOrdered(RideImportJob::Queued, RideImportJob::Cancelled);
+    }
+    queued.clear();
+    cancelled = true;
+}
+
+RideImportJobPtr
+RideImportPipeline::wait(int ticket)
+{
+    RideImportJobPtr job = jobs.value(ticket);
+    if (job.isNull()) return job;
+
+    // the caller wants this one next, so don't leave it queued
+    if (queued.contains(ticket)) start(ticket);
+
+    // keep the ui alive while we wait
+    while (!cancelled) {
+
+        int state = job->state.loadAcquire();
+        if (state == RideImportJob::Done || state == RideImportJob::Cancelled) break;
+
+        // taking too long?
+        qint64 started = job->started.loadAcquire();
+        if (state == RideImportJob::Running && started && QDateTime::currentMSecsSinceEpoch() - started > qint64(timeout) * 1000) {
+            QMutexLocker locker(&job->lock);
+            if (job->state.testAndSetOrdered(RideImportJob::Running, RideImportJob::TimedOut)) {
+                job->timedout = true;
+                job->errors << tr("Timed out after %1 seconds").arg(timeout);
+                break;
+            }
+        }
+
+        QEventLoop loop;
+        QTimer::singleShot(20, &loop, SLOT(quit()));
+        loop.exec();
+    }
+
+    // collected, so makes room for another
+    jobs.remove(ticket);
+    if (job->state.loadAcquire() != RideImportJob::Cancelled) inflight--;
+    dispatch();
+
+    switch (job->state.loadAcquire()) {
+    case RideImportJob::Done: finish(job); break;
+    case RideImportJob::Cancelled: job->errors << tr("Cancelled"); break;
+    case RideImportJob::Running:
+    case RideImportJob::Queued:
+        // cancel() while running, can't use it
+        {
+            QMutexLocker locker(&job->lock);
+            if (job->state.testAndSetOrdered(RideImportJob::Running, RideImportJob::TimedOut) ||
+                job->state.testAndSetOrdered(RideImportJob::Queued, RideImportJob::Cancelled))
+                job->errors << tr("Cancelled");
+        }
+        // it may have finished after all
+        if (job->state.loadAcquire() == RideImportJob::Done) finish(job);
+        break;
+    }
+    return job;
+}
+
+void
+RideImportPipeline::finish(RideImportJobPtr job)
+{
+    // stages the workers weren't allowed to run
+    int remaining = job->stages & ~workerStages;
+    if (remaining) run(context, job.data(), remaining, job->ride, job->rides, job->errors, job->written);
+}
+
+void
+RideImportPipeline::run(Context *context, const RideImportJob *job, int stages,
+                        RideFile *&ride, QList<RideFile*> &rides, QStringList &errors, bool &written)
+{
+    // PARSE
+    if (stages & RideImportJob::Parse) {
+
+        QFile file(job->filename);
+        ride = RideFileFactory::instance().openRideFile(context, file, errors, &rides);
+
+        // archives are split by the caller
+        if (rides.count() > 1) return;
+
+        // warnings go with the ride
+        if (ride && errors.count() && (job->stages & RideImportJob::Serialise))
+            ride->setTag("Import errors", errors.join("\n"));
+    }
+    if (ride == NULL) return;
+
+    if (stages & (RideImportJob::Parse | RideImportJob::Process)) {
+        if (job->startTime.isValid()) ride->setStartTime(job->startTime);
+        QMapIterator<QString,QString> tag(job->tags);
+        while (tag.hasNext()) {
+            tag.next();
+            ride->setTag(tag.key(), tag.value());
+        }
+    }
+
+    // PROCESS
+    if (stages & RideImportJob::Process) {
+
+        // process linked defaults
+        if (context) context->athlete->rideMetadata()->setLinkedDefaults(ride);
+
+        // run the processor first... import
+        DataProcessorFactory::instance().autoProcess(ride, "Auto", "Import");
+        ride->recalculateDerivedSeries();
+    }
+
+    // SAVE
+    if (stages & RideImportJob::Save) DataProcessorFactory::instance().autoProcess(ride, "Save", "ADD");
+
+    // SERIALISE
+    if (stages & RideImportJob::Serialise) {
+        JsonFileReader reader;
+        QFile target(job->target);
+        written = reader.writeRideFile(context, ride, target);
+    }
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideImportPipeline_h
+#define _GC_RideImportPipeline_h 1
+
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QMap>
+#include <QDateTime>
+#include <QStringList>
+
+class Context;
+class RideFile;
+class QThreadPool;
+
+// seconds a file may spend in the worker stages before we give up on it
+#define RIDE_IMPORT_TIMEOUT 120
+
+// how many jobs may be started ahead of the one being collected, per
+// thread, so parsed rides don't pile up in memory waiting to be saved
+#define RIDE_IMPORT_WINDOW 4
+
+//
+// A file (or a ride already in memory) going through the import stages:
+//
+//    Parse     - read with the RideFileReader for its suffix
+//    Process   - linked defaults, "Auto" data processors, derived series
+//    Save      - "Save" data processors
+//    Serialise - write as json to target
+//
+// Inputs must be set before the job is submitted and are not changed
+// after that. Results are only valid once returned by wait().
+//
+class RideImportJob
+{
+    public:
+
+        enum { Parse=0x01, Process=0x02, Save=0x04, Serialise=0x08 };
+
+        RideImportJob(QString filename, int stages);
+        RideImportJob(RideFile *ride, int stages); // takes ownership
+        ~RideImportJob(); // deletes rides not taken
+
+        // what to do
+        QString filename;
+        int stages;
+        QDateTime startTime;            // replaces the one from the file when valid
+        QMap<QString,QString> tags;     // set before processing
+        QString target;                 // json file written by Serialise
+
+        // what happened
+        RideFile *ride;
+        QList<RideFile*> rides;         // when the file is an archive of several
+        QStringList errors;             // just warnings when ride != NULL
+        bool written;
+        bool timedout;
+
+        // the caller keeps the ride, otherwise it goes with the job
+        RideFile *take() { RideFile *r = ride; ride = NULL; return r; }
+
+    private:
+        friend class RideImportPipeline;
+        friend class RideImportRunner;
+
+        enum { Queued, Running, Done, Cancelled, TimedOut };
+
+        QMutex lock;                    // worker finishing vs. timing out
+        QAtomicInt state;
+        QAtomicInteger<qint64> started; // msecs since epoch, 0 till running
+};
+typedef QSharedPointer<RideImportJob> RideImportJobPtr;
+
+//
+// Runs import jobs concurrently on a bounded pool of threads shared by
+// everything that imports (the import wizard, auto import folders) while
+// the caller collects the results in the order it wants with wait(),
+// which keeps the event loop running.
+//
+// A job that fails or throws only affects that file, and one that takes
+// longer than the timeout is abandoned; the thread it is stuck on cleans
+// up after itself if it ever finishes. The athlete waits for those still
+// using its context before closing, see drain().
+//
+// Only parsing runs on the workers. Data processors are shared and some
+// of them use widgets, so Process, Save and Serialise are run by wait()
+// on the main thread.
+//
+class RideImportPipeline : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        RideImportPipeline(Context *context, QObject *parent=NULL);
+        ~RideImportPipeline(); // abandons anything not collected
+
+        // queue a job, the ticket is used to collect it
+        int submit(RideImportJobPtr job);
+
+        // block until the job has finished, failed or timed out
+        RideImportJobPtr wait(int ticket);
+
+        // drop jobs that haven't started, wait() returns straight away
+        void cancel();
+
+        int timeout; // seconds, defaults to RIDE_IMPORT_TIMEOUT
+
+        // the stages, for callers that import one ride at a time
+        static void run(Context *context, const RideImportJob *job, int stages,
+                        RideFile *&ride, QList<RideFile*> &rides, QStringList &errors, bool &written);
+
+        // the pool all imports share
+        static QThreadPool *pool();
+
+        // wait for workers still using context, before it goes
+        static void drain(Context *context);
+
+    private:
+
+        void start(int ticket);
+        void dispatch();
+        void finish(RideImportJobPtr job);
+
+        friend class RideImportRunner;
+        static void track(Context *context, int delta);
+        static QMutex usersLock;
+        static QWaitCondition drained;
+        static QMap<Context*, int> users;  // workers started, by context
+
+        Context *context;
+        int workerStages; // the stages safe to run on a worker
+
+        int tickets;
+        int inflight;
+        bool cancelled;
+        QMap<int, RideImportJobPtr> jobs; // not collected yet, by ticket
+        QList<int> queued;                // not started yet
+};
+
+#endif
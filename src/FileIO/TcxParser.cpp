@@ -129,7 +129,7 @@ bool
 TcxParser::endElement( const QString&, const QString&, const QString& qName)
 {
     if (qName == "Time") {
-        time = convertToLocalTime(buffer);
+        time = convertISO8601ToUTC(buffer); // only used for offsets
         secs = double(start_time.msecsTo(time)) / 1000.00f;
 
     } else if (qName == "DistanceMeters") { distance = buffer.toDouble() / 1000; }
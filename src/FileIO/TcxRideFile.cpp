@@ -19,7 +19,11 @@
 
 #include "TcxRideFile.h"
 #include "TcxParser.h"
-#include <QDomDocument>
+#include "XmlStreamParser.h"
+#include "TimeUtils.h"
+#include <QXmlStreamWriter>
+#include <QXmlStreamReader>
+#include <QBuffer>
 
 #include "Context.h"
 #include "Athlete.h"
@@ -44,28 +48,96 @@ RideFile *TcxFileReader::openRideFile(QFile &file, QStringList &errors, QList<Ri
 
     TcxParser handler(rideFile, list);
 
-    QXmlInputSource source (&file);
-    QXmlSimpleReader reader;
-    reader.setContentHandler (&handler);
-    reader.parse (source);
+    XmlStreamParser::parse(file, handler);
 
     return rideFile;
 }
 
-QByteArray
-TcxFileReader::toByteArray(Context *context, const RideFile *ride, bool withAlt, bool withWatts, bool withHr, bool withCad) const
+//
+// The first activity's sport, start, duration and device, as
+// openRideFile() would find them, without reading the tracks
+//
+bool TcxFileReader::scanRideFile(QFile &file, RideFileSummary &summary, QStringList &errors) const
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        errors << tr("Could not open file %1").arg(file.fileName());
+        return false;
+    }
+
+    QXmlStreamReader xml(&file);
+    bool activity = false;
+    QDateTime id, first, last;
+    double lastLapSecs = 0;
+    summary.deviceType = "Garmin";
+
+    while (!xml.atEnd()) {
+
+        xml.readNext();
+        if (xml.isEndElement() && xml.name() == "Activity") break;
+        if (!xml.isStartElement()) continue;
+
+        if (xml.name() == "Activity") {
+            activity = true;
+
+            // Sport ("Biking", "Running", "Other")
+            QStringRef sport = xml.attributes().value("Sport");
+            if (sport == "Biking") summary.tags.insert("Sport", "Bike");
+            else if (sport == "Running") summary.tags.insert("Sport", "Run");
+
+        } else if (!activity) {
+            continue;
+
+        } else if (xml.name() == "Id") {
+            id = convertToLocalTime(xml.readElementText().trimmed());
+
+        } else if (xml.name() == "Lap") {
+            // the first lap is the start of the activity
+            last = convertToLocalTime(xml.attributes().value("StartTime").toString().trimmed());
+            if (!first.isValid()) first = last;
+            lastLapSecs = 0;
+
+        } else if (xml.name() == "TotalTimeSeconds") {
+            lastLapSecs = xml.readElementText().toDouble();
+
+        } else if (xml.name() == "Track") {
+            xml.skipCurrentElement(); // the samples
+
+        } else if (xml.name() == "Creator") {
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "Name") {
+                    QString name = xml.readElementText();
+                    if (!name.isEmpty()) summary.deviceType = name;
+                } else xml.skipCurrentElement();
+            }
+        }
+    }
+    bool parsed = !xml.hasError();
+    file.close();
+
+    if (!parsed || !activity) return false;
+
+    summary.startTime = first.isValid() ? first : id;
+    if (last.isValid()) summary.duration = first.msecsTo(last) / 1000.0 + lastLapSecs;
+    return summary.startTime.isValid();
+}
+
+//
+// The document is streamed out as it is generated, rather than being built
+// as a DOM first, since rides with many hours of samples made for very
+// large documents when batch exporting
+//
+void
+TcxFileReader::write(QXmlStreamWriter &xml, Context *context, const RideFile *ride, bool withAlt, bool withWatts, bool withHr, bool withCad) const
 {
-    QDomText text;
-    QDomDocument doc;
-    QDomProcessingInstruction hdr = doc.createProcessingInstruction("xml","version=\"1.0\"");
-    doc.appendChild(hdr);
-
-    // pwx
-    QDomElement tcx = doc.createElementNS("http://www.garmin.com/xmlschemas/TrainingCenterDatabase/v2", "TrainingCenterDatabase");
-    tcx.setAttribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance");
-    tcx.setAttribute("xsi:schemaLocation", "http://www.garmin.com/xmlschemas/ActivityExtension/v2 http://www.garmin.com/xmlschemas/ActivityExtensionv2.xsd http://www.garmin.com/xmlschemas/TrainingCenterDatabase/v2 http://www.garmin.com/xmlschemas/TrainingCenterDatabasev2.xsd");
-    //tcx.setAttribute("version", "2.0");
-    doc.appendChild(tcx);
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(4);
+    xml.writeStartDocument();
+
+    // tcx
+    xml.writeStartElement("TrainingCenterDatabase");
+    xml.writeAttribute("xmlns", "http://www.garmin.com/xmlschemas/TrainingCenterDatabase/v2");
+    xml.writeAttribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance");
+    xml.writeAttribute("xsi:schemaLocation", "http://www.garmin.com/xmlschemas/ActivityExtension/v2 http://www.garmin.com/xmlschemas/ActivityExtensionv2.xsd http://www.garmin.com/xmlschemas/TrainingCenterDatabase/v2 http://www.garmin.com/xmlschemas/TrainingCenterDatabasev2.xsd");
 
     // activities, we just serialise one ride
     QString sport = ride->getTag("Sport", "Biking");
@@ -76,70 +148,34 @@ TcxFileReader::toByteArray(Context *context, const RideFile *ride, bool withAlt,
     } else {
         sport = "Other";
     }
-    QDomElement activities = doc.createElement("Activities");
-    tcx.appendChild(activities);
-    QDomElement activity = doc.createElement("Activity");
-    activity.setAttribute("Sport", sport); // was ride->getTag("Sport", "Biking") but must be Biking, Running or Other
-    activities.appendChild(activity);
+    xml.writeStartElement("Activities");
+    xml.writeStartElement("Activity");
+    xml.writeAttribute("Sport", sport); // was ride->getTag("Sport", "Biking") but must be Biking, Running or Other
 
     // time
-    QDomElement id = doc.createElement("Id");
-    text = doc.createTextNode(ride->startTime().toUTC().toString(Qt::ISODate));
-    id.appendChild(text);
-    activity.appendChild(id);
+    xml.writeTextElement("Id", ride->startTime().toUTC().toString(Qt::ISODate));
 
     // notes if present
-    if (ride->getTag("Notes","") != "") {
-        QDomElement notes = doc.createElement("Notes");
-        text = doc.createTextNode(ride->getTag("Notes",""));
-        notes.appendChild(text);
-        activity.appendChild(notes);
-    }
+    if (ride->getTag("Notes","") != "") xml.writeTextElement("Notes", ride->getTag("Notes",""));
 
     // always create as Garmin TCX (to allow import into other programs)
     // exception is "Zwift" - since some programs (e.g. Strava) interpret that as "virtual ride"
     // so let them still have the chance to identify a ride coming from Zwift
-    QDomElement creator = doc.createElement("Creator");
-    creator.setAttribute("xsi:type", "Device_t");
-    QDomElement creatorName = doc.createElement("Name");
-    if (ride->deviceType().toLower().contains("zwift") ) {
-        text = doc.createTextNode("Zwift");
-    } else {
-        text = doc.createTextNode("Garmin TCX");
-    }
-    creatorName.appendChild(text);
-    creator.appendChild(creatorName);
-    QDomElement unitid = doc.createElement("UnitId");
-    text = doc.createTextNode ("0");
-    unitid.appendChild(text);
-    creator.appendChild(unitid);
-    QDomElement productid = doc.createElement("ProductId");
-    text = doc.createTextNode ("20119");
-    productid.appendChild(text);
-    creator.appendChild(productid);
-    QDomElement version = doc.createElement("Version");
-    QDomElement versionMajor = doc.createElement("VersionMajor");
-    text = doc.createTextNode ("0");
-    versionMajor.appendChild(text);
-    version.appendChild(versionMajor);
-    QDomElement versionMinor = doc.createElement("VersionMinor");
-    text = doc.createTextNode ("0");
-    versionMinor.appendChild(text);
-    version.appendChild(versionMinor);
-    QDomElement buildMajor = doc.createElement("BuildMajor");
-    text = doc.createTextNode ("0");
-    buildMajor.appendChild(text);
-    version.appendChild(buildMajor);
-    QDomElement buildMinor = doc.createElement("BuildMinor");
-    text = doc.createTextNode ("0");
-    buildMinor.appendChild(text);
-    version.appendChild(buildMinor);
-    creator.appendChild(version);
-    activity.appendChild(creator);
-
-    QDomElement lap = doc.createElement("Lap");
-    lap.setAttribute("StartTime", ride->startTime().toUTC().toString(Qt::ISODate));
-    activity.appendChild(lap);
+    xml.writeStartElement("Creator");
+    xml.writeAttribute("xsi:type", "Device_t");
+    xml.writeTextElement("Name", ride->deviceType().toLower().contains("zwift") ? "Zwift" : "Garmin TCX");
+    xml.writeTextElement("UnitId", "0");
+    xml.writeTextElement("ProductId", "20119");
+    xml.writeStartElement("Version");
+    xml.writeTextElement("VersionMajor", "0");
+    xml.writeTextElement("VersionMinor", "0");
+    xml.writeTextElement("BuildMajor", "0");
+    xml.writeTextElement("BuildMinor", "0");
+    xml.writeEndElement(); // Version
+    xml.writeEndElement(); // Creator
+
+    xml.writeStartElement("Lap");
+    xml.writeAttribute("StartTime", ride->startTime().toUTC().toString(Qt::ISODate));
 
     const char *metrics[] = {
         "total_distance",
@@ -163,319 +199,124 @@ TcxFileReader::toByteArray(Context *context, const RideFile *ride, bool withAlt,
         RideItem *tempItem = new RideItem(const_cast<RideFile*>(ride), context);
         QHash<QString,RideMetricPtr> computed = RideMetric::computeMetrics(tempItem, Specification(), worklist);
 
-        QDomElement lap_time = doc.createElement("TotalTimeSeconds");
-        text = doc.createTextNode(QString("%1").arg(computed.value("workout_time")->value(true)));
-        //text = doc.createTextNode(ride->dataPoints().last()->secs);
-        lap_time.appendChild(text);
-        lap.appendChild(lap_time);
-
-        QDomElement lap_distance = doc.createElement("DistanceMeters");
-        text = doc.createTextNode(QString("%1").arg(1000*computed.value("total_distance")->value(true)));
-        //text = doc.createTextNode(ride->dataPoints().last()->km);
-        lap_distance.appendChild(text);
-        lap.appendChild(lap_distance);
-
-        QDomElement max_speed = doc.createElement("MaximumSpeed");
-        text = doc.createTextNode(QString("%1")
-            .arg(computed.value("max_speed")->value(true) / 3.6));
-        max_speed.appendChild(text);
-        lap.appendChild(max_speed);
-
-        QDomElement lap_calories = doc.createElement("Calories");
-        text = doc.createTextNode(QString("%1").arg((int)computed.value("total_work")->value(true)));
-        lap_calories.appendChild(text);
-        lap.appendChild(lap_calories);
+        xml.writeTextElement("TotalTimeSeconds", QString("%1").arg(computed.value("workout_time")->value(true)));
+        xml.writeTextElement("DistanceMeters", QString("%1").arg(1000*computed.value("total_distance")->value(true)));
+        xml.writeTextElement("MaximumSpeed", QString("%1").arg(computed.value("max_speed")->value(true) / 3.6));
+        xml.writeTextElement("Calories", QString("%1").arg((int)computed.value("total_work")->value(true)));
 
         // optional per XSD, so only generate them if the data is to be exported and is present
         if (withHr && ride->areDataPresent()->hr)
         {
-            QDomElement avg_heartrate = doc.createElement("AverageHeartRateBpm");
-            QDomElement value = doc.createElement("Value");
-            text = doc.createTextNode(QString("%1").arg((int)computed.value("average_hr")->value(true)));
-            value.appendChild(text);
-            avg_heartrate.appendChild(value);
-            lap.appendChild(avg_heartrate);
-
-            QDomElement max_heartrate = doc.createElement("MaximumHeartRateBpm");
-            value = doc.createElement("Value");
-            text = doc.createTextNode(QString("%1").arg((int)computed.value("max_heartrate")->value(true)));
-            value.appendChild(text);
-            max_heartrate.appendChild(value);
-            lap.appendChild(max_heartrate);
-        }
+            xml.writeStartElement("AverageHeartRateBpm");
+            xml.writeTextElement("Value", QString("%1").arg((int)computed.value("average_hr")->value(true)));
+            xml.writeEndElement();
 
-        QDomElement lap_intensity = doc.createElement("Intensity");
-        text = doc.createTextNode("Active");
-        lap_intensity.appendChild(text);
-        lap.appendChild(lap_intensity);
+            xml.writeStartElement("MaximumHeartRateBpm");
+            xml.writeTextElement("Value", QString("%1").arg((int)computed.value("max_heartrate")->value(true)));
+            xml.writeEndElement();
+        }
 
-        QDomElement lap_triggerMethod = doc.createElement("TriggerMethod");
-        text = doc.createTextNode("Manual");
-        lap_triggerMethod.appendChild(text);
-        lap.appendChild(lap_triggerMethod);
+        xml.writeTextElement("Intensity", "Active");
+        xml.writeTextElement("TriggerMethod", "Manual");
     }
 
     // samples
     // data points: timeoffset, dist, hr, spd, pwr, torq, cad, lat, lon, alt
     if (!ride->dataPoints().empty()) {
-        QDomElement track = doc.createElement("Track");
-        lap.appendChild(track);
+        xml.writeStartElement("Track");
+
+        QDateTime start = ride->startTime().toUTC();
+        const RideFileDataPresent *present = ride->areDataPresent();
 
         foreach (const RideFilePoint *point, ride->dataPoints()) {
-            QDomElement trackpoint = doc.createElement("Trackpoint");
-            track.appendChild(trackpoint);
+            xml.writeStartElement("Trackpoint");
 
             // time
-            QDomElement time = doc.createElement("Time");
-            text = doc.createTextNode(ride->startTime().toUTC().addSecs(point->secs).toString(Qt::ISODate));
-            time.appendChild(text);
-            trackpoint.appendChild(time);
+            xml.writeTextElement("Time", start.addSecs(point->secs).toString(Qt::ISODate));
 
             // position
-            if (ride->areDataPresent()->lat && point->lat > -90.0 && point->lat < 90.0 && point->lat != 0.0 &&
-                ride->areDataPresent()->lon && point->lon > -180.00 && point->lon < 180.00 && point->lon != 0.0 ) {
-                QDomElement position = doc.createElement("Position");
-                trackpoint.appendChild(position);
-
-                // lat
-                QDomElement lat = doc.createElement("LatitudeDegrees");
-                text = doc.createTextNode(QString("%1").arg(point->lat, 0, 'g', 11));
-                lat.appendChild(text);
-                position.appendChild(lat);
-
-                // lon
-                QDomElement lon = doc.createElement("LongitudeDegrees");
-                text = doc.createTextNode(QString("%1").arg(point->lon, 0, 'g', 11));
-                lon.appendChild(text);
-                position.appendChild(lon);
+            if (present->lat && point->lat > -90.0 && point->lat < 90.0 && point->lat != 0.0 &&
+                present->lon && point->lon > -180.00 && point->lon < 180.00 && point->lon != 0.0 ) {
+                xml.writeStartElement("Position");
+                xml.writeTextElement("LatitudeDegrees", QString("%1").arg(point->lat, 0, 'g', 11));
+                xml.writeTextElement("LongitudeDegrees", QString("%1").arg(point->lon, 0, 'g', 11));
+                xml.writeEndElement();
             }
 
-
             // alt
-            if (withAlt && ride->areDataPresent()->alt && point->alt != 0.0) {
-                QDomElement alt = doc.createElement("AltitudeMeters");
-                text = doc.createTextNode(QString("%1").arg(point->alt));
-                alt.appendChild(text);
-                trackpoint.appendChild(alt);
-            }
+            if (withAlt && present->alt && point->alt != 0.0)
+                xml.writeTextElement("AltitudeMeters", QString("%1").arg(point->alt));
 
             // distance - meters
-            if (ride->areDataPresent()->km) {
-                QDomElement dist = doc.createElement("DistanceMeters");
-                text = doc.createTextNode(QString("%1").arg((point->km*1000)));
-                dist.appendChild(text);
-                trackpoint.appendChild(dist);
-            }
+            if (present->km)
+                xml.writeTextElement("DistanceMeters", QString("%1").arg((point->km*1000)));
 
-            if (withHr && ride->areDataPresent()->hr)  {
+            if (withHr && present->hr)  {
                 // HeartRate hack for Garmin Training Center
                 // It needs an hr datapoint for every trackpoint or else the
                 // hr graph in TC won't display. Schema defines the datapoint
                 // as a positive int (> 0)
 
                 int tHr = 1;
-                if (ride->areDataPresent()->hr && point->hr >0.00) {
+                if (present->hr && point->hr >0.00) {
                     tHr = (int)point->hr;
                 }
-                QDomElement hr = doc.createElement("HeartRateBpm");
-                hr.setAttribute("xsi:type", "HeartRateInBeatsPerMinute_t");
-                QDomElement value = doc.createElement("Value");
-                text = doc.createTextNode(QString("%1").arg(tHr));
-                value.appendChild(text);
-                hr.appendChild(value);
-                trackpoint.appendChild(hr);
+                xml.writeStartElement("HeartRateBpm");
+                xml.writeAttribute("xsi:type", "HeartRateInBeatsPerMinute_t");
+                xml.writeTextElement("Value", QString("%1").arg(tHr));
+                xml.writeEndElement();
             }
 
             // cad
-            if (withCad && ride->areDataPresent()->cad && point->cad < 255) { //xsd maxInclusive value="254"
-                QDomElement cad = doc.createElement("Cadence");
-                text = doc.createTextNode(QString("%1").arg((int)(point->cad)));
-                cad.appendChild(text);
-                trackpoint.appendChild(cad);
-            }
+            if (withCad && present->cad && point->cad < 255) //xsd maxInclusive value="254"
+                xml.writeTextElement("Cadence", QString("%1").arg((int)(point->cad)));
 
-            if (ride->areDataPresent()->kph || ride->areDataPresent()->watts) {
-                QDomElement extension = doc.createElement("Extensions");
-                trackpoint.appendChild(extension);
-                QDomElement tpx = doc.createElement("TPX");
-                tpx.setAttribute("xmlns", "http://www.garmin.com/xmlschemas/ActivityExtension/v2");
-                extension.appendChild(tpx);
+            if (present->kph || present->watts) {
+                xml.writeStartElement("Extensions");
+                xml.writeStartElement("TPX");
+                xml.writeAttribute("xmlns", "http://www.garmin.com/xmlschemas/ActivityExtension/v2");
 
                 // spd - meters per second
-                if (ride->areDataPresent()->kph) {
-                    QDomElement spd = doc.createElement("Speed");
-                    text = doc.createTextNode(QString("%1").arg(point->kph / 3.6));
-                    spd.appendChild(text);
-                    tpx.appendChild(spd);
-                }
+                if (present->kph)
+                    xml.writeTextElement("Speed", QString("%1").arg(point->kph / 3.6));
+
                 // pwr
-                if (withWatts && ride->areDataPresent()->watts) {
-                    QDomElement pwr = doc.createElement("Watts");
-                    text = doc.createTextNode(QString("%1").arg((int)point->watts));
-                    pwr.appendChild(text);
-                    tpx.appendChild(pwr);
-                }
+                if (withWatts && present->watts)
+                    xml.writeTextElement("Watts", QString("%1").arg((int)point->watts));
+
+                xml.writeEndElement(); // TPX
+                xml.writeEndElement(); // Extensions
             }
+            xml.writeEndElement(); // Trackpoint
         }
+        xml.writeEndElement(); // Track
     }
 
-#if 0 // REFACTOR METRICS
-    if (context) {
-        // Activity Extensions
-        QDomElement extensions = doc.createElement("Extensions");
-        lap.appendChild(extensions);
-        QDomElement lx = doc.createElement("LX");
-        lx.setAttribute("xmlns", "http://www.garmin.com/xmlschemas/ActivityExtension/v2");
-        extensions.appendChild(lx);
-
-        QDomElement max_cad = doc.createElement("MaxBikeCadence");
-        text = doc.createTextNode(QString("%1").arg(computed.value("max_cadence")->value(true)));
-        max_cad.appendChild(text);
-        lx.appendChild(max_cad);
-
-        lx = doc.createElement("LX");
-        lx.setAttribute("xmlns", "http://www.garmin.com/xmlschemas/ActivityExtension/v2");
-        extensions.appendChild(lx);
-
-        QDomElement avg_speed = doc.createElement("AvgSpeed");
-        text = doc.createTextNode(QString("%1")
-            .arg(computed.value("average_speed")->value(true) / 3.6));
-        avg_speed.appendChild(text);
-        lx.appendChild(avg_speed);
-
-        lx = doc.createElement("LX");
-        lx.setAttribute("xmlns", "http://www.garmin.com/xmlschemas/ActivityExtension/v2");
-        extensions.appendChild(lx);
-
-        QDomElement avg_power = doc.createElement("AvgWatts");
-        text = doc.createTextNode(QString("%1").arg((int)computed.value("average_power")->value(true)));
-        avg_power.appendChild(text);
-        lx.appendChild(avg_power);
-
-        lx = doc.createElement("LX");
-        lx.setAttribute("xmlns", "http://www.garmin.com/xmlschemas/ActivityExtension/v2");
-        extensions.appendChild(lx);
-
-        QDomElement max_power = doc.createElement("MaxWatts");
-        text = doc.createTextNode(QString("%1").arg((int)computed.value("max_power")->value(true)));
-        max_power.appendChild(text);
-        lx.appendChild(max_power);
-
-        // Creator - Device
-        QDomElement creator = doc.createElement("Creator");
-        creator.setAttribute("xsi:type", "Device_t");
-        activity.appendChild(creator);
-
-        QDomElement creator_name = doc.createElement("Name");
-        if (ride->deviceType() != "")
-            text = doc.createTextNode(ride->deviceType());
-        else
-            text = doc.createTextNode("Unknown");
-        creator_name.appendChild(text);
-        creator.appendChild(creator_name);
-
-        QDomElement creator_unitId = doc.createElement("UnitId");
-        text = doc.createTextNode("0");
-        creator_unitId.appendChild(text);
-        creator.appendChild(creator_unitId);
-
-        QDomElement creator_productId = doc.createElement("ProductID");
-        text = doc.createTextNode("0");
-        creator_productId.appendChild(text);
-        creator.appendChild(creator_productId);
-
-        QDomElement creator_version = doc.createElement("Version");
-        creator.appendChild(creator_version);
-
-        QDomElement creator_version_version_major = doc.createElement("VersionMajor");
-        text = doc.createTextNode("3");
-        creator_version_version_major.appendChild(text);
-        creator_version.appendChild(creator_version_version_major);
-
-        QDomElement creator_version_version_minor = doc.createElement("VersionMinor");
-        text = doc.createTextNode("0");
-        creator_version_version_minor.appendChild(text);
-        creator_version.appendChild(creator_version_version_minor);
-
-        QDomElement creator_version_build_major = doc.createElement("BuildMajor");
-        text = doc.createTextNode("0");
-        creator_version_build_major.appendChild(text);
-        creator_version.appendChild(creator_version_build_major);
-
-        QDomElement creator_version_build_minor = doc.createElement("BuildMinor");
-        text = doc.createTextNode("0");
-        creator_version_build_minor.appendChild(text);
-        creator_version.appendChild(creator_version_build_minor);
-
-        // Author - Application
-        QDomElement author = doc.createElement("Author");
-        author.setAttribute("xsi:type", "Application_t");
-        tcx.appendChild(author);
-
-        QDomElement author_name = doc.createElement("Name");
-        text = doc.createTextNode("GoldenCheetah");
-        author_name.appendChild(text);
-        author.appendChild(author_name);
-
-        QDomElement author_build = doc.createElement("Build");
-        author.appendChild(author_build);
-
-        QDomElement author_version = doc.createElement("Version");
-        author_build.appendChild(author_version);
-
-        QDomElement author_version_version_major = doc.createElement("VersionMajor");
-        text = doc.createTextNode("3");
-        author_version_version_major.appendChild(text);
-        author_version.appendChild(author_version_version_major);
-
-        QDomElement author_version_version_minor = doc.createElement("VersionMinor");
-        text = doc.createTextNode("0");
-        author_version_version_minor.appendChild(text);
-        author_version.appendChild(author_version_version_minor);
-
-        QDomElement author_version_build_major = doc.createElement("BuildMajor");
-        text = doc.createTextNode("0");
-        author_version_build_major.appendChild(text);
-        author_version.appendChild(author_version_build_major);
-
-        QDomElement author_version_build_minor = doc.createElement("BuildMinor");
-        text = doc.createTextNode("0");
-        author_version_build_minor.appendChild(text);
-        author_version.appendChild(author_version_build_minor);
-
-        QDomElement author_type = doc.createElement("Type");
-        text = doc.createTextNode("Beta"); // was GC_VERSION but should be Interna | Alpha | Beta | Release
-        author_type.appendChild(text);
-        author_build.appendChild(author_type);
-
-        QDomElement author_lang = doc.createElement("LangID");
-        QVariant lang = appsettings->value(NULL, GC_LANG, QLocale::system().name());
-        text = doc.createTextNode(lang.toString());
-        author_lang.appendChild(text);
-        author.appendChild(author_lang);
-
-        QDomElement author_part_number = doc.createElement("PartNumber");
-        text = doc.createTextNode("000-00000-00");
-        author_part_number.appendChild(text);
-        author.appendChild(author_part_number);
-    }
-#endif
+    xml.writeEndDocument(); // closes Lap, Activity, Activities and TrainingCenterDatabase
+}
 
-    return doc.toByteArray(4);
+QByteArray
+TcxFileReader::toByteArray(Context *context, const RideFile *ride, bool withAlt, bool withWatts, bool withHr, bool withCad) const
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    QXmlStreamWriter xml(&buffer);
+    write(xml, context, ride, withAlt, withWatts, withHr, withCad);
+    return data;
 }
 
 bool
 TcxFileReader::writeRideFile(Context *context, const RideFile *ride, QFile &file) const
 {
-    QByteArray xml = toByteArray(context, ride, true, true, true, true);
-
     if (!file.open(QIODevice::WriteOnly)) return(false);
     file.resize(0);
-    QTextStream out(&file);
-    out.setCodec("UTF-8");
-    out.setGenerateByteOrderMark(true);
-    out << xml;
-    out.flush();
+    file.write("\xEF\xBB\xBF"); // utf-8 byte order mark
+
+    QXmlStreamWriter xml(&file);
+    xml.setCodec("UTF-8");
+    write(xml, context, ride, true, true, true, true);
+    bool success = !xml.hasError();
     file.close();
-    return(true);
+    return success;
 }
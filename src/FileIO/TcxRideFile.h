@@ -23,6 +23,8 @@
 
 #include "RideFile.h"
 
+class QXmlStreamWriter;
+
 class TcxFileReader : public RideFileReader {
     Q_DECLARE_TR_FUNCTIONS(TcxFileReader)
     public:
@@ -31,6 +33,11 @@ class TcxFileReader : public RideFileReader {
     QByteArray toByteArray(Context *context, const RideFile *ride, bool withAlt, bool withWatts, bool withHr, bool withCad) const;
     bool writeRideFile(Context *context, const RideFile *ride, QFile &file) const;
     bool hasWrite() const { return true; }
+    bool hasScan() const { return true; }
+    bool scanRideFile(QFile &file, RideFileSummary &summary, QStringList &errors) const;
+
+    private:
+    void write(QXmlStreamWriter &xml, Context *context, const RideFile *ride, bool withAlt, bool withWatts, bool withHr, bool withCad) const;
 };
 
 #endif // _TcxRideFile_h
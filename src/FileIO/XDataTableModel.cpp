@@ -90,7 +90,7 @@ XDataTableModel::data(const QModelIndex & index, int role) const
         case 1: // distance
            return series->datapoints[index.row()]->km;
         default:
-        return series->datapoints[index.row()]->number[index.column()-2];
+        return series->value(index.row(), index.column()-2);
         }
     }
 }
@@ -222,7 +222,7 @@ XDataTableModel::setValue(int row, int column, double value)
 double
 XDataTableModel::getValue(int row, int column)
 {
-    return series->datapoints[row]->number[column];
+    return series->value(row, column);
 }
 
 void
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "XmlStreamParser.h"
+#include <QXmlStreamReader>
+#include <QXmlAttributes>
+
+bool
+XmlStreamParser::parse(QIODevice &device, QXmlDefaultHandler &handler, QString *error)
+{
+    bool opened = false;
+    if (!device.isOpen()) {
+        if (!device.open(QIODevice::ReadOnly)) {
+            if (error) *error = device.errorString();
+            return false;
+        }
+        opened = true;
+    }
+
+    QXmlStreamReader xml(&device);
+    bool ok = handler.startDocument();
+
+    while (ok && !xml.atEnd()) {
+
+        switch (xml.readNext()) {
+
+        case QXmlStreamReader::StartElement:
+            {
+                QXmlAttributes attributes;
+                foreach(const QXmlStreamAttribute &attribute, xml.attributes()) {
+                    attributes.append(attribute.qualifiedName().toString(), attribute.namespaceUri().toString(),
+                                      attribute.name().toString(), attribute.value().toString());
+                }
+                ok = handler.startElement(xml.namespaceUri().toString(), xml.name().toString(),
+                                          xml.qualifiedName().toString(), attributes);
+            }
+            break;
+
+        case QXmlStreamReader::EndElement:
+            ok = handler.endElement(xml.namespaceUri().toString(), xml.name().toString(),
+                                    xml.qualifiedName().toString());
+            break;
+
+        case QXmlStreamReader::Characters:
+            // whitespace and CDATA included, as QXmlSimpleReader does
+            ok = handler.characters(xml.text().toString());
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if (xml.hasError()) {
+        if (error) *error = QString("%1 at line %2").arg(xml.errorString()).arg(xml.lineNumber());
+        ok = false;
+    } else if (ok) {
+        ok = handler.endDocument();
+        if (!ok && error) *error = handler.errorString();
+    } else if (error) {
+        *error = handler.errorString();
+    }
+
+    if (opened) device.close();
+    return ok;
+}
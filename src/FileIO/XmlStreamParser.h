@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _XmlStreamParser_h
+#define _XmlStreamParser_h
+#include "GoldenCheetah.h"
+
+#include <QIODevice>
+#include <QXmlDefaultHandler>
+#include <QString>
+
+// Drives an existing SAX style handler (TcxParser, GpxParser, FitlogParser)
+// from a QXmlStreamReader instead of QXmlSimpleReader. The pull parser is
+// a good deal faster and doesn't buffer the whole document, so the handlers
+// see the same callbacks in the same order while trackpoints go straight
+// into the ride as they are read.
+//
+// Namespace declarations are not passed as attributes and the qualified
+// names are as written in the file, just as QXmlSimpleReader reports them.
+class XmlStreamParser
+{
+    public:
+
+        // returns false if the document is malformed or the handler stopped,
+        // whatever was handled before then is left in place
+        static bool parse(QIODevice &device, QXmlDefaultHandler &handler, QString *error = NULL);
+};
+
+#endif
@@ -25,6 +25,9 @@
 #include "RideCache.h"
 #include "HelpWhatsThis.h"
 #include "CsvRideFile.h"
+#include "RideExporter.h"
+
+#include <QEventLoop>
 
 BatchExportDialog::BatchExportDialog(Context *context) : QDialog(context->mainWindow), context(context)
 {
@@ -135,6 +138,7 @@ BatchExportDialog::BatchExportDialog(Context *context) : QDialog(context->mainWi
     layout->addLayout(buttons);
 
     exports = fails = 0;
+    exporter = NULL;
 
     // connect signals and slots up..
     connect(selectDir, SIGNAL(clicked()), this, SLOT(selectClicked()));
@@ -188,6 +192,7 @@ BatchExportDialog::okClicked()
 
     } else if (ok->text() == "Abort" || ok->text() == tr("Abort")) {
         aborted = true;
+        if (exporter) exporter->cancel();
     } else if (ok->text() == "Finish" || ok->text() == tr("Finish")) {
         accept(); // our work is done!
     }
@@ -205,28 +210,27 @@ BatchExportDialog::exportFiles()
     // what format to export as?
     QString type = format->currentIndex() > 0 ? RideFileFactory::instance().writeSuffixes().at(format->currentIndex()-1) : "csv";
 
+    // files are exported in parallel, so check what needs
+    // exporting first and then follow along as they complete
+    RideExporter exporter(context);
+    connect(&exporter, SIGNAL(progress(int,QString)), this, SLOT(exportProgress(int,QString)));
+    connect(&exporter, SIGNAL(exported(int,bool,QString)), this, SLOT(exported(int,bool,QString)));
+    exporting.clear();
+
     // loop through the table and export all selected
     for(int i=0; i<files->invisibleRootItem()->childCount(); i++) {
 
-        // give user a chance to abort..
-        QApplication::processEvents();
-
-        // did they?
-        if (aborted == true) return; // user aborted!
-
         QTreeWidgetItem *current = files->invisibleRootItem()->child(i);
 
         // is it selected
         if (static_cast<QCheckBox*>(files->itemWidget(current,0))->isChecked()) {
 
-            files->setCurrentItem(current); QApplication::processEvents();
-
             QString filename = dirName->text() + "/" + QFileInfo(current->text(1)).baseName() + "." + type;
 
             if (QFile(filename).exists()) {
                 if (overwrite->isChecked() == false) {
                     // skip existing files
-                    current->setText(4, tr("Exists - not exported")); QApplication::processEvents();
+                    current->setText(4, tr("Exists - not exported"));
                     fails++;
                     continue;
 
@@ -234,50 +238,41 @@ BatchExportDialog::exportFiles()
 
                     // remove existing
                     QFile(filename).remove();
-                    current->setText(4, tr("Removing...")); QApplication::processEvents();
                 }
 
             }
             // this one then
-            current->setText(4, tr("Reading...")); QApplication::processEvents();
-
-            // open it..
-            QStringList errors;
-            QList<RideFile*> rides;
-            QFile thisfile(QString(context->athlete->home->activities().absolutePath()+"/"+current->text(1)));
-            RideFile *ride = RideFileFactory::instance().openRideFile(context, thisfile, errors, &rides);
-
-            // open success?
-            if (ride) {
-
-
-                current->setText(4, tr("Writing...")); QApplication::processEvents();
-                QFile out(filename);
-
-                bool success = false;
-                if (format->currentIndex() > 0)
-                    success = RideFileFactory::instance().writeRideFile(context, ride, out, type);
-                else {
-                    CsvFileReader writer;
-                    success = writer.writeRideFile(context, ride, out, CsvFileReader::gc);
-                }
+            current->setText(4, tr("Queued"));
+            exporting.insert(exporter.add(context->athlete->home->activities().absolutePath()+"/"+current->text(1), filename, type), current);
+        }
+    }
 
-                if (success) {
-                    exports++;
-                    current->setText(4, tr("Exported")); QApplication::processEvents();
-                } else {
-                    fails++;
-                    current->setText(4, tr("Write failed")); QApplication::processEvents();
-                }
+    // wait for them all, abort drops those not started yet
+    QEventLoop loop;
+    connect(&exporter, SIGNAL(finished()), &loop, SLOT(quit()));
+    this->exporter = &exporter;
+    exporter.start();
+    loop.exec();
+    this->exporter = NULL;
+}
 
-                delete ride; // free memory!
+void
+BatchExportDialog::exportProgress(int index, QString status)
+{
+    QTreeWidgetItem *current = exporting.value(index);
+    if (current == NULL) return;
 
-            // open failed
-            } else {
+    files->setCurrentItem(current);
+    current->setText(4, status);
+}
 
-                current->setText(4, tr("Read error")); QApplication::processEvents();
+void
+BatchExportDialog::exported(int index, bool success, QString status)
+{
+    QTreeWidgetItem *current = exporting.value(index);
+    if (current == NULL) return;
 
-            }
-        }
-    }
+    if (success) exports++;
+    else fails++;
+    current->setText(4, status);
 }
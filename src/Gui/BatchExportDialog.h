@@ -31,12 +31,15 @@
 #include <QTreeWidget>
 #include <QProgressBar>
 #include <QList>
+#include <QMap>
 #include <QFileDialog>
 #include <QCheckBox>
 #include <QLabel>
 #include <QListIterator>
 #include <QDebug>
 
+class RideExporter;
+
 // Dialog class to show filenames, import progress and to capture user input
 // of ride date and time
 
@@ -58,6 +61,8 @@ private slots:
     void okClicked();
     void selectClicked();
     void exportFiles();
+    void exportProgress(int index, QString status);
+    void exported(int index, bool success, QString status);
     void allClicked();
 
 private:
@@ -77,6 +82,9 @@ private:
 
     int exports, fails;
     QLabel *status;
+
+    RideExporter *exporter; // whilst exporting
+    QMap<int, QTreeWidgetItem*> exporting; // exporter index to row
 };
 #endif // _BatchExportDialog_h
 
@@ -60,6 +60,7 @@
 #include "EstimateCPDialog.h"
 #include "SolveCPDialog.h"
 #include "ToolsRhoEstimator.h"
+#include "RideResidency.h"
 #include "VDOTCalculator.h"
 #include "SplitActivityWizard.h"
 #include "MergeActivityWizard.h"
@@ -500,6 +501,7 @@ MainWindow::MainWindow(const QDir &home)
 
     optionsMenu->addAction(tr("Create Heat Map..."), this, SLOT(generateHeatMap()), tr(""));
     optionsMenu->addAction(tr("Export Metrics as CSV..."), this, SLOT(exportMetrics()), tr(""));
+    optionsMenu->addAction(tr("Resident Activities..."), this, SLOT(showResidency()));
 
 #ifdef GC_HAS_CLOUD_DB
     // CloudDB options
@@ -1075,6 +1077,12 @@ void MainWindow::showRhoEstimator()
    tre->show();
 }
 
+void MainWindow::showResidency()
+{
+   RideResidencyDialog *residency = new RideResidencyDialog(currentTab->context);
+   residency->show();
+}
+
 void MainWindow::showVDOTCalculator()
 {
    VDOTCalculator *VDOTcalculator = new VDOTCalculator();
@@ -1947,14 +1955,23 @@ MainWindow::setBackupAthleteMenu()
         backupMapper->setMapping(action, name);
     }
 
+    // and getting it back
+    backupAthleteMenu->addSeparator();
+    backupAthleteMenu->addAction(tr("Restore Backup..."), this, SLOT(restoreAthlete()));
 }
 
 void
 MainWindow::backupAthlete(QString name)
 {
+    // runs in the background and deletes itself when done
     AthleteBackup *backup = new AthleteBackup(QDir(gcroot+"/"+name));
     backup->backupImmediate();
-    delete backup;
+}
+
+void
+MainWindow::restoreAthlete()
+{
+    AthleteBackup::restoreImmediate();
 }
 
 void
@@ -152,6 +152,7 @@ class MainWindow : public QMainWindow
         // Athlete Backup
         void setBackupAthleteMenu();
         void backupAthlete(QString name);
+        void restoreAthlete();
 
         // Search / Filter
         void setFilter(QStringList);
@@ -192,6 +193,7 @@ class MainWindow : public QMainWindow
         void showEstimateCP();
         void showSolveCP();
         void showRhoEstimator();
+        void showResidency();
         void showVDOTCalculator();
 
         // Training View
@@ -25,6 +25,9 @@
 #include "HelpWhatsThis.h"
 #include "LocationInterpolation.h"
 
+#include <complex>
+#include <vector>
+
 // minimum R-squared fit when trying to find offsets to
 // merge ride files. Lower numbers mean happier to take
 // and answer that is less likely to be correct, but then
@@ -35,6 +38,105 @@
 // We always use the best fit anyway, this is just to
 // decide what to discard as not valuable
 static const double MINIMUM_R2_FIT = 0.75f; 
+
+// when voting, series whose best offsets are this
+// many samples apart or less are counted as agreeing
+static const int VOTE_TOLERANCE = 2;
+
+// in-place iterative radix-2 FFT, size must be a power of 2
+static void
+fft(std::vector<std::complex<double> > &data, bool inverse)
+{
+    const int n = data.size();
+
+    // bit reversal permutation
+    for (int i=1, j=0; i<n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(data[i], data[j]);
+    }
+
+    // butterflies
+    for (int len=2; len <= n; len <<= 1) {
+        double angle = 2 * M_PI / len * (inverse ? 1 : -1);
+        std::complex<double> wlen(cos(angle), sin(angle));
+        for (int i=0; i<n; i += len) {
+            std::complex<double> w(1);
+            for (int j=0; j < len/2; j++) {
+                std::complex<double> u = data[i+j];
+                std::complex<double> v = data[i+j+len/2] * w;
+                data[i+j] = u + v;
+                data[i+j+len/2] = u - v;
+                w *= wlen;
+            }
+        }
+    }
+
+    if (inverse) for (int i=0; i<n; i++) data[i] /= n;
+}
+
+// The R2 fit of fit[i] against base[i+offset] over the samples where
+// they overlap, for every offset in [-maxoffset, maxoffset). The sum of
+// products comes from a cross correlation via the FFT and the other sums
+// from running totals, so its O(n log n) rather than O(n) per offset.
+static void
+fitOffsets(const QVector<double> &base, const QVector<double> &fit, int maxoffset, QVector<double> &R2)
+{
+    const int nb = base.count();
+    const int nf = fit.count();
+    R2.fill(0, 2 * maxoffset);
+    if (nb < 2 || nf < 2) return;
+
+    // shift both by the same amount, the residuals are unchanged and
+    // the sums stay small so the FFT doesn't lose precision
+    double shift = 0;
+    foreach(double v, base) shift += v;
+    shift /= nb;
+
+    int size = 1;
+    while (size < nb + nf) size <<= 1;
+
+    std::vector<std::complex<double> > a(size), b(size);
+    for (int i=0; i<nb; i++) a[i] = base[i] - shift;
+    for (int i=0; i<nf; i++) b[i] = fit[i] - shift;
+
+    // sum over i of a[i+offset] * b[i], negative offsets wrap to the end
+    fft(a, false);
+    fft(b, false);
+    for (int i=0; i<size; i++) a[i] *= std::conj(b[i]);
+    fft(a, true);
+
+    // running totals
+    QVector<double> sa(nb+1, 0), saa(nb+1, 0), sbb(nf+1, 0);
+    for (int i=0; i<nb; i++) {
+        double v = base[i] - shift;
+        sa[i+1] = sa[i] + v;
+        saa[i+1] = saa[i] + v*v;
+    }
+    for (int i=0; i<nf; i++) {
+        double v = fit[i] - shift;
+        sbb[i+1] = sbb[i] + v*v;
+    }
+
+    for (int offset=-maxoffset; offset<maxoffset; offset++) {
+
+        // fit[from..to) overlaps base[from+offset..to+offset)
+        int from = qMax(0, -offset);
+        int to = qMin(nf, nb - offset);
+        int n = to - from;
+        if (n < 2) continue;
+
+        double sab = a[offset < 0 ? size + offset : offset].real();
+        double SA = sa[to+offset] - sa[from+offset];
+        double SAA = saa[to+offset] - saa[from+offset];
+        double SBB = sbb[to] - sbb[from];
+
+        double SSres = SAA - 2*sab + SBB;
+        double SStot = SAA - (SA*SA)/n;
+        if (SStot > 0) R2[offset + maxoffset] = 1.0f - (SSres/SStot);
+    }
+}
 /*----------------------------------------------------------------------
  *
  * Page Flow Summary
@@ -84,6 +186,10 @@ MergeActivityWizard::MergeActivityWizard(Context *context) : QWizard(context->ma
     // and merge on device clocks
     mode = 0;
     strategy = 0;
+    vote = true;
+    fitQuality = -1;
+    fitSeries = RideFile::none;
+    fitVotes = fitCandidates = 0;
 
     // 5 step process, although Conflict may be skipped
     setPage(10, new MergeWelcome(this));
@@ -124,6 +230,7 @@ MergeActivityWizard::analyse()
     // looking at the parameters determine the offset
     // default to align left if all else fails !
     offset1 = offset2 = 0;
+    fitQuality = -1;
 
     switch(strategy) {
 
@@ -155,10 +262,8 @@ MergeActivityWizard::analyse()
             break;
 
     case 1: // align on shared series
-            // using a shotgun algorithm
+            // using the R2 fit at every offset
     {
-            // calculate the R2 fit using the current offset
-            // for the first shared series
             RideFile *base = ride1;
             RideFile *fit = ride2;
 
@@ -172,9 +277,13 @@ MergeActivityWizard::analyse()
                 fit=ride2;
             }
 
-            double bestFit=0.0;
-            int offsetFit=0;
-            RideFile::SeriesType bestSeries=RideFile::none;
+            // no more than shifting by a third of the ride backwards or forwards
+            int maxoffset = base->dataPoints().count()/3;
+
+            // best offset for each shared series
+            QList<RideFile::SeriesType> series;
+            QList<int> offsets;
+            QList<double> fits;
 
             QMapIterator<RideFile::SeriesType, QCheckBox *> i(rightSeries);
             while(i.hasNext()) {
@@ -184,51 +293,67 @@ MergeActivityWizard::analyse()
                     // for each shared series look for best fit
                     RideFile::SeriesType shared = i.key();
 
-                    double bestR2 = 0.0f;
-                    int bestOffset = 0;
-
-                    // no more than shifting by a third of the ride backwards or forwards
-                    for(int offset=-1 * (base->dataPoints().count()/3); 
-                            offset<base->dataPoints().count()/3; 
-                            offset++) {
+                    // the working copies are already resampled
+                    // so the samples are evenly spaced
+                    QVector<double> b, f;
+                    b.reserve(base->dataPoints().count());
+                    f.reserve(fit->dataPoints().count());
+                    foreach(RideFilePoint *p, base->dataPoints()) b << p->value(shared);
+                    foreach(RideFilePoint *p, fit->dataPoints()) f << p->value(shared);
 
-                        double SStot=0.0f, SSres=0.0f;
-                        double mean =0.0f;
-                        int count=0;
+                    QVector<double> R2;
+                    fitOffsets(b, f, maxoffset, R2);
 
-                        for(int i=0; (i+offset)<base->dataPoints().count(); i++) {
-                            if ((i+offset)>0) {
-                                mean += base->dataPoints()[i+offset]->value(shared);
-                            }
-                            count++;
-                        }
-                        mean /= double(count);
-                
-                        for(int i=0; (i+offset)<base->dataPoints().count() && i<fit->dataPoints().count(); i++) {
-                            if((i+offset)>0) {
-                                SSres += pow(base->dataPoints()[i+offset]->value(shared) - fit->dataPoints()[i]->value(shared), 2);
-                                SStot += pow(base->dataPoints()[i+offset]->value(shared) - mean, 2);
-                            }
+                    double bestR2 = 0.0f;
+                    int bestOffset = 0;
+                    for(int k=0; k<R2.count(); k++) {
+                        if (R2[k] > bestR2) {
+                            bestR2 = R2[k];
+                            bestOffset = k - maxoffset;
                         }
+                    }
+
+                    series << shared;
+                    offsets << bestOffset;
+                    fits << bestR2;
+                    //qDebug()<<"best R2="<<bestR2<<"at best offset"<<bestOffset<<"with series"<<fit->seriesName(shared);
+                }
+            }
 
-                        double R2= 1.0f - (SSres/SStot);
-                        if (R2 > bestR2) {
-                            bestR2= R2;
-                            bestOffset=offset;
+            // pick the best fit, or when voting the best fit of
+            // the offset most of the good fits agree on
+            double bestFit=0.0;
+            int offsetFit=0;
+            double bestVotes=0.0;
+            fitSeries = RideFile::none;
+            fitVotes = 0;
+            fitCandidates = 0;
+
+            for(int k=0; k<series.count(); k++) {
+                if (fits[k] > MINIMUM_R2_FIT) fitCandidates++;
+
+                int votes=0;
+                double weight=0.0;
+                if (vote && fits[k] > MINIMUM_R2_FIT) {
+                    for(int j=0; j<series.count(); j++) {
+                        if (fits[j] > MINIMUM_R2_FIT && abs(offsets[j] - offsets[k]) <= VOTE_TOLERANCE) {
+                            votes++;
+                            weight += fits[j];
                         }
                     }
+                }
 
-                    // is this a better fit ?
-                    if (bestR2 > bestFit) {
-                        bestFit=bestR2;
-                        offsetFit=bestOffset;
-                        bestSeries=shared;
-                        Q_UNUSED(bestSeries); // shutup compiler when qDebugs commented out below
-                    }
-                    //qDebug()<<"best R2="<<bestR2<<"at best offset"<<bestOffset<<"with series"<<fit->seriesName(shared);
+                // is this a better fit ?
+                if (weight > bestVotes || (weight == bestVotes && fits[k] > bestFit)) {
+                    bestVotes=weight;
+                    bestFit=fits[k];
+                    offsetFit=offsets[k];
+                    fitSeries=series[k];
+                    fitVotes=votes;
                 }
             }
-            //qDebug()<<"THEREFORE: best R2="<<bestFit<<"at best offset"<<offsetFit<<"with series"<<ride1->seriesName(bestSeries);
+            fitQuality = bestFit;
+            //qDebug()<<"THEREFORE: best R2="<<bestFit<<"at best offset"<<offsetFit<<"with series"<<ride1->seriesName(fitSeries);
 
             // so lets turn that into an offset for ride1 and ride2
             if (bestFit > MINIMUM_R2_FIT) {
@@ -465,8 +590,8 @@ MergeActivityWizard::combine()
                     pt->secs = point->secs + timeOffset;
                     pt->km = point->km + distanceOffset;
                     for (int i=0; i<indexMap.count(); i++) {
-                        pt->number[i] = point->number[indexMap[i]];
-                        pt->string[i] = point->string[indexMap[i]];
+                        pt->number[i] = point->number.at(indexMap[i]);
+                        if (indexMap[i] < point->string.count()) pt->string[i] = point->string.at(indexMap[i]);
                     }
                     combined->xdata(xdata->name)->datapoints.append(pt);
                 }
@@ -1012,6 +1137,10 @@ MergeStrategy::MergeStrategy(MergeActivityWizard *parent) : QWizardPage(parent),
     mapper->setMapping(shared, "shared");
     layout->addWidget(shared);
 
+    vote = new QCheckBox(tr("Use the offset most shared data series agree on"), this);
+    vote->setChecked(wizard->vote);
+    layout->addWidget(vote);
+
     // start at same time
     p = new QCommandLinkButton(tr("Align starting together"), 
                                 tr("Regardless of the timestamp on the activity, align with both "
@@ -1053,6 +1182,7 @@ MergeStrategy::initializePage()
             hasShared = true;
     }
     shared->setEnabled(hasShared);
+    vote->setEnabled(hasShared);
 }
    
 
@@ -1068,6 +1198,7 @@ MergeStrategy::clicked(QString p)
     } else if (p == "shared" ) {
         // where to next ?
         wizard->strategy = 1; // merge ...
+        wizard->vote = vote->isChecked();
     } else if (p == "left" ) {
         wizard->strategy = 2; // merge ...
     } else if (p == "right" ) {
@@ -1128,6 +1259,8 @@ MergeAdjust::MergeAdjust(MergeActivityWizard *parent) : QWizardPage(parent), wiz
 
     layout->addWidget(spanSlider);
     layout->addWidget(fullPlot);
+    qualityLabel = new QLabel("", this);
+    layout->addWidget(qualityLabel);
     layout->addStretch();
 
     QLabel *adjust = new QLabel(tr("Adjust:"));
@@ -1157,6 +1290,21 @@ MergeAdjust::initializePage()
     offset1 = wizard->offset1;
     offset2 = wizard->offset2;
 
+    // how good was the fit we started from
+    if (wizard->strategy == 1 && wizard->fitQuality >= 0) {
+        QString quality = QString(wizard->fitQuality > MINIMUM_R2_FIT ?
+                                  tr("Aligned on %1 with an R-squared fit of %2") :
+                                  tr("No good fit found, best was %1 with an R-squared fit of %2"))
+                          .arg(RideFile::seriesName(wizard->fitSeries))
+                          .arg(wizard->fitQuality, 0, 'f', 3);
+        if (wizard->vote && wizard->fitCandidates > 1)
+            quality += QString(tr(", %1 of %2 series agree")).arg(wizard->fitVotes).arg(wizard->fitCandidates);
+        qualityLabel->setText(quality);
+        qualityLabel->show();
+    } else {
+        qualityLabel->hide();
+    }
+
     // setup plot
     fullPlot->setDataFromRide(wizard->combinedItem, QList<UserData*>());
     spanSlider->setMinimum(0);
@@ -83,6 +83,12 @@ class MergeActivityWizard : public QWizard
         // method for combining
         int mode; // 0 = merge, 1 = join
         int strategy; // 0=clock, 1=shared, 2=start, 3=end, 4=distance
+        bool vote; // shared: use the offset most series agree on
+
+        // how well the shared series fit, R2 or -1 if not used
+        double fitQuality;
+        RideFile::SeriesType fitSeries;
+        int fitVotes, fitCandidates;
 
         // recording interval to use
         double recIntSecs;
@@ -244,6 +250,7 @@ class MergeStrategy : public QWizardPage
         QLabel *label;
         int next;
         QCommandLinkButton *shared;
+        QCheckBox *vote;
 };
 
 class MergeAdjust : public QWizardPage
@@ -260,6 +267,7 @@ class MergeAdjust : public QWizardPage
         AllPlot *fullPlot;
         QxtSpanSlider *spanSlider;
 
+        QLabel *qualityLabel;
         QSlider *adjustSlider;
         QLabel *offsetLabel;
         QPushButton *reset;
@@ -926,6 +926,14 @@ BackupPage::BackupPage(Context *context) : context(context)
     grid->addWidget(autoBackupPeriodLabel, 8, 0,alignment);
     grid->addLayout(backupInput, 8, 1, alignment);
 
+    // only what changed, and whether to bother with the cache
+    autoBackupIncremental = new QCheckBox(tr("Only back up files changed since the last backup to the same folder"), this);
+    autoBackupIncremental->setChecked(appsettings->cvalue(context->athlete->cyclist, GC_AUTOBACKUP_INCREMENTAL, false).toBool());
+    autoBackupCache = new QCheckBox(tr("Include the cache, which can be regenerated but makes a restore quicker"), this);
+    autoBackupCache->setChecked(appsettings->cvalue(context->athlete->cyclist, GC_AUTOBACKUP_CACHE, false).toBool());
+    grid->addWidget(autoBackupIncremental, 9, 1, alignment);
+    grid->addWidget(autoBackupCache, 10, 1, alignment);
+
     all->addLayout(grid);
     all->addStretch();
 }
@@ -947,6 +955,8 @@ BackupPage::saveClicked()
     // Auto Backup
     appsettings->setCValue(context->athlete->cyclist, GC_AUTOBACKUP_FOLDER, autoBackupFolder->text());
     appsettings->setCValue(context->athlete->cyclist, GC_AUTOBACKUP_PERIOD, autoBackupPeriod->value());
+    appsettings->setCValue(context->athlete->cyclist, GC_AUTOBACKUP_INCREMENTAL, autoBackupIncremental->isChecked());
+    appsettings->setCValue(context->athlete->cyclist, GC_AUTOBACKUP_CACHE, autoBackupCache->isChecked());
     return 0;
 }
 
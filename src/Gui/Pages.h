@@ -341,6 +341,8 @@ class BackupPage : public QWidget
         QSpinBox *autoBackupPeriod;
         QLineEdit *autoBackupFolder;
         QPushButton *autoBackupFolderBrowse;
+        QCheckBox *autoBackupIncremental;
+        QCheckBox *autoBackupCache;
 
     private slots:
 
@@ -38,10 +38,12 @@
 #include "TcxRideFile.h" // for opening multi-ride file
 #include "DataProcessor.h"
 #include "RideMetadata.h" // for linked defaults processing
+#include "RideImportPipeline.h"
 
 #include <QDebug>
 #include <QWaitCondition>
 #include <QMessageBox>
+#include <QSet>
 
 enum WizardTable {
     FILENAME_COLUMN = 0,
@@ -249,6 +251,9 @@ RideImportWizard::init(QList<QString> original, Context * /*mainWindow*/)
     //                                     before we close.
     QList<QString> files = expandFiles(original);
 
+    // parses and saves the files in parallel
+    pipeline = new RideImportPipeline(context, this);
+
     // setup Help
     HelpWhatsThis *help = new HelpWhatsThis(this);
     this->setWhatsThis(help->getWhatsThisText(HelpWhatsThis::MenuBar_Activity_Import));
@@ -532,16 +537,22 @@ RideImportWizard::process()
     repaint();
     QApplication::processEvents();
 
-    // Pass 2 - Read in with the relevant RideFileReader method
+    // Pass 2 - Read in with the relevant RideFileReader method, the files
+    //          are all parsed in parallel and we collect them in order
 
     phaseLabel->setText(tr("Step 2 of 4: Validating Files"));
+    QList<int> tickets;
+    for (int i=0; i< filenames.count(); i++) {
+        if (tableWidget->item(i,STATUS_COLUMN)->text().startsWith(tr("Error"))) tickets << -1;
+        else tickets << pipeline->submit(RideImportJobPtr(new RideImportJob(filenames[i], RideImportJob::Parse)));
+    }
+
    for (int i=0; i< filenames.count(); i++) {
 
 
         // does the status say Queued?
-        if (!tableWidget->item(i,STATUS_COLUMN)->text().startsWith(tr("Error"))) {
+        if (tickets[i] >= 0) {
 
-              QStringList errors;
               QFile thisfile(filenames[i]);
 
               tableWidget->item(i,STATUS_COLUMN)->setText(tr("Parsing..."));
@@ -552,8 +563,13 @@ RideImportWizard::process()
               this->repaint();
               QApplication::processEvents();
 
-              QList<RideFile*> rides;
-              RideFile *ride = RideFileFactory::instance().openRideFile(context, thisfile, errors, &rides);
+              // the job owns the rides and deletes them when we're done
+              RideImportJobPtr job = pipeline->wait(tickets[i]);
+              if (aborted) { done(0); return 0; }
+
+              QStringList &errors = job->errors;
+              QList<RideFile*> &rides = job->rides;
+              RideFile *ride = job->ride;
 
               // is this an archive of files?
               if (rides.count() > 1) {
@@ -563,6 +579,7 @@ RideImportWizard::process()
                  // remove current filename from state arrays and tableview
                  filenames.removeAt(here);
                  blanks.removeAt(here);
+                 tickets.removeAt(here);
                  tableWidget->removeRow(here);
 
                  // resize dialog according to the number of rows we expect
@@ -584,11 +601,11 @@ RideImportWizard::process()
                      QFile target(fulltarget);
                      reader.writeRideFile(context, extracted, target);
                      deleteMe.append(fulltarget);
-                     delete extracted;
-                     
+
                      // now add each temporary file ...
                      filenames.insert(here, fulltarget);
                      blanks.insert(here, true); // by default editable
+                     tickets.insert(here, pipeline->submit(RideImportJobPtr(new RideImportJob(fulltarget, RideImportJob::Parse))));
                      tableWidget->insertRow(here+counter);
 
                      QTableWidgetItem *t;
@@ -641,8 +658,6 @@ RideImportWizard::process()
                  progressBar->setMaximum(filenames.count()*4);
 
                  // then go back one and re-parse from there
-                 rides.clear();
-   
                  i--;
                  goto next; // buttugly I know, but count em across 100,000 lines of code
 
@@ -705,7 +720,6 @@ RideImportWizard::process()
                    tableWidget->item(i,DISTANCE_COLUMN)->setText(dist);
                    tableWidget->item(i,DISTANCE_COLUMN)->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
 
-                   delete ride;
                } else {
                    // nope - can't handle this file
                    tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - ") + errors.join(tr(";")));
@@ -964,6 +978,7 @@ RideImportWizard::abortClicked()
     if (label == tr("Abort")) {
         hide();
         aborted=true; // terminated. I'll be back.
+        pipeline->cancel();
         return;
     }
 
@@ -1001,16 +1016,20 @@ RideImportWizard::abortClicked()
     QChar zero = QLatin1Char ( '0' );
 
 
-    // Saving now - process the files one-by-one
+    // Saving now - the files are checked and queued one-by-one, then the
+    // parsing, processing and serialising runs in parallel while we add
+    // them to the library in the same order
+    QMap<int,int> tickets; // row to pipeline ticket
+    QMap<int,QString> targets; // row to activities target
+    QSet<QString> queuedTargets; // to spot two files for the same date and time
     for (int i=0; i< filenames.count(); i++) {
 
         if (tableWidget->item(i,STATUS_COLUMN)->text().startsWith(tr("Error"))) continue; // skip errors
 
-        tableWidget->item(i,STATUS_COLUMN)->setText(tr("Saving..."));
+        tableWidget->item(i,STATUS_COLUMN)->setText(tr("Queued"));
         tableWidget->setCurrentCell(i,5);
         QApplication::processEvents();
         if (aborted) { done(0); return; }
-        this->repaint();
 
 
         // SAVE STEP 3 - prepare the new file names for the next steps - basic name and .JSON in GC format
@@ -1031,7 +1050,8 @@ RideImportWizard::abortClicked()
         QString finalActivitiesFulltarget = homeActivities.canonicalPath() + "/" + activitiesTarget;
 
         // check if a ride at this point of time already exists in /activities - if yes, skip import
-        if (QFileInfo(finalActivitiesFulltarget).exists()) { tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - Activity file exists")); continue; }
+        // including one earlier in this import that hasn't been saved yet
+        if (QFileInfo(finalActivitiesFulltarget).exists() || queuedTargets.contains(activitiesTarget)) { tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - Activity file exists")); continue; }
 
         // in addition, also check the RideCache for a Ride with the same point in Time in UTC, which also indicates
         // that there was already a ride imported - reason is that RideCache start time is in UTC, while the file Name is in "localTime"
@@ -1062,41 +1082,47 @@ RideImportWizard::abortClicked()
         }
 
 
-        // SAVE STEP 5 - open the file with the respective format reader and export as .JSON
+        // SAVE STEP 5 - open the file with the respective format reader, run the
+        // import processors and export as .JSON, this is the part that runs in parallel
         // to track if addRideCache() has caused an error due to bad data we work with a interim directory for the activities
         // -- first   export to /tmpactivities
         // -- second  create RideCache() entry
         // -- third   move file from /tmpactivities to /activities
+        RideImportJobPtr job(new RideImportJob(filenames[i], RideImportJob::Parse | RideImportJob::Process | RideImportJob::Serialise));
+        job->startTime = ridedatetime;
+        job->tags.insert("Source Filename", importsTarget);
+        job->tags.insert("Filename", activitiesTarget);
+        job->target = tmpActivitiesFulltarget;
+
+        tickets.insert(i, pipeline->submit(job));
+        targets.insert(i, activitiesTarget);
+        queuedTargets.insert(activitiesTarget);
+    }
 
-        // serialize the file to .JSON
-        QStringList errors;
-        QFile thisfile(filenames[i]);
-        RideFile *ride(RideFileFactory::instance().openRideFile(context, thisfile, errors));
+    for (int i=0; i< filenames.count(); i++) {
 
-        // did the input file parse ok ? (should be fine here - since it was alrady checked before - but just in case)
-        if (ride) {
+        if (!tickets.contains(i)) continue; // skip errors
 
-            // update ridedatetime and set the Source File name
-            ride->setStartTime(ridedatetime);
-            ride->setTag("Source Filename", importsTarget);
-            ride->setTag("Filename", activitiesTarget);
-            if (errors.count() > 0)
-                ride->setTag("Import errors", errors.join("\n"));
+        tableWidget->item(i,STATUS_COLUMN)->setText(tr("Saving..."));
+        tableWidget->setCurrentCell(i,5);
+        QApplication::processEvents();
+        if (aborted) { done(0); return; }
+        this->repaint();
 
-            // process linked defaults
-            context->athlete->rideMetadata()->setLinkedDefaults(ride);
+        RideImportJobPtr job = pipeline->wait(tickets.value(i));
+        if (aborted) { done(0); return; }
 
-            // run the processor first... import
-            tableWidget->item(i,STATUS_COLUMN)->setText(tr("Processing..."));
-            DataProcessorFactory::instance().autoProcess(ride, "Auto", "Import");
-            ride->recalculateDerivedSeries();
+        QString activitiesTarget = targets.value(i);
+        QString tmpActivitiesFulltarget = tmpActivities.canonicalPath() + "/" + activitiesTarget;
+        QString finalActivitiesFulltarget = homeActivities.canonicalPath() + "/" + activitiesTarget;
 
-            tableWidget->item(i,STATUS_COLUMN)->setText(tr("Saving file..."));
+        // did the input file parse ok ? (should be fine here - since it was alrady checked before - but just in case)
+        if (job->timedout) {
+            tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - ") + job->errors.join(tr(";")));
+
+        } else if (job->ride) {
 
-            // serialize
-            JsonFileReader reader;
-            QFile target(tmpActivitiesFulltarget);
-            if (reader.writeRideFile(context, ride, target)) {
+            if (job->written) {
 
                 // now try adding the Ride to the RideCache - since this may fail due to various reason, the activity file
                 // is stored in tmpActivities during this process to understand which file has create the problem when restarting GC
@@ -1117,16 +1143,14 @@ RideImportWizard::abortClicked()
             }  else {
                 tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - .JSON creation failed"));
             }
+
+            // now metrics have been calculated
+            DataProcessorFactory::instance().autoProcess(job->ride, "Save", "ADD");
+
         } else {
             tableWidget->item(i,STATUS_COLUMN)->setText(tr("Error - Import of activitiy file failed"));
         }
 
-        // now metrics have been calculated
-        DataProcessorFactory::instance().autoProcess(ride, "Save", "ADD");
-
-        // clear
-        delete ride;
-
         QApplication::processEvents();
         if (aborted) { done(0); return; }
         progressBar->setValue(progressBar->value()+1);
@@ -33,6 +33,8 @@
 #include "Context.h"
 #include "RideAutoImportConfig.h"
 
+class RideImportPipeline;
+
 // Dialog class to show filenames, import progress and to capture user input
 // of ride date and time
 
@@ -91,6 +93,7 @@ private:
     // bool overwriteFiles; // flag to overwrite files from checkbox               // deprecate for this release... XXX
     Context *context; // caller
     RideAutoImportConfig *importConfig;
+    RideImportPipeline *pipeline; // parsing and saving in parallel
 
     QStringList deleteMe; // list of temp files created during import
 
@@ -837,10 +837,8 @@ SplitConfirm::createRideFile(long start, long stop)
                 XDataPoint *p = new XDataPoint;
                 p->secs = point->secs - offset;
                 p->km = point->km - distanceoffset;
-                for(int i=0; i<XDATA_MAXVALUES; i++) {
-                    p->number[i] = point->number[i];
-                    p->string[i] = point->string[i];
-                }
+                p->number = point->number;
+                p->string = point->string;
                 xd->datapoints.append(p);
             }
         }
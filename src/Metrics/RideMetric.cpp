@@ -17,6 +17,7 @@
  */
 
 #include "RideMetric.h"
+#include "Trace.h"
 #include "RideItem.h"
 #include "IntervalItem.h"
 #include "Specification.h"
@@ -187,6 +188,8 @@ RideMetric::userMetricFingerprint(QList<UserMetricSettings> these)
 QHash<QString,RideMetricPtr>
 RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList &metrics)
 {
+    GC_TRACE("RideMetric::computeMetrics");
+
     const RideMetricFactory &factory = RideMetricFactory::instance();
 
     // generate worklist from metrics we know
@@ -17,6 +17,7 @@
  */
 
 #include "RideMetric.h"
+#include "Trace.h"
 #include "UserMetricSettings.h"
 #include "DataFilter.h"
 
@@ -196,8 +197,7 @@ UserMetric::isRelevantForRide(const RideItem *item) const
 void
 UserMetric::compute(RideItem *item, Specification spec, const QHash<QString,RideMetric*> &pc)
 {
-    QTime timer;
-    timer.start();
+    GC_TRACE("UserMetric::compute");
 
     //qDebug()<<"CODE";
     if (!root) {
@@ -271,8 +271,6 @@ UserMetric::compute(RideItem *item, Specification spec, const QHash<QString,Ride
         Result n = root->eval(rt, fcount, 0, 0, const_cast<RideItem*>(item), NULL, c, spec);
         setCount(n.number);
     }
-
-    //qDebug()<<symbol()<<index_<<value_<<"ELAPSED="<<timer.elapsed()<<"ms";
 }
 
 
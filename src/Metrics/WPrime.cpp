@@ -498,6 +498,9 @@ WPrime::setErg(ErgFile *input)
 
     minY = maxY = WPRIME;
 
+    // the target each second, compiled with the workout
+    const QVector<double> &power = input->timeline().power();
+
     if (integral) {
 
         last = input->Duration / 1000; 
@@ -513,8 +516,7 @@ WPrime::setErg(ErgFile *input)
         for (int i=0; i<last; i++) {
 
             // get watts at point in time
-            int lap;
-            int value = input->wattsAt(i*1000, lap);
+            int value = i < power.count() ? power[i] : 0;
 
             powerValues[i] = value > CP ? value-CP : 0;
 
@@ -562,11 +564,10 @@ WPrime::setErg(ErgFile *input)
         // input array contains the actual W' expenditure
         // and will also contain non-zero values
         double W = WPRIME;
-        int lap; // passed by reference
         for (int i=0; i<last; i++) {
 
             // get watts at point in time
-            int value = input->wattsAt(i*1000, lap);
+            int value = i < power.count() ? power[i] : 0;
 
             if(value < CP) {
                 W  = W + (CP-value)*(WPRIME-W)/WPRIME;
@@ -22,6 +22,13 @@
 #include <QUrl>
 #include <datetime.h> // for Python datetime macros
 
+// the dicts we return own the values we add
+static void setItem(PyObject *dict, const char *key, PyObject *value)
+{
+    PyDict_SetItemString(dict, key, value);
+    Py_XDECREF(value);
+}
+
 long Bindings::threadid() const
 {
     // Get current thread ID via Python thread functions
@@ -140,25 +147,25 @@ PyObject* Bindings::athlete() const
     if (dict == NULL) return dict;
 
     // NAME
-    PyDict_SetItemString(dict, "name", PyUnicode_FromString(context->athlete->cyclist.toUtf8().constData()));
+    setItem(dict, "name", PyUnicode_FromString(context->athlete->cyclist.toUtf8().constData()));
 
     // HOME
-    PyDict_SetItemString(dict, "home", PyUnicode_FromString(context->athlete->home->root().absolutePath().toUtf8().constData()));
+    setItem(dict, "home", PyUnicode_FromString(context->athlete->home->root().absolutePath().toUtf8().constData()));
 
     // DOB
     if (PyDateTimeAPI == NULL) PyDateTime_IMPORT;// import datetime if necessary
     QDate d = appsettings->cvalue(context->athlete->cyclist, GC_DOB).toDate();
-    PyDict_SetItemString(dict, "dob", PyDate_FromDate(d.year(), d.month(), d.day()));
+    setItem(dict, "dob", PyDate_FromDate(d.year(), d.month(), d.day()));
 
     // WEIGHT
-    PyDict_SetItemString(dict, "weight", PyFloat_FromDouble(appsettings->cvalue(context->athlete->cyclist, GC_WEIGHT).toDouble()));
+    setItem(dict, "weight", PyFloat_FromDouble(appsettings->cvalue(context->athlete->cyclist, GC_WEIGHT).toDouble()));
 
     // HEIGHT
-    PyDict_SetItemString(dict, "height", PyFloat_FromDouble(appsettings->cvalue(context->athlete->cyclist, GC_HEIGHT).toDouble()));
+    setItem(dict, "height", PyFloat_FromDouble(appsettings->cvalue(context->athlete->cyclist, GC_HEIGHT).toDouble()));
 
     // GENDER
     int isfemale = appsettings->cvalue(context->athlete->cyclist, GC_SEX).toInt();
-    PyDict_SetItemString(dict, "gender", PyUnicode_FromString(isfemale ? "female" : "male"));
+    setItem(dict, "gender", PyUnicode_FromString(isfemale ? "female" : "male"));
 
     return dict;
 }
@@ -514,18 +521,18 @@ Bindings::athleteZones(PyObject* date, QString sport) const
     }
 
     // add to dict
-    PyDict_SetItemString(dict, "date", dates);
-    PyDict_SetItemString(dict, "sport", sports);
-    PyDict_SetItemString(dict, "cp", cp);
-    PyDict_SetItemString(dict, "wprime", wprime);
-    PyDict_SetItemString(dict, "pmax", pmax);
-    PyDict_SetItemString(dict, "ftp", ftp);
-    PyDict_SetItemString(dict, "lthr", lthr);
-    PyDict_SetItemString(dict, "rhr", rhr);
-    PyDict_SetItemString(dict, "hrmax", hrmax);
-    PyDict_SetItemString(dict, "cv", cv);
-    PyDict_SetItemString(dict, "zoneslow", zoneslow);
-    PyDict_SetItemString(dict, "zonescolor", zonescolor);
+    setItem(dict, "date", dates);
+    setItem(dict, "sport", sports);
+    setItem(dict, "cp", cp);
+    setItem(dict, "wprime", wprime);
+    setItem(dict, "pmax", pmax);
+    setItem(dict, "ftp", ftp);
+    setItem(dict, "lthr", lthr);
+    setItem(dict, "rhr", rhr);
+    setItem(dict, "hrmax", hrmax);
+    setItem(dict, "cv", cv);
+    setItem(dict, "zoneslow", zoneslow);
+    setItem(dict, "zonescolor", zonescolor);
 
     return dict;
 }
@@ -641,10 +648,9 @@ Bindings::series(int type, PyObject* activity) const
     RideFile *f = selectRideFile(activity);
     if (f == nullptr) return nullptr;
 
-    // count the included points, create data series output and copy data
-    int pCount = 0;
+    // the included points are a contiguous range, so no need to count them
     RideFileIterator it(f, python->contexts.value(threadid()).spec);
-    while (it.hasNext()) { it.next(); pCount++; }
+    int pCount = it.hasNext() ? it.lastIndex() - it.firstIndex() + 1 : 0;
     RideFile::SeriesType seriesType = static_cast<RideFile::SeriesType>(type);
     bool readOnly = python->contexts.value(threadid()).readOnly;
     QList<RideFile *> *editedRideFiles = python->contexts.value(threadid()).editedRideFiles;
@@ -654,10 +660,10 @@ Bindings::series(int type, PyObject* activity) const
     }
 
     PythonDataSeries* ds = new PythonDataSeries(seriesName(type), pCount, readOnly, seriesType, f);
-    it.toFront();
+    double *data = ds->data;
     for(int i=0; i<pCount && it.hasNext(); i++) {
         struct RideFilePoint *point = it.next();
-        ds->data[i] = point->value(seriesType);
+        data[i] = point->value(seriesType);
     }
 
     return ds;
@@ -685,8 +691,7 @@ Bindings::activityWbal(PyObject* activity) const
         if (pCount == 0) idxStart = i;
         pCount++;
     }
-    PythonDataSeries* ds = new PythonDataSeries("WBal", pCount);
-    for(int i=0; i<pCount; i++) ds->data[i] = w->ydata()[i+idxStart];
+    PythonDataSeries* ds = new PythonDataSeries("WBal", w->ydata().mid(idxStart, pCount));
 
     return ds;
 }
@@ -716,17 +721,16 @@ Bindings::xdata(QString name, QString series, QString join, PyObject* activity)
 
     if (!xds->valuename.contains(series)) return NULL; // No such XData name
 
-    // count the included points, create data series output and copy data
-    int pCount = 0;
+    // the included points are a contiguous range, so no need to count them
     RideFileIterator it(f, python->contexts.value(threadid()).spec);
-    while (it.hasNext()) { it.next(); pCount++; }
+    int pCount = it.hasNext() ? it.lastIndex() - it.firstIndex() + 1 : 0;
     PythonDataSeries* ds = new PythonDataSeries(QString("%1_%2").arg(name).arg(series), pCount);
-    it.toFront();
+    double *data = ds->data;
     int idx = 0;
     for(int i=0; i<pCount && it.hasNext(); i++) {
         struct RideFilePoint *point = it.next();
         double val = f->xdataValue(point, idx, name, series, xjoin);
-        ds->data[i] = (val == RideFile::NA) ? sqrt(-1) : val; // NA => NaN
+        data[i] = (val == RideFile::NA) ? sqrt(-1) : val; // NA => NaN
     }
 
     return ds;
@@ -754,31 +758,23 @@ PythonXDataSeries *Bindings::xdataSeries(QString name, QString series, PyObject*
         editedRideFiles->append(f);
     }
 
-    // count the included points, create data series output and copy data
+    // copy the included points in one pass, these are the current values
+    // so they go straight into the series rather than via set()
     Specification spec(python->contexts.value(threadid()).spec);
     IntervalItem* it = spec.interval();
-    int pCount = 0;
-    foreach(XDataPoint* p, xds->datapoints) {
-        if (it && p->secs < it->start) continue;
-        if (it && p->secs > it->stop) break;
-        pCount++;
-    }
-
-    PythonXDataSeries* ds = new PythonXDataSeries(name, series, valueIdx >= 0 ? xds->unitname[valueIdx] : "",
-                                                  pCount, readOnly, f);
-
-    int idx = 0;
+    QVector<double> values;
+    values.reserve(xds->datapoints.count());
     foreach(XDataPoint* p, xds->datapoints) {
         if (it && p->secs < it->start) continue;
         if (it && p->secs > it->stop) break;
         double val = sqrt(-1); // NA => NaN
-        if (valueIdx >= 0) val = p->number[valueIdx];
+        if (valueIdx >= 0) val = p->number.at(valueIdx);
         else if (series == "secs") val = p->secs;
         else if (series == "km") val = p->km;
-        ds->set(idx++, val);
+        values << val;
     }
 
-    return ds;
+    return new PythonXDataSeries(name, series, valueIdx >= 0 ? xds->unitname[valueIdx] : "", values, readOnly, f);
 }
 
 PyObject*
@@ -824,15 +820,21 @@ Bindings::seriesPresent(int type, PyObject* activity) const
 }
 
 PythonDataSeries::PythonDataSeries(QString name, Py_ssize_t count, bool readOnly, RideFile::SeriesType seriesType, RideFile *rideFile)
-    : name(name), count(count), data(NULL), readOnly(readOnly), seriesType(seriesType), rideFile(rideFile)
+    : name(name), count(count), data(NULL), readOnly(readOnly), seriesType(seriesType), rideFile(rideFile), values(count > 0 ? count : 0)
 {
-    if (count > 0) data = new double[count];
+    if (count > 0) data = values.data();
 }
 
 PythonDataSeries::PythonDataSeries(QString name, Py_ssize_t count) : name(name), count(count), data(NULL),
-    readOnly(true), seriesType(RideFile::none), rideFile(NULL)
+    readOnly(true), seriesType(RideFile::none), rideFile(NULL), values(count > 0 ? count : 0)
+{
+    if (count > 0) data = values.data();
+}
+
+PythonDataSeries::PythonDataSeries(QString name, const QVector<double> &values) : name(name), count(values.count()), data(NULL),
+    readOnly(true), seriesType(RideFile::none), rideFile(NULL), values(values)
 {
-    if (count > 0) data = new double[count];
+    if (count > 0) data = this->values.data(); // our own copy
 }
 
 // default constructor and copy constructor
@@ -845,14 +847,25 @@ PythonDataSeries::PythonDataSeries(PythonDataSeries *clone)
         name = QString();
         count = 0;
         data = NULL;
+        readOnly = true;
+        seriesType = RideFile::none;
+        rideFile = NULL;
     }
 }
 
-PythonDataSeries::~PythonDataSeries()
+PythonDataSeries &
+PythonDataSeries::operator=(const PythonDataSeries &other)
 {
-    if (data) delete[] data;
-    data=NULL;
-    rideFile = NULL;
+    name = other.name;
+    count = other.count;
+    readOnly = other.readOnly;
+    seriesType = other.seriesType;
+    rideFile = other.rideFile;
+
+    // each copy has its own values, python may write to them
+    values = other.values;
+    data = count > 0 ? values.data() : NULL;
+    return *this;
 }
 
 PythonXDataSeries::PythonXDataSeries(QString xdata, QString series, QString unit, int count, bool readOnly, RideFile *rideFile)
@@ -861,6 +874,12 @@ PythonXDataSeries::PythonXDataSeries(QString xdata, QString series, QString unit
     shape[0] = count >= 0 ? count : 0;
 }
 
+PythonXDataSeries::PythonXDataSeries(QString xdata, QString series, QString unit, const QVector<double> &values, bool readOnly, RideFile *rideFile)
+    : xdata(xdata), series(series), colIdx(-1), unit(unit), readOnly(readOnly), rideFile(rideFile), shape(1), data(values)
+{
+    shape[0] = data.count();
+}
+
 PythonXDataSeries::PythonXDataSeries(PythonXDataSeries *clone)
 {
     if (clone) *this = *clone;
@@ -1015,9 +1034,9 @@ Bindings::activityMetrics(RideItem* item) const
     //
     if (PyDateTimeAPI == NULL) PyDateTime_IMPORT;// import datetime if necessary
     QDate d = item->dateTime.date();
-    PyDict_SetItemString(dict, "date", PyDate_FromDate(d.year(), d.month(), d.day()));
+    setItem(dict, "date", PyDate_FromDate(d.year(), d.month(), d.day()));
     QTime t = item->dateTime.time();
-    PyDict_SetItemString(dict, "time", PyTime_FromTime(t.hour(), t.minute(), t.second(), t.msec()*10));
+    setItem(dict, "time", PyTime_FromTime(t.hour(), t.minute(), t.second(), t.msec()*10));
 
     //
     // METRICS
@@ -1040,7 +1059,7 @@ Bindings::activityMetrics(RideItem* item) const
         }
 
         // add to the dict
-        PyDict_SetItemString(dict, name.toUtf8().constData(), PyFloat_FromDouble(value));
+        setItem(dict, name.toUtf8().constData(), PyFloat_FromDouble(value));
     }
 
     //
@@ -1053,7 +1072,7 @@ Bindings::activityMetrics(RideItem* item) const
             context->specialFields.isMetric(field.name)) continue;
 
         // add to the dict
-        PyDict_SetItemString(dict, field.name.replace(" ","_").toUtf8().constData(), PyUnicode_FromString(item->getText(field.name, "").toUtf8().constData()));
+        setItem(dict, field.name.replace(" ","_").toUtf8().constData(), PyUnicode_FromString(item->getText(field.name, "").toUtf8().constData()));
     }
 
     //
@@ -1075,7 +1094,7 @@ Bindings::activityMetrics(RideItem* item) const
         color = item->color.name();
 
     // add to the dict
-    PyDict_SetItemString(dict, "color", PyUnicode_FromString(color.toUtf8().constData()));
+    setItem(dict, "color", PyUnicode_FromString(color.toUtf8().constData()));
 
     return dict;
 }
@@ -1161,12 +1180,14 @@ Bindings::seasonMetrics(bool all, DateRange range, QString filter) const
 
     specification.setFilterSet(fs);
 
-    // we need to count rides that are in range...
-    int rides = 0;
+    // the rides that are in range, filtering just once
+    // rather than for every metric and meta field
+    QVector<RideItem*> selected;
     foreach(RideItem *ride, context->athlete->rideCache->rides()) {
         if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date())) rides++;
+        if (all || range.pass(ride->dateTime.date())) selected << ride;
     }
+    int rides = selected.count();
 
     PyObject* dict = PyDict_New();
     if (dict == NULL) return dict;
@@ -1181,40 +1202,36 @@ Bindings::seasonMetrics(bool all, DateRange range, QString filter) const
     PyObject* colorlist = PyList_New(rides);
 
     int idx = 0;
-    foreach(RideItem *ride, context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date())) {
+    foreach(RideItem *ride, selected) {
+        QDate d = ride->dateTime.date();
+        PyList_SET_ITEM(datelist, idx, PyDate_FromDate(d.year(), d.month(), d.day()));
 
-            QDate d = ride->dateTime.date();
-            PyList_SET_ITEM(datelist, idx, PyDate_FromDate(d.year(), d.month(), d.day()));
+        QTime t = ride->dateTime.time();
+        PyList_SET_ITEM(timelist, idx, PyTime_FromTime(t.hour(), t.minute(), t.second(), t.msec()*10));
 
-            QTime t = ride->dateTime.time();
-            PyList_SET_ITEM(timelist, idx, PyTime_FromTime(t.hour(), t.minute(), t.second(), t.msec()*10));
+        // apply item color, remembering that 1,1,1 means use default (reverse in this case)
+        QString color;
 
-            // apply item color, remembering that 1,1,1 means use default (reverse in this case)
-            QString color;
+        if (ride->color == QColor(1,1,1,1)) {
 
-            if (ride->color == QColor(1,1,1,1)) {
+            // use the inverted color, not plot marker as that hideous
+            QColor col =GCColor::invertColor(GColor(CPLOTBACKGROUND));
 
-                // use the inverted color, not plot marker as that hideous
-                QColor col =GCColor::invertColor(GColor(CPLOTBACKGROUND));
+            // white is jarring on a dark background!
+            if (col==QColor(Qt::white)) col=QColor(127,127,127);
 
-                // white is jarring on a dark background!
-                if (col==QColor(Qt::white)) col=QColor(127,127,127);
+            color = col.name();
+        } else
+            color = ride->color.name();
 
-                color = col.name();
-            } else
-                color = ride->color.name();
+        PyList_SET_ITEM(colorlist, idx, PyUnicode_FromString(color.toUtf8().constData()));
 
-            PyList_SET_ITEM(colorlist, idx, PyUnicode_FromString(color.toUtf8().constData()));
-
-            idx++;
-        }
+        idx++;
     }
 
-    PyDict_SetItemString(dict, "date", datelist);
-    PyDict_SetItemString(dict, "time", timelist);
-    PyDict_SetItemString(dict, "color", colorlist);
+    setItem(dict, "date", datelist);
+    setItem(dict, "time", timelist);
+    setItem(dict, "color", colorlist);
 
     //
     // METRICS
@@ -1232,16 +1249,13 @@ Bindings::seasonMetrics(bool all, DateRange range, QString filter) const
         // set a list of metric values
         PyObject* metriclist = PyList_New(rides);
 
-        int idx = 0;
-        foreach(RideItem *item, context->athlete->rideCache->rides()) {
-            if (!specification.pass(item)) continue;
-            if (all || range.pass(item->dateTime.date())) {
-                PyList_SET_ITEM(metriclist, idx++, PyFloat_FromDouble(item->metrics()[i] * (useMetricUnits ? 1.0f : metric->conversion()) + (useMetricUnits ? 0.0f : metric->conversionSum())));
-            }
-        }
+        double factor = useMetricUnits ? 1.0f : metric->conversion();
+        double sum = useMetricUnits ? 0.0f : metric->conversionSum();
+        for (int idx=0; idx<rides; idx++)
+            PyList_SET_ITEM(metriclist, idx, PyFloat_FromDouble(selected[idx]->metrics()[i] * factor + sum));
 
         // add to the dict
-        PyDict_SetItemString(dict, name.toUtf8().constData(), metriclist);
+        setItem(dict, name.toUtf8().constData(), metriclist);
     }
 
     //
@@ -1256,16 +1270,11 @@ Bindings::seasonMetrics(bool all, DateRange range, QString filter) const
         // Create a string list
         PyObject* metalist = PyList_New(rides);
 
-        int idx = 0;
-        foreach(RideItem *item, context->athlete->rideCache->rides()) {
-            if (!specification.pass(item)) continue;
-            if (all || range.pass(item->dateTime.date())) {
-                PyList_SET_ITEM(metalist, idx++, PyUnicode_FromString(item->getText(field.name, "").toUtf8().constData()));
-            }
-        }
+        for (int idx=0; idx<rides; idx++)
+            PyList_SET_ITEM(metalist, idx, PyUnicode_FromString(selected[idx]->getText(field.name, "").toUtf8().constData()));
 
         // add to the dict
-        PyDict_SetItemString(dict, field.name.replace(" ","_").toUtf8().constData(), metalist);
+        setItem(dict, field.name.replace(" ","_").toUtf8().constData(), metalist);
     }
 
     return dict;
@@ -1344,19 +1353,18 @@ Bindings::seasonIntervals(DateRange range, QString type) const
     fs.addFilter(context->ishomefiltered, context->homeFilters);
     specification.setFilterSet(fs);
 
-    // we need to count intervals that are in range...
-    intervals = 0;
+    // the intervals that are in range, filtering just once
+    // rather than for every metric
+    QVector<IntervalItem*> selected;
     foreach(RideItem *ride, context->athlete->rideCache->rides()) {
         if (!specification.pass(ride)) continue;
         if (!range.pass(ride->dateTime.date())) continue;
 
-        if (type.isEmpty()) intervals += ride->intervals().count();
-        else {
-            foreach(IntervalItem *item, ride->intervals())
-                if (type == RideFileInterval::typeDescription(item->type))
-                    intervals++;
-        }
+        foreach(IntervalItem *item, ride->intervals())
+            if (type.isEmpty() || type == RideFileInterval::typeDescription(item->type))
+                selected << item;
     }
+    intervals = selected.count();
 
     PyObject* dict = PyDict_New();
     if (dict == NULL) return dict;
@@ -1410,11 +1418,11 @@ Bindings::seasonIntervals(DateRange range, QString type) const
         }
     }
 
-    PyDict_SetItemString(dict, "date", datelist);
-    PyDict_SetItemString(dict, "time", timelist);
-    PyDict_SetItemString(dict, "name", namelist);
-    PyDict_SetItemString(dict, "type", typelist);
-    PyDict_SetItemString(dict, "color", colorlist);
+    setItem(dict, "date", datelist);
+    setItem(dict, "time", timelist);
+    setItem(dict, "name", namelist);
+    setItem(dict, "type", typelist);
+    setItem(dict, "color", colorlist);
 
     //
     // METRICS
@@ -1432,20 +1440,13 @@ Bindings::seasonIntervals(DateRange range, QString type) const
 
         bool useMetricUnits = context->athlete->useMetricUnits;
 
-        int index=0;
-        foreach(RideItem *item, context->athlete->rideCache->rides()) {
-            if (!specification.pass(item)) continue;
-            if (range.pass(item->dateTime.date())) {
-
-                foreach(IntervalItem *interval, item->intervals()) {
-                    if (type.isEmpty() || type == RideFileInterval::typeDescription(interval->type))
-                        PyList_SET_ITEM(metriclist, index++, PyFloat_FromDouble(interval->metrics()[i] * (useMetricUnits ? 1.0f : metric->conversion()) + (useMetricUnits ? 0.0f : metric->conversionSum())));
-                }
-            }
-        }
+        double factor = useMetricUnits ? 1.0f : metric->conversion();
+        double sum = useMetricUnits ? 0.0f : metric->conversionSum();
+        for (int index=0; index<intervals; index++)
+            PyList_SET_ITEM(metriclist, index, PyFloat_FromDouble(selected[index]->metrics()[i] * factor + sum));
 
         // add to the dict
-        PyDict_SetItemString(dict, name.toUtf8().constData(), metriclist);
+        setItem(dict, name.toUtf8().constData(), metriclist);
     }
 
     return dict;
@@ -1521,12 +1522,12 @@ Bindings::activityIntervals(QString type, PyObject* activity) const
             idx++;
         }
 
-    PyDict_SetItemString(dict, "start", startlist);
-    PyDict_SetItemString(dict, "stop", stoplist);
-    PyDict_SetItemString(dict, "name", namelist);
-    PyDict_SetItemString(dict, "type", typelist);
-    PyDict_SetItemString(dict, "color", colorlist);
-    PyDict_SetItemString(dict, "selected", selectedlist);
+    setItem(dict, "start", startlist);
+    setItem(dict, "stop", stoplist);
+    setItem(dict, "name", namelist);
+    setItem(dict, "type", typelist);
+    setItem(dict, "color", colorlist);
+    setItem(dict, "selected", selectedlist);
 
     //
     // METRICS
@@ -1551,7 +1552,7 @@ Bindings::activityIntervals(QString type, PyObject* activity) const
         }
 
         // add to the dict
-        PyDict_SetItemString(dict, name.toUtf8().constData(), metriclist);
+        setItem(dict, name.toUtf8().constData(), metriclist);
     }
 
     return dict;
@@ -1706,12 +1707,13 @@ Bindings::metrics(QString metric, bool all, QString filter) const
 
             // found, set an array of metric values
             PythonDataSeries* pds = new PythonDataSeries(name, rides);
+            double *data = pds->data;
 
             int idx = 0;
             foreach(RideItem *item, context->athlete->rideCache->rides()) {
                 if (!specification.pass(item)) continue;
                 if (all || range.pass(item->dateTime.date())) {
-                    pds->data[idx++] = item->metrics()[i] * (useMetricUnits ? 1.0f : m->conversion()) + (useMetricUnits ? 0.0f : m->conversionSum());
+                    data[idx++] = item->metrics()[i] * (useMetricUnits ? 1.0f : m->conversion()) + (useMetricUnits ? 0.0f : m->conversionSum());
                 }
             }
 
@@ -1892,7 +1894,7 @@ Bindings::rideFileCacheMeanmax(RideFileCache* cache) const
         for(int j=0; j<values.count(); j++) PyList_SET_ITEM(list, j, PyFloat_FromDouble(values[j]));
 
         // add to the dict
-        PyDict_SetItemString(ans, RideFile::seriesName(series, true).toUtf8().constData(), list);
+        setItem(ans, RideFile::seriesName(series, true).toUtf8().constData(), list);
 
         // if is power add the dates
         if(series == RideFile::watts) {
@@ -1911,7 +1913,7 @@ Bindings::rideFileCacheMeanmax(RideFileCache* cache) const
             }
 
             // add to the dict
-            PyDict_SetItemString(ans, "power_date", datelist);
+            setItem(ans, "power_date", datelist);
         }
     }
 
@@ -1965,7 +1967,7 @@ Bindings::seasonPmc(bool all, QString metric) const
         }
 
         // add to the dict
-        PyDict_SetItemString(ans, "date", datelist);
+        setItem(ans, "date", datelist);
 
         // PMC DATA
 
@@ -2006,11 +2008,11 @@ Bindings::seasonPmc(bool all, QString metric) const
         }
 
         // add to the dict
-        PyDict_SetItemString(ans, "stress", stress);
-        PyDict_SetItemString(ans, "lts", lts);
-        PyDict_SetItemString(ans, "sts", sts);
-        PyDict_SetItemString(ans, "sb", sb);
-        PyDict_SetItemString(ans, "rr", rr);
+        setItem(ans, "stress", stress);
+        setItem(ans, "lts", lts);
+        setItem(ans, "sts", sts);
+        setItem(ans, "sb", sb);
+        setItem(ans, "rr", rr);
 
         // return it
         return ans;
@@ -2060,7 +2062,7 @@ Bindings::seasonMeasures(bool all, QString group) const
         }
 
         // add to the dict
-        PyDict_SetItemString(ans, "date", datelist);
+        setItem(ans, "date", datelist);
 
         // MEASURES DATA
         QStringList fieldSymbols = context->athlete->measures->getFieldSymbols(groupIdx);
@@ -2083,7 +2085,7 @@ Bindings::seasonMeasures(bool all, QString group) const
 
         // add to the dict
         for (int fieldIdx=0; fieldIdx<fields.count(); fieldIdx++)
-            PyDict_SetItemString(ans, fieldSymbols[fieldIdx].toUtf8().constData(), fields[fieldIdx]);
+            setItem(ans, fieldSymbols[fieldIdx].toUtf8().constData(), fields[fieldIdx]);
 
         // return it
         return ans;
@@ -2151,10 +2153,10 @@ Bindings::season(bool all, bool compare) const
     }
 
     // list into a data.frame
-    PyDict_SetItemString(ans, "start", start);
-    PyDict_SetItemString(ans, "end", end);
-    PyDict_SetItemString(ans, "name", name);
-    PyDict_SetItemString(ans, "color", color);
+    setItem(ans, "start", start);
+    setItem(ans, "end", end);
+    setItem(ans, "name", name);
+    setItem(ans, "color", color);
 
     // return it
     return ans;
@@ -2299,7 +2301,7 @@ Bindings::seasonPeaks(bool all, DateRange range, QString filter, QList<RideFile:
     }
 
     // add to the dict
-    PyDict_SetItemString(ans, "datetime", datetimelist);
+    setItem(ans, "datetime", datetimelist);
 
     foreach(RideFile::SeriesType pseries, series) {
 
@@ -2329,7 +2331,7 @@ Bindings::seasonPeaks(bool all, DateRange range, QString filter, QList<RideFile:
             }
 
             // add to the dict
-            PyDict_SetItemString(ans, name.toUtf8().constData(), list);
+            setItem(ans, name.toUtf8().constData(), list);
         }
     }
 
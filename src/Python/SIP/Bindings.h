@@ -10,14 +10,20 @@
 #include <Python.h>
 
 
+// A series of doubles handed to Python via the buffer protocol. The
+// values are held in a QVector so copies made by SIP each own theirs
+// and data always points at our own copy, so Python may write to it.
 class PythonDataSeries {
 
     public:
         PythonDataSeries(QString name, Py_ssize_t count, bool readOnly, RideFile::SeriesType seriesType, RideFile *rideFile);
         PythonDataSeries(QString name, Py_ssize_t count);
+        PythonDataSeries(QString name, const QVector<double> &values);
         PythonDataSeries(PythonDataSeries*);
+        PythonDataSeries(const PythonDataSeries &other) { *this = other; }
         PythonDataSeries();
-        ~PythonDataSeries();
+
+        PythonDataSeries &operator=(const PythonDataSeries &other);
 
         QString name;
         Py_ssize_t count;
@@ -26,11 +32,15 @@ class PythonDataSeries {
         bool readOnly;
         int seriesType;
         RideFile *rideFile;
+
+    private:
+        QVector<double> values; // data points into this
 };
 
 class PythonXDataSeries {
     public:
         PythonXDataSeries(QString xdata, QString series, QString unit, int count, bool readOnly, RideFile *rideFile);
+        PythonXDataSeries(QString xdata, QString series, QString unit, const QVector<double> &values, bool readOnly, RideFile *rideFile);
         PythonXDataSeries(PythonXDataSeries*);
         PythonXDataSeries();
 
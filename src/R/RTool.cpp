@@ -62,6 +62,12 @@ typedef struct {
 
 } R_CMethodDef33;
 
+// older R versions don't have the macro, NAMED of 2 means the
+// same thing; the object is referenced elsewhere so copy on modify
+#ifndef MARK_NOT_MUTABLE
+#define MARK_NOT_MUTABLE(x) SET_NAMED(x, 2)
+#endif
+
 RTool::RTool()
 {
     // setup the R runtime elements
@@ -70,6 +76,8 @@ RTool::RTool()
     canvas = NULL;
     chart = NULL;
     context = NULL;
+    framesContext = NULL;
+    frameCells = 0;
 
     // if we bail we need to explain why, its in here
     QString dialogtext;
@@ -392,6 +400,9 @@ RTool::configChanged()
     // wait until loaded
     if (starting || failed) return;
 
+    // colors and units may have changed
+    clearFrames();
+
     // update global R appearances
     QString parCommand=QString("par(par.default)\n"
                                "par(bg=\"%1\", "
@@ -410,6 +421,14 @@ RTool::configChanged()
     rtool->R->parseEvalNT(parCommand);
 }
 
+void
+RTool::clearFrames()
+{
+    foreach(Frame frame, frames) R_ReleaseObject(frame.df);
+    frames.clear();
+    frameCells = 0;
+}
+
 SEXP
 RTool::athlete()
 {
@@ -1169,23 +1188,21 @@ SEXP
 RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
 {
     const RideMetricFactory &factory = RideMetricFactory::instance();
-    int rides = rtool->context->athlete->rideCache->count();
     int metrics = factory.metricCount();
+    bool useMetricUnits = rtool->context->athlete->useMetricUnits;
 
-    // count the number of meta fields to add
-    int meta = 0;
+    // the meta fields to add, skipping incomplete meta definitions
+    // and metric override fields
+    QList<FieldDefinition> fields;
     if (rtool->context && rtool->context->athlete->rideMetadata()) {
 
-        // count active fields
         foreach(FieldDefinition def, rtool->context->athlete->rideMetadata()->getFields()) {
             if (def.name != "" && def.tab != "" &&
                 !rtool->context->specialFields.isMetric(def.name))
-                meta++;
+                fields << def;
         }
     }
-
-    // how many rides to return if we're limiting to the
-    // currently selected date range ?
+    int meta = fields.count();
 
     // apply any global filters
     Specification specification;
@@ -1195,6 +1212,7 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     specification.setFilterSet(fs);
 
     // did call contain any filters?
+    QStringList filters;
     PROTECT(filter=Rf_coerceVector(filter, STRSXP));
     for(int i=0; i<Rf_length(filter); i++) {
 
@@ -1206,16 +1224,64 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
             QStringList files;
             dataFilter.parseFilter(rtool->context, f, &files);
             fs.addFilter(true, files);
+            filters << f;
         }
     }
     specification.setFilterSet(fs);
     UNPROTECT(1);
 
-    // we need to count rides that are in range...
-    rides = 0;
+    // select the rides once, every column is filled from this list
+    QVector<RideItem*> selected;
+    selected.reserve(rtool->context->athlete->rideCache->count());
     foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
         if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date())) rides++;
+        if (all || range.pass(ride->dateTime.date())) selected << ride;
+    }
+    int rides = selected.count();
+
+    // default color for rides without one, remembering that 1,1,1 means
+    // use default (reverse in this case) use the inverted color, not plot
+    // marker as that hideous
+    QColor defaultColor = GCColor::invertColor(GColor(CPLOTBACKGROUND));
+
+    // white is jarring on a dark background!
+    if (defaultColor==QColor(Qt::white)) defaultColor=QColor(127,127,127);
+
+    // charts refresh far more often than rides change, so if the same
+    // selection has been converted before and none of the rides have
+    // changed since then we can hand back the frame we built last time
+    if (rtool->framesContext != rtool->context) {
+        rtool->clearFrames();
+        rtool->framesContext = rtool->context;
+    }
+
+    QString key = QString("%1|%2|%3|%4|%5")
+                  .arg(all ? "all" : range.from.toString(Qt::ISODate) + ":" + range.to.toString(Qt::ISODate))
+                  .arg(useMetricUnits ? 1 : 0)
+                  .arg(metrics)
+                  .arg(defaultColor.name())
+                  .arg(filters.join("|"));
+    foreach(FieldDefinition field, fields) key += "|" + field.name;
+
+    QVector<RTool::FrameRow> rows(rides);
+    for(int i=0; i<rides; i++) {
+        RideItem *item = selected[i];
+        RTool::FrameRow &row = rows[i];
+        row.item = item;
+        row.dateTime = item->dateTime;
+        row.metrics = item->metrics();
+        row.metadata = item->metadata();
+        row.color = item->color.rgba();
+    }
+
+    if (rtool->frames.contains(key)) {
+        const RTool::Frame &cached = rtool->frames[key];
+        if (cached.rows == rows) return cached.df;
+
+        // stale, will be replaced below
+        R_ReleaseObject(cached.df);
+        rtool->frameCells -= cached.cells;
+        rtool->frames.remove(key);
     }
 
     // get a listAllocated
@@ -1227,12 +1293,11 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     PROTECT(ans=Rf_allocVector(VECSXP, metrics+meta+3));
     PROTECT(names = Rf_allocVector(STRSXP, metrics+meta+3));
 
-    // we have to give a name to each row
-    PROTECT(rownames = Rf_allocVector(STRSXP, rides));
-    for(int i=0; i<rides; i++) {
-        QString rownumber=QString("%1").arg(i+1);
-        SET_STRING_ELT(rownames, i, Rf_mkChar(rownumber.toLatin1().constData()));
-    }
+    // row names are just 1..rides so we use the compact form R uses
+    // internally for automatic row names, rather than a string per row
+    PROTECT(rownames = Rf_allocVector(INTSXP, 2));
+    INTEGER(rownames)[0] = NA_INTEGER;
+    INTEGER(rownames)[1] = -rides;
 
     // next name
     int next=0;
@@ -1241,13 +1306,9 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     SEXP date;
     PROTECT(date=Rf_allocVector(INTSXP, rides));
 
-    int k=0;
     QDate d1970(1970,01,01);
-    foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date()))
-            INTEGER(date)[k++] = d1970.daysTo(ride->dateTime.date());
-    }
+    int *dates = INTEGER(date);
+    for(int k=0; k<rides; k++) dates[k] = d1970.daysTo(selected[k]->dateTime.date());
 
     SEXP dclas;
     PROTECT(dclas=Rf_allocVector(STRSXP, 1));
@@ -1262,13 +1323,8 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     SEXP time;
     PROTECT(time=Rf_allocVector(REALSXP, rides));
 
-    // fill with values for date and class if its one we need to return
-    k=0;
-    foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date()))
-            REAL(time)[k++] = ride->dateTime.toUTC().toTime_t();
-    }
+    double *times = REAL(time);
+    for(int k=0; k<rides; k++) times[k] = selected[k]->dateTime.toUTC().toTime_t();
 
     // POSIXct class
     SEXP clas;
@@ -1290,7 +1346,12 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     //
     // METRICS
     //
-    for(int i=0; i<factory.metricCount();i++) {
+    // allocate every column up front and then fill them ride by ride,
+    // so each ride's metrics are read once, front to back, and written
+    // straight into the R vectors
+    QVector<double*> columns(metrics);
+    QVector<double> factor(metrics), sum(metrics);
+    for(int i=0; i<metrics; i++) {
 
         // set a vector
         SEXP m;
@@ -1298,22 +1359,15 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
 
         QString symbol = factory.metricName(i);
         const RideMetric *metric = factory.rideMetric(symbol);
-        QString name = rtool->context->specialFields.internalName(factory.rideMetric(symbol)->name());
+        QString name = rtool->context->specialFields.internalName(metric->name());
         name = name.replace(" ","_");
         name = name.replace("'","_");
 
-        bool useMetricUnits = rtool->context->athlete->useMetricUnits;
-
-        int index=0;
-        foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-            if (!specification.pass(item)) continue;
-            if (all || range.pass(item->dateTime.date())) {
-                REAL(m)[index++] = item->metrics()[i] * (useMetricUnits ? 1.0f : metric->conversion())
-                                                      + (useMetricUnits ? 0.0f : metric->conversionSum());
-            }
-        }
+        factor[i] = useMetricUnits ? 1.0f : metric->conversion();
+        sum[i] = useMetricUnits ? 0.0f : metric->conversionSum();
+        columns[i] = REAL(m);
 
-        // add to the list
+        // add to the list, which protects it from here on
         SET_VECTOR_ELT(ans, next, m);
 
         // give it a name
@@ -1325,25 +1379,35 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
         UNPROTECT(1);
     }
 
+    for(int k=0; k<rides; k++) {
+        const double *values = selected[k]->metrics().constData();
+        if (useMetricUnits) {
+            for(int i=0; i<metrics; i++) columns[i][k] = values[i];
+        } else {
+            for(int i=0; i<metrics; i++) columns[i][k] = values[i] * factor[i] + sum[i];
+        }
+    }
+
     //
     // META
     //
-    foreach(FieldDefinition field, rtool->context->athlete->rideMetadata()->getFields()) {
-
-        // don't add incomplete meta definitions or metric override fields
-        if (field.name == "" || field.tab == "" ||
-            rtool->context->specialFields.isMetric(field.name)) continue;
+    foreach(FieldDefinition field, fields) {
 
         // Create a string vector
         SEXP m;
         PROTECT(m=Rf_allocVector(STRSXP, rides));
 
-        int index=0;
-        foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-            if (!specification.pass(item)) continue;
-            if (all || range.pass(item->dateTime.date())) {
-                SET_STRING_ELT(m, index++, Rf_mkChar(item->getText(field.name, "").toLatin1().constData()));
+        // most meta fields only take a handful of distinct values
+        // (sport, workout code, etc) so share one string for each
+        QHash<QString,SEXP> strings;
+        for(int k=0; k<rides; k++) {
+            QString value = selected[k]->getText(field.name, "");
+            SEXP s = strings.value(value, NULL);
+            if (s == NULL) {
+                s = Rf_mkChar(value.toLatin1().constData());
+                strings.insert(value, s);
             }
+            SET_STRING_ELT(m, k, s);
         }
 
         // add to the list
@@ -1362,24 +1426,15 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     SEXP color;
     PROTECT(color=Rf_allocVector(STRSXP, rides));
 
-    int index=0;
-    foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(item)) continue;
-        if (all || range.pass(item->dateTime.date())) {
-
-            // apply item color, remembering that 1,1,1 means use default (reverse in this case)
-            if (item->color == QColor(1,1,1,1)) {
-
-                // use the inverted color, not plot marker as that hideous
-                QColor col =GCColor::invertColor(GColor(CPLOTBACKGROUND));
-
-                // white is jarring on a dark background!
-                if (col==QColor(Qt::white)) col=QColor(127,127,127);
-
-                SET_STRING_ELT(color, index++, Rf_mkChar(col.name().toLatin1().constData()));
-            } else
-                SET_STRING_ELT(color, index++, Rf_mkChar(item->color.name().toLatin1().constData()));
+    QHash<QRgb,SEXP> colors;
+    for(int k=0; k<rides; k++) {
+        QColor col = selected[k]->color == QColor(1,1,1,1) ? defaultColor : selected[k]->color;
+        SEXP s = colors.value(col.rgba(), NULL);
+        if (s == NULL) {
+            s = Rf_mkChar(col.name().toLatin1().constData());
+            colors.insert(col.rgba(), s);
         }
+        SET_STRING_ELT(color, k, s);
     }
 
     // add to the list and name it
@@ -1394,6 +1449,25 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     Rf_setAttrib(ans, R_RowNamesSymbol, rownames);
     Rf_namesgets(ans, names);
 
+    // the frame may be handed out again, so R must copy it
+    // rather than modify it in place
+    for(int i=0; i<Rf_length(ans); i++) MARK_NOT_MUTABLE(VECTOR_ELT(ans, i));
+    MARK_NOT_MUTABLE(ans);
+
+    // keep it for next time, the cache only needs to cover the
+    // handful of compare ranges a chart asks for so when it gets
+    // too big we just start again
+    RTool::Frame frame;
+    frame.rows = rows;
+    frame.cells = qint64(rides) * (metrics+meta+3);
+    frame.df = ans;
+    if (rtool->frameCells + frame.cells > RTool::maxFrameCells) rtool->clearFrames();
+    if (frame.cells <= RTool::maxFrameCells) {
+        R_PreserveObject(ans);
+        rtool->frames.insert(key, frame);
+        rtool->frameCells += frame.cells;
+    }
+
     // ans + names
     UNPROTECT(3);
 
@@ -2223,7 +2297,9 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
         pcount++;
 
         // fill with values for date and class
-        for(int k=0; k<points; k++) REAL(time)[k] = f->startTime().addSecs(f->dataPoints()[index+k]->secs).toUTC().toTime_t();
+        double *times = REAL(time);
+        qint64 start = f->startTime().toUTC().toTime_t();
+        for(int k=0; k<points; k++) times[k] = start + static_cast<qint64>(f->dataPoints()[index+k]->secs);
 
         // POSIXct class
         SEXP clas = PROTECT(Rf_allocVector(STRSXP, 2));
@@ -2252,15 +2328,18 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
             SEXP vector = PROTECT(Rf_allocVector(REALSXP, points));
             pcount++;
 
-            for(int j=index; j<stop; j++) {
-                if (f->isDataPresent(series)) {
-                    if (f->dataPoints()[j]->value(series) == 0 && (series == RideFile::lat || series == RideFile::lon))
-                        REAL(vector)[j-index] = NA_REAL;
-                    else
-                        REAL(vector)[j-index] = f->dataPoints()[j]->value(series);
-                } else {
-                    REAL(vector)[j-index] = NA_REAL;
+            // samples are held by pointer so we can't copy a block,
+            // but decide what to do once per series, not per sample
+            double *out = REAL(vector);
+            if (!f->isDataPresent(series)) {
+                for(int j=0; j<points; j++) out[j] = NA_REAL;
+            } else if (series == RideFile::lat || series == RideFile::lon) {
+                for(int j=index; j<stop; j++) {
+                    double value = f->dataPoints()[j]->value(series);
+                    out[j-index] = value == 0 ? NA_REAL : value;
                 }
+            } else {
+                for(int j=index; j<stop; j++) out[j-index] = f->dataPoints()[j]->value(series);
             }
 
             // add to the list
@@ -2318,13 +2397,11 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
             }
         }
 
-        // add rownames
-        SEXP rownames = PROTECT(Rf_allocVector(STRSXP, points));
+        // add rownames, in the compact 1..points form
+        SEXP rownames = PROTECT(Rf_allocVector(INTSXP, 2));
         pcount++;
-        for(int i=0; i<points; i++) {
-            QString rownumber=QString("%1").arg(i+1);
-            SET_STRING_ELT(rownames, i, Rf_mkChar(rownumber.toLatin1().constData()));
-        }
+        INTEGER(rownames)[0] = NA_INTEGER;
+        INTEGER(rownames)[1] = -points;
 
         // turn the list into a data frame + set column names
         Rf_setAttrib(ans, R_RowNamesSymbol, rownames);
@@ -2658,7 +2735,7 @@ RTool::dfForRideFileCache(RideFileCache *cache)
         // will have different sizes e.g. when a daterange
         // since longest ride with e.g. power may be different
         // to longest ride with heartrate
-        for(int j=0; j<values.count(); j++) REAL(vector)[j] = values[j];
+        memcpy(REAL(vector), values.constData(), values.count() * sizeof(double));
 
         // add to the list
         SET_VECTOR_ELT(ans, next, vector);
@@ -2704,13 +2781,11 @@ RTool::dfForRideFileCache(RideFileCache *cache)
         }
     }
 
-    // add rownames
+    // add rownames, in the compact 1..size form
     SEXP rownames;
-    PROTECT(rownames = Rf_allocVector(STRSXP, size));
-    for(unsigned int i=0; i<size; i++) {
-        QString rownumber=QString("%1").arg(i+1);
-        SET_STRING_ELT(rownames, i, Rf_mkChar(rownumber.toLatin1().constData()));
-    }
+    PROTECT(rownames = Rf_allocVector(INTSXP, 2));
+    INTEGER(rownames)[0] = NA_INTEGER;
+    INTEGER(rownames)[1] = -static_cast<int>(size);
 
     // turn the list into a data frame + set column names
     Rf_setAttrib(ans, R_RowNamesSymbol, rownames);
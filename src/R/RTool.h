@@ -103,6 +103,34 @@ class RTool {
 
         QStringList messages;
 
+        // season frames handed out by GC.season.metrics(), kept
+        // so unchanged seasons aren't rebuilt on every refresh. A frame
+        // is reused only when every ride it was built from is the same,
+        // the metrics and metadata are implicitly shared with the ride
+        // items so keeping them costs nothing until they change
+        struct FrameRow {
+            RideItem *item;
+            QDateTime dateTime;
+            QVector<double> metrics;
+            QMap<QString,QString> metadata;
+            QRgb color;
+
+            bool operator==(const FrameRow &other) const {
+                return item == other.item && dateTime == other.dateTime && color == other.color &&
+                       metrics == other.metrics && metadata == other.metadata;
+            }
+        };
+        struct Frame {
+            QVector<FrameRow> rows;
+            qint64 cells;
+            SEXP df;
+        };
+        static const qint64 maxFrameCells = 4 * 1024 * 1024; // ~32MB of doubles
+        QHash<QString, Frame> frames; // keyed on range, filters, units, fields and colors
+        Context *framesContext; // athlete the frames were built for
+        qint64 frameCells; // rides x columns over all frames
+        void clearFrames();
+
 
     protected:
 
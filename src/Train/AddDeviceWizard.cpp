@@ -216,6 +216,7 @@ DeviceScanner::quickScan(bool deep) // scan quickly or if true scan forever, as
 #endif
     case DEV_NULL : wizard->controller = new NullController(NULL, NULL); break;
     case DEV_ANTLOCAL : wizard->controller = new ANTlocalController(NULL, NULL); break;
+    case DEV_ANTREPLAY : wizard->controller = new ANTReplayController(NULL, NULL); break;
 #ifdef QT_BLUETOOTH_LIB
     case DEV_BT40 : wizard->controller = new BT40Controller(NULL, NULL); break;
 #endif
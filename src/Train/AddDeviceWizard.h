@@ -38,6 +38,7 @@
 #include "ErgofitController.h"
 #include "DaumController.h"
 #include "ANTlocalController.h"
+#include "ANTReplayController.h"
 #include "ANTChannel.h"
 #include "NullController.h"
 #include "Settings.h"
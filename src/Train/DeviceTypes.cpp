@@ -81,6 +81,11 @@ DeviceTypes::DeviceTypes()
         tr("Testing device used for development only. If an ERG file is selected it will "
         "replay back, with a little randomness thrown in."),
         "" },
+      { DEV_ANTREPLAY, DEV_FILE,   (char *) "ANT+ Replay", false,   false,
+        tr("Testing device used for development only. Replays an antlog.raw through the ANT+ "
+        "channels, enter the log as the port and the replay speed (e.g. 4 for 4x, 0 for as "
+        "fast as possible) as the profile."),
+        "" },
 #endif
       { 0, 0, NULL, 0, 0, "", "" }
     };
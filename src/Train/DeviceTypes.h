@@ -41,6 +41,7 @@
 #define DEV_KETTLER_RACER    0x8100   // Kettler racer Serial
 #define DEV_ERGOFIT    0x9000   // Ergofit Serial
 #define DEV_DAUM       0x10000   // Daum Serial
+#define DEV_ANTREPLAY  0x20000   // Replay an ANT+ log (testing)
 
 #define DEV_QUARQ      0x01     // ants use id:hostname:port
 #define DEV_SERIAL     0x02     // use filename COMx or /dev/cuxxxx
@@ -48,6 +49,7 @@
 #define DEV_USB        0x04     // use filename COMx or /dev/cuxxxx
 #define DEV_LIBUSB     0x08     // will interact directly (i.e. no device file needed)
 #define DEV_BTLE       0x10     // bluetooth
+#define DEV_FILE       0x20     // replayed from a file, the port is the path
 
 class DeviceType
 {
@@ -26,6 +26,7 @@
 #include <QXmlSimpleReader>
 
 #include <stdint.h>
+#include <algorithm>
 #include "Units.h"
 #include "Utils.h"
 
@@ -1308,51 +1309,14 @@ ErgFile::wattsAt(double x, int &lapnum)
     if (x < 0 || x > Duration) return -100;   // out of bounds!!!
 
     // do we need to return the Lap marker?
-    if (Laps.count() > 0) {
-        int lap=0;
-        for (int i=0; i<Laps.count(); i++) {
-            if (x>=Laps.at(i).x) lap += 1;
-        }
-        lapnum = lap;
-
-    } else lapnum = 0;
+    const ErgFileTimeline &t = timeline();
+    lapnum = t.lap(x);
 
     // find right section of the file
-    while (x < Points.at(leftPoint).x || x > Points.at(rightPoint).x) {
-        if (x < Points.at(leftPoint).x) {
-            leftPoint--;
-            rightPoint--;
-        } else if (x > Points.at(rightPoint).x) {
-            leftPoint++;
-            rightPoint++;
-        }
-    }
-
-    // two different points in time but the same watts
-    // at both, it doesn't really matter which value
-    // we use
-    if (Points.at(leftPoint).val == Points.at(rightPoint).val)
-        return Points.at(rightPoint).val;
-
-    // the erg file will list the point in time twice
-    // to show a jump from one wattage to another
-    // at this point in ime (i.e x=100 watts=100 followed
-    // by x=100 watts=200)
-    if (Points.at(leftPoint).x == Points.at(rightPoint).x)
-        return Points.at(rightPoint).val;
+    leftPoint = t.segment(x);
+    rightPoint = leftPoint + 1;
 
-    // so this point in time between two points and
-    // we are ramping from one point and another
-    // the steps in the calculation have been explicitly
-    // listed for code clarity
-    double deltaW = Points.at(rightPoint).val - Points.at(leftPoint).val;
-    double deltaT = Points.at(rightPoint).x - Points.at(leftPoint).x;
-    double offT = x - Points.at(leftPoint).x;
-    double factor = offT / deltaT;
-
-    double nowW = Points.at(leftPoint).val + (deltaW * factor);
-
-    return nowW;
+    return t.value(x);
 }
 
 double
@@ -1366,29 +1330,127 @@ ErgFile::gradientAt(double x, int &lapnum)
     if (x < 0 || x > Duration) return -100;   // out of bounds!!! (-40 through +40 are valid return vals)
 
     // do we need to return the Lap marker?
-    if (Laps.count() > 0) {
-        int lap=0;
-        for (int i=0; i<Laps.count(); i++) {
-            if (x>=Laps.at(i).x) lap += 1;
-        }
-        lapnum = lap;
-
-    } else lapnum = 0;
+    const ErgFileTimeline &t = timeline();
+    lapnum = t.lap(x);
 
     // find right section of the file
-    while (x < Points.at(leftPoint).x || x > Points.at(rightPoint).x) {
-        if (x < Points.at(leftPoint).x) {
-            leftPoint--;
-            rightPoint--;
-        } else if (x > Points.at(rightPoint).x) {
-            leftPoint++;
-            rightPoint++;
-        }
+    leftPoint = t.segment(x);
+    rightPoint = leftPoint + 1;
+
+    return t.value(x);
+}
+
+bool
+ErgFile::nextChange(double x, double &when, double &value)
+{
+    if (!isValid()) return false;
+    return timeline().nextChange(x, when, value);
+}
+
+void
+ErgFile::compile()
+{
+    compiled.compile(Points, Laps, format != CRS, Duration);
+}
+
+void
+ErgFileTimeline::compile(const QList<ErgFilePoint> &points, const QList<ErgFileLap> &lapmarkers,
+                         bool interpolate, long duration)
+{
+    this->interpolate = interpolate;
+    cursor = 0;
+
+    int n = points.count();
+    x.resize(n);
+    val.resize(n);
+    for (int i=0; i<n; i++) {
+        x[i] = points.at(i).x;
+        val[i] = points.at(i).val;
+    }
+
+    laps.resize(0);
+    foreach(const ErgFileLap &lap, lapmarkers) laps << lap.x;
+    std::sort(laps.begin(), laps.end());
+
+    // target each second, one pass through the points
+    seconds.resize(0);
+    if (interpolate && n > 1 && duration > 0) {
+        seconds.resize(duration / 1000 + 1);
+        for (int t=0; t<seconds.count(); t++) seconds[t] = value(t * 1000.0);
+        cursor = 0;
     }
+}
+
+int
+ErgFileTimeline::segment(double at) const
+{
+    int n = x.count();
+    if (n < 2) return 0;
+
+    // usually where we were last time or the next one along
+    for (int s = cursor; s < cursor + 2 && s < n - 1; s++)
+        if (x[s] < at && at <= x[s+1]) return cursor = s;
 
-    double gradient = Points.at(leftPoint).val;
+    if (at <= x[0]) return cursor = 0;
 
-    return gradient;
+    // the first point at or after, where a point is listed twice
+    // (a step) we are still in the segment before until we pass it
+    int k = std::lower_bound(x.constBegin(), x.constEnd(), at) - x.constBegin();
+    if (k >= n) k = n - 1;
+    return cursor = k - 1;
+}
+
+double
+ErgFileTimeline::value(double at) const
+{
+    if (x.count() < 2) return x.count() ? val[0] : 0;
+
+    int s = segment(at);
+
+    // slope files hold the gradient until the next point
+    if (!interpolate) return val[s];
+
+    // two different points in time but the same watts
+    // at both, it doesn't really matter which value
+    // we use, and the erg file will list the point in
+    // time twice to show a jump from one wattage to another
+    if (val[s] == val[s+1] || x[s] == x[s+1]) return val[s+1];
+
+    // so this point in time between two points and
+    // we are ramping from one point and another
+    return val[s] + (val[s+1] - val[s]) * ((at - x[s]) / (x[s+1] - x[s]));
+}
+
+int
+ErgFileTimeline::lap(double at) const
+{
+    return std::upper_bound(laps.constBegin(), laps.constEnd(), at) - laps.constBegin();
+}
+
+bool
+ErgFileTimeline::nextChange(double at, double &when, double &to) const
+{
+    int n = x.count();
+    if (n < 2) return false;
+
+    for (int k = segment(at) + 1; k < n; k++) {
+
+        if (x[k] <= at) continue;
+
+        if (interpolate) {
+            // a step or a ramp starts here
+            if (k + 1 < n && val[k+1] != val[k]) {
+                when = x[k];
+                to = val[k+1];
+                return true;
+            }
+        } else if (val[k] != val[k-1]) {
+            when = x[k];
+            to = val[k];
+            return true;
+        }
+    }
+    return false;
 }
 
 // Returns true if a location is determined, otherwise returns false.
@@ -1521,6 +1583,9 @@ ErgFile::calculateMetrics()
 
     maxY = 0; // we need to reset it
 
+    // compile for lookups whilst training
+    compile();
+
     // is it valid?
     if (!isValid()) return;
 
@@ -31,6 +31,7 @@
 #include <QTextStream>
 #include <QTextEdit>
 #include <QRegExp>
+#include <QVector>
 #include "Zones.h"      // For zones ... see below vvvv
 #include "LocationInterpolation.h"
 
@@ -92,6 +93,40 @@ class ErgFileLap
         QString name;
 };
 
+//
+// The workout compiled for lookups whilst training; the points as sorted
+// arrays so any x is a binary search away and the usual case, x moving
+// forward a little at a time, is found from the last segment we used.
+// For erg files the target is sampled every second ready for W'bal.
+//
+class ErgFileTimeline
+{
+    public:
+        ErgFileTimeline() : cursor(0) {}
+
+        void compile(const QList<ErgFilePoint> &points, const QList<ErgFileLap> &laps,
+                     bool interpolate, long duration);
+
+        int count() const { return x.count(); }
+
+        int segment(double at) const;            // index of the point at the start of the segment
+        double value(double at) const;           // ramped for erg, stepped for slope
+        int lap(double at) const;                // laps started at or before
+
+        // the next point after at where the value steps or
+        // starts to ramp, false if it doesn't change again
+        bool nextChange(double at, double &when, double &to) const;
+
+        const QVector<double> &power() const { return seconds; } // target each second, erg only
+
+    private:
+        bool interpolate;
+        QVector<double> x, val;
+        QVector<long> laps;
+        QVector<double> seconds;
+        mutable int cursor;
+};
+
 class ErgFile
 {
     public:
@@ -125,6 +160,10 @@ class ErgFile
         double gradientAt(double, int&); // return the gradient value for the passed meter
         bool locationAt  (double x, int& lapnum, geolocation &geoLoc, double &slope100); // location at meter
 
+        // look ahead for the next load/gradient change so controllers
+        // can send it early, false if nothing more to change
+        bool nextChange(double x, double &when, double &value);
+
         int nextLap(long);      // return the start value (erg - time(ms) or slope - distance(m)) for the next lap
         int currentLap(long);   // return the start value (erg - time(ms) or slope - distance(m)) for the current lap
 
@@ -160,6 +199,10 @@ class ErgFile
 
         void calculateMetrics(); // calculate IsoPower value for ErgFile
 
+        // rebuild the timeline after changing Points or Laps (calculateMetrics does this)
+        void compile();
+        const ErgFileTimeline &timeline() { if (compiled.count() != Points.count()) compile(); return compiled; }
+
         // Metrics for this workout
         double maxY;                // maximum Y value
         double CP;
@@ -169,6 +212,8 @@ class ErgFile
 
         Context *context;
 
+    private:
+        ErgFileTimeline compiled;
 };
 
 #endif
@@ -20,6 +20,7 @@
 // Abstract base class for Realtime device controllers
 #include "RealtimeData.h"
 #include "CalibrationData.h"
+#include "TelemetryBus.h"
 #include "TrainSidebar.h"
 
 #ifndef _GC_RealtimeController_h
@@ -57,6 +58,10 @@ public:
     virtual void getRealtimeData(RealtimeData &rtData); // update realtime data with current values
     virtual void pushRealtimeData(RealtimeData &rtData); // update realtime data with current values
 
+    // devices that publish telemetry as it arrives (ANT+), NULL if we
+    // can only poll with getRealtimeData
+    virtual TelemetryBus *telemetryBus() { return NULL; }
+
     // only relevant for Computrainer like devices
     virtual void setLoad(double) { return; }
     virtual void setGradient(double) { return; }
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2020 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TelemetryBus.h"
+#include <atomic>
+
+TelemetryBus::TelemetryBus() : head(0), receiver(NULL), member(NULL), pending(0)
+{
+    clock.start();
+}
+
+void
+TelemetryBus::publish(const RealtimeData &data, bool power)
+{
+    quint32 index = head.loadAcquire();
+    Slot &slot = ring[index & (Size-1)];
+
+    // mark as being written before we touch the sample
+    slot.sequence.fetchAndStoreOrdered(0);
+
+    slot.sample.timestamp = clock.elapsed();
+    slot.sample.power = power;
+    slot.sample.data = data;
+
+    // complete, then make it visible
+    slot.sequence.storeRelease(index + 1);
+    head.storeRelease(index + 1);
+
+    // let the receiver know, unless it has yet to pick up the last one
+    QObject *to = receiver.loadAcquire();
+    if (to && pending.testAndSetOrdered(0, 1)) QMetaObject::invokeMethod(to, member, Qt::QueuedConnection);
+}
+
+void
+TelemetryBus::setReceiver(QObject *to, const char *call)
+{
+    receiver.storeRelease(NULL);
+    member = call;
+    pending.storeRelease(0);
+    receiver.storeRelease(to);
+}
+
+bool
+TelemetryBus::read(quint32 index, TelemetrySample &sample) const
+{
+    const Slot &slot = ring[index & (Size-1)];
+
+    if (slot.sequence.loadAcquire() != index + 1) return false;
+    sample = slot.sample;
+
+    // if it changed whilst we were copying we got a torn sample
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.loadAcquire() == index + 1;
+}
+
+bool
+TelemetryBus::latest(TelemetrySample &sample) const
+{
+    // the producer may lap us whilst copying, so just try again
+    for (int tries=0; tries < 4; tries++) {
+        quint32 n = head.loadAcquire();
+        if (n == 0) return false;
+        if (read(n - 1, sample)) return true;
+    }
+    return false;
+}
+
+TelemetryBus::Reader::Reader(const TelemetryBus *bus) : bus(bus), cursor(0), missed(0)
+{
+    if (bus) cursor = bus->published();
+}
+
+void
+TelemetryBus::Reader::skip()
+{
+    if (bus) cursor = bus->published();
+}
+
+bool
+TelemetryBus::Reader::next(TelemetrySample &sample)
+{
+    if (!bus) return false;
+
+    while (1) {
+        quint32 n = bus->published();
+        if (cursor == n) return false;
+
+        // fallen more than a ring behind, skip to the oldest we still have
+        if (n - cursor > quint32(Size)) {
+            missed += (n - cursor) - Size;
+            cursor = n - Size;
+        }
+
+        if (bus->read(cursor, sample)) {
+            cursor++;
+            return true;
+        }
+
+        // overwritten under us, so we're behind; go round again
+        missed++;
+        cursor++;
+    }
+}
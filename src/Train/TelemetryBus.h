@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2020 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_TelemetryBus_h
+#define _GC_TelemetryBus_h 1
+#include "GoldenCheetah.h"
+
+#include "RealtimeData.h"
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QObject>
+#include <QElapsedTimer>
+
+struct TelemetrySample {
+    qint64 timestamp;       // msecs since the bus was created
+    bool power;             // published for a power data page
+    RealtimeData data;
+};
+
+//
+// A device thread publishes telemetry here as it arrives and any number of
+// consumers read it without ever blocking the device thread or each other.
+// A device with several sensors, e.g. an ANT+ stick, publishes for every
+// message it gets, so samples updated by a power data page are marked and
+// anything that wants only the power samples (W'bal, recording) skips the
+// rest.
+//
+// There is one producer per bus, the samples live in a fixed ring and each
+// slot carries a sequence number so a reader can tell if the slot was
+// overwritten whilst it was copying (a seqlock). A reader that falls more
+// than a ring behind skips to the oldest sample still held and counts
+// what it missed.
+//
+// A receiver on another thread, e.g. the train view, can ask to be told
+// when there is something new rather than polling. It gets a queued call
+// but never more than one at a time, so a busy gui can't build a queue,
+// and calls consumed() once it has read what it wanted.
+//
+class TelemetryBus
+{
+    public:
+
+        TelemetryBus();
+
+        // device thread only
+        void publish(const RealtimeData &data, bool power);
+
+        // the most recent sample, false if nothing published yet
+        bool latest(TelemetrySample &sample) const;
+
+        // how many have been published
+        quint32 published() const { return head.loadAcquire(); }
+
+        // the clock sample timestamps are taken from
+        qint64 elapsed() const { return clock.elapsed(); }
+
+        // tell receiver, by a queued call to member, when something is published
+        void setReceiver(QObject *receiver, const char *member);
+        void consumed() { pending.storeRelease(0); }
+
+        // consumers that want every sample, e.g. W'bal, keep a reader
+        class Reader {
+            public:
+                Reader(const TelemetryBus *bus = NULL); // starts after the latest sample
+
+                bool next(TelemetrySample &sample); // false when caught up
+                void skip(); // ignore everything published so far
+                quint32 dropped() const { return missed; }
+                bool attached() const { return bus != NULL; }
+
+            private:
+                const TelemetryBus *bus;
+                quint32 cursor, missed;
+        };
+
+    private:
+
+        bool read(quint32 index, TelemetrySample &sample) const;
+
+        enum { Size = 256 }; // power of two, ~5s at the busiest ANT+ rates
+
+        struct Slot {
+            Slot() : sequence(0) {}
+            QAtomicInteger<quint32> sequence; // index+1 when complete, 0 whilst writing
+            TelemetrySample sample;
+        };
+        Slot ring[Size];
+
+        QAtomicInteger<quint32> head;       // next index to write
+        QElapsedTimer clock;
+
+        QAtomicPointer<QObject> receiver;
+        const char *member;
+        QAtomicInteger<int> pending;        // a call is queued
+};
+
+#endif // _GC_TelemetryBus_h
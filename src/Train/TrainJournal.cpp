@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TrainJournal.h"
+#include <QDataStream>
+#include <QTextStream>
+#include <QFileInfo>
+#include <math.h>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// layout, all little endian
+//
+// header:  magic, version, record size, interval (msecs), start (msecs since epoch UTC)
+// record:  msecs, values[Fields], lap, checksum of the preceding bytes
+//
+static const quint32 JOURNAL_MAGIC = 0x47434a31; // "GCJ1"
+static const quint16 JOURNAL_VERSION = 1;
+static const int JOURNAL_HEADER_SIZE = 4 + 2 + 2 + 4 + 8;
+static const int JOURNAL_RECORD_SIZE = 8 + (8 * TrainJournal::Fields) + 4 + 2;
+
+TrainJournal::TrainJournal() {}
+
+TrainJournal::~TrainJournal()
+{
+    close();
+}
+
+bool
+TrainJournal::open(const QString &filename, const QDateTime &start, int interval)
+{
+    close();
+
+    // ours until closed
+    lock.reset(lockFor(filename));
+    if (lock.isNull()) return false;
+
+    file.setFileName(filename);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Unbuffered)) {
+        lock.reset();
+        return false;
+    }
+
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << JOURNAL_MAGIC << JOURNAL_VERSION << quint16(JOURNAL_RECORD_SIZE)
+        << qint32(interval) << qint64(start.toMSecsSinceEpoch());
+
+    if (file.write(header) != header.size()) {
+        file.close();
+        file.remove();
+        lock.reset();
+        return false;
+    }
+    checkpoint();
+    return true;
+}
+
+void
+TrainJournal::append(const Record &record)
+{
+    if (!file.isOpen()) return;
+
+    QByteArray bytes;
+    bytes.reserve(JOURNAL_RECORD_SIZE);
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+    out << record.msecs;
+    for (int i=0; i<Fields; i++) out << record.value[i];
+    out << record.lap;
+    out << quint16(qChecksum(bytes.constData(), bytes.size()));
+
+    // unbuffered so it's with the OS straight away, we only
+    // wait for the disk at a checkpoint
+    file.write(bytes);
+
+    if (synced.elapsed() >= JOURNAL_CHECKPOINT) checkpoint();
+}
+
+void
+TrainJournal::checkpoint()
+{
+    if (!file.isOpen()) return;
+
+    file.flush();
+#ifdef Q_OS_WIN
+    _commit(file.handle());
+#else
+    fsync(file.handle());
+#endif
+    synced.start();
+}
+
+void
+TrainJournal::close()
+{
+    if (!file.isOpen()) return;
+
+    checkpoint();
+    file.close();
+    lock.reset(); // unlocks
+}
+
+bool
+TrainJournal::read(const QString &filename, QDateTime &start, int &interval,
+                   QVector<Record> &records, QString &error)
+{
+    QFile in(filename);
+    if (!in.open(QFile::ReadOnly)) {
+        error = QObject::tr("cannot open %1").arg(filename);
+        return false;
+    }
+    QByteArray bytes = in.readAll();
+    in.close();
+
+    QDataStream stream(bytes);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+    quint32 magic = 0;
+    quint16 version = 0, size = 0;
+    qint32 rate = 0;
+    qint64 epoch = 0;
+    stream >> magic >> version >> size >> rate >> epoch;
+    if (bytes.size() < JOURNAL_HEADER_SIZE || magic != JOURNAL_MAGIC ||
+        version > JOURNAL_VERSION || size != JOURNAL_RECORD_SIZE) {
+        error = QObject::tr("%1 is not a train journal").arg(filename);
+        return false;
+    }
+    start = QDateTime::fromMSecsSinceEpoch(epoch);
+    interval = rate > 0 ? rate : 1000;
+
+    records.clear();
+    records.reserve((bytes.size() - JOURNAL_HEADER_SIZE) / JOURNAL_RECORD_SIZE);
+
+    // a torn record can only be at the tail, stop at the first bad one
+    for (int offset = JOURNAL_HEADER_SIZE; offset + JOURNAL_RECORD_SIZE <= bytes.size();
+         offset += JOURNAL_RECORD_SIZE) {
+
+        Record record;
+        quint16 checksum;
+        stream >> record.msecs;
+        for (int i=0; i<Fields; i++) stream >> record.value[i];
+        stream >> record.lap >> checksum;
+
+        if (checksum != qChecksum(bytes.constData() + offset, JOURNAL_RECORD_SIZE - 2)) break;
+        records << record;
+    }
+    return true;
+}
+
+bool
+TrainJournal::toCsv(const QString &journal, QString &csv, QString &error)
+{
+    QDateTime start;
+    int interval;
+    QVector<Record> records;
+    if (!read(journal, start, interval, records, error)) return false;
+
+    QFileInfo info(journal);
+    csv = info.absolutePath() + "/" + info.completeBaseName() + ".csv";
+
+    QFile out(csv);
+    if (!out.open(QFile::WriteOnly | QFile::Truncate)) {
+        error = QObject::tr("cannot write %1").arg(csv);
+        return false;
+    }
+
+    QTextStream stream(&out);
+    stream << "secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, slope, temp, interval, lrbalance, lte, rte, lps, rps, smo2, thb, o2hb, hhb, target\n";
+
+    // the csv reader needs a fixed recording interval, so every record
+    // goes in a slot of the journal's interval. The latest in a slot is
+    // kept, as we always did, but at device rate power and torque are
+    // averaged over the slot and a slot a sample missed holds the one
+    // before for up to a second. Longer gaps are pauses and left as is
+    bool devicerate = interval < 1000;
+    qint64 last = -1;
+    Record held;
+    for (int i=0; i<records.count(); i++) {
+
+        qint64 slot = qRound64(double(records[i].msecs) / double(interval));
+        if (slot <= last) continue;
+
+        // the last one in this slot
+        Record p = records[i];
+        double watts = p.value[Watts], nm = p.value[Nm];
+        int n = 1;
+        while (i+1 < records.count() && qRound64(double(records[i+1].msecs) / double(interval)) == slot) {
+            p = records[++i];
+            watts += p.value[Watts];
+            nm += p.value[Nm];
+            n++;
+        }
+        if (devicerate) {
+            p.value[Watts] = watts / n;
+            p.value[Nm] = nm / n;
+
+            if (last >= 0 && (slot - last) * interval <= 1000)
+                for (qint64 missed = last + 1; missed < slot; missed++) writeCsv(stream, missed * interval, held);
+        }
+        writeCsv(stream, slot * interval, p);
+        held = p;
+        last = slot;
+    }
+    stream.flush();
+    out.close();
+
+    // the ride time is taken from the filename, as it always was
+    Q_UNUSED(start);
+    return true;
+}
+
+void
+TrainJournal::writeCsv(QTextStream &stream, qint64 msecs, const Record &p)
+{
+    stream << QString::number(double(msecs) / 1000.0)
+           << "," << p.value[Cad]
+           << "," << p.value[Hr]
+           << "," << p.value[Km]
+           << "," << p.value[Kph]
+           << "," << p.value[Nm]
+           << "," << p.value[Watts]
+           << "," << QString::number(p.value[Alt], 'g', 20) // location needs the precision
+           << "," << QString::number(p.value[Lon], 'g', 20)
+           << "," << QString::number(p.value[Lat], 'g', 20)
+           << "," // headwind
+           << "," // slope
+           << "," // temp
+           << "," << p.lap
+           << "," << p.value[LRBalance]
+           << "," << p.value[LTE]
+           << "," << p.value[RTE]
+           << "," << p.value[LPS]
+           << "," << p.value[RPS]
+           << "," << p.value[SmO2]
+           << "," << p.value[tHb]
+           << "," << p.value[O2Hb]
+           << "," << p.value[HHb]
+           << "," << p.value[Load]
+           << "," << "\n";
+}
+
+QLockFile *
+TrainJournal::lockFor(const QString &journal)
+{
+    // a session can run for hours, so only a dead owner makes it stale
+    QLockFile *returning = new QLockFile(journal + ".lock");
+    returning->setStaleLockTime(0);
+    if (returning->tryLock(0)) return returning;
+    delete returning;
+    return NULL;
+}
+
+QStringList
+TrainJournal::interrupted(const QDir &records)
+{
+    QStringList returning;
+    foreach(QString name, records.entryList(QStringList() << QString("*.%1").arg(JOURNAL_SUFFIX), QDir::Files, QDir::Name))
+        returning << records.absoluteFilePath(name);
+    return returning;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2021 Mark Liversedge (liversedge@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_TrainJournal_h
+#define _GC_TrainJournal_h 1
+#include "GoldenCheetah.h"
+
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QLockFile>
+#include <QScopedPointer>
+#include <QTextStream>
+
+//
+// Train sessions are recorded to an append-only binary journal of fixed
+// size records, each with its own checksum. Records are written unbuffered
+// as they arrive and the file is synced to disk every few seconds, so if
+// we crash (or the power goes) at most the last checkpoint is lost and any
+// torn record at the tail is simply discarded on recovery.
+//
+// When the session ends the journal is converted to the usual GoldenCheetah
+// CSV (alongside the .rr and .vo2 files) for import and then removed; any
+// journal still present in the records folder was interrupted and is
+// recovered the same way.
+//
+// A journal is locked (a .lock file alongside it) whilst it is being
+// written, so another GoldenCheetah running on the same athlete doesn't
+// recover a session that is still going. Anyone converting it takes the
+// lock too. A lock left by a process that died is stale and is taken.
+//
+// When the power device publishes every sample the journal keeps each power
+// sample at its own time and the CSV resamples them onto the journal's
+// interval (DEVICERATE); otherwise one a second.
+//
+#define JOURNAL_CHECKPOINT 5000 // msecs between fsync
+#define JOURNAL_SUFFIX     "gcj"
+
+class TrainJournal
+{
+    public:
+
+        // the values we record, in file order
+        enum { Cad=0, Hr, Km, Kph, Nm, Watts, Alt, Lon, Lat,
+               LRBalance, LTE, RTE, LPS, RPS, SmO2, tHb, O2Hb, HHb, Load,
+               Fields };
+
+        struct Record {
+            Record() : msecs(0), lap(0) { for (int i=0; i<Fields; i++) value[i] = 0; }
+            qint64 msecs;           // session time
+            double value[Fields];
+            qint32 lap;
+        };
+
+        TrainJournal();
+        ~TrainJournal();
+
+        // start a new journal, interval is the sample rate we expect
+        // and is the rate used when converting
+        bool open(const QString &filename, const QDateTime &start, int interval);
+        bool isOpen() const { return file.isOpen(); }
+        QString fileName() const { return file.fileName(); }
+
+        void append(const Record &record);
+        void checkpoint();      // flush and sync to disk
+        void close();
+
+        // read back all the intact records
+        static bool read(const QString &filename, QDateTime &start, int &interval,
+                         QVector<Record> &records, QString &error);
+
+        // convert to GoldenCheetah CSV for import, filename is returned
+        static bool toCsv(const QString &journal, QString &csv, QString &error);
+
+        // journals left behind by a session that never finished
+        static QStringList interrupted(const QDir &records);
+
+        // the lock held whilst writing or converting a journal
+        static QLockFile *lockFor(const QString &journal); // NULL if in use
+
+    private:
+
+        static void writeCsv(QTextStream &stream, qint64 msecs, const Record &record);
+
+        QFile file;
+        QScopedPointer<QLockFile> lock;
+        QElapsedTimer synced;
+};
+
+#endif // _GC_TrainJournal_h
@@ -48,6 +48,7 @@
 #include "ErgofitController.h"
 #include "DaumController.h"
 #include "ANTlocalController.h"
+#include "ANTReplayController.h"
 #include "NullController.h"
 #ifdef QT_BLUETOOTH_LIB
 #include "BT40Controller.h"
@@ -334,8 +335,8 @@ TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(contex
     lap_time = QTime();
     lap_elapsed_msec = 0;
 
-    rrFile = recordFile = vo2File = NULL;
-    lastRecordSecs = 0;
+    rrFile = vo2File = NULL;
+    lastRecordMsecs = -1;
     status = 0;
     setStatusFlags(RT_MODE_ERGO);         // ergo mode by default
     mode = ERG;
@@ -348,8 +349,10 @@ TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(contex
     spdcount = 0;
     lodcount = 0;
     wbalr = wbal = 0;
+    wbalLast = -1;
+    setNowSecs = -1;
     load_msecs = total_msecs = lap_msecs = 0;
-    displayWorkoutDistance = displayDistance = displayPower = displayHeartRate =
+    displayWorkoutDistance = displayDistance = displayPower = displayTorque = displayHeartRate =
     displaySpeed = displayCadence = slope = load = 0;
     displaySMO2 = displayTHB = displayO2HB = displayHHB = 0;
     displayLRBalance = displayLTE = displayRTE = displayLPS = displayRPS = 0;
@@ -362,6 +365,9 @@ TrainSidebar::TrainSidebar(Context *context) : GcWindow(context), context(contex
     configChanged(CONFIG_APPEARANCE | CONFIG_DEVICES | CONFIG_ZONES); // will reset the workout tree
     setLabels();
 
+    // any sessions we didn't finish last time?
+    QTimer::singleShot(0, this, SLOT(recoverJournals()));
+
     // capture keyboard events so we can control during
     // a workout using basic keyboard controls
     context->mainWindow->installEventFilter(this);
@@ -661,8 +667,9 @@ TrainSidebar::configChanged(qint32)
 #endif
         } else if (Devices.at(i).type == DEV_NULL) {
             Devices[i].controller = new NullController(this, &Devices[i]);
-        } else if (Devices.at(i).type == DEV_ANTLOCAL) {
-            Devices[i].controller = new ANTlocalController(this, &Devices[i]);
+        } else if (Devices.at(i).type == DEV_ANTLOCAL || Devices.at(i).type == DEV_ANTREPLAY) {
+            if (Devices.at(i).type == DEV_ANTREPLAY) Devices[i].controller = new ANTReplayController(this, &Devices[i]);
+            else Devices[i].controller = new ANTlocalController(this, &Devices[i]);
             // connect slot for receiving remote control commands
             connect(Devices[i].controller, SIGNAL(remoteControl(uint16_t)), this, SLOT(remoteControl(uint16_t)));
             // connect slot for receiving rrData
@@ -1221,8 +1228,7 @@ void TrainSidebar::Start()       // when start button is pressed
         session_elapsed_msec = 0;
         lap_time.start();
         lap_elapsed_msec = 0;
-        wbalr = 0;
-        wbal = WPRIME;
+        resetWbal();
         lapAudioThisLap = true;
 
         //reset all calibration data
@@ -1249,29 +1255,26 @@ void TrainSidebar::Start()       // when start button is pressed
             QDateTime now = QDateTime::currentDateTime();
 
             // setup file
-            QString filename = now.toString(QString("yyyy_MM_dd_hh_mm_ss")) + QString(".csv");
+            QString filename = now.toString(QString("yyyy_MM_dd_hh_mm_ss")) + QString("." JOURNAL_SUFFIX);
 
             if (!context->athlete->home->records().exists())
                 context->athlete->home->createAllSubdirs();
 
             QString fulltarget = context->athlete->home->records().canonicalPath() + "/" + filename;
 
-            if (recordFile) delete recordFile;
-            recordFile = new QFile(fulltarget);
-            lastRecordSecs = 0;
-            if (!recordFile->open(QFile::WriteOnly | QFile::Truncate)) {
+            // record every sample if the power device publishes them
+            TelemetryBus *bus = powerBus();
+            journalReader = TelemetryBus::Reader(bus);
+            lastRecordMsecs = -1;
+            if (!journal.open(fulltarget, now, bus ? DEVICERATE : SAMPLERATE)) {
                 clearStatusFlags(RT_RECORDING);
             } else {
-
-                // CSV File header
-
-                QTextStream recordFileStream(recordFile);
-                recordFileStream << "secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, slope, temp, interval, lrbalance, lte, rte, lps, rps, smo2, thb, o2hb, hhb, target\n";
-
                 disk_timer->start(SAMPLERATE);  // start screen
             }
         }
         gui_timer->start(REFRESHRATE);      // start recording
+        guiPeriod.invalidate();
+        listenTelemetry(true);
 
         emit setNotification(tr("Starting.."), 2);
     }
@@ -1291,6 +1294,9 @@ void TrainSidebar::Pause()        // pause capture to recalibrate
         clearStatusFlags(RT_PAUSED);
         foreach(int dev, activeDevices) Devices[dev].controller->restart();
         gui_timer->start(REFRESHRATE);
+        guiPeriod.invalidate();
+        listenTelemetry(true);
+        restartWbal();
         if (status & RT_RECORDING) disk_timer->start(SAMPLERATE);
         load_period.restart();
         if (status & RT_WORKOUT) load_timer->start(LOADRATE);
@@ -1311,6 +1317,7 @@ void TrainSidebar::Pause()        // pause capture to recalibrate
         foreach(int dev, activeDevices) Devices[dev].controller->pause();
         setStatusFlags(RT_PAUSED);
         gui_timer->stop();
+        listenTelemetry(false);
         if (status & RT_RECORDING) disk_timer->stop();
         if (status & RT_WORKOUT) load_timer->stop();
         load_msecs += load_period.restart();
@@ -1328,6 +1335,56 @@ void TrainSidebar::Pause()        // pause capture to recalibrate
     }
 }
 
+void TrainSidebar::resetWbal()
+{
+    wbalr = 0;
+    wbal = WPRIME;
+
+    // follow the power device's samples if it publishes them
+    wbalReader = TelemetryBus::Reader(powerBus());
+    restartWbal();
+}
+
+void TrainSidebar::restartWbal()
+{
+    // the first sample is measured from now
+    TelemetryBus *bus = powerBus();
+    wbalReader.skip();
+    wbalLast = bus ? bus->elapsed() : -1;
+}
+
+void TrainSidebar::listenTelemetry(bool listen)
+{
+    foreach(int dev, activeDevices) {
+        TelemetryBus *bus = Devices[dev].controller->telemetryBus();
+        if (bus) bus->setReceiver(listen ? this : NULL, "telemetryPublished");
+    }
+}
+
+void TrainSidebar::telemetryPublished()
+{
+    foreach(int dev, activeDevices) {
+        TelemetryBus *bus = Devices[dev].controller->telemetryBus();
+        if (bus) bus->consumed();
+    }
+
+    // as it arrives, but no faster than the displays can follow
+    // the timer still updates when devices go quiet
+    if (!gui_timer->isActive()) return;
+    if (guiPeriod.isValid() && guiPeriod.elapsed() < TELEMETRYRATE) return;
+    guiUpdate();
+}
+
+TelemetryBus *TrainSidebar::powerBus()
+{
+    // virtual power is worked out from speed by the controller, so there
+    // are no power pages to follow and watts are polled as before
+    if (wattsTelemetry != -1 && wattsTelemetry < Devices.count() && Devices[wattsTelemetry].controller &&
+        Devices[wattsTelemetry].postProcess == 0)
+        return Devices[wattsTelemetry].controller->telemetryBus();
+    return NULL;
+}
+
 void TrainSidebar::Stop(int deviceStatus)        // when stop button is pressed
 {
     if ((status&RT_RUNNING) == 0) return;
@@ -1371,7 +1428,7 @@ void TrainSidebar::Stop(int deviceStatus)        // when stop button is pressed
         disk_timer->stop();
 
         // close and reset File
-        recordFile->close();
+        journal.close();
 
         // close rrFile
         if (rrFile) {
@@ -1391,18 +1448,10 @@ void TrainSidebar::Stop(int deviceStatus)        // when stop button is pressed
 
         if(deviceStatus == DEVICE_ERROR)
         {
-            recordFile->remove();
+            QFile::remove(journal.fileName());
         }
         else {
-            // add to the view - using basename ONLY
-            QString name;
-            name = recordFile->fileName();
-
-            QList<QString> list;
-            list.append(name);
-
-            RideImportWizard *dialog = new RideImportWizard (list, context);
-            dialog->process(); // do it!
+            importJournals(QStringList() << journal.fileName());
         }
 
         // cancel recording
@@ -1438,8 +1487,7 @@ void TrainSidebar::Stop(int deviceStatus)        // when stop button is pressed
     spdcount = 0;
     lodcount = 0;
     displayWorkoutLap = displayLap =0;
-    wbalr = 0;
-    wbal = WPRIME;
+    resetWbal();
     session_elapsed_msec = 0;
     session_time.restart();
     lap_elapsed_msec = 0;
@@ -1460,6 +1508,7 @@ void TrainSidebar::Stop(int deviceStatus)        // when stop button is pressed
 void TrainSidebar::updateData(RealtimeData &rtData)
 {
     displayPower = rtData.getWatts();
+    displayTorque = rtData.getTorque();
     displayCadence = rtData.getCadence();
     displayHeartRate = rtData.getHr();
     displaySpeed = rtData.getSpeed();
@@ -1523,6 +1572,8 @@ void TrainSidebar::Connect()
     }
     setStatusFlags(RT_CONNECTED);
     gui_timer->start(REFRESHRATE);
+    guiPeriod.invalidate();
+    listenTelemetry(true);
 
     emit setNotification(tr("Connected.."), 2);
 }
@@ -1544,6 +1595,7 @@ void TrainSidebar::Disconnect()
     clearStatusFlags(RT_CONNECTED);
 
     gui_timer->stop();
+    listenTelemetry(false);
 
     emit setNotification(tr("Disconnected.."), 2);
 }
@@ -1624,6 +1676,11 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
             // and exit.  Nothing else to do until we finish calibrating
             return;
         } else {
+            // called by the timer and as devices publish, so use the real interval
+            double secs = REFRESHRATE / 1000.00;
+            if (guiPeriod.isValid()) secs = qMin(1.00, guiPeriod.restart() / 1000.00);
+            else guiPeriod.start();
+
             rtData.setLoad(load); // always set load..
             rtData.setSlope(slope); // always set load..
             rtData.setAltitude(displayAltitude); // always set display altitude
@@ -1651,7 +1708,7 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
 					// to within defined limits
 				}
 
-                if (Devices[dev].type == DEV_ANTLOCAL || Devices[dev].type == DEV_NULL) {
+                if (Devices[dev].type == DEV_ANTLOCAL || Devices[dev].type == DEV_ANTREPLAY || Devices[dev].type == DEV_NULL) {
                     rtData.setHb(local.getSmO2(), local.gettHb()); //only moxy data from ant and robot devices right now
                 }
 
@@ -1677,6 +1734,7 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
                 }
                 if (dev == wattsTelemetry) {
                     rtData.setWatts(local.getWatts());
+                    rtData.setTorque(local.getTorque());
                     rtData.setAltWatts(local.getAltWatts());
                     rtData.setLRBalance(local.getLRBalance());
                     rtData.setLTE(local.getLTE());
@@ -1705,7 +1763,7 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
                 displaySpeed = ret.v;
                 distanceTick = ret.d;
             } else {
-                distanceTick = displaySpeed / (5 * 3600); // assumes 200ms refreshrate
+                distanceTick = displaySpeed * secs / 3600;
             }
 
             // only update time & distance if actively running (not just connected, and not running but paused)
@@ -1833,6 +1891,7 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
 
             // local stuff ...
             displayPower = rtData.getWatts();
+            displayTorque = rtData.getTorque();
             displayCadence = rtData.getCadence();
             displayHeartRate = rtData.getHr();
             displaySpeed = rtData.getSpeed();
@@ -1860,9 +1919,32 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
             // using Dave Waterworth's reformulation
             double TAU = appsettings->cvalue(context->athlete->cyclist, GC_WBALTAU, 300).toInt();
 
-            // any watts expended in last 200msec?
-            double JOULES = double(rtData.getWatts() - FTP) / 5.00f;
-            if (JOULES < 0) JOULES = 0;
+            double JOULES = 0;
+            if (wbalReader.attached()) {
+
+                // the power device publishes every sample, so integrate
+                // over each of them rather than sampling one every 200ms
+                // the first is measured from when we (re)started and
+                // a sample held through a dropout counts for a second
+                // other sensors on the same device don't count
+                TelemetrySample sample;
+                while (wbalReader.next(sample)) {
+                    if (!sample.power) continue;
+
+                    double sampleSecs = qMin(1.00, (sample.timestamp - wbalLast) / 1000.00);
+                    wbalLast = sample.timestamp;
+                    if (status&RT_PAUSED) continue; // nothing expended whilst paused
+
+                    double joules = double(sample.data.getWatts() - FTP) * sampleSecs;
+                    if (joules > 0) JOULES += joules;
+                }
+
+            } else if ((status&RT_PAUSED) == 0) {
+
+                // any watts expended since the last update?
+                JOULES = double(rtData.getWatts() - FTP) * secs;
+                if (JOULES < 0) JOULES = 0;
+            }
 
             // running total of replenishment
             wbalr += JOULES * exp((total_msecs/1000.00f) / TAU);
@@ -1882,7 +1964,9 @@ void TrainSidebar::guiUpdate()           // refreshes the telemetry
             // With this, it will now call tick just about every second
             long rmsecs = round((rtData.getMsecs() + 99) / 100) * 100;
             // Test for <= 100ms
-            if (!(status&RT_WORKOUT) && ((rmsecs % 1000) <= 100)) {
+            // Updates can now be more frequent, so only once a second
+            if (!(status&RT_WORKOUT) && ((rmsecs % 1000) <= 100) && rmsecs/1000 != setNowSecs) {
+                setNowSecs = rmsecs/1000;
                 context->notifySetNow(rtData.getMsecs());
             }
         }
@@ -1949,80 +2033,112 @@ void TrainSidebar::warnnoConfig()
     QMessageBox::warning(this, tr("No Devices Configured"), tr("Please configure a device in Preferences."));
 }
 
-template<class T, typename T_GetMethod, typename T_SetMethod, typename T_arg>
-struct ScopedOp
-{
-    T* m_pt;
-    T_SetMethod m_setMethod;
-    T_arg m_argSave;
-
-    ScopedOp(T* pt, T_GetMethod getMethod, T_SetMethod setMethod, T_arg argNew) : m_pt(pt), m_setMethod(setMethod) {
-        m_argSave = (m_pt->*getMethod)();
-        (m_pt->*m_setMethod)(argNew);
-    }
-
-    virtual ~ScopedOp() { (m_pt->*m_setMethod)(m_argSave); }
-};
-
-struct ScopedPrecision : ScopedOp<QTextStream, int (QTextStream::*)() const, void (QTextStream::*)(int), int> {
-    ScopedPrecision(QTextStream* pc, int tempPrecision) : ScopedOp::ScopedOp(pc, &QTextStream::realNumberPrecision, &QTextStream::setRealNumberPrecision, tempPrecision) {}
-};
-
 //----------------------------------------------------------------------
 // DISK UPDATE FUNCTIONS
 //----------------------------------------------------------------------
 void TrainSidebar::diskUpdate()
 {
-    int  secs;
-
-    long torq = 0;
-    QTextStream recordFileStream(recordFile);
-
     if (calibrating) return;
 
-    // convert from milliseconds to secondes
     total_msecs = session_elapsed_msec + session_time.elapsed();
-    secs = round(total_msecs / 1000.0);
 
-    if (secs <= lastRecordSecs) return; // Avoid duplicates
-    lastRecordSecs = secs;
+    TrainJournal::Record record;
+    record.msecs = total_msecs;
+    record.value[TrainJournal::Cad] = displayCadence;
+    record.value[TrainJournal::Hr] = displayHeartRate;
+    record.value[TrainJournal::Km] = displayDistance;
+    record.value[TrainJournal::Kph] = displaySpeed;
+    record.value[TrainJournal::Nm] = displayTorque;
+    record.value[TrainJournal::Watts] = displayPower;
+    record.value[TrainJournal::Alt] = displayAltitude;
+    record.value[TrainJournal::Lon] = displayLongitude;
+    record.value[TrainJournal::Lat] = displayLatitude;
+    record.value[TrainJournal::LRBalance] = displayLRBalance;
+    record.value[TrainJournal::LTE] = displayLTE;
+    record.value[TrainJournal::RTE] = displayRTE;
+    record.value[TrainJournal::LPS] = displayLPS;
+    record.value[TrainJournal::RPS] = displayRPS;
+    record.value[TrainJournal::SmO2] = displaySMO2;
+    record.value[TrainJournal::tHb] = displayTHB;
+    record.value[TrainJournal::O2Hb] = displayO2HB;
+    record.value[TrainJournal::HHb] = displayHHB;
+    record.value[TrainJournal::Load] = load;
+    record.lap = displayLap + displayWorkoutLap;
+
+    TelemetryBus *bus = journalReader.attached() ? powerBus() : NULL;
+    if (bus == NULL) {
+
+        // one record per update
+        if (record.msecs/1000 <= lastRecordMsecs/1000) return; // Avoid duplicates
+        lastRecordMsecs = record.msecs;
+        journal.append(record);
+        return;
+    }
 
-    // GoldenCheetah CVS Format "secs, cad, hr, km, kph, nm, watts, alt, lon, lat, headwind, slope, temp, interval, lrbalance, lte, rte, lps, rps, smo2, thb, o2hb, hhb\n";
+    // every power sample the device published since last time, the
+    // rest of the record is as displayed, with distance taken back
+    // at the current speed so it doesn't move in steps. The journal
+    // is resampled onto DEVICERATE when it is imported, see toCsv()
+    qint64 now = bus->elapsed();
+    double km = displayDistance;
+    TelemetrySample sample;
+    while (journalReader.next(sample)) {
 
-    recordFileStream    << secs
-                        << "," << displayCadence
-                        << "," << displayHeartRate
-                        << "," << displayDistance
-                        << "," << displaySpeed
-                        << "," << torq
-                        << "," << displayPower;
+        if (!sample.power) continue; // other sensors on the same device
 
-    // QTextStream default precision is 6, location data needs much more than that.
-    // Avoid extra precision for other fields since it isn't needed and would grow
-    // the intermediate file for no reason.
-    {
-        ScopedPrecision tempPrecision(&recordFileStream, 20);
-
-        recordFileStream << "," << displayAltitude
-                         << "," << displayLongitude
-                         << "," << displayLatitude;
-    }
-
-    recordFileStream    << "," // headwind
-                        << "," // slope
-                        << "," // temp
-                        << "," << (displayLap + displayWorkoutLap)
-                        << "," << displayLRBalance
-                        << "," << displayLTE
-                        << "," << displayRTE
-                        << "," << displayLPS
-                        << "," << displayRPS
-                        << "," << displaySMO2
-                        << "," << displayTHB
-                        << "," << displayO2HB
-                        << "," << displayHHB
-                        << "," << load
-                        << "," << "\n";
+        qint64 msecs = total_msecs - (now - sample.timestamp);
+        if (msecs <= lastRecordMsecs) continue; // whilst paused or calibrating
+        lastRecordMsecs = record.msecs = msecs;
+
+        record.value[TrainJournal::Km] = qMax(0.0, km - displaySpeed * double(total_msecs - msecs) / 3600000.0);
+        record.value[TrainJournal::Watts] = sample.data.getWatts();
+        record.value[TrainJournal::Nm] = sample.data.getTorque();
+        record.value[TrainJournal::LRBalance] = sample.data.getLRBalance();
+        record.value[TrainJournal::LTE] = sample.data.getLTE();
+        record.value[TrainJournal::RTE] = sample.data.getRTE();
+        record.value[TrainJournal::LPS] = sample.data.getLPS();
+        record.value[TrainJournal::RPS] = sample.data.getRPS();
+        if (rpmTelemetry == wattsTelemetry) record.value[TrainJournal::Cad] = sample.data.getCadence();
+        if (bpmTelemetry == wattsTelemetry) record.value[TrainJournal::Hr] = sample.data.getHr();
+        if (kphTelemetry == wattsTelemetry) record.value[TrainJournal::Kph] = sample.data.getSpeed();
+
+        journal.append(record);
+    }
+}
+
+void TrainSidebar::importJournals(QStringList journals)
+{
+    // convert to csv and import, the .rr and .vo2 files
+    // share the name so they come along too
+    QList<QString> list;
+    foreach(QString name, journals) {
+
+        // still being written by someone else, or they got there first
+        QScopedPointer<QLockFile> lock(TrainJournal::lockFor(name));
+        if (lock.isNull() || !QFile::exists(name)) continue;
+
+        QString csv, error;
+        if (TrainJournal::toCsv(name, csv, error)) {
+            QFile::remove(name);
+            list.append(csv);
+        } else {
+            qDebug()<<"train journal:"<<error;
+        }
+    }
+
+    if (list.count()) {
+        RideImportWizard *dialog = new RideImportWizard (list, context);
+        dialog->process(); // do it!
+    }
+}
+
+void TrainSidebar::recoverJournals()
+{
+    QStringList journals;
+    foreach(QString name, TrainJournal::interrupted(context->athlete->home->records()))
+        if (!journal.isOpen() || name != journal.fileName()) journals << name;
+
+    importJournals(journals);
 }
 
 //----------------------------------------------------------------------
@@ -2817,8 +2933,8 @@ TrainSidebar::remoteControl(uint16_t command)
 // HRV R-R data received
 void TrainSidebar::rrData(uint16_t  rrtime, uint8_t count, uint8_t bpm)
 {
-    if (status&RT_RECORDING && rrFile == NULL && recordFile != NULL) {
-        QString rrfile = recordFile->fileName().replace("csv", "rr");
+    if (status&RT_RECORDING && rrFile == NULL && journal.isOpen()) {
+        QString rrfile = journal.fileName().replace("." JOURNAL_SUFFIX, ".rr");
         //fprintf(stderr, "First r-r, need to open file %s\n", rrfile.toStdString().c_str()); fflush(stderr);
 
         // setup the rr file
@@ -2850,8 +2966,8 @@ void TrainSidebar::rrData(uint16_t  rrtime, uint8_t count, uint8_t bpm)
 // VO2 Measurement data received
 void TrainSidebar::vo2Data(double rf, double rmv, double vo2, double vco2, double tv, double feo2)
 {
-    if (status&RT_RECORDING && vo2File == NULL && recordFile != NULL) {
-        QString vo2filename = recordFile->fileName().replace("csv", "vo2");
+    if (status&RT_RECORDING && vo2File == NULL && journal.isOpen()) {
+        QString vo2filename = journal.fileName().replace("." JOURNAL_SUFFIX, ".vo2");
 
         // setup the rr file
         vo2File = new QFile(vo2filename);
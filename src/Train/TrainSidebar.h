@@ -22,6 +22,8 @@
 
 #include "Context.h"
 #include "RealtimeData.h"
+#include "TelemetryBus.h"
+#include "TrainJournal.h"
 #include "RealtimePlot.h"
 #include "DeviceConfiguration.h"
 #include "DeviceTypes.h"
@@ -68,8 +70,10 @@
 
 // msecs constants for timers
 #define REFRESHRATE    200 // screen refresh in milliseconds
+#define TELEMETRYRATE  50  // fastest screen refresh as devices publish telemetry
 #define STREAMRATE     200 // rate at which we stream updates to remote peer
 #define SAMPLERATE     1000 // disk update in milliseconds
+#define DEVICERATE     250  // recorded sample rate when the power device publishes every sample
 #define LOADRATE       1000 // rate at which load is adjusted
 
 // device treeview node types
@@ -195,7 +199,9 @@ class TrainSidebar : public GcWindow
 
         // Timed actions
         void guiUpdate();           // refreshes the telemetry
-        void diskUpdate();          // writes to CSV file
+        void telemetryPublished();  // a device published telemetry (see TelemetryBus)
+        void diskUpdate();          // writes to the journal
+        void recoverJournals();     // import sessions interrupted by a crash
         void loadUpdate();          // sets Load on CT like devices
 
         // When no config has been setup
@@ -254,7 +260,7 @@ class TrainSidebar : public GcWindow
         // updated with a RealtimeData object either from
         // update() - from a push device (quarqd ANT+)
         // Device->getRealtimeData() - from a pull device (Computrainer)
-        double displayPower, displayHeartRate, displayCadence, displaySpeed;
+        double displayPower, displayTorque, displayHeartRate, displayCadence, displaySpeed;
         double displayLRBalance, displayLTE, displayRTE, displayLPS, displayRPS;
         double displaySMO2, displayTHB, displayO2HB, displayHHB;
         double displayDistance, displayWorkoutDistance;
@@ -276,8 +282,10 @@ class TrainSidebar : public GcWindow
         int status;
         int displaymode;
 
-        QFile *recordFile;      // where we record!
-        int lastRecordSecs;     // to avoid duplicates
+        TrainJournal journal;   // where we record!
+        TelemetryBus::Reader journalReader; // samples from the power device
+        qint64 lastRecordMsecs; // to avoid duplicates
+        void importJournals(QStringList);
         QFile *rrFile;          // r-r records, if any received.
         QFile *vo2File;         // vo2 records, if any received.
         ErgFile *ergFile;       // workout file
@@ -314,6 +322,20 @@ class TrainSidebar : public GcWindow
         QSharedPointer<QFileSystemWatcher> watcher;
         bool calibrating;
         double wbalr, wbal;
+
+        // W'bal integrated over every sample when the power
+        // device publishes them (see TelemetryBus)
+        void resetWbal();
+        void restartWbal(); // skip what was published whilst paused
+        TelemetryBus *powerBus();
+        TelemetryBus::Reader wbalReader;
+        qint64 wbalLast;
+
+        // displays are updated as devices publish, not just on
+        // the timer, so updates use the real interval between them
+        void listenTelemetry(bool listen);
+        QElapsedTimer guiPeriod;
+        long setNowSecs;
 };
 
 class MultiDeviceDialog : public QDialog
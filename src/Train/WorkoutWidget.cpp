@@ -125,6 +125,7 @@ WorkoutWidget::updateErgFile(ErgFile *f)
     }
 
     f->Laps = laps_;
+    f->compile();
 
     // update METADATA too
     // XXX missing!
@@ -1495,6 +1496,7 @@ WorkoutWidget::save()
         ergFile->Duration = p->x * 1000; // whatever the last is
     }
     ergFile->Laps = laps_;
+    ergFile->compile();
 
     //
     // SAVE